@@ -23,8 +23,10 @@ LOCAL_SRC_FILES := ../../engine/assets/BmfLoader.cpp \
 	../../engine/assets/Cache.cpp \
     ../../engine/assets/ColladaLoader.cpp \
     ../../engine/assets/CueLoader.cpp \
+    ../../engine/assets/DdsLoader.cpp \
 	../../engine/assets/GltfLoader.cpp \
     ../../engine/assets/ImageLoader.cpp \
+    ../../engine/assets/KtxLoader.cpp \
     ../../engine/assets/MtlLoader.cpp \
     ../../engine/assets/ObjLoader.cpp \
     ../../engine/assets/ParticleSystemLoader.cpp \
@@ -63,11 +65,16 @@ LOCAL_SRC_FILES := ../../engine/assets/BmfLoader.cpp \
     ../../engine/graphics/opengl/android/OGLRenderDeviceAndroid.cpp \
     ../../engine/graphics/opengl/OGLBlendState.cpp \
     ../../engine/graphics/opengl/OGLBuffer.cpp \
+    ../../engine/graphics/opengl/OGLStreamBuffer.cpp \
 	../../engine/graphics/opengl/OGLDepthStencilState.cpp \
+	../../engine/graphics/opengl/OGLPipelineState.cpp \
     ../../engine/graphics/opengl/OGLRenderDevice.cpp \
 	../../engine/graphics/opengl/OGLRenderTarget.cpp \
     ../../engine/graphics/opengl/OGLShader.cpp \
     ../../engine/graphics/opengl/OGLTexture.cpp \
+    ../../engine/graphics/software/SoftwareRasterizer.cpp \
+    ../../engine/graphics/software/SoftwareRenderDevice.cpp \
+    ../../engine/graphics/software/SoftwareTexture.cpp \
     ../../engine/graphics/BlendState.cpp \
     ../../engine/graphics/Buffer.cpp \
 	../../engine/graphics/DepthStencilState.cpp \
@@ -76,6 +83,9 @@ LOCAL_SRC_FILES := ../../engine/assets/BmfLoader.cpp \
 	../../engine/graphics/RenderTarget.cpp \
     ../../engine/graphics/Shader.cpp \
     ../../engine/graphics/Texture.cpp \
+    ../../engine/graphics/TextureAtlas.cpp \
+    ../../engine/graphics/TextureStreamer.cpp \
+    ../../engine/graphics/FrameCapture.cpp \
     ../../engine/gui/BMFont.cpp \
     ../../engine/gui/TTFont.cpp \
     ../../engine/gui/Widget.cpp \
@@ -97,6 +107,7 @@ LOCAL_SRC_FILES := ../../engine/assets/BmfLoader.cpp \
     ../../engine/localization/Localization.cpp \
     ../../engine/math/MathUtils.cpp \
     ../../engine/math/Matrix.cpp \
+    ../../engine/math/Batch.cpp \
     ../../engine/network/Client.cpp \
     ../../engine/network/Network.cpp \
 	../../engine/network/Server.cpp \
@@ -106,6 +117,7 @@ LOCAL_SRC_FILES := ../../engine/assets/BmfLoader.cpp \
     ../../engine/scene/Camera.cpp \
     ../../engine/scene/Component.cpp \
     ../../engine/scene/Layer.cpp \
+    ../../engine/scene/InstanceBatch.cpp \
     ../../engine/scene/Light.cpp \
     ../../engine/scene/ParticleSystem.cpp \
     ../../engine/scene/Scene.cpp \
@@ -117,6 +129,7 @@ LOCAL_SRC_FILES := ../../engine/assets/BmfLoader.cpp \
     ../../engine/scene/TextRenderer.cpp \
     ../../engine/storage/FileSystem.cpp \
     ../../engine/utils/Log.cpp \
+    ../../engine/utils/Trace.cpp \
     ../../engine/utils/Utils.cpp
 
 include $(BUILD_STATIC_LIBRARY)
@@ -4,7 +4,10 @@
 #include <stdexcept>
 #include "Bundle.hpp"
 #include "Cache.hpp"
+#include "ImageLoader.hpp"
 #include "Loader.hpp"
+#include "../core/Engine.hpp"
+#include "../graphics/TextureAtlas.hpp"
 #include "../utils/Json.hpp"
 
 namespace ouzel
@@ -44,13 +47,29 @@ namespace ouzel
         {
             const json::Data data(fileSystem.readFile(filename));
 
+            std::vector<std::string> atlasImages;
+            bool atlasMipmaps = true;
+
             for (const json::Value& asset : data["assets"])
             {
                 const auto file = asset["filename"].as<std::string>();
-                const auto name = asset.hasMember("name") ? asset["name"].as<std::string>() : file;
                 const auto mipmaps = asset.hasMember("mipmaps") ? asset["mipmaps"].as<bool>() : true;
-                loadAsset(asset["type"].as<std::uint32_t>(), name, file, mipmaps);
+                const auto type = asset["type"].as<std::uint32_t>();
+
+                // images marked for the atlas are packed together after the loop
+                if (type == Loader::Image && asset.hasMember("atlas") && asset["atlas"].as<bool>())
+                {
+                    atlasImages.push_back(file);
+                    atlasMipmaps = atlasMipmaps && mipmaps;
+                    continue;
+                }
+
+                const auto name = asset.hasMember("name") ? asset["name"].as<std::string>() : file;
+                loadAsset(type, name, file, mipmaps);
             }
+
+            if (!atlasImages.empty())
+                loadAtlas(atlasImages, atlasMipmaps);
         }
 
         void Bundle::loadAssets(const std::vector<Asset>& assets)
@@ -79,6 +98,62 @@ namespace ouzel
             textures.clear();
         }
 
+        void Bundle::loadAtlas(const std::vector<std::string>& filenames, bool mipmaps,
+                               const Size2U& pageSize, std::uint32_t padding)
+        {
+            graphics::TextureAtlas atlas(pageSize, padding, mipmaps);
+
+            for (const std::string& filename : filenames)
+                atlas.addImage(filename, ImageLoader::decodeImage(fileSystem.readFile(filename)));
+
+            atlas.pack();
+
+            std::vector<std::shared_ptr<graphics::Texture>> pageTextures;
+            pageTextures.reserve(atlas.getPages().size());
+
+            for (const graphics::Image& page : atlas.getPages())
+                pageTextures.push_back(std::make_shared<graphics::Texture>(*engine->getRenderer(),
+                                                                           page.getData(),
+                                                                           page.getSize(), 0,
+                                                                           mipmaps ? 0 : 1,
+                                                                           page.getPixelFormat()));
+
+            for (const auto& region : atlas.getRegions())
+            {
+                AtlasRegion& atlasRegion = atlasRegions[region.first];
+                atlasRegion.texture = pageTextures[region.second.page];
+                atlasRegion.rectangle = region.second.rectangle;
+
+                const Size2F textureSize(static_cast<float>(atlasRegion.texture->getSize().v[0]),
+                                         static_cast<float>(atlasRegion.texture->getSize().v[1]));
+
+                scene::SpriteData newSpriteData;
+                newSpriteData.texture = atlasRegion.texture;
+
+                scene::SpriteData::Animation animation;
+                animation.frames.emplace_back(region.first, textureSize, atlasRegion.rectangle, false,
+                                              atlasRegion.rectangle.size, Vector2F(), Vector2F{0.5F, 0.5F});
+                newSpriteData.animations[""] = std::move(animation);
+
+                spriteData[region.first] = newSpriteData;
+            }
+        }
+
+        const AtlasRegion* Bundle::getAtlasRegion(const std::string& name) const
+        {
+            auto i = atlasRegions.find(name);
+
+            if (i != atlasRegions.end())
+                return &i->second;
+
+            return nullptr;
+        }
+
+        void Bundle::releaseAtlasRegions()
+        {
+            atlasRegions.clear();
+        }
+
         const graphics::Shader* Bundle::getShader(const std::string& name) const
         {
             auto i = shaders.find(name);
@@ -146,7 +221,7 @@ namespace ouzel
             auto extension = storage::Path(filename).getExtension();
             std::transform(extension.begin(), extension.end(), extension.begin(),
                            [](char c) noexcept { return static_cast<char>(std::tolower(c)); });
-            const std::vector<std::string> imageExtensions{"jpg", "jpeg", "png", "bmp", "tga"};
+            const std::vector<std::string> imageExtensions{"jpg", "jpeg", "png", "bmp", "tga", "dds", "ktx"};
 
             if (std::find(imageExtensions.begin(), imageExtensions.end(), extension) != imageExtensions.end())
             {
@@ -155,15 +230,25 @@ namespace ouzel
                 if (spritesX == 0) spritesX = 1;
                 if (spritesY == 0) spritesY = 1;
 
-                newSpriteData.texture = getTexture(filename);
+                RectF imageRectangle;
 
-                const Size2F textureSize(static_cast<float>(newSpriteData.texture->getSize().v[0]),
-                                         static_cast<float>(newSpriteData.texture->getSize().v[1]));
+                // images packed into an atlas are cut from their region of the atlas texture
+                if (const AtlasRegion* atlasRegion = getAtlasRegion(filename))
+                {
+                    newSpriteData.texture = atlasRegion->texture;
+                    imageRectangle = atlasRegion->rectangle;
+                }
+                else if ((newSpriteData.texture = getTexture(filename)))
+                    imageRectangle = RectF(static_cast<float>(newSpriteData.texture->getSize().v[0]),
+                                           static_cast<float>(newSpriteData.texture->getSize().v[1]));
 
                 if (newSpriteData.texture)
                 {
-                    const auto spriteSize = Size2F(textureSize.v[0] / spritesX,
-                                                   textureSize.v[1] / spritesY);
+                    const Size2F textureSize(static_cast<float>(newSpriteData.texture->getSize().v[0]),
+                                             static_cast<float>(newSpriteData.texture->getSize().v[1]));
+
+                    const auto spriteSize = Size2F(imageRectangle.size.v[0] / spritesX,
+                                                   imageRectangle.size.v[1] / spritesY);
 
                     scene::SpriteData::Animation animation;
                     animation.frames.reserve(spritesX * spritesY);
@@ -172,8 +257,8 @@ namespace ouzel
                     {
                         for (std::uint32_t y = 0; y < spritesY; ++y)
                         {
-                            RectF rectangle(spriteSize.v[0] * x,
-                                            spriteSize.v[1] * y,
+                            RectF rectangle(imageRectangle.position.v[0] + spriteSize.v[0] * x,
+                                            imageRectangle.position.v[1] + spriteSize.v[1] * y,
                                             spriteSize.v[0],
                                             spriteSize.v[1]);
 
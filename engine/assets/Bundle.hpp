@@ -13,6 +13,7 @@
 #include "../graphics/Material.hpp"
 #include "../graphics/Shader.hpp"
 #include "../graphics/Texture.hpp"
+#include "../math/Rect.hpp"
 #include "../gui/Font.hpp"
 #include "../scene/SkinnedMeshRenderer.hpp"
 #include "../scene/StaticMeshRenderer.hpp"
@@ -46,6 +47,14 @@ namespace ouzel
             bool mipmaps;
         };
 
+        // area of a packed image inside one of the atlas textures
+        class AtlasRegion final
+        {
+        public:
+            std::shared_ptr<graphics::Texture> texture;
+            RectF rectangle;
+        };
+
         class Bundle final
         {
             friend Cache;
@@ -68,6 +77,13 @@ namespace ouzel
             void setTexture(const std::string& name, const std::shared_ptr<graphics::Texture>& texture);
             void releaseTextures();
 
+            // packs the images into shared textures and creates a sprite for each of them
+            void loadAtlas(const std::vector<std::string>& filenames, bool mipmaps = true,
+                           const Size2U& pageSize = Size2U(2048, 2048),
+                           std::uint32_t padding = 2);
+            const AtlasRegion* getAtlasRegion(const std::string& name) const;
+            void releaseAtlasRegions();
+
             const graphics::Shader* getShader(const std::string& shaderName) const;
             void setShader(const std::string& name, std::unique_ptr<graphics::Shader> shader);
             void releaseShaders();
@@ -120,6 +136,7 @@ namespace ouzel
             storage::FileSystem& fileSystem;
 
             std::map<std::string, std::shared_ptr<graphics::Texture>> textures;
+            std::map<std::string, AtlasRegion> atlasRegions;
             std::map<std::string, std::unique_ptr<graphics::Shader>> shaders;
             std::map<std::string, scene::ParticleSystemData> particleSystemData;
             std::map<std::string, std::unique_ptr<graphics::BlendState>> blendStates;
@@ -5,8 +5,10 @@
 #include "BmfLoader.hpp"
 #include "ColladaLoader.hpp"
 #include "CueLoader.hpp"
+#include "DdsLoader.hpp"
 #include "GltfLoader.hpp"
 #include "ImageLoader.hpp"
+#include "KtxLoader.hpp"
 #include "MtlLoader.hpp"
 #include "ObjLoader.hpp"
 #include "ParticleSystemLoader.hpp"
@@ -29,6 +31,9 @@ namespace ouzel
             addLoader(std::make_unique<CueLoader>(*this));
             addLoader(std::make_unique<GltfLoader>(*this));
             addLoader(std::make_unique<ImageLoader>(*this));
+            // added after ImageLoader, so that they are tried before it
+            addLoader(std::make_unique<DdsLoader>(*this));
+            addLoader(std::make_unique<KtxLoader>(*this));
             addLoader(std::make_unique<MtlLoader>(*this));
             addLoader(std::make_unique<ObjLoader>(*this));
             addLoader(std::make_unique<ParticleSystemLoader>(*this));
@@ -77,6 +82,15 @@ namespace ouzel
             return nullptr;
         }
 
+        const AtlasRegion* Cache::getAtlasRegion(const std::string& name) const
+        {
+            for (const Bundle* bundle : bundles)
+                if (auto atlasRegion = bundle->getAtlasRegion(name))
+                    return atlasRegion;
+
+            return nullptr;
+        }
+
         const graphics::Shader* Cache::getShader(const std::string& name) const
         {
             for (const Bundle* bundle : bundles)
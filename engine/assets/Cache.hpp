@@ -30,6 +30,7 @@ namespace ouzel
             auto& getLoaders() const noexcept { return loaders; }
 
             std::shared_ptr<graphics::Texture> getTexture(const std::string& name) const;
+            const AtlasRegion* getAtlasRegion(const std::string& name) const;
             const graphics::Shader* getShader(const std::string& name) const;
             const graphics::BlendState* getBlendState(const std::string& name) const;
             const graphics::DepthStencilState* getDepthStencilState(const std::string& name) const;
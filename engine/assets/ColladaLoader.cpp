@@ -20,12 +20,8 @@ namespace ouzel
                                       const std::vector<std::uint8_t>& data,
                                       bool)
         {
-            xml::Data colladaData(data);
-
-            if (colladaData.getChildren().empty())
-                throw std::runtime_error("Invalid Collada file");
-
-            xml::Node rootNode = colladaData.getChildren().front();
+            const xml::Document colladaData(data);
+            const xml::Document::Element rootNode = colladaData.getRoot();
 
             if (rootNode.getValue() != "COLLADA")
                 throw std::runtime_error("Invalid Collada file");
@@ -0,0 +1,166 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <stdexcept>
+#include "DdsLoader.hpp"
+#include "Bundle.hpp"
+#include "../core/Engine.hpp"
+#include "../graphics/Texture.hpp"
+#include "../utils/Utils.hpp"
+
+namespace ouzel
+{
+    namespace assets
+    {
+        namespace
+        {
+            constexpr std::uint32_t makeFourCC(char a, char b, char c, char d) noexcept
+            {
+                return static_cast<std::uint32_t>(static_cast<std::uint8_t>(a)) |
+                    (static_cast<std::uint32_t>(static_cast<std::uint8_t>(b)) << 8) |
+                    (static_cast<std::uint32_t>(static_cast<std::uint8_t>(c)) << 16) |
+                    (static_cast<std::uint32_t>(static_cast<std::uint8_t>(d)) << 24);
+            }
+
+            constexpr std::uint32_t DDS_MAGIC = makeFourCC('D', 'D', 'S', ' ');
+            constexpr std::size_t HEADER_SIZE = 124;
+            constexpr std::size_t DX10_HEADER_SIZE = 20;
+
+            constexpr std::uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+            constexpr std::uint32_t DDPF_FOURCC = 0x4;
+            constexpr std::uint32_t DDPF_RGB = 0x40;
+            constexpr std::uint32_t DDSCAPS2_CUBEMAP = 0x200;
+            constexpr std::uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+            constexpr std::uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+            graphics::PixelFormat getPixelFormatFromFourCC(std::uint32_t fourCC)
+            {
+                switch (fourCC)
+                {
+                    case makeFourCC('D', 'X', 'T', '1'): return graphics::PixelFormat::BC1RGBAUNorm;
+                    case makeFourCC('D', 'X', 'T', '2'):
+                    case makeFourCC('D', 'X', 'T', '3'): return graphics::PixelFormat::BC2RGBAUNorm;
+                    case makeFourCC('D', 'X', 'T', '4'):
+                    case makeFourCC('D', 'X', 'T', '5'): return graphics::PixelFormat::BC3RGBAUNorm;
+                    case makeFourCC('A', 'T', 'I', '1'):
+                    case makeFourCC('B', 'C', '4', 'U'): return graphics::PixelFormat::BC4RUNorm;
+                    case makeFourCC('A', 'T', 'I', '2'):
+                    case makeFourCC('B', 'C', '5', 'U'): return graphics::PixelFormat::BC5RGUNorm;
+                    default: throw std::runtime_error("Unsupported DDS pixel format");
+                }
+            }
+
+            graphics::PixelFormat getPixelFormatFromDxgi(std::uint32_t dxgiFormat)
+            {
+                switch (dxgiFormat)
+                {
+                    case 28: return graphics::PixelFormat::RGBA8UNorm; // DXGI_FORMAT_R8G8B8A8_UNORM
+                    case 29: return graphics::PixelFormat::RGBA8UNormSRGB; // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+                    case 71: return graphics::PixelFormat::BC1RGBAUNorm; // DXGI_FORMAT_BC1_UNORM
+                    case 72: return graphics::PixelFormat::BC1RGBAUNormSRGB; // DXGI_FORMAT_BC1_UNORM_SRGB
+                    case 74: return graphics::PixelFormat::BC2RGBAUNorm; // DXGI_FORMAT_BC2_UNORM
+                    case 75: return graphics::PixelFormat::BC2RGBAUNormSRGB; // DXGI_FORMAT_BC2_UNORM_SRGB
+                    case 77: return graphics::PixelFormat::BC3RGBAUNorm; // DXGI_FORMAT_BC3_UNORM
+                    case 78: return graphics::PixelFormat::BC3RGBAUNormSRGB; // DXGI_FORMAT_BC3_UNORM_SRGB
+                    case 80: return graphics::PixelFormat::BC4RUNorm; // DXGI_FORMAT_BC4_UNORM
+                    case 83: return graphics::PixelFormat::BC5RGUNorm; // DXGI_FORMAT_BC5_UNORM
+                    case 98: return graphics::PixelFormat::BC7RGBAUNorm; // DXGI_FORMAT_BC7_UNORM
+                    case 99: return graphics::PixelFormat::BC7RGBAUNormSRGB; // DXGI_FORMAT_BC7_UNORM_SRGB
+                    default: throw std::runtime_error("Unsupported DDS pixel format");
+                }
+            }
+        }
+
+        DdsLoader::DdsLoader(Cache& initCache):
+            Loader(initCache, Loader::Image)
+        {
+        }
+
+        bool DdsLoader::loadAsset(Bundle& bundle,
+                                  const std::string& name,
+                                  const std::vector<std::uint8_t>& data,
+                                  bool mipmaps)
+        {
+            if (data.size() < 4 + HEADER_SIZE ||
+                decodeLittleEndian<std::uint32_t>(data.data()) != DDS_MAGIC)
+                return false;
+
+            const std::uint8_t* header = data.data() + 4;
+
+            if (decodeLittleEndian<std::uint32_t>(header) != HEADER_SIZE)
+                throw std::runtime_error("Invalid DDS header size");
+
+            const auto headerFlags = decodeLittleEndian<std::uint32_t>(header + 4);
+            const auto height = decodeLittleEndian<std::uint32_t>(header + 8);
+            const auto width = decodeLittleEndian<std::uint32_t>(header + 12);
+            const auto mipMapCount = decodeLittleEndian<std::uint32_t>(header + 24);
+            const auto pixelFormatFlags = decodeLittleEndian<std::uint32_t>(header + 76);
+            const auto fourCC = decodeLittleEndian<std::uint32_t>(header + 80);
+            const auto rgbBitCount = decodeLittleEndian<std::uint32_t>(header + 84);
+            const auto redMask = decodeLittleEndian<std::uint32_t>(header + 88);
+            const auto caps2 = decodeLittleEndian<std::uint32_t>(header + 108);
+
+            if (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))
+                throw std::runtime_error("Only 2D DDS textures are supported");
+
+            if (width == 0 || height == 0)
+                throw std::runtime_error("Invalid DDS texture size");
+
+            std::size_t offset = 4 + HEADER_SIZE;
+            graphics::PixelFormat pixelFormat;
+
+            if ((pixelFormatFlags & DDPF_FOURCC) && fourCC == makeFourCC('D', 'X', '1', '0'))
+            {
+                if (data.size() < offset + DX10_HEADER_SIZE)
+                    throw std::runtime_error("Failed to load DDS file, file too small");
+
+                const std::uint8_t* dx10Header = data.data() + offset;
+
+                if (decodeLittleEndian<std::uint32_t>(dx10Header + 4) != D3D10_RESOURCE_DIMENSION_TEXTURE2D ||
+                    decodeLittleEndian<std::uint32_t>(dx10Header + 12) > 1)
+                    throw std::runtime_error("Only 2D DDS textures are supported");
+
+                pixelFormat = getPixelFormatFromDxgi(decodeLittleEndian<std::uint32_t>(dx10Header));
+                offset += DX10_HEADER_SIZE;
+            }
+            else if (pixelFormatFlags & DDPF_FOURCC)
+                pixelFormat = getPixelFormatFromFourCC(fourCC);
+            else if ((pixelFormatFlags & DDPF_RGB) && rgbBitCount == 32 && redMask == 0x000000FF)
+                pixelFormat = graphics::PixelFormat::RGBA8UNorm;
+            else
+                throw std::runtime_error("Unsupported DDS pixel format");
+
+            std::uint32_t levelCount = (headerFlags & DDSD_MIPMAPCOUNT) ? mipMapCount : 1;
+            if (levelCount == 0 || !mipmaps) levelCount = 1;
+
+            std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels;
+            levels.reserve(levelCount);
+
+            Size2U levelSize(width, height);
+
+            for (std::uint32_t level = 0; level < levelCount; ++level)
+            {
+                const auto levelDataSize = graphics::getLevelSize(pixelFormat, levelSize.v[0], levelSize.v[1]);
+
+                if (data.size() - offset < levelDataSize)
+                    throw std::runtime_error("Failed to load DDS file, file too small");
+
+                levels.emplace_back(levelSize, std::vector<std::uint8_t>(data.begin() + static_cast<std::ptrdiff_t>(offset),
+                                                                         data.begin() + static_cast<std::ptrdiff_t>(offset + levelDataSize)));
+                offset += levelDataSize;
+
+                levelSize.v[0] = std::max(levelSize.v[0] / 2, 1U);
+                levelSize.v[1] = std::max(levelSize.v[1] / 2, 1U);
+            }
+
+            auto texture = std::make_shared<graphics::Texture>(*engine->getRenderer(),
+                                                               levels,
+                                                               Size2U(width, height), 0,
+                                                               pixelFormat);
+
+            bundle.setTexture(name, texture);
+
+            return true;
+        }
+    } // namespace assets
+} // namespace ouzel
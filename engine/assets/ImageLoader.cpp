@@ -55,6 +55,21 @@ namespace ouzel
                                     const std::string& name,
                                     const std::vector<std::uint8_t>& data,
                                     bool mipmaps)
+        {
+            const graphics::Image image = decodeImage(data);
+
+            auto texture = std::make_shared<graphics::Texture>(*engine->getRenderer(),
+                                                               image.getData(),
+                                                               image.getSize(), 0,
+                                                               mipmaps ? 0 : 1,
+                                                               image.getPixelFormat());
+
+            bundle.setTexture(name, texture);
+
+            return true;
+        }
+
+        graphics::Image ImageLoader::decodeImage(const std::vector<std::uint8_t>& data)
         {
             int width;
             int height;
@@ -146,20 +161,10 @@ namespace ouzel
                     throw std::runtime_error("Unsupported pixel format");
             }
 
-            graphics::Image image(pixelFormat,
-                                  Size2U(static_cast<std::uint32_t>(width),
-                                         static_cast<std::uint32_t>(height)),
-                                  imageData);
-
-            auto texture = std::make_shared<graphics::Texture>(*engine->getRenderer(),
-                                                               image.getData(),
-                                                               image.getSize(), 0,
-                                                               mipmaps ? 0 : 1,
-                                                               image.getPixelFormat());
-
-            bundle.setTexture(name, texture);
-
-            return true;
+            return graphics::Image(pixelFormat,
+                                   Size2U(static_cast<std::uint32_t>(width),
+                                          static_cast<std::uint32_t>(height)),
+                                   imageData);
         }
     } // namespace assets
 } // namespace ouzel
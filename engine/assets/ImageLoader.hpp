@@ -4,6 +4,7 @@
 #define OUZEL_ASSETS_IMAGELOADER_HPP
 
 #include "Loader.hpp"
+#include "../graphics/Image.hpp"
 
 namespace ouzel
 {
@@ -17,6 +18,8 @@ namespace ouzel
                            const std::string& name,
                            const std::vector<std::uint8_t>& data,
                            bool mipmaps = true) final;
+
+            static graphics::Image decodeImage(const std::vector<std::uint8_t>& data);
         };
     } // namespace assets
 } // namespace ouzel
@@ -0,0 +1,142 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <stdexcept>
+#include "KtxLoader.hpp"
+#include "Bundle.hpp"
+#include "../core/Engine.hpp"
+#include "../graphics/Texture.hpp"
+#include "../utils/Utils.hpp"
+
+namespace ouzel
+{
+    namespace assets
+    {
+        namespace
+        {
+            constexpr std::uint8_t KTX_IDENTIFIER[12] = {
+                0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+            };
+            constexpr std::size_t HEADER_SIZE = 64;
+            constexpr std::uint32_t ENDIANNESS = 0x04030201;
+
+            graphics::PixelFormat getPixelFormat(std::uint32_t glInternalFormat)
+            {
+                switch (glInternalFormat)
+                {
+                    case 0x8058: return graphics::PixelFormat::RGBA8UNorm; // GL_RGBA8
+                    case 0x8C43: return graphics::PixelFormat::RGBA8UNormSRGB; // GL_SRGB8_ALPHA8
+                    case 0x83F0: // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                    case 0x83F1: return graphics::PixelFormat::BC1RGBAUNorm; // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+                    case 0x8C4D: return graphics::PixelFormat::BC1RGBAUNormSRGB; // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+                    case 0x83F2: return graphics::PixelFormat::BC2RGBAUNorm; // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+                    case 0x8C4E: return graphics::PixelFormat::BC2RGBAUNormSRGB; // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+                    case 0x83F3: return graphics::PixelFormat::BC3RGBAUNorm; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                    case 0x8C4F: return graphics::PixelFormat::BC3RGBAUNormSRGB; // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                    case 0x8DBB: return graphics::PixelFormat::BC4RUNorm; // GL_COMPRESSED_RED_RGTC1
+                    case 0x8DBD: return graphics::PixelFormat::BC5RGUNorm; // GL_COMPRESSED_RG_RGTC2
+                    case 0x8E8C: return graphics::PixelFormat::BC7RGBAUNorm; // GL_COMPRESSED_RGBA_BPTC_UNORM
+                    case 0x8E8D: return graphics::PixelFormat::BC7RGBAUNormSRGB; // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                    case 0x9274: return graphics::PixelFormat::ETC2RGB8UNorm; // GL_COMPRESSED_RGB8_ETC2
+                    case 0x9275: return graphics::PixelFormat::ETC2RGB8UNormSRGB; // GL_COMPRESSED_SRGB8_ETC2
+                    case 0x9278: return graphics::PixelFormat::ETC2RGBA8UNorm; // GL_COMPRESSED_RGBA8_ETC2_EAC
+                    case 0x9279: return graphics::PixelFormat::ETC2RGBA8UNormSRGB; // GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+                    case 0x93B0: return graphics::PixelFormat::ASTC4x4UNorm; // GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+                    case 0x93D0: return graphics::PixelFormat::ASTC4x4UNormSRGB; // GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+                    case 0x93B7: return graphics::PixelFormat::ASTC8x8UNorm; // GL_COMPRESSED_RGBA_ASTC_8x8_KHR
+                    case 0x93D7: return graphics::PixelFormat::ASTC8x8UNormSRGB; // GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR
+                    default: throw std::runtime_error("Unsupported KTX pixel format");
+                }
+            }
+        }
+
+        KtxLoader::KtxLoader(Cache& initCache):
+            Loader(initCache, Loader::Image)
+        {
+        }
+
+        bool KtxLoader::loadAsset(Bundle& bundle,
+                                  const std::string& name,
+                                  const std::vector<std::uint8_t>& data,
+                                  bool mipmaps)
+        {
+            if (data.size() < HEADER_SIZE ||
+                !std::equal(std::begin(KTX_IDENTIFIER), std::end(KTX_IDENTIFIER), data.begin()))
+                return false;
+
+            // the file is stored in the byte order of the writer, the endianness field tells which one it was
+            const bool bigEndian = decodeLittleEndian<std::uint32_t>(data.data() + 12) != ENDIANNESS;
+
+            auto decode = [bigEndian](const std::uint8_t* buffer) noexcept {
+                return bigEndian ?
+                    (static_cast<std::uint32_t>(buffer[0]) << 24) |
+                    (static_cast<std::uint32_t>(buffer[1]) << 16) |
+                    (static_cast<std::uint32_t>(buffer[2]) << 8) |
+                    static_cast<std::uint32_t>(buffer[3]) :
+                    decodeLittleEndian<std::uint32_t>(buffer);
+            };
+
+            if (decode(data.data() + 12) != ENDIANNESS)
+                throw std::runtime_error("Invalid KTX endianness");
+
+            const auto glInternalFormat = decode(data.data() + 28);
+            const auto width = decode(data.data() + 36);
+            const auto height = decode(data.data() + 40);
+            const auto depth = decode(data.data() + 44);
+            const auto arrayElements = decode(data.data() + 48);
+            const auto faces = decode(data.data() + 52);
+            const auto mipmapLevels = decode(data.data() + 56);
+            const auto keyValueDataSize = decode(data.data() + 60);
+
+            if (height == 0 || depth != 0 || arrayElements != 0 || faces != 1)
+                throw std::runtime_error("Only 2D KTX textures are supported");
+
+            if (width == 0)
+                throw std::runtime_error("Invalid KTX texture size");
+
+            const graphics::PixelFormat pixelFormat = getPixelFormat(glInternalFormat);
+
+            std::size_t offset = HEADER_SIZE + keyValueDataSize;
+
+            std::uint32_t levelCount = mipmapLevels;
+            if (levelCount == 0 || !mipmaps) levelCount = 1;
+
+            std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels;
+            levels.reserve(levelCount);
+
+            Size2U levelSize(width, height);
+
+            for (std::uint32_t level = 0; level < levelCount; ++level)
+            {
+                if (data.size() < offset + sizeof(std::uint32_t))
+                    throw std::runtime_error("Failed to load KTX file, file too small");
+
+                const std::size_t imageSize = decode(data.data() + offset);
+                offset += sizeof(std::uint32_t);
+
+                if (imageSize != graphics::getLevelSize(pixelFormat, levelSize.v[0], levelSize.v[1]))
+                    throw std::runtime_error("Invalid KTX image size");
+
+                if (data.size() - offset < imageSize)
+                    throw std::runtime_error("Failed to load KTX file, file too small");
+
+                levels.emplace_back(levelSize, std::vector<std::uint8_t>(data.begin() + static_cast<std::ptrdiff_t>(offset),
+                                                                         data.begin() + static_cast<std::ptrdiff_t>(offset + imageSize)));
+
+                // each level is padded to four bytes
+                offset += (imageSize + 3) & ~static_cast<std::size_t>(3);
+
+                levelSize.v[0] = std::max(levelSize.v[0] / 2, 1U);
+                levelSize.v[1] = std::max(levelSize.v[1] / 2, 1U);
+            }
+
+            auto texture = std::make_shared<graphics::Texture>(*engine->getRenderer(),
+                                                               levels,
+                                                               Size2U(width, height), 0,
+                                                               pixelFormat);
+
+            bundle.setTexture(name, texture);
+
+            return true;
+        }
+    } // namespace assets
+} // namespace ouzel
@@ -1,14 +1,18 @@
 // Copyright 2015-2020 Elviss Strazdins. All rights reserved.
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdlib>
-#include <map>
+#include <exception>
 #include <stdexcept>
 #include <string>
-#include <tuple>
+#include <thread>
 #include "ObjLoader.hpp"
 #include "Bundle.hpp"
 #include "Cache.hpp"
 #include "../graphics/Material.hpp"
+#include "../utils/Thread.hpp"
 
 namespace ouzel
 {
@@ -16,6 +20,10 @@ namespace ouzel
     {
         namespace
         {
+            // files smaller than this are not worth distributing across threads
+            constexpr std::size_t MIN_PARALLEL_SIZE = 1024 * 1024;
+            constexpr std::size_t MIN_CHUNK_SIZE = 256 * 1024;
+
             constexpr auto isWhitespace(std::uint8_t c)
             {
                 return c == ' ' || c == '\t';
@@ -31,144 +39,438 @@ namespace ouzel
                 return c <= 0x1F;
             }
 
-            void skipWhitespaces(std::vector<std::uint8_t>::const_iterator& iterator,
-                                 std::vector<std::uint8_t>::const_iterator end)
+            constexpr auto isDigit(std::uint8_t c)
             {
-                while (iterator != end)
-                    if (isWhitespace(*iterator))
-                        ++iterator;
-                    else
-                        break;
+                return c >= '0' && c <= '9';
             }
 
-            void skipLine(std::vector<std::uint8_t>::const_iterator& iterator,
-                          std::vector<std::uint8_t>::const_iterator end)
+            void skipWhitespaces(const std::uint8_t*& iterator, const std::uint8_t* end) noexcept
+            {
+                while (iterator != end && isWhitespace(*iterator))
+                    ++iterator;
+            }
+
+            void skipLine(const std::uint8_t*& iterator, const std::uint8_t* end) noexcept
             {
                 while (iterator != end)
-                {
-                    if (isNewline(*iterator))
-                    {
-                        ++iterator;
+                    if (isNewline(*iterator++))
                         break;
-                    }
+            }
 
-                    ++iterator;
-                }
+            bool isEndOfLine(const std::uint8_t* iterator, const std::uint8_t* end) noexcept
+            {
+                return iterator == end || isNewline(*iterator) || *iterator == '#';
             }
 
-            std::string parseString(std::vector<std::uint8_t>::const_iterator& iterator,
-                                    std::vector<std::uint8_t>::const_iterator end)
+            std::string parseString(const std::uint8_t*& iterator, const std::uint8_t* end)
             {
-                std::string result;
+                const std::uint8_t* start = iterator;
 
                 while (iterator != end && !isControlChar(*iterator) && !isWhitespace(*iterator))
-                {
-                    result.push_back(static_cast<char>(*iterator));
-
                     ++iterator;
-                }
 
-                if (result.empty())
+                if (iterator == start)
                     throw std::runtime_error("Invalid string");
 
-                return result;
+                return std::string(start, iterator);
             }
 
-            std::int32_t parseInt32(std::vector<std::uint8_t>::const_iterator& iterator,
-                                    std::vector<std::uint8_t>::const_iterator end)
+            // SWAR checks and conversion of eight ASCII digits at once
+            std::uint64_t loadEightBytes(const std::uint8_t* buffer) noexcept
             {
-                std::string value;
-                std::uint32_t length = 1;
+                return static_cast<std::uint64_t>(buffer[0]) |
+                    (static_cast<std::uint64_t>(buffer[1]) << 8) |
+                    (static_cast<std::uint64_t>(buffer[2]) << 16) |
+                    (static_cast<std::uint64_t>(buffer[3]) << 24) |
+                    (static_cast<std::uint64_t>(buffer[4]) << 32) |
+                    (static_cast<std::uint64_t>(buffer[5]) << 40) |
+                    (static_cast<std::uint64_t>(buffer[6]) << 48) |
+                    (static_cast<std::uint64_t>(buffer[7]) << 56);
+            }
 
-                if (iterator != end && *iterator == '-')
-                {
-                    value.push_back(static_cast<char>(*iterator));
-                    ++length;
-                    ++iterator;
-                }
+            constexpr bool areEightDigits(std::uint64_t value) noexcept
+            {
+                return ((value & 0xF0F0F0F0F0F0F0F0ULL) |
+                        (((value + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+            }
 
-                while (iterator != end && *iterator >= '0' && *iterator <= '9')
+            inline std::uint32_t parseEightDigits(std::uint64_t value) noexcept
+            {
+                value -= 0x3030303030303030ULL;
+                value = (value * 10) + (value >> 8);
+                value = (((value & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+                         (((value >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+                return static_cast<std::uint32_t>(value);
+            }
+
+            // appends the digits to the mantissa, the ones that do not fit in it are counted as dropped
+            void parseDigits(const std::uint8_t*& iterator, const std::uint8_t* end,
+                             std::uint64_t& mantissa, std::uint32_t& mantissaDigits,
+                             std::uint32_t& droppedDigits) noexcept
+            {
+                while (end - iterator >= 8 && mantissaDigits + 8 <= 19)
                 {
-                    value.push_back(static_cast<char>(*iterator));
+                    const std::uint64_t value = loadEightBytes(iterator);
+                    if (!areEightDigits(value)) break;
 
-                    ++iterator;
+                    mantissa = mantissa * 100000000ULL + parseEightDigits(value);
+                    mantissaDigits += 8;
+                    iterator += 8;
                 }
 
-                if (value.length() < length) return false;
-
-                return std::stoi(value);
+                for (; iterator != end && isDigit(*iterator); ++iterator)
+                {
+                    if (mantissaDigits < 19)
+                    {
+                        mantissa = mantissa * 10 + static_cast<std::uint64_t>(*iterator - '0');
+                        ++mantissaDigits;
+                    }
+                    else
+                        ++droppedDigits;
+                }
             }
 
-            float parseFloat(std::vector<std::uint8_t>::const_iterator& iterator,
-                             std::vector<std::uint8_t>::const_iterator end)
+            std::int32_t parseInt32(const std::uint8_t*& iterator, const std::uint8_t* end)
             {
-                std::string value;
-                std::uint32_t length = 1;
-
+                bool negative = false;
                 if (iterator != end && *iterator == '-')
                 {
-                    value.push_back(static_cast<char>(*iterator));
-                    ++length;
+                    negative = true;
                     ++iterator;
                 }
 
-                while (iterator != end && *iterator >= '0' && *iterator <= '9')
-                {
-                    value.push_back(static_cast<char>(*iterator));
+                if (iterator == end || !isDigit(*iterator))
+                    throw std::runtime_error("Invalid integer");
 
-                    ++iterator;
+                std::int64_t result = 0;
+                for (; iterator != end && isDigit(*iterator); ++iterator)
+                {
+                    result = result * 10 + (*iterator - '0');
+                    if (result > 0x7FFFFFFF)
+                        throw std::runtime_error("Integer out of range");
                 }
 
+                return static_cast<std::int32_t>(negative ? -result : result);
+            }
+
+            float parseFloat(const std::uint8_t*& iterator, const std::uint8_t* end)
+            {
+                static constexpr double powersOfTen[] = {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+                };
+
+                bool negative = false;
+                if (iterator != end && (*iterator == '-' || *iterator == '+'))
+                    negative = (*iterator++ == '-');
+
+                std::uint64_t mantissa = 0;
+                std::uint32_t mantissaDigits = 0;
+                std::uint32_t droppedDigits = 0;
+
+                // leading zeros do not take space in the mantissa
+                const std::uint8_t* integerStart = iterator;
+                while (iterator != end && *iterator == '0') ++iterator;
+                parseDigits(iterator, end, mantissa, mantissaDigits, droppedDigits);
+                bool hasDigits = (iterator != integerStart);
+
+                std::int32_t exponent = static_cast<std::int32_t>(droppedDigits);
+
                 if (iterator != end && *iterator == '.')
                 {
-                    value.push_back(static_cast<char>(*iterator));
-                    ++length;
                     ++iterator;
+                    const std::uint8_t* fractionStart = iterator;
 
-                    while (iterator != end && *iterator >= '0' && *iterator <= '9')
+                    if (mantissaDigits == 0)
                     {
-                        value.push_back(static_cast<char>(*iterator));
-
-                        ++iterator;
+                        while (iterator != end && *iterator == '0') ++iterator;
+                        exponent -= static_cast<std::int32_t>(iterator - fractionStart);
                     }
+
+                    const std::uint32_t digitsBefore = mantissaDigits;
+                    std::uint32_t droppedFractionDigits = 0;
+                    parseDigits(iterator, end, mantissa, mantissaDigits, droppedFractionDigits);
+                    exponent -= static_cast<std::int32_t>(mantissaDigits - digitsBefore);
+
+                    if (iterator != fractionStart) hasDigits = true;
                 }
 
+                if (!hasDigits)
+                    throw std::runtime_error("Invalid float");
+
                 // parse exponent
-                if (iterator != end &&
-                    (*iterator == 'e' || *iterator == 'E'))
+                if (iterator != end && (*iterator == 'e' || *iterator == 'E'))
                 {
-                    value.push_back(static_cast<char>(*iterator));
                     if (++iterator == end)
                         throw std::runtime_error("Invalid exponent");
 
+                    bool negativeExponent = false;
                     if (*iterator == '+' || *iterator == '-')
-                        value.push_back(static_cast<char>(*iterator++));
+                        negativeExponent = (*iterator++ == '-');
 
-                    if (iterator == end || *iterator < '0' || *iterator > '9')
+                    if (iterator == end || !isDigit(*iterator))
                         throw std::runtime_error("Invalid exponent");
 
-                    while (iterator != end && *iterator >= '0' && *iterator <= '9')
+                    std::int32_t explicitExponent = 0;
+                    for (; iterator != end && isDigit(*iterator); ++iterator)
+                        if (explicitExponent < 10000)
+                            explicitExponent = explicitExponent * 10 + (*iterator - '0');
+
+                    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                }
+
+                double result = static_cast<double>(mantissa);
+                if (mantissa)
+                {
+                    if (exponent < 0 && exponent >= -22)
+                        result /= powersOfTen[-exponent];
+                    else if (exponent > 0 && exponent <= 22)
+                        result *= powersOfTen[exponent];
+                    else if (exponent != 0)
+                        result *= std::pow(10.0, static_cast<double>(exponent));
+                }
+
+                return static_cast<float>(negative ? -result : result);
+            }
+
+            // references to positions, texture coordinates and normals of a face corner
+            struct Corner final
+            {
+                std::int32_t indices[3] = {0, 0, 0}; // zero if not present
+                std::uint8_t relative = 0; // bits of the indices that are relative to the start of the chunk
+            };
+
+            struct Statement final
+            {
+                enum class Type
+                {
+                    MaterialLibrary,
+                    UseMaterial,
+                    Object
+                };
+
+                Type type;
+                std::string value;
+                std::size_t faceCount; // number of faces of the chunk before the statement
+                bool keywordBefore; // whether any keyword of the chunk precedes the statement
+            };
+
+            struct Chunk final
+            {
+                std::vector<Vector3F> positions;
+                std::vector<Vector2F> texCoords;
+                std::vector<Vector3F> normals;
+                std::vector<Corner> corners;
+                std::vector<std::uint32_t> faceSizes;
+                std::vector<Statement> statements;
+                bool hasKeywords = false;
+                std::exception_ptr exception;
+            };
+
+            void parseChunk(const std::uint8_t* iterator, const std::uint8_t* end, Chunk& chunk)
+            {
+                while (iterator != end)
+                {
+                    if (isNewline(*iterator))
                     {
-                        value.push_back(static_cast<char>(*iterator));
+                        // skip empty lines
                         ++iterator;
+                        continue;
+                    }
+                    else if (*iterator == '#')
+                    {
+                        // skip the comment
+                        skipLine(iterator, end);
+                        continue;
                     }
-                }
 
-                if (value.length() < length) return false;
+                    skipWhitespaces(iterator, end);
+                    if (isEndOfLine(iterator, end)) continue;
+
+                    const std::uint8_t* keyword = iterator;
+                    while (iterator != end && !isControlChar(*iterator) && !isWhitespace(*iterator))
+                        ++iterator;
+                    const auto keywordLength = static_cast<std::size_t>(iterator - keyword);
 
-                return std::stof(value);
+                    if (!keywordLength)
+                        throw std::runtime_error("Invalid string");
+
+                    skipWhitespaces(iterator, end);
+
+                    if (keywordLength == 1 && keyword[0] == 'v')
+                    {
+                        Vector3F position;
+                        position.v[0] = parseFloat(iterator, end);
+                        skipWhitespaces(iterator, end);
+                        position.v[1] = parseFloat(iterator, end);
+                        skipWhitespaces(iterator, end);
+                        position.v[2] = parseFloat(iterator, end);
+
+                        chunk.positions.push_back(position);
+                    }
+                    else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+                    {
+                        Vector2F texCoord;
+                        texCoord.v[0] = parseFloat(iterator, end);
+                        skipWhitespaces(iterator, end);
+                        if (!isEndOfLine(iterator, end))
+                            texCoord.v[1] = parseFloat(iterator, end);
+
+                        chunk.texCoords.push_back(texCoord);
+                    }
+                    else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+                    {
+                        Vector3F normal;
+                        normal.v[0] = parseFloat(iterator, end);
+                        skipWhitespaces(iterator, end);
+                        normal.v[1] = parseFloat(iterator, end);
+                        skipWhitespaces(iterator, end);
+                        normal.v[2] = parseFloat(iterator, end);
+
+                        chunk.normals.push_back(normal);
+                    }
+                    else if (keywordLength == 1 && keyword[0] == 'f')
+                    {
+                        const std::size_t counts[3] = {
+                            chunk.positions.size(),
+                            chunk.texCoords.size(),
+                            chunk.normals.size()
+                        };
+
+                        std::uint32_t cornerCount = 0;
+
+                        while (!isEndOfLine(iterator, end))
+                        {
+                            Corner corner;
+
+                            for (std::uint32_t component = 0; component < 3; ++component)
+                            {
+                                // texture coordinates and normals are optional
+                                if (component > 0)
+                                {
+                                    if (iterator == end || *iterator != '/') break;
+                                    ++iterator;
+                                    if (iterator == end || *iterator == '/' || isWhitespace(*iterator) || isNewline(*iterator)) continue;
+                                }
+
+                                std::int32_t index = parseInt32(iterator, end);
+
+                                if (index < 0)
+                                {
+                                    index = static_cast<std::int32_t>(counts[component]) + index + 1;
+                                    corner.relative |= 1U << component;
+                                }
+                                else if (index == 0)
+                                    throw std::runtime_error("Invalid face index");
+
+                                corner.indices[component] = index;
+                            }
+
+                            chunk.corners.push_back(corner);
+                            ++cornerCount;
+
+                            skipWhitespaces(iterator, end);
+                        }
+
+                        if (cornerCount < 3)
+                            throw std::runtime_error("Invalid face count");
+
+                        chunk.faceSizes.push_back(cornerCount);
+                    }
+                    else if ((keywordLength == 1 && keyword[0] == 'o') ||
+                             (keywordLength == 6 && std::equal(keyword, keyword + 6, "usemtl")) ||
+                             (keywordLength == 6 && std::equal(keyword, keyword + 6, "mtllib")))
+                    {
+                        Statement statement;
+                        statement.type = (keywordLength == 1) ? Statement::Type::Object :
+                            (keyword[0] == 'u') ? Statement::Type::UseMaterial : Statement::Type::MaterialLibrary;
+                        statement.value = parseString(iterator, end);
+                        statement.faceCount = chunk.faceSizes.size();
+                        statement.keywordBefore = chunk.hasKeywords;
+                        chunk.statements.push_back(std::move(statement));
+                    }
+
+                    // skip the rest of the line and all unknown commands
+                    skipLine(iterator, end);
+
+                    chunk.hasKeywords = true;
+                }
             }
 
-            bool parseToken(const std::vector<std::uint8_t>& str,
-                            std::vector<std::uint8_t>::const_iterator& iterator,
-                            char token)
+            // open addressing hash map from face corners to vertex indices
+            class VertexMap final
             {
-                if (iterator == str.end() || *iterator != static_cast<std::uint8_t>(token)) return false;
+            public:
+                explicit VertexMap(std::size_t expectedSize)
+                {
+                    std::size_t capacity = 16;
+                    while (capacity < expectedSize * 2) capacity <<= 1;
+                    slots.resize(capacity);
+                }
 
-                ++iterator;
+                // returns true if the corner was inserted
+                bool insert(const std::uint32_t (&key)[3], std::uint32_t value, std::uint32_t& result)
+                {
+                    if ((size + 1) * 2 > slots.size()) grow();
 
-                return true;
-            }
+                    const std::size_t mask = slots.size() - 1;
+                    for (std::size_t i = hash(key) & mask;; i = (i + 1) & mask)
+                    {
+                        Slot& slot = slots[i];
+
+                        if (slot.key[0] == 0)
+                        {
+                            std::copy(std::begin(key), std::end(key), std::begin(slot.key));
+                            slot.value = value;
+                            result = value;
+                            ++size;
+                            return true;
+                        }
+                        else if (slot.key[0] == key[0] && slot.key[1] == key[1] && slot.key[2] == key[2])
+                        {
+                            result = slot.value;
+                            return false;
+                        }
+                    }
+                }
+
+                // shrinks the table too, so that a file with many small objects does not clear a large table for each of them
+                void clear()
+                {
+                    slots = std::vector<Slot>(16);
+                    size = 0;
+                }
+
+            private:
+                struct Slot final
+                {
+                    std::uint32_t key[3] = {0, 0, 0}; // position index is never zero for a used slot
+                    std::uint32_t value = 0;
+                };
+
+                static std::size_t hash(const std::uint32_t (&key)[3]) noexcept
+                {
+                    std::uint64_t h = key[0] * 0x9E3779B97F4A7C15ULL;
+                    h ^= key[1] * 0xC2B2AE3D27D4EB4FULL;
+                    h ^= key[2] * 0x165667B19E3779F9ULL;
+                    h ^= h >> 32;
+                    return static_cast<std::size_t>(h);
+                }
+
+                void grow()
+                {
+                    std::vector<Slot> oldSlots(slots.size() * 2);
+                    oldSlots.swap(slots);
+                    size = 0;
+
+                    std::uint32_t result;
+                    for (const Slot& slot : oldSlots)
+                        if (slot.key[0] != 0) insert(slot.key, slot.value, result);
+                }
+
+                std::vector<Slot> slots;
+                std::size_t size = 0;
+            };
         }
 
         ObjLoader::ObjLoader(Cache& initCache):
@@ -181,225 +483,202 @@ namespace ouzel
                                   const std::vector<std::uint8_t>& data,
                                   bool mipmaps)
         {
-            std::string objectName = name;
-            const graphics::Material* material = nullptr;
-            std::vector<Vector3F> positions;
-            std::vector<Vector2F> texCoords;
-            std::vector<Vector3F> normals;
-            std::vector<graphics::Vertex> vertices;
-            std::map<std::tuple<std::uint32_t, std::uint32_t, std::uint32_t>, std::uint32_t> vertexMap;
-            std::vector<std::uint32_t> indices;
-            Box3F boundingBox;
+            const std::uint8_t* begin = data.data();
+            const std::uint8_t* end = data.data() + data.size();
 
-            std::uint32_t objectCount = 0;
+            const std::uint32_t hardwareThreads = std::thread::hardware_concurrency();
+            std::size_t chunkCount = (data.size() >= MIN_PARALLEL_SIZE && hardwareThreads > 1) ?
+                std::min(static_cast<std::size_t>(hardwareThreads), data.size() / MIN_CHUNK_SIZE) : 1;
+            if (chunkCount < 1) chunkCount = 1;
 
-            auto iterator = data.cbegin();
+            // split the file at line boundaries
+            std::vector<const std::uint8_t*> boundaries{begin};
+            for (std::size_t i = 1; i < chunkCount; ++i)
+            {
+                const std::uint8_t* boundary = std::max(boundaries.back(), begin + data.size() * i / chunkCount);
+                while (boundary != end && *boundary != '\n') ++boundary;
+                if (boundary != end) ++boundary;
+                boundaries.push_back(boundary);
+            }
+            boundaries.push_back(end);
 
-            std::string keyword;
-            std::string value;
+            std::vector<Chunk> chunks(chunkCount);
 
-            while (iterator != data.end())
-            {
-                if (isNewline(*iterator))
+            auto parse = [&boundaries, &chunks](std::size_t index) {
+                try
                 {
-                    // skip empty lines
-                    ++iterator;
+                    parseChunk(boundaries[index], boundaries[index + 1], chunks[index]);
                 }
-                else if (*iterator == '#')
+                catch (...)
                 {
-                    // skip the comment
-                    skipLine(iterator, data.end());
+                    chunks[index].exception = std::current_exception();
                 }
-                else
-                {
-                    skipWhitespaces(iterator, data.end());
-                    keyword = parseString(iterator, data.end());
-
-                    if (keyword == "mtllib")
-                    {
-                        skipWhitespaces(iterator, data.end());
-                        value = parseString(iterator, data.end());
-
-                        skipLine(iterator, data.end());
+            };
 
-                        //if (!cache.getMaterial(filename))
-                        // TODO don't load material lib every time
-                        bundle.loadAsset(Loader::Material, value, value, mipmaps);
-                    }
-                    else if (keyword == "usemtl")
-                    {
-                        skipWhitespaces(iterator, data.end());
-                        value = parseString(iterator, data.end());
-
-                        skipLine(iterator, data.end());
-
-                        material = cache.getMaterial(value);
-                    }
-                    else if (keyword == "o")
-                    {
-                        if (objectCount)
-                        {
-                            scene::StaticMeshData meshData(boundingBox, indices, vertices, material);
-                            bundle.setStaticMeshData(objectName, std::move(meshData));
-                        }
+            {
+                std::vector<Thread> threads;
+                threads.reserve(chunkCount - 1);
 
-                        skipWhitespaces(iterator, data.end());
-                        objectName = parseString(iterator, data.end());
+                // the calling thread parses the first chunk itself
+                for (std::size_t i = 1; i < chunkCount; ++i)
+                    threads.emplace_back(parse, i);
 
-                        skipLine(iterator, data.end());
+                parse(0);
 
-                        material = nullptr;
-                        vertices.clear();
-                        indices.clear();
-                        vertexMap.clear();
-                        boundingBox.reset();
-                        ++objectCount;
-                    }
-                    else if (keyword == "v")
-                    {
-                        Vector3F position;
+                for (auto& thread : threads) thread.join();
+            }
 
-                        skipWhitespaces(iterator, data.end());
-                        position.v[0] = parseFloat(iterator, data.end());
-                        skipWhitespaces(iterator, data.end());
-                        position.v[1] = parseFloat(iterator, data.end());
-                        skipWhitespaces(iterator, data.end());
-                        position.v[2] = parseFloat(iterator, data.end());
+            for (const Chunk& chunk : chunks)
+                if (chunk.exception) std::rethrow_exception(chunk.exception);
 
-                        skipLine(iterator, data.end());
+            // merge the attributes and remember where each chunk starts
+            std::vector<Vector3F> positions;
+            std::vector<Vector2F> texCoords;
+            std::vector<Vector3F> normals;
+            std::vector<std::array<std::int32_t, 3>> bases(chunkCount);
+            std::size_t cornerCount = 0;
+            std::size_t faceCount = 0;
 
-                        positions.push_back(position);
-                    }
-                    else if (keyword == "vt")
-                    {
-                        Vector2F texCoord;
+            if (chunkCount == 1)
+            {
+                positions = std::move(chunks[0].positions);
+                texCoords = std::move(chunks[0].texCoords);
+                normals = std::move(chunks[0].normals);
+                bases[0] = {0, 0, 0};
+                cornerCount = chunks[0].corners.size();
+                faceCount = chunks[0].faceSizes.size();
+            }
+            else
+            {
+                for (std::size_t i = 0; i < chunkCount; ++i)
+                {
+                    bases[i] = {
+                        static_cast<std::int32_t>(positions.size()),
+                        static_cast<std::int32_t>(texCoords.size()),
+                        static_cast<std::int32_t>(normals.size())
+                    };
+
+                    positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+                    texCoords.insert(texCoords.end(), chunks[i].texCoords.begin(), chunks[i].texCoords.end());
+                    normals.insert(normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+                    cornerCount += chunks[i].corners.size();
+                    faceCount += chunks[i].faceSizes.size();
+
+                    chunks[i].positions = std::vector<Vector3F>();
+                    chunks[i].texCoords = std::vector<Vector2F>();
+                    chunks[i].normals = std::vector<Vector3F>();
+                }
+            }
 
-                        skipWhitespaces(iterator, data.end());
-                        texCoord.v[0] = parseFloat(iterator, data.end());
-                        skipWhitespaces(iterator, data.end());
-                        texCoord.v[1] = parseFloat(iterator, data.end());
+            const std::size_t counts[3] = {positions.size(), texCoords.size(), normals.size()};
 
-                        skipLine(iterator, data.end());
+            std::string objectName = name;
+            const graphics::Material* material = nullptr;
+            std::vector<graphics::Vertex> vertices;
+            VertexMap vertexMap(cornerCount / 4); // closed meshes share each vertex between several faces
+            std::vector<std::uint32_t> indices;
+            indices.reserve((cornerCount - std::min(cornerCount, faceCount * 2)) * 3);
+            std::vector<std::uint32_t> vertexIndices;
+            Box3F boundingBox;
 
-                        texCoords.push_back(texCoord);
-                    }
-                    else if (keyword == "vn")
-                    {
-                        Vector3F normal;
+            bool hasKeywords = false; // a keyword anywhere before means there is an object to store
 
-                        skipWhitespaces(iterator, data.end());
-                        normal.v[0] = parseFloat(iterator, data.end());
-                        skipWhitespaces(iterator, data.end());
-                        normal.v[1] = parseFloat(iterator, data.end());
-                        skipWhitespaces(iterator, data.end());
-                        normal.v[2] = parseFloat(iterator, data.end());
+            for (std::size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+            {
+                const Chunk& chunk = chunks[chunkIndex];
+                const std::array<std::int32_t, 3>& base = bases[chunkIndex];
 
-                        skipLine(iterator, data.end());
+                std::size_t cornerIndex = 0;
+                std::size_t statementIndex = 0;
 
-                        normals.push_back(normal);
-                    }
-                    else if (keyword == "f")
+                for (std::size_t faceIndex = 0; faceIndex <= chunk.faceSizes.size(); ++faceIndex)
+                {
+                    for (; statementIndex < chunk.statements.size() &&
+                         chunk.statements[statementIndex].faceCount == faceIndex; ++statementIndex)
                     {
-                        std::vector<std::uint32_t> vertexIndices;
-
-                        auto i = std::make_tuple<std::uint32_t, std::uint32_t, std::uint32_t>(0, 0, 0);
-                        std::int32_t positionIndex = 0;
-                        std::int32_t texCoordIndex = 0;
-                        std::int32_t normalIndex = 0;
+                        const Statement& statement = chunk.statements[statementIndex];
 
-                        while (iterator != data.end())
+                        switch (statement.type)
                         {
-                            if (isNewline(*iterator)) break;
-
-                            skipWhitespaces(iterator, data.end());
-                            positionIndex = parseInt32(iterator, data.end());
-
-                            if (positionIndex < 0)
-                                positionIndex = static_cast<std::int32_t>(positions.size()) + positionIndex + 1;
-
-                            if (positionIndex < 1 || positionIndex > static_cast<std::int32_t>(positions.size()))
-                                throw std::runtime_error("Invalid position index");
-
-                            std::get<0>(i) = static_cast<std::uint32_t>(positionIndex);
-
-                            // has texture coordinates
-                            if (parseToken(data, iterator, '/'))
-                            {
-                                // two slashes in a row indicates no texture coordinates
-                                if (iterator != data.end() && *iterator != '/')
+                            case Statement::Type::MaterialLibrary:
+                                // TODO don't load material lib every time
+                                bundle.loadAsset(Loader::Material, statement.value, statement.value, mipmaps);
+                                break;
+                            case Statement::Type::UseMaterial:
+                                material = cache.getMaterial(statement.value);
+                                break;
+                            case Statement::Type::Object:
+                                if (hasKeywords || statement.keywordBefore)
                                 {
-                                    texCoordIndex = parseInt32(iterator, data.end());
+                                    scene::StaticMeshData meshData(boundingBox, indices, vertices, material);
+                                    bundle.setStaticMeshData(objectName, std::move(meshData));
+                                }
 
-                                    if (texCoordIndex < 0)
-                                        texCoordIndex = static_cast<std::int32_t>(texCoords.size()) + texCoordIndex + 1;
+                                objectName = statement.value;
+                                material = nullptr;
+                                vertices.clear();
+                                indices.clear();
+                                vertexMap.clear();
+                                boundingBox.reset();
+                                break;
+                        }
+                    }
 
-                                    if (texCoordIndex < 1 || texCoordIndex > static_cast<std::int32_t>(texCoords.size()))
-                                        throw std::runtime_error("Invalid texture coordinate index");
+                    if (faceIndex == chunk.faceSizes.size()) break;
 
-                                    std::get<1>(i) = static_cast<std::uint32_t>(texCoordIndex);
-                                }
+                    vertexIndices.clear();
 
-                                // has normal
-                                if (parseToken(data, iterator, '/'))
-                                {
-                                    normalIndex = parseInt32(iterator, data.end());
+                    for (std::uint32_t i = 0; i < chunk.faceSizes[faceIndex]; ++i, ++cornerIndex)
+                    {
+                        const Corner& corner = chunk.corners[cornerIndex];
+                        std::uint32_t key[3];
 
-                                    if (normalIndex < 0)
-                                        normalIndex = static_cast<std::int32_t>(normals.size()) + normalIndex + 1;
+                        for (std::uint32_t component = 0; component < 3; ++component)
+                        {
+                            std::int32_t index = corner.indices[component];
 
-                                    if (normalIndex < 1 || normalIndex > static_cast<std::int32_t>(normals.size()))
-                                        throw std::runtime_error("Invalid normal index");
+                            if (corner.relative & (1U << component))
+                                index += base[component];
 
-                                    std::get<2>(i) = static_cast<std::uint32_t>(normalIndex);
-                                }
-                            }
+                            if ((index != 0 || (corner.relative & (1U << component))) &&
+                                (index < 1 || static_cast<std::size_t>(index) > counts[component]))
+                                throw std::runtime_error(component == 0 ? "Invalid position index" :
+                                                         component == 1 ? "Invalid texture coordinate index" :
+                                                         "Invalid normal index");
 
-                            std::uint32_t index = 0;
+                            key[component] = static_cast<std::uint32_t>(index);
+                        }
 
-                            auto vertexIterator = vertexMap.find(i);
-                            if (vertexIterator == vertexMap.end())
-                            {
-                                index = static_cast<std::uint32_t>(vertices.size());
-                                vertexMap[i] = index;
-
-                                graphics::Vertex vertex;
-                                if (std::get<0>(i) >= 1) vertex.position = positions[std::get<0>(i) - 1];
-                                if (std::get<1>(i) >= 1) vertex.texCoords[0] = texCoords[std::get<1>(i) - 1];
-                                vertex.color = Color::white();
-                                if (std::get<2>(i) >= 1) vertex.normal = normals[std::get<2>(i) - 1];
-                                vertices.push_back(vertex);
-                                boundingBox.insertPoint(vertex.position);
-                            }
-                            else
-                                index = vertexIterator->second;
+                        if (key[0] == 0)
+                            throw std::runtime_error("Invalid position index");
 
-                            vertexIndices.push_back(index);
+                        std::uint32_t index;
+                        if (vertexMap.insert(key, static_cast<std::uint32_t>(vertices.size()), index))
+                        {
+                            graphics::Vertex vertex;
+                            vertex.position = positions[key[0] - 1];
+                            if (key[1] >= 1) vertex.texCoords[0] = texCoords[key[1] - 1];
+                            vertex.color = Color::white();
+                            if (key[2] >= 1) vertex.normal = normals[key[2] - 1];
+                            vertices.push_back(vertex);
+                            boundingBox.insertPoint(vertex.position);
                         }
 
-                        if (vertexIndices.size() < 3)
-                            throw std::runtime_error("Invalid face count");
-                        else if (vertexIndices.size() == 3)
-                            for (const auto vertexIndex : vertexIndices)
-                                indices.push_back(vertexIndex);
-                        else
-                            for (std::uint32_t index = 0; index < vertexIndices.size() - 2; ++index)
-                            {
-                                indices.push_back(vertexIndices[0]);
-                                indices.push_back(vertexIndices[index + 1]);
-                                indices.push_back(vertexIndices[index + 2]);
-                            }
+                        vertexIndices.push_back(index);
                     }
-                    else
+
+                    for (std::uint32_t index = 0; index < vertexIndices.size() - 2; ++index)
                     {
-                        // skip all unknown commands
-                        skipLine(iterator, data.end());
+                        indices.push_back(vertexIndices[0]);
+                        indices.push_back(vertexIndices[index + 1]);
+                        indices.push_back(vertexIndices[index + 2]);
                     }
-
-                    if (!objectCount) ++objectCount; // if we got at least one attribute, we have an object
                 }
+
+                if (chunk.hasKeywords) hasKeywords = true;
             }
 
-            if (objectCount)
+            if (hasKeywords)
             {
                 scene::StaticMeshData meshData(boundingBox, indices, vertices, material);
                 bundle.setStaticMeshData(objectName, std::move(meshData));
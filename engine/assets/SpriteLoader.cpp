@@ -32,11 +32,22 @@ namespace ouzel
             const json::Value& metaObject = d["meta"];
 
             auto imageFilename = metaObject["image"].as<std::string>();
-            spriteData.texture = cache.getTexture(imageFilename);
-            if (!spriteData.texture)
+
+            // frames of a sheet that was packed into an atlas are moved to its region
+            Vector2F atlasOffset;
+            if (const AtlasRegion* atlasRegion = cache.getAtlasRegion(imageFilename))
+            {
+                spriteData.texture = atlasRegion->texture;
+                atlasOffset = atlasRegion->rectangle.position;
+            }
+            else
             {
-                bundle.loadAsset(Loader::Image, imageFilename, imageFilename, mipmaps);
                 spriteData.texture = cache.getTexture(imageFilename);
+                if (!spriteData.texture)
+                {
+                    bundle.loadAsset(Loader::Image, imageFilename, imageFilename, mipmaps);
+                    spriteData.texture = cache.getTexture(imageFilename);
+                }
             }
 
             if (!spriteData.texture)
@@ -61,6 +72,7 @@ namespace ouzel
                                      static_cast<float>(frameRectangleObject["y"].as<std::int32_t>()),
                                      static_cast<float>(frameRectangleObject["w"].as<std::int32_t>()),
                                      static_cast<float>(frameRectangleObject["h"].as<std::int32_t>()));
+                frameRectangle.position += atlasOffset;
 
                 const json::Value& sourceSizeObject = frameObject["sourceSize"];
 
@@ -110,8 +122,8 @@ namespace ouzel
                         vertices.emplace_back(Vector3F{static_cast<float>(vertexObject[0].as<std::int32_t>()) + finalOffset.v[0],
                                                        -static_cast<float>(vertexObject[1].as<std::int32_t>()) - finalOffset.v[1], 0.0F},
                                               Color::white(),
-                                              Vector2F{static_cast<float>(vertexUVObject[0].as<std::int32_t>()) / textureSize.v[0],
-                                                       static_cast<float>(vertexUVObject[1].as<std::int32_t>()) / textureSize.v[1]},
+                                              Vector2F{(static_cast<float>(vertexUVObject[0].as<std::int32_t>()) + atlasOffset.v[0]) / textureSize.v[0],
+                                                       (static_cast<float>(vertexUVObject[1].as<std::int32_t>()) + atlasOffset.v[1]) / textureSize.v[1]},
                                               Vector3F{0.0F, 0.0F, -1.0F});
                     }
 
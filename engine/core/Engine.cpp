@@ -22,6 +22,7 @@
 #    include "opengl/ColorVSGLES3.h"
 #    include "opengl/TexturePSGLES3.h"
 #    include "opengl/TextureVSGLES3.h"
+#    include "opengl/TextureInstancedVSGLES3.h"
 #  else
 #    include "opengl/ColorPSGL2.h"
 #    include "opengl/ColorVSGL2.h"
@@ -31,10 +32,12 @@
 #    include "opengl/ColorVSGL3.h"
 #    include "opengl/TexturePSGL3.h"
 #    include "opengl/TextureVSGL3.h"
+#    include "opengl/TextureInstancedVSGL3.h"
 #    include "opengl/ColorPSGL4.h"
 #    include "opengl/ColorVSGL4.h"
 #    include "opengl/TexturePSGL4.h"
 #    include "opengl/TextureVSGL4.h"
+#    include "opengl/TextureInstancedVSGL4.h"
 #  endif
 #endif
 
@@ -126,6 +129,8 @@ namespace ouzel
         bool debugRenderer = false;
         bool exclusiveFullscreen = false;
         bool highDpi = true; // should high DPI resolution be used
+        std::size_t textureStreamingBudget = 0; // in megabytes, zero disables streaming
+        std::uint32_t framesInFlight = 1;
         bool debugAudio = false;
 
         if (fileSystem.fileExists("settings.ini"))
@@ -191,6 +196,12 @@ namespace ouzel
         const std::string highDpiValue = userEngineSection.getValue("highDpi", defaultEngineSection.getValue("highDpi"));
         if (!highDpiValue.empty()) highDpi = (highDpiValue == "true" || highDpiValue == "1" || highDpiValue == "yes");
 
+        const std::string textureStreamingBudgetValue = userEngineSection.getValue("textureStreamingBudget", defaultEngineSection.getValue("textureStreamingBudget"));
+        if (!textureStreamingBudgetValue.empty()) textureStreamingBudget = static_cast<std::size_t>(std::stoul(textureStreamingBudgetValue));
+
+        const std::string framesInFlightValue = userEngineSection.getValue("framesInFlight", defaultEngineSection.getValue("framesInFlight"));
+        if (!framesInFlightValue.empty()) framesInFlight = static_cast<std::uint32_t>(std::stoul(framesInFlightValue));
+
         const std::string audioDriverValue = userEngineSection.getValue("audioDriver", defaultEngineSection.getValue("audioDriver"));
 
         const std::string debugAudioValue = userEngineSection.getValue("debugAudio", defaultEngineSection.getValue("debugAudio"));
@@ -222,6 +233,9 @@ namespace ouzel
                                                         stencil,
                                                         debugRenderer);
 
+        renderer->getTextureStreamer().setBudget(textureStreamingBudget * 1024 * 1024);
+        renderer->setFramesInFlight(framesInFlight);
+
         audio::Driver audioDriver = audio::Audio::getDriver(audioDriverValue);
         audio = std::make_unique<audio::Audio>(audioDriver, debugAudio);
 
@@ -336,6 +350,78 @@ namespace ouzel
 
                 assetBundle.setShader(SHADER_TEXTURE, std::move(textureShader));
 
+                // OpenGL 2 and OpenGL ES 2 shaders can not declare matrix attributes
+                if (renderer->getDevice()->isInstancingSupported())
+                {
+                    std::unique_ptr<graphics::Shader> textureInstancedShader;
+
+                    switch (renderer->getDevice()->getAPIMajorVersion())
+                    {
+#  if OUZEL_OPENGLES
+                        case 3:
+                            textureInstancedShader = std::make_unique<graphics::Shader>(*renderer,
+                                                                                        std::vector<std::uint8_t>(std::begin(TexturePSGLES3_glsl),
+                                                                                                                  std::end(TexturePSGLES3_glsl)),
+                                                                                        std::vector<std::uint8_t>(std::begin(TextureInstancedVSGLES3_glsl),
+                                                                                                                  std::end(TextureInstancedVSGLES3_glsl)),
+                                                                                        std::set<graphics::Vertex::Attribute::Usage>{
+                                                                                            graphics::Vertex::Attribute::Usage::Position,
+                                                                                            graphics::Vertex::Attribute::Usage::Color,
+                                                                                            graphics::Vertex::Attribute::Usage::TextureCoordinates0
+                                                                                        },
+                                                                                        std::vector<std::pair<std::string, graphics::DataType>>{
+                                                                                            {"color", graphics::DataType::FloatVector4}
+                                                                                        },
+                                                                                        std::vector<std::pair<std::string, graphics::DataType>>{
+                                                                                            {"viewProjection", graphics::DataType::FloatMatrix4}
+                                                                                        });
+                            break;
+#  else
+                        case 3:
+                            textureInstancedShader = std::make_unique<graphics::Shader>(*renderer,
+                                                                                        std::vector<std::uint8_t>(std::begin(TexturePSGL3_glsl),
+                                                                                                                  std::end(TexturePSGL3_glsl)),
+                                                                                        std::vector<std::uint8_t>(std::begin(TextureInstancedVSGL3_glsl),
+                                                                                                                  std::end(TextureInstancedVSGL3_glsl)),
+                                                                                        std::set<graphics::Vertex::Attribute::Usage>{
+                                                                                            graphics::Vertex::Attribute::Usage::Position,
+                                                                                            graphics::Vertex::Attribute::Usage::Color,
+                                                                                            graphics::Vertex::Attribute::Usage::TextureCoordinates0
+                                                                                        },
+                                                                                        std::vector<std::pair<std::string, graphics::DataType>>{
+                                                                                            {"color", graphics::DataType::FloatVector4}
+                                                                                        },
+                                                                                        std::vector<std::pair<std::string, graphics::DataType>>{
+                                                                                            {"viewProjection", graphics::DataType::FloatMatrix4}
+                                                                                        });
+                            break;
+                        case 4:
+                            textureInstancedShader = std::make_unique<graphics::Shader>(*renderer,
+                                                                                        std::vector<std::uint8_t>(std::begin(TexturePSGL4_glsl),
+                                                                                                                  std::end(TexturePSGL4_glsl)),
+                                                                                        std::vector<std::uint8_t>(std::begin(TextureInstancedVSGL4_glsl),
+                                                                                                                  std::end(TextureInstancedVSGL4_glsl)),
+                                                                                        std::set<graphics::Vertex::Attribute::Usage>{
+                                                                                            graphics::Vertex::Attribute::Usage::Position,
+                                                                                            graphics::Vertex::Attribute::Usage::Color,
+                                                                                            graphics::Vertex::Attribute::Usage::TextureCoordinates0
+                                                                                        },
+                                                                                        std::vector<std::pair<std::string, graphics::DataType>>{
+                                                                                            {"color", graphics::DataType::FloatVector4}
+                                                                                        },
+                                                                                        std::vector<std::pair<std::string, graphics::DataType>>{
+                                                                                            {"viewProjection", graphics::DataType::FloatMatrix4}
+                                                                                        });
+                            break;
+#  endif
+                        default:
+                            break;
+                    }
+
+                    if (textureInstancedShader)
+                        assetBundle.setShader(SHADER_TEXTURE_INSTANCED, std::move(textureInstancedShader));
+                }
+
                 auto colorShader = std::make_unique<graphics::Shader>(*renderer);
 
                 switch (renderer->getDevice()->getAPIMajorVersion())
@@ -34,6 +34,7 @@ namespace ouzel
     std::unique_ptr<Application> main(const std::vector<std::string>& args);
 
     const std::string SHADER_TEXTURE = "shaderTexture";
+    const std::string SHADER_TEXTURE_INSTANCED = "shaderTextureInstanced";
     const std::string SHADER_COLOR = "shaderColor";
 
     const std::string BLEND_NO_BLEND = "blendNoBlend";
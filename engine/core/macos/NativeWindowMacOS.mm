@@ -172,6 +172,7 @@ namespace ouzel
         switch (graphicsDriver)
         {
             case graphics::Driver::Empty:
+            case graphics::Driver::Software:
                 view = [[ViewMacOS alloc] initWithFrame:windowFrame];
                 break;
 #if OUZEL_COMPILE_OPENGL
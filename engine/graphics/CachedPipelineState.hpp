@@ -0,0 +1,56 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_CACHEDPIPELINESTATE_HPP
+#define OUZEL_GRAPHICS_CACHEDPIPELINESTATE_HPP
+
+#include <cstdint>
+#include "Renderer.hpp"
+#include "RasterizerState.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        // Pipeline state of the combination that was drawn with last time. The renderer's cache is
+        // searched only when the combination changes or the renderer has deleted pipeline states since.
+        class CachedPipelineState final
+        {
+        public:
+            std::uintptr_t get(Renderer& renderer,
+                               std::uintptr_t newBlendState,
+                               std::uintptr_t newShader,
+                               CullMode newCullMode,
+                               FillMode newFillMode)
+            {
+                const std::uint32_t currentGeneration = renderer.getPipelineStateGeneration();
+
+                if (!pipelineState ||
+                    generation != currentGeneration ||
+                    blendState != newBlendState ||
+                    shader != newShader ||
+                    cullMode != newCullMode ||
+                    fillMode != newFillMode)
+                {
+                    pipelineState = renderer.getPipelineState(newBlendState, newShader, newCullMode, newFillMode);
+                    generation = currentGeneration;
+                    blendState = newBlendState;
+                    shader = newShader;
+                    cullMode = newCullMode;
+                    fillMode = newFillMode;
+                }
+
+                return pipelineState;
+            }
+
+        private:
+            std::uintptr_t pipelineState = 0;
+            std::uint32_t generation = 0;
+            std::uintptr_t blendState = 0;
+            std::uintptr_t shader = 0;
+            CullMode cullMode = CullMode::NoCull;
+            FillMode fillMode = FillMode::Solid;
+        };
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_CACHEDPIPELINESTATE_HPP
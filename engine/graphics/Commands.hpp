@@ -3,6 +3,7 @@
 #ifndef OUZEL_GRAPHICS_COMMANDS_HPP
 #define OUZEL_GRAPHICS_COMMANDS_HPP
 
+#include <memory>
 #include <queue>
 #include <string>
 #include "BlendFactor.hpp"
@@ -46,8 +47,10 @@ namespace ouzel
                 SetViewport,
                 InitDepthStencilState,
                 SetDepthStencilState,
+                InitPipelineState,
                 SetPipelineState,
                 Draw,
+                DrawInstanced,
                 PushDebugMarker,
                 PopDebugMarker,
                 InitBlendState,
@@ -315,14 +318,18 @@ namespace ouzel
             const std::uint32_t stencilReferenceValue;
         };
 
-        class SetPipelineStateCommand final: public Command
+        // immutable combination of the shader, blend and rasterizer states, the depth and stencil state and
+        // the stencil reference value stay separate, because they change per camera
+        class InitPipelineStateCommand final: public Command
         {
         public:
-            constexpr SetPipelineStateCommand(std::uintptr_t initBlendState,
-                                              std::uintptr_t initShader,
-                                              CullMode initCullMode,
-                                              FillMode initFillMode) noexcept:
-                Command(Command::Type::SetPipelineState),
+            constexpr InitPipelineStateCommand(std::uintptr_t initPipelineState,
+                                               std::uintptr_t initBlendState,
+                                               std::uintptr_t initShader,
+                                               CullMode initCullMode,
+                                               FillMode initFillMode) noexcept:
+                Command(Command::Type::InitPipelineState),
+                pipelineState(initPipelineState),
                 blendState(initBlendState),
                 shader(initShader),
                 cullMode(initCullMode),
@@ -330,12 +337,25 @@ namespace ouzel
             {
             }
 
+            const std::uintptr_t pipelineState;
             const std::uintptr_t blendState;
             const std::uintptr_t shader;
             const CullMode cullMode;
             const FillMode fillMode;
         };
 
+        class SetPipelineStateCommand final: public Command
+        {
+        public:
+            explicit constexpr SetPipelineStateCommand(std::uintptr_t initPipelineState) noexcept:
+                Command(Command::Type::SetPipelineState),
+                pipelineState(initPipelineState)
+            {
+            }
+
+            const std::uintptr_t pipelineState;
+        };
+
         class DrawCommand final: public Command
         {
         public:
@@ -363,6 +383,39 @@ namespace ouzel
             const std::uint32_t startIndex;
         };
 
+        class DrawInstancedCommand final: public Command
+        {
+        public:
+            constexpr DrawInstancedCommand(std::uintptr_t initIndexBuffer,
+                                           std::uint32_t initIndexCount,
+                                           std::uint32_t initIndexSize,
+                                           std::uintptr_t initVertexBuffer,
+                                           std::uintptr_t initInstanceBuffer,
+                                           std::uint32_t initInstanceCount,
+                                           DrawMode initDrawMode,
+                                           std::uint32_t initStartIndex) noexcept:
+                Command(Command::Type::DrawInstanced),
+                indexBuffer(initIndexBuffer),
+                indexCount(initIndexCount),
+                indexSize(initIndexSize),
+                vertexBuffer(initVertexBuffer),
+                instanceBuffer(initInstanceBuffer),
+                instanceCount(initInstanceCount),
+                drawMode(initDrawMode),
+                startIndex(initStartIndex)
+            {
+            }
+
+            const std::uintptr_t indexBuffer;
+            const std::uint32_t indexCount;
+            const std::uint32_t indexSize;
+            const std::uintptr_t vertexBuffer;
+            const std::uintptr_t instanceBuffer; // array of Instance
+            const std::uint32_t instanceCount;
+            const DrawMode drawMode;
+            const std::uint32_t startIndex;
+        };
+
         class PushDebugMarkerCommand final: public Command
         {
         public:
@@ -448,10 +501,10 @@ namespace ouzel
         {
         public:
             SetBufferDataCommand(std::uintptr_t initBuffer,
-                                 const std::vector<std::uint8_t>& initData) noexcept:
+                                 std::vector<std::uint8_t> initData) noexcept:
                 Command(Command::Type::SetBufferData),
                 buffer(initBuffer),
-                data(initData)
+                data(std::move(initData))
             {
             }
 
@@ -507,6 +560,10 @@ namespace ouzel
             const std::vector<std::vector<float>> vertexShaderConstants;
         };
 
+        // Held by the render device until the texture data of a command is uploaded,
+        // the sender keeps a weak pointer to it to find out when that happens
+        struct UploadToken final {};
+
         class InitTextureCommand final: public Command
         {
         public:
@@ -515,14 +572,16 @@ namespace ouzel
                                TextureType initTextureType,
                                std::uint32_t initFlags,
                                std::uint32_t initSampleCount,
-                               PixelFormat initPixelFormat) noexcept:
+                               PixelFormat initPixelFormat,
+                               std::shared_ptr<UploadToken> initUploadToken = nullptr) noexcept:
                 Command(Command::Type::InitTexture),
                 texture(initTexture),
                 levels(initLevels),
                 textureType(initTextureType),
                 flags(initFlags),
                 sampleCount(initSampleCount),
-                pixelFormat(initPixelFormat)
+                pixelFormat(initPixelFormat),
+                uploadToken(std::move(initUploadToken))
             {
             }
 
@@ -532,6 +591,7 @@ namespace ouzel
             const std::uint32_t flags;
             const std::uint32_t sampleCount;
             const PixelFormat pixelFormat;
+            const std::shared_ptr<UploadToken> uploadToken;
         };
 
         class SetTextureDataCommand final: public Command
@@ -548,17 +608,20 @@ namespace ouzel
 
             SetTextureDataCommand(std::uintptr_t initTexture,
                                   const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& initLevels,
-                                  CubeFace initFace) noexcept:
+                                  CubeFace initFace,
+                                  std::shared_ptr<UploadToken> initUploadToken = nullptr) noexcept:
                 Command(Command::Type::SetTextureData),
                 texture(initTexture),
                 levels(initLevels),
-                face(initFace)
+                face(initFace),
+                uploadToken(std::move(initUploadToken))
             {
             }
 
             const std::uintptr_t texture;
             const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels;
             const CubeFace face;
+            const std::shared_ptr<UploadToken> uploadToken;
         };
 
         class SetTextureParametersCommand final: public Command
@@ -621,6 +684,16 @@ namespace ouzel
                 commands.push(std::move(command));
             }
 
+            // moves the commands of the other buffer to the end of this one
+            inline void append(CommandBuffer& other)
+            {
+                while (!other.commands.empty())
+                {
+                    commands.push(std::move(other.commands.front()));
+                    other.commands.pop();
+                }
+            }
+
             inline std::unique_ptr<Command> popCommand()
             {
                 auto result = std::move(commands.front());
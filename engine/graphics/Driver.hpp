@@ -12,7 +12,8 @@ namespace ouzel
             Empty,
             OpenGL,
             Direct3D11,
-            Metal
+            Metal,
+            Software
         };
     } // namespace graphics
 } // namespace ouzel
@@ -0,0 +1,131 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <algorithm>
+#include "FrameCapture.hpp"
+#include "../core/Engine.hpp"
+#include "../utils/Log.hpp"
+#include "stb_image_write.h"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        FrameCapture::~FrameCapture()
+        {
+            std::unique_lock<std::mutex> lock(frameMutex);
+            running = false;
+            lock.unlock();
+            frameCondition.notify_all();
+
+            // the queued frames are written before the thread exits
+            if (encodeThread.isJoinable()) encodeThread.join();
+        }
+
+        void FrameCapture::saveScreenshot(const std::string& filename)
+        {
+            screenshotFilenames.push_back(filename);
+        }
+
+        void FrameCapture::start(const std::string& filenamePrefix, std::uint32_t frameInterval)
+        {
+            prefix = filenamePrefix;
+            interval = frameInterval;
+            frameNumber = 0;
+        }
+
+        void FrameCapture::stop()
+        {
+            interval = 0;
+        }
+
+        std::vector<std::string> FrameCapture::nextFrame(std::size_t pendingFrames)
+        {
+            std::vector<std::string> filenames = std::move(screenshotFilenames);
+            screenshotFilenames.clear();
+
+            if (interval && frameNumber++ % interval == 0)
+            {
+                std::unique_lock<std::mutex> lock(frameMutex);
+                const std::size_t queuedFrames = pendingFrames + frames.size() + encodingFrames;
+                lock.unlock();
+
+                // screenshots are always saved, but the capture skips frames instead of piling them up in memory
+                if (queuedFrames < maxQueuedFrames)
+                {
+                    std::string number = std::to_string(frameNumber - 1);
+                    if (number.size() < 6) number.insert(0, 6 - number.size(), '0');
+                    filenames.push_back(prefix + number + ".png");
+                }
+                else
+                    engine->log(Log::Level::Warning) << "Frame " << frameNumber - 1 << " not captured, the capture is falling behind";
+            }
+
+            return filenames;
+        }
+
+        void FrameCapture::encode(Frame frame)
+        {
+            std::unique_lock<std::mutex> lock(frameMutex);
+            frames.push(std::move(frame));
+
+            if (!running)
+            {
+                running = true;
+                encodeThread = Thread(&FrameCapture::encodeMain, this);
+            }
+
+            lock.unlock();
+            frameCondition.notify_all();
+        }
+
+        void FrameCapture::encodeMain()
+        {
+            Thread::setCurrentThreadName("Capture");
+
+            std::vector<std::uint8_t> image;
+
+            for (;;)
+            {
+                std::unique_lock<std::mutex> lock(frameMutex);
+                while (running && frames.empty()) frameCondition.wait(lock);
+                if (frames.empty()) break;
+
+                Frame frame = std::move(frames.front());
+                frames.pop();
+                ++encodingFrames;
+                lock.unlock();
+
+                // convert to top-down RGBA rows without padding
+                const std::size_t rowSize = frame.width * 4;
+                image.resize(rowSize * frame.height);
+
+                for (std::uint32_t y = 0; y < frame.height; ++y)
+                {
+                    const std::uint8_t* sourceRow = frame.data.data() +
+                        static_cast<std::size_t>(frame.bottomUp ? frame.height - y - 1 : y) * frame.pitch;
+                    std::uint8_t* destinationRow = image.data() + y * rowSize;
+
+                    std::copy(sourceRow, sourceRow + rowSize, destinationRow);
+
+                    if (frame.bgra || frame.opaque)
+                        for (std::size_t x = 0; x < rowSize; x += 4)
+                        {
+                            if (frame.bgra) std::swap(destinationRow[x], destinationRow[x + 2]);
+                            if (frame.opaque) destinationRow[x + 3] = 255;
+                        }
+                }
+
+                for (const std::string& filename : frame.filenames)
+                    if (!stbi_write_png(filename.c_str(),
+                                        static_cast<int>(frame.width),
+                                        static_cast<int>(frame.height), 4,
+                                        image.data(),
+                                        static_cast<int>(rowSize)))
+                        engine->log(Log::Level::Error) << "Failed to save image to file " << filename;
+
+                lock.lock();
+                --encodingFrames;
+            }
+        }
+    } // namespace graphics
+} // namespace ouzel
@@ -0,0 +1,80 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_FRAMECAPTURE_HPP
+#define OUZEL_GRAPHICS_FRAMECAPTURE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+#include "../utils/Thread.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        // Decides which presented frames are saved and writes them to PNG files on its own thread.
+        // The render devices read the frames back asynchronously and pass them to encode once the
+        // data has arrived, so capturing never waits for the GPU or the disk.
+        class FrameCapture final
+        {
+        public:
+            struct Frame final
+            {
+                std::vector<std::string> filenames;
+                std::uint32_t width = 0;
+                std::uint32_t height = 0;
+                std::uint32_t pitch = 0; // bytes between the starts of two rows
+                std::vector<std::uint8_t> data; // 8-bit RGBA pixels
+                bool bottomUp = false; // the first row is the bottom of the image
+                bool bgra = false; // the red and blue channels are swapped
+                bool opaque = false; // the alpha channel is undefined
+            };
+
+            static constexpr std::size_t maxQueuedFrames = 4;
+
+            FrameCapture() = default;
+            ~FrameCapture();
+
+            FrameCapture(const FrameCapture&) = delete;
+            FrameCapture& operator=(const FrameCapture&) = delete;
+            FrameCapture(FrameCapture&&) = delete;
+            FrameCapture& operator=(FrameCapture&&) = delete;
+
+            // saves the next presented frame, called by the render thread
+            void saveScreenshot(const std::string& filename);
+
+            // saves every frameInterval-th presented frame to prefix + frame number + ".png", called by the render thread
+            void start(const std::string& filenamePrefix, std::uint32_t frameInterval);
+            void stop();
+
+            // Called by the render thread when a frame is presented, returns the files the frame has to be
+            // saved to, if any. pendingFrames is the number of read backs that the device has not passed to
+            // encode yet. Frames of the continuous capture are skipped while the read backs and the encoder
+            // fall behind.
+            std::vector<std::string> nextFrame(std::size_t pendingFrames);
+
+            // queues the frame for encoding, can be called by any thread
+            void encode(Frame frame);
+
+        private:
+            void encodeMain();
+
+            std::vector<std::string> screenshotFilenames;
+            std::string prefix;
+            std::uint32_t interval = 0; // zero when the continuous capture is stopped
+            std::uint64_t frameNumber = 0; // frames presented since the start of the continuous capture
+
+            std::mutex frameMutex;
+            std::condition_variable frameCondition;
+            std::queue<Frame> frames;
+            std::size_t encodingFrames = 0; // frames taken from the queue and not written yet
+            bool running = false;
+            Thread encodeThread;
+        };
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_FRAMECAPTURE_HPP
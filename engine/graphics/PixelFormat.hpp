@@ -3,6 +3,8 @@
 #ifndef OUZEL_GRAPHICS_PIXELFORMAT_HPP
 #define OUZEL_GRAPHICS_PIXELFORMAT_HPP
 
+#include <cstdint>
+
 namespace ouzel
 {
     namespace graphics
@@ -40,10 +42,74 @@ namespace ouzel
             RGBA32UInt,
             RGBA32SInt,
             RGBA32Float,
+            BC1RGBAUNorm,
+            BC1RGBAUNormSRGB,
+            BC2RGBAUNorm,
+            BC2RGBAUNormSRGB,
+            BC3RGBAUNorm,
+            BC3RGBAUNormSRGB,
+            BC4RUNorm,
+            BC5RGUNorm,
+            BC7RGBAUNorm,
+            BC7RGBAUNormSRGB,
+            ETC2RGB8UNorm,
+            ETC2RGB8UNormSRGB,
+            ETC2RGBA8UNorm,
+            ETC2RGBA8UNormSRGB,
+            ASTC4x4UNorm,
+            ASTC4x4UNormSRGB,
+            ASTC8x8UNorm,
+            ASTC8x8UNormSRGB,
             Depth,
             DepthStencil
         };
 
+        inline bool isCompressed(PixelFormat pixelFormat)
+        {
+            switch (pixelFormat)
+            {
+                case PixelFormat::BC1RGBAUNorm:
+                case PixelFormat::BC1RGBAUNormSRGB:
+                case PixelFormat::BC2RGBAUNorm:
+                case PixelFormat::BC2RGBAUNormSRGB:
+                case PixelFormat::BC3RGBAUNorm:
+                case PixelFormat::BC3RGBAUNormSRGB:
+                case PixelFormat::BC4RUNorm:
+                case PixelFormat::BC5RGUNorm:
+                case PixelFormat::BC7RGBAUNorm:
+                case PixelFormat::BC7RGBAUNormSRGB:
+                case PixelFormat::ETC2RGB8UNorm:
+                case PixelFormat::ETC2RGB8UNormSRGB:
+                case PixelFormat::ETC2RGBA8UNorm:
+                case PixelFormat::ETC2RGBA8UNormSRGB:
+                case PixelFormat::ASTC4x4UNorm:
+                case PixelFormat::ASTC4x4UNormSRGB:
+                case PixelFormat::ASTC8x8UNorm:
+                case PixelFormat::ASTC8x8UNormSRGB:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // width and height of the block in pixels (1x1 for uncompressed formats)
+        inline std::uint32_t getBlockWidth(PixelFormat pixelFormat)
+        {
+            switch (pixelFormat)
+            {
+                case PixelFormat::ASTC8x8UNorm:
+                case PixelFormat::ASTC8x8UNormSRGB:
+                    return 8;
+                default:
+                    return isCompressed(pixelFormat) ? 4 : 1;
+            }
+        }
+
+        inline std::uint32_t getBlockHeight(PixelFormat pixelFormat)
+        {
+            return getBlockWidth(pixelFormat);
+        }
+
         inline std::uint32_t getPixelSize(PixelFormat pixelFormat)
         {
             switch (pixelFormat)
@@ -159,17 +225,36 @@ namespace ouzel
                 case PixelFormat::R32UInt:
                 case PixelFormat::R32SInt:
                 case PixelFormat::R32Float:
+                case PixelFormat::BC4RUNorm:
                     return 1;
                 case PixelFormat::RG8UNorm:
                 case PixelFormat::RG8SNorm:
                 case PixelFormat::RG8UInt:
                 case PixelFormat::RG8SInt:
+                case PixelFormat::BC5RGUNorm:
                     return 2;
+                case PixelFormat::ETC2RGB8UNorm:
+                case PixelFormat::ETC2RGB8UNormSRGB:
+                    return 3;
                 case PixelFormat::RGBA8UNorm:
                 case PixelFormat::RGBA8UNormSRGB:
                 case PixelFormat::RGBA8SNorm:
                 case PixelFormat::RGBA8UInt:
                 case PixelFormat::RGBA8SInt:
+                case PixelFormat::BC1RGBAUNorm:
+                case PixelFormat::BC1RGBAUNormSRGB:
+                case PixelFormat::BC2RGBAUNorm:
+                case PixelFormat::BC2RGBAUNormSRGB:
+                case PixelFormat::BC3RGBAUNorm:
+                case PixelFormat::BC3RGBAUNormSRGB:
+                case PixelFormat::BC7RGBAUNorm:
+                case PixelFormat::BC7RGBAUNormSRGB:
+                case PixelFormat::ETC2RGBA8UNorm:
+                case PixelFormat::ETC2RGBA8UNormSRGB:
+                case PixelFormat::ASTC4x4UNorm:
+                case PixelFormat::ASTC4x4UNormSRGB:
+                case PixelFormat::ASTC8x8UNorm:
+                case PixelFormat::ASTC8x8UNormSRGB:
                 case PixelFormat::RGBA16UNorm:
                 case PixelFormat::RGBA16SNorm:
                 case PixelFormat::RGBA16UInt:
@@ -188,6 +273,54 @@ namespace ouzel
                     return 0;
             }
         }
+
+        // size of the block in bytes (size of the pixel for uncompressed formats)
+        inline std::uint32_t getBlockSize(PixelFormat pixelFormat)
+        {
+            switch (pixelFormat)
+            {
+                case PixelFormat::BC1RGBAUNorm:
+                case PixelFormat::BC1RGBAUNormSRGB:
+                case PixelFormat::BC4RUNorm:
+                case PixelFormat::ETC2RGB8UNorm:
+                case PixelFormat::ETC2RGB8UNormSRGB:
+                    return 8;
+                case PixelFormat::BC2RGBAUNorm:
+                case PixelFormat::BC2RGBAUNormSRGB:
+                case PixelFormat::BC3RGBAUNorm:
+                case PixelFormat::BC3RGBAUNormSRGB:
+                case PixelFormat::BC5RGUNorm:
+                case PixelFormat::BC7RGBAUNorm:
+                case PixelFormat::BC7RGBAUNormSRGB:
+                case PixelFormat::ETC2RGBA8UNorm:
+                case PixelFormat::ETC2RGBA8UNormSRGB:
+                case PixelFormat::ASTC4x4UNorm:
+                case PixelFormat::ASTC4x4UNormSRGB:
+                case PixelFormat::ASTC8x8UNorm:
+                case PixelFormat::ASTC8x8UNormSRGB:
+                    return 16;
+                default:
+                    return getPixelSize(pixelFormat);
+            }
+        }
+
+        // number of bytes in a row of blocks
+        inline std::uint32_t getRowPitch(PixelFormat pixelFormat, std::uint32_t width)
+        {
+            const std::uint32_t blockWidth = getBlockWidth(pixelFormat);
+            return (width + blockWidth - 1) / blockWidth * getBlockSize(pixelFormat);
+        }
+
+        inline std::uint32_t getRowCount(PixelFormat pixelFormat, std::uint32_t height)
+        {
+            const std::uint32_t blockHeight = getBlockHeight(pixelFormat);
+            return (height + blockHeight - 1) / blockHeight;
+        }
+
+        inline std::uint32_t getLevelSize(PixelFormat pixelFormat, std::uint32_t width, std::uint32_t height)
+        {
+            return getRowPitch(pixelFormat, width) * getRowCount(pixelFormat, height);
+        }
     } // namespace graphics
 } // namespace ouzel
 
@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include "RenderDevice.hpp"
+#include "../core/Engine.hpp"
+#include "../utils/Log.hpp"
 
 namespace ouzel
 {
@@ -24,7 +26,13 @@ namespace ouzel
             renderTargetsSupported(false),
             clampToBorderSupported(false),
             multisamplingSupported(false),
-            uintIndicesSupported(false)
+            uintIndicesSupported(false),
+            dxtTexturesSupported(false),
+            rgtcTexturesSupported(false),
+            bptcTexturesSupported(false),
+            etc2TexturesSupported(false),
+            astcTexturesSupported(false),
+            instancingSupported(false)
         {
         }
 
@@ -78,13 +86,58 @@ namespace ouzel
             }
         }
 
+        bool RenderDevice::isCompressedFormatSupported(PixelFormat pixelFormat) const noexcept
+        {
+            switch (pixelFormat)
+            {
+                case PixelFormat::BC1RGBAUNorm:
+                case PixelFormat::BC1RGBAUNormSRGB:
+                case PixelFormat::BC2RGBAUNorm:
+                case PixelFormat::BC2RGBAUNormSRGB:
+                case PixelFormat::BC3RGBAUNorm:
+                case PixelFormat::BC3RGBAUNormSRGB:
+                    return dxtTexturesSupported;
+                case PixelFormat::BC4RUNorm:
+                case PixelFormat::BC5RGUNorm:
+                    return rgtcTexturesSupported;
+                case PixelFormat::BC7RGBAUNorm:
+                case PixelFormat::BC7RGBAUNormSRGB:
+                    return bptcTexturesSupported;
+                case PixelFormat::ETC2RGB8UNorm:
+                case PixelFormat::ETC2RGB8UNormSRGB:
+                case PixelFormat::ETC2RGBA8UNorm:
+                case PixelFormat::ETC2RGBA8UNormSRGB:
+                    return etc2TexturesSupported;
+                case PixelFormat::ASTC4x4UNorm:
+                case PixelFormat::ASTC4x4UNormSRGB:
+                case PixelFormat::ASTC8x8UNorm:
+                case PixelFormat::ASTC8x8UNormSRGB:
+                    return astcTexturesSupported;
+                default:
+                    return false;
+            }
+        }
+
         std::vector<Size2U> RenderDevice::getSupportedResolutions() const
         {
             return std::vector<Size2U>();
         }
 
-        void RenderDevice::generateScreenshot(const std::string&)
+        void RenderDevice::setPassTimings(std::vector<PassTiming> newPassTimings)
         {
+            // every region name is a trace event with the nesting depth and the duration in nanoseconds
+            for (const auto& passTiming : newPassTimings)
+            {
+                auto& passTimingEvent = passTimingEvents[passTiming.name];
+                if (!passTimingEvent)
+                    passTimingEvent = std::make_unique<trace::Event<std::uint32_t, std::uint64_t>>("gpu:" + passTiming.name,
+                                                                                                  std::array<std::string, 2>{{"depth", "duration"}});
+
+                engine->getLogger().trace(*passTimingEvent, passTiming.depth, passTiming.duration);
+            }
+
+            std::lock_guard<std::mutex> lock(passTimingMutex);
+            passTimings = std::move(newPassTimings);
         }
 
         void RenderDevice::executeOnRenderThread(const std::function<void()>& func)
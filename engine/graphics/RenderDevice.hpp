@@ -7,15 +7,21 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <set>
+#include <string>
+#include <vector>
 #include "Commands.hpp"
 #include "Driver.hpp"
+#include "FrameCapture.hpp"
 #include "SamplerFilter.hpp"
 #include "Vertex.hpp"
 #include "../math/Matrix.hpp"
 #include "../math/Size.hpp"
+#include "../utils/Trace.hpp"
 
 namespace ouzel
 {
@@ -84,7 +90,7 @@ namespace ouzel
 
             virtual std::vector<Size2U> getSupportedResolutions() const;
 
-            void submitCommandBuffer(CommandBuffer&& commandBuffer)
+            virtual void submitCommandBuffer(CommandBuffer&& commandBuffer)
             {
                 std::unique_lock<std::mutex> lock(commandQueueMutex);
                 commandQueue.push(std::move(commandBuffer));
@@ -94,12 +100,30 @@ namespace ouzel
 
             inline auto getDrawCallCount() const noexcept { return drawCallCount; }
 
+            // GPU time of a region between pushDebugMarker and popDebugMarker
+            struct PassTiming final
+            {
+                std::string name;
+                std::uint32_t depth = 0; // number of the enclosing regions
+                std::uint64_t duration = 0; // nanoseconds
+            };
+
+            // timings of the most recent frame whose results are available, a few frames behind the
+            // rendered one, in the order the regions were started
+            std::vector<PassTiming> getPassTimings() const
+            {
+                std::lock_guard<std::mutex> lock(passTimingMutex);
+                return passTimings;
+            }
+
             inline auto getAPIMajorVersion() const noexcept { return apiVersion.v[0]; }
             inline auto getAPIMinorVersion() const noexcept { return apiVersion.v[1]; }
 
             inline auto isNPOTTexturesSupported() const noexcept { return npotTexturesSupported; }
             inline auto isAnisotropicFilteringSupported() const noexcept { return anisotropicFilteringSupported; }
             inline auto isRenderTargetsSupported() const noexcept { return renderTargetsSupported; }
+            inline auto isInstancingSupported() const noexcept { return instancingSupported; }
+            bool isCompressedFormatSupported(PixelFormat pixelFormat) const noexcept;
 
             auto& getProjectionTransform(bool renderTarget) const noexcept
             {
@@ -156,21 +180,26 @@ namespace ouzel
                 std::function<void(std::uintptr_t)> deleter;
             };
 
+            // Resources can be created and released by the command encoder threads. The renderer deletes
+            // released resources at the end of the frame and their ids are reused when that frame is rendered.
             Resource createResource()
             {
+                std::lock_guard<std::mutex> lock(resourceMutex);
+
+                const auto deleter = [this](std::uintptr_t id){
+                    std::lock_guard<std::mutex> deleterLock(resourceMutex);
+                    releasedResourceIds.push_back(id);
+                };
+
                 auto i = deletedResourceIds.begin();
 
                 if (i == deletedResourceIds.end())
-                    return Resource(++lastResourceId, [this](std::uintptr_t id){
-                        deletedResourceIds.insert(id);
-                    }); // zero is reserved for null resource
+                    return Resource(++lastResourceId, deleter); // zero is reserved for null resource
                 else
                 {
                     std::uintptr_t resourceId = *i;
                     deletedResourceIds.erase(i);
-                    return Resource(resourceId, [this](std::uintptr_t id){
-                        deletedResourceIds.insert(id);
-                    });
+                    return Resource(resourceId, deleter);
                 }
             }
 
@@ -188,7 +217,8 @@ namespace ouzel
 
             void executeAll();
 
-            virtual void generateScreenshot(const std::string& filename);
+            // called by the render thread, also writes the timings to the trace
+            void setPassTimings(std::vector<PassTiming> newPassTimings);
 
             Driver driver;
             std::function<void(const Event&)> callback;
@@ -214,6 +244,12 @@ namespace ouzel
             bool clampToBorderSupported:1;
             bool multisamplingSupported:1;
             bool uintIndicesSupported:1;
+            bool dxtTexturesSupported:1; // BC1, BC2 and BC3
+            bool rgtcTexturesSupported:1; // BC4 and BC5
+            bool bptcTexturesSupported:1; // BC7
+            bool etc2TexturesSupported:1;
+            bool astcTexturesSupported:1;
+            bool instancingSupported:1;
 
             Matrix4F projectionTransform = Matrix4F::identity();
             Matrix4F renderTargetProjectionTransform = Matrix4F::identity();
@@ -234,9 +270,18 @@ namespace ouzel
             std::queue<std::function<void()>> executeQueue;
             std::mutex executeMutex;
 
+            mutable std::mutex passTimingMutex;
+            std::vector<PassTiming> passTimings;
+            std::map<std::string, std::unique_ptr<trace::Event<std::uint32_t, std::uint64_t>>> passTimingEvents;
+
+            // the devices read the frames it selects back at present and pass them to it for saving
+            FrameCapture frameCapture;
+
         private:
+            std::mutex resourceMutex;
             std::uintptr_t lastResourceId = 0;
             std::set<std::uintptr_t> deletedResourceIds;
+            std::vector<std::uintptr_t> releasedResourceIds; // released in the frame that is being recorded
         };
     } // namespace graphics
 } // namespace ouzel
@@ -3,7 +3,9 @@
 #if defined(__APPLE__)
 #  include <TargetConditionals.h>
 #endif
+#include <algorithm>
 #include <stdexcept>
+#include <thread>
 #include "../core/Setup.h"
 #include "Renderer.hpp"
 #include "Commands.hpp"
@@ -37,11 +39,14 @@
 #include "opengl/OGLRenderDevice.hpp"
 #include "direct3d11/D3D11RenderDevice.hpp"
 #include "metal/MetalRenderDevice.hpp"
+#include "software/SoftwareRenderDevice.hpp"
 
 namespace ouzel
 {
     namespace graphics
     {
+        thread_local CommandBuffer* Renderer::recordingBuffer = nullptr;
+
         Driver Renderer::getDriver(const std::string& driver)
         {
             if (driver.empty() || driver == "default")
@@ -65,6 +70,8 @@ namespace ouzel
                 return Driver::Direct3D11;
             else if (driver == "metal")
                 return Driver::Metal;
+            else if (driver == "software")
+                return Driver::Software;
             else
                 throw std::runtime_error("Invalid graphics driver");
         }
@@ -76,6 +83,7 @@ namespace ouzel
             if (availableDrivers.empty())
             {
                 availableDrivers.insert(Driver::Empty);
+                availableDrivers.insert(Driver::Software);
 
 #if OUZEL_COMPILE_OPENGL
                 availableDrivers.insert(Driver::OpenGL);
@@ -102,7 +110,8 @@ namespace ouzel
                            bool newVerticalSync,
                            bool newDepth,
                            bool newStencil,
-                           bool newDebugRenderer)
+                           bool newDebugRenderer):
+            textureStreamer(*this)
         {
             switch (driver)
             {
@@ -146,6 +155,10 @@ namespace ouzel
 #  endif
                     break;
 #endif
+                case Driver::Software:
+                    engine->log(Log::Level::Info) << "Using software render driver";
+                    device = std::make_unique<software::RenderDevice>(std::bind(&Renderer::handleEvent, this, std::placeholders::_1));
+                    break;
                 default:
                     engine->log(Log::Level::Info) << "Not using render driver";
                     device = std::make_unique<empty::RenderDevice>(std::bind(&Renderer::handleEvent, this, std::placeholders::_1));
@@ -164,6 +177,22 @@ namespace ouzel
                          newDepth,
                          newStencil,
                          newDebugRenderer);
+
+#if !defined(__EMSCRIPTEN__)
+            // more threads than this do not pay off, because the merge and the submit are serial
+            const std::size_t hardwareThreads = std::thread::hardware_concurrency();
+            if (hardwareThreads > 1) maxEncoderThreads = std::min(hardwareThreads - 1, std::size_t{7});
+#endif
+        }
+
+        Renderer::~Renderer()
+        {
+            std::unique_lock<std::mutex> lock(encoderMutex);
+            encoderRunning = false;
+            lock.unlock();
+            encoderCondition.notify_all();
+
+            encoderThreads.clear(); // joins the threads
         }
 
         void Renderer::handleEvent(const RenderDevice::Event& event)
@@ -171,13 +200,36 @@ namespace ouzel
             if (event.type == RenderDevice::Event::Type::Frame)
             {
                 std::unique_lock<std::mutex> lock(frameMutex);
+
+                // every frame event but the first one means that the oldest frame in flight has been rendered
+                if (renderStarted && !retiredResourceIds.empty())
+                {
+                    std::unique_lock<std::mutex> resourceLock(device->resourceMutex);
+                    device->deletedResourceIds.insert(retiredResourceIds.front().begin(),
+                                                      retiredResourceIds.front().end());
+                    resourceLock.unlock();
+
+                    retiredResourceIds.pop();
+                }
+
+                renderStarted = true;
                 newFrame = true;
-                refillQueue = true;
+                refillQueue = retiredResourceIds.size() < framesInFlight;
                 lock.unlock();
                 frameCondition.notify_all();
             }
         }
 
+        void Renderer::setFramesInFlight(std::uint32_t newFramesInFlight)
+        {
+            if (newFramesInFlight < 1 || newFramesInFlight > 3)
+                throw std::runtime_error("Invalid frames in flight count");
+
+            std::lock_guard<std::mutex> lock(frameMutex);
+            framesInFlight = newFramesInFlight;
+            refillQueue = retiredResourceIds.size() < framesInFlight;
+        }
+
         void Renderer::setSize(const Size2U& newSize)
         {
             size = newSize;
@@ -187,7 +239,29 @@ namespace ouzel
 
         void Renderer::saveScreenshot(const std::string& filename)
         {
-            device->executeOnRenderThread(std::bind(&RenderDevice::generateScreenshot, device.get(), filename));
+            RenderDevice* renderDevice = device.get();
+            device->executeOnRenderThread([renderDevice, filename]() {
+                renderDevice->frameCapture.saveScreenshot(filename);
+            });
+        }
+
+        void Renderer::startCapture(const std::string& filenamePrefix, std::uint32_t frameInterval)
+        {
+            if (!frameInterval)
+                throw std::runtime_error("Invalid frame interval");
+
+            RenderDevice* renderDevice = device.get();
+            device->executeOnRenderThread([renderDevice, filenamePrefix, frameInterval]() {
+                renderDevice->frameCapture.start(filenamePrefix, frameInterval);
+            });
+        }
+
+        void Renderer::stopCapture()
+        {
+            RenderDevice* renderDevice = device.get();
+            device->executeOnRenderThread([renderDevice]() {
+                renderDevice->frameCapture.stop();
+            });
         }
 
         void Renderer::setRenderTarget(std::uintptr_t renderTarget)
@@ -227,15 +301,31 @@ namespace ouzel
                                                                      stencilReferenceValue));
         }
 
-        void Renderer::setPipelineState(std::uintptr_t blendState,
-                                        std::uintptr_t shader,
-                                        CullMode cullMode,
-                                        FillMode fillMode)
+        std::uintptr_t Renderer::getPipelineState(std::uintptr_t blendState,
+                                                  std::uintptr_t shader,
+                                                  CullMode cullMode,
+                                                  FillMode fillMode)
         {
-            addCommand(std::make_unique<SetPipelineStateCommand>(blendState,
-                                                                 shader,
-                                                                 cullMode,
-                                                                 fillMode));
+            const PipelineStateKey key{blendState, shader, cullMode, fillMode};
+
+            std::lock_guard<std::mutex> lock(pipelineStateMutex);
+
+            auto i = pipelineStates.find(key);
+            if (i != pipelineStates.end()) return i->second;
+
+            RenderDevice::Resource pipelineState = device->createResource();
+            pipelineStateCommands.pushCommand(std::make_unique<InitPipelineStateCommand>(pipelineState,
+                                                                                         blendState,
+                                                                                         shader,
+                                                                                         cullMode,
+                                                                                         fillMode));
+
+            return pipelineStates.insert(std::make_pair(key, std::move(pipelineState))).first->second;
+        }
+
+        void Renderer::setPipelineState(std::uintptr_t pipelineState)
+        {
+            addCommand(std::make_unique<SetPipelineStateCommand>(pipelineState));
         }
 
         void Renderer::draw(std::uintptr_t indexBuffer,
@@ -256,6 +346,31 @@ namespace ouzel
                                                      startIndex));
         }
 
+        void Renderer::drawInstanced(std::uintptr_t indexBuffer,
+                                     std::uint32_t indexCount,
+                                     std::uint32_t indexSize,
+                                     std::uintptr_t vertexBuffer,
+                                     std::uintptr_t instanceBuffer,
+                                     std::uint32_t instanceCount,
+                                     DrawMode drawMode,
+                                     std::uint32_t startIndex)
+        {
+            if (!indexBuffer || !vertexBuffer || !instanceBuffer)
+                throw std::runtime_error("Invalid mesh buffer passed to render queue");
+
+            if (!device->isInstancingSupported())
+                throw std::runtime_error("Instancing is not supported");
+
+            addCommand(std::make_unique<DrawInstancedCommand>(indexBuffer,
+                                                              indexCount,
+                                                              indexSize,
+                                                              vertexBuffer,
+                                                              instanceBuffer,
+                                                              instanceCount,
+                                                              drawMode,
+                                                              startIndex));
+        }
+
         void Renderer::pushDebugMarker(const std::string& name)
         {
             addCommand(std::make_unique<PushDebugMarkerCommand>(name));
@@ -275,17 +390,163 @@ namespace ouzel
 
         void Renderer::setTextures(const std::vector<std::uintptr_t>& textures)
         {
+            if (textureStreamer.isEnabled()) textureStreamer.markUsed(textures);
+
             addCommand(std::make_unique<SetTexturesCommand>(textures));
         }
 
         void Renderer::present()
         {
-            refillQueue = false;
+            textureStreamer.update();
+
+            std::unique_lock<std::mutex> resourceLock(device->resourceMutex);
+            std::vector<std::uintptr_t> releasedResourceIds;
+            releasedResourceIds.swap(device->releasedResourceIds);
+            resourceLock.unlock();
+
+            std::unique_lock<std::mutex> pipelineStateLock(pipelineStateMutex);
+
+            if (!pipelineStateCommands.isEmpty())
+            {
+                pipelineStateCommands.append(commandBuffer);
+                commandBuffer = std::move(pipelineStateCommands);
+                pipelineStateCommands = CommandBuffer();
+            }
+
+            // the pipeline states of the released states are deleted with the next frame
+            if (!releasedResourceIds.empty())
+            {
+                const std::size_t pipelineStateCount = pipelineStates.size();
+
+                for (auto i = pipelineStates.begin(); i != pipelineStates.end();)
+                {
+                    if (std::find(releasedResourceIds.begin(), releasedResourceIds.end(), i->first.blendState) != releasedResourceIds.end() ||
+                        std::find(releasedResourceIds.begin(), releasedResourceIds.end(), i->first.shader) != releasedResourceIds.end())
+                        i = pipelineStates.erase(i);
+                    else
+                        ++i;
+                }
+
+                // the ids of the deleted states can be reused, so the cached handles have to be looked up again
+                if (pipelineStates.size() != pipelineStateCount) ++pipelineStateGeneration;
+            }
+
+            pipelineStateLock.unlock();
+
+            for (const auto resourceId : releasedResourceIds)
+                addCommand(std::make_unique<DeleteResourceCommand>(resourceId));
+
             addCommand(std::make_unique<PresentCommand>());
+
+            // the frame has to be counted before the render thread can finish it
+            std::unique_lock<std::mutex> lock(frameMutex);
+            retiredResourceIds.push(std::move(releasedResourceIds));
+            refillQueue = retiredResourceIds.size() < framesInFlight;
+            lock.unlock();
+
             device->submitCommandBuffer(std::move(commandBuffer));
             commandBuffer = CommandBuffer();
         }
 
+        void Renderer::encodeParallel(std::size_t count, const std::function<void(std::size_t)>& encode)
+        {
+            if (count > getEncoderCount())
+                throw std::runtime_error("Too many parallel encodes");
+
+            if (count <= 1)
+            {
+                if (count) encode(0);
+                return;
+            }
+
+            if (encoderThreads.empty())
+            {
+                encoderBuffers = std::vector<CommandBuffer>(getEncoderCount());
+
+                for (std::size_t i = 0; i < maxEncoderThreads; ++i)
+                    encoderThreads.emplace_back(&Renderer::encoderLoop, this, i + 1);
+            }
+
+            std::unique_lock<std::mutex> lock(encoderMutex);
+            encodeFunction = &encode;
+            encodeCount = count;
+            encodeException = nullptr;
+            pendingEncoders = encoderThreads.size();
+            ++encodeGeneration;
+            lock.unlock();
+            encoderCondition.notify_all();
+
+            // the first encode goes straight to the current buffer, because nothing precedes it
+            std::exception_ptr exception;
+            try
+            {
+                encode(0);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            while (pendingEncoders) encoderDoneCondition.wait(lock);
+            if (!exception) exception = encodeException;
+            lock.unlock();
+
+            CommandBuffer& target = recordingBuffer ? *recordingBuffer : commandBuffer;
+            for (std::size_t i = 1; i < count; ++i)
+                if (exception)
+                    encoderBuffers[i] = CommandBuffer();
+                else
+                    target.append(encoderBuffers[i]);
+
+            if (exception) std::rethrow_exception(exception);
+        }
+
+        void Renderer::encoderLoop(std::size_t index)
+        {
+            Thread::setCurrentThreadName("Encoder");
+
+            std::uint64_t generation = 0;
+
+            for (;;)
+            {
+                std::unique_lock<std::mutex> lock(encoderMutex);
+                while (encoderRunning && encodeGeneration == generation) encoderCondition.wait(lock);
+                if (!encoderRunning) return;
+
+                generation = encodeGeneration;
+                const auto encode = encodeFunction;
+                const std::size_t count = encodeCount;
+                lock.unlock();
+
+                // every thread reports back, even without work, so none of them sees the next encode's state early
+                if (index < count)
+                {
+                    recordingBuffer = &encoderBuffers[index];
+
+                    try
+                    {
+                        (*encode)(index);
+                    }
+                    catch (...)
+                    {
+                        lock.lock();
+                        if (!encodeException) encodeException = std::current_exception();
+                        lock.unlock();
+                    }
+
+                    recordingBuffer = nullptr;
+                }
+
+                lock.lock();
+                if (--pendingEncoders == 0)
+                {
+                    lock.unlock();
+                    encoderDoneCondition.notify_all();
+                }
+            }
+        }
+
         void Renderer::waitForNextFrame()
         {
             std::unique_lock<std::mutex> lock(frameMutex);
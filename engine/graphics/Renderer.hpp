@@ -4,9 +4,13 @@
 #define OUZEL_GRAPHICS_RENDERER_HPP
 
 #include <cstdint>
+#include <condition_variable>
+#include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <queue>
 #include <set>
@@ -14,10 +18,12 @@
 #include "Commands.hpp"
 #include "Driver.hpp"
 #include "RenderDevice.hpp"
+#include "TextureStreamer.hpp"
 #include "../math/Rect.hpp"
 #include "../math/Matrix.hpp"
 #include "../math/Size.hpp"
 #include "../math/Color.hpp"
+#include "../utils/Thread.hpp"
 
 namespace ouzel
 {
@@ -38,6 +44,12 @@ namespace ouzel
                      bool newDepth,
                      bool newStencil,
                      bool newDebugRenderer);
+            ~Renderer();
+
+            Renderer(const Renderer&) = delete;
+            Renderer& operator=(const Renderer&) = delete;
+            Renderer(Renderer&&) = delete;
+            Renderer& operator=(Renderer&&) = delete;
 
             static Driver getDriver(const std::string& driver);
             static std::set<Driver> getAvailableRenderDrivers();
@@ -46,7 +58,15 @@ namespace ouzel
 
             inline auto& getSize() const noexcept { return size; }
 
+            inline auto& getTextureStreamer() noexcept { return textureStreamer; }
+            inline auto& getTextureStreamer() const noexcept { return textureStreamer; }
+
+            // saves the next presented frame, the image is read back and written without stalling the frame
             void saveScreenshot(const std::string& filename);
+            // Saves every frameInterval-th presented frame to filenamePrefix + frame number + ".png" until
+            // stopped. Frames are skipped while the disk can not keep up.
+            void startCapture(const std::string& filenamePrefix, std::uint32_t frameInterval = 1);
+            void stopCapture();
 
             void setRenderTarget(std::uintptr_t renderTarget);
             void clearRenderTarget(bool clearColorBuffer,
@@ -59,16 +79,30 @@ namespace ouzel
             void setViewport(const RectF& viewport);
             void setDepthStencilState(std::uintptr_t depthStencilState,
                                       std::uint32_t stencilReferenceValue);
-            void setPipelineState(std::uintptr_t blendState,
-                                  std::uintptr_t shader,
-                                  CullMode cullMode,
-                                  FillMode fillMode);
+            // Returns the pipeline state object of the combination. It is created on the first request
+            // and kept until the blend state or the shader is released. Components keep the result in
+            // a CachedPipelineState instead of calling this for every draw.
+            std::uintptr_t getPipelineState(std::uintptr_t blendState,
+                                            std::uintptr_t shader,
+                                            CullMode cullMode,
+                                            FillMode fillMode);
+            // changes every time pipeline states are deleted, so the handles that were returned before may be invalid
+            inline std::uint32_t getPipelineStateGeneration() const noexcept { return pipelineStateGeneration; }
+            void setPipelineState(std::uintptr_t pipelineState);
             void draw(std::uintptr_t indexBuffer,
                       std::uint32_t indexCount,
                       std::uint32_t indexSize,
                       std::uintptr_t vertexBuffer,
                       DrawMode drawMode,
                       std::uint32_t startIndex);
+            void drawInstanced(std::uintptr_t indexBuffer,
+                               std::uint32_t indexCount,
+                               std::uint32_t indexSize,
+                               std::uintptr_t vertexBuffer,
+                               std::uintptr_t instanceBuffer,
+                               std::uint32_t instanceCount,
+                               DrawMode drawMode,
+                               std::uint32_t startIndex);
             void pushDebugMarker(const std::string& name);
             void popDebugMarker();
             void setShaderConstants(const std::vector<std::vector<float>>& fragmentShaderConstants,
@@ -77,13 +111,26 @@ namespace ouzel
 
             inline void addCommand(std::unique_ptr<Command> command)
             {
-                commandBuffer.pushCommand(std::move(command));
+                (recordingBuffer ? *recordingBuffer : commandBuffer).pushCommand(std::move(command));
             }
             void present();
 
+            // the number of encodes that can run at the same time, including the calling thread
+            inline auto getEncoderCount() const noexcept { return maxEncoderThreads + 1; }
+
+            // Calls encode with indices from 0 to count - 1 at the same time on the encoder threads.
+            // Each call records the commands that it adds to its own command buffer and the buffers
+            // are appended in the order of the indices, so the result is the same as calling them in a loop.
+            void encodeParallel(std::size_t count, const std::function<void(std::size_t)>& encode);
+
             void waitForNextFrame();
             inline bool getRefillQueue() const noexcept { return refillQueue; }
 
+            // how many presented frames can wait for the render thread before the update thread stops drawing,
+            // more frames let the update and the rendering overlap at the cost of latency
+            inline auto getFramesInFlight() const noexcept { return framesInFlight; }
+            void setFramesInFlight(std::uint32_t newFramesInFlight);
+
             Vector2F convertScreenToNormalizedLocation(const Vector2F& position)
             {
                 return Vector2F(position.v[0] / size.v[0],
@@ -99,16 +146,72 @@ namespace ouzel
         private:
             void handleEvent(const RenderDevice::Event& event);
             void setSize(const Size2U& newSize);
+            void encoderLoop(std::size_t index);
 
             std::unique_ptr<RenderDevice> device;
 
             Size2U size;
             CommandBuffer commandBuffer;
+            TextureStreamer textureStreamer;
 
             bool newFrame = false;
             std::mutex frameMutex;
             std::condition_variable frameCondition;
             std::atomic_bool refillQueue{true};
+
+            struct PipelineStateKey final
+            {
+                std::uintptr_t blendState;
+                std::uintptr_t shader;
+                CullMode cullMode;
+                FillMode fillMode;
+
+                bool operator==(const PipelineStateKey& other) const noexcept
+                {
+                    return blendState == other.blendState &&
+                        shader == other.shader &&
+                        cullMode == other.cullMode &&
+                        fillMode == other.fillMode;
+                }
+            };
+
+            struct PipelineStateKeyHash final
+            {
+                std::size_t operator()(const PipelineStateKey& key) const noexcept
+                {
+                    std::size_t result = std::hash<std::uintptr_t>()(key.blendState);
+                    result = result * 31 + std::hash<std::uintptr_t>()(key.shader);
+                    return result * 31 + static_cast<std::size_t>(key.cullMode) * 2 + static_cast<std::size_t>(key.fillMode);
+                }
+            };
+
+            std::unordered_map<PipelineStateKey, RenderDevice::Resource, PipelineStateKeyHash> pipelineStates;
+            // init commands of the new pipeline states, they go before all the other commands of the frame,
+            // because the encoder threads share the pipeline states
+            CommandBuffer pipelineStateCommands;
+            std::mutex pipelineStateMutex;
+            std::atomic<std::uint32_t> pipelineStateGeneration{0};
+
+            std::uint32_t framesInFlight = 1;
+            bool renderStarted = false;
+            // ids of the resources that the frames in flight delete, they are reused once the frame is rendered
+            std::queue<std::vector<std::uintptr_t>> retiredResourceIds;
+
+            // commands of the calling thread go here instead of the frame's command buffer when set
+            static thread_local CommandBuffer* recordingBuffer;
+
+            std::size_t maxEncoderThreads = 0;
+            std::vector<CommandBuffer> encoderBuffers;
+            const std::function<void(std::size_t)>* encodeFunction = nullptr;
+            std::size_t encodeCount = 0;
+            std::uint64_t encodeGeneration = 0;
+            std::size_t pendingEncoders = 0;
+            std::exception_ptr encodeException;
+            bool encoderRunning = true;
+            std::mutex encoderMutex;
+            std::condition_variable encoderCondition;
+            std::condition_variable encoderDoneCondition;
+            std::vector<Thread> encoderThreads; // started by the first parallel encode
         };
     } // namespace graphics
 } // namespace ouzel
@@ -1,8 +1,23 @@
 // Copyright 2015-2020 Elviss Strazdins. All rights reserved.
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <vector>
+#if defined(__SSE__)
+#  include <xmmintrin.h>
+#elif defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#endif
 #include "Texture.hpp"
 #include "Renderer.hpp"
+#include "../math/MathUtils.hpp"
+#include "../utils/Thread.hpp"
 
 namespace ouzel
 {
@@ -46,22 +61,190 @@ namespace ouzel
                 0.9406006932F, 0.9489649534F, 0.957369566F, 0.9658146501F, 0.9743002057F, 0.9828262329F, 0.9913928509F, 1.0F
             };
 
+            // rows smaller than this are not worth distributing across threads
+            constexpr std::uint32_t MIN_PARALLEL_PIXELS = 64 * 1024;
+            constexpr std::uint32_t MIN_ROWS_PER_THREAD = 16;
+
+            // Threads that process the row ranges of the large mipmap levels. They are started with the
+            // first large level and kept until exit, so that the levels do not pay for creating threads.
+            class RowWorkerPool final
+            {
+            public:
+                RowWorkerPool()
+                {
+                    const std::uint32_t hardwareThreads = std::thread::hardware_concurrency();
+                    for (std::uint32_t i = 1; i < hardwareThreads; ++i)
+                        workerThreads.emplace_back(&RowWorkerPool::workerLoop, this);
+                }
+
+                ~RowWorkerPool()
+                {
+                    std::unique_lock<std::mutex> lock(workerMutex);
+                    running = false;
+                    lock.unlock();
+                    workerCondition.notify_all();
+
+                    workerThreads.clear(); // joins the threads
+                }
+
+                RowWorkerPool(const RowWorkerPool&) = delete;
+                RowWorkerPool& operator=(const RowWorkerPool&) = delete;
+
+                inline auto getWorkerCount() const noexcept { return static_cast<std::uint32_t>(workerThreads.size()); }
+
+                // the calling thread processes ranges too, returns false without calling the function
+                // if another thread is using the pool
+                bool run(std::uint32_t newRowCount, std::uint32_t newRowsPerRange,
+                         const std::function<void(std::uint32_t, std::uint32_t)>& function)
+                {
+                    std::unique_lock<std::mutex> runLock(runMutex, std::try_to_lock);
+                    if (!runLock.owns_lock()) return false;
+
+                    std::unique_lock<std::mutex> lock(workerMutex);
+                    job = &function;
+                    rowCount = newRowCount;
+                    rowsPerRange = newRowsPerRange;
+                    nextRow = 0;
+                    pendingWorkers = workerThreads.size();
+                    ++generation;
+                    lock.unlock();
+                    workerCondition.notify_all();
+
+                    processRanges();
+
+                    lock.lock();
+                    while (pendingWorkers) workerDoneCondition.wait(lock);
+                    job = nullptr;
+
+                    return true;
+                }
+
+            private:
+                void processRanges()
+                {
+                    for (;;)
+                    {
+                        const std::uint32_t firstRow = nextRow.fetch_add(rowsPerRange);
+                        if (firstRow >= rowCount) break;
+
+                        (*job)(firstRow, std::min(firstRow + rowsPerRange, rowCount));
+                    }
+                }
+
+                void workerLoop()
+                {
+                    Thread::setCurrentThreadName("Mipmap");
+
+                    std::uint64_t currentGeneration = 0;
+
+                    for (;;)
+                    {
+                        std::unique_lock<std::mutex> lock(workerMutex);
+                        while (running && generation == currentGeneration) workerCondition.wait(lock);
+                        if (!running) return;
+
+                        currentGeneration = generation;
+                        lock.unlock();
+
+                        processRanges();
+
+                        lock.lock();
+                        if (--pendingWorkers == 0)
+                        {
+                            lock.unlock();
+                            workerDoneCondition.notify_all();
+                        }
+                    }
+                }
+
+                std::vector<Thread> workerThreads;
+                std::mutex runMutex; // held by the thread that uses the pool
+                std::mutex workerMutex;
+                std::condition_variable workerCondition;
+                std::condition_variable workerDoneCondition;
+                bool running = true;
+                std::uint64_t generation = 0;
+                std::size_t pendingWorkers = 0;
+
+                const std::function<void(std::uint32_t, std::uint32_t)>* job = nullptr;
+                std::uint32_t rowCount = 0;
+                std::uint32_t rowsPerRange = 0;
+                std::atomic<std::uint32_t> nextRow{0};
+            };
+
+            // calls function(firstRow, lastRow) for disjoint row ranges, in parallel for large images
+            template <class F>
+            void processRows(std::uint32_t width, std::uint32_t height, F function)
+            {
+                if (width * height < MIN_PARALLEL_PIXELS || height < MIN_ROWS_PER_THREAD * 2)
+                {
+                    function(0, height);
+                    return;
+                }
+
+                static RowWorkerPool rowWorkerPool;
+
+                const std::uint32_t threadCount = rowWorkerPool.getWorkerCount() + 1;
+                const std::uint32_t rowsPerRange = std::max(MIN_ROWS_PER_THREAD, (height + threadCount - 1) / threadCount);
+
+                // the levels of textures that other threads create at the same time are processed on the calling thread
+                if (threadCount == 1 ||
+                    !rowWorkerPool.run(height, rowsPerRange, std::function<void(std::uint32_t, std::uint32_t)>(function)))
+                    function(0, height);
+            }
+
             void downsample2x2A8(std::uint32_t width, std::uint32_t height,
-                                 const std::vector<float>& original, std::vector<float>& resized)
+                                 const float* original, float* resized,
+                                 std::uint32_t firstRow, std::uint32_t lastRow) noexcept
             {
                 const std::uint32_t dstWidth = width >> 1;
                 const std::uint32_t dstHeight = height >> 1;
                 const std::uint32_t pitch = width * 1;
-                resized.resize(dstWidth * dstHeight * 1);
-                const float* src = original.data();
-                float* dst = resized.data();
 
                 if (dstWidth > 0 && dstHeight > 0)
                 {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2)
+                    const float* src = original + firstRow * pitch * 2;
+                    float* dst = resized + firstRow * dstWidth * 1;
+
+                    for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch * 2)
                     {
                         const float* pixel = src;
-                        for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 2, dst += 1)
+                        std::uint32_t x = 0;
+
+                        if (isSimdAvailable)
+                        {
+#if defined(__SSE__)
+                            const __m128 divisor = _mm_set1_ps(4.0F);
+                            for (; x + 4 <= dstWidth; x += 4, pixel += 8, dst += 4)
+                            {
+                                const __m128 top0 = _mm_loadu_ps(pixel);
+                                const __m128 top1 = _mm_loadu_ps(pixel + 4);
+                                const __m128 bottom0 = _mm_loadu_ps(pixel + pitch);
+                                const __m128 bottom1 = _mm_loadu_ps(pixel + pitch + 4);
+
+                                // same summation order as the scalar path to get identical results
+                                __m128 a = _mm_shuffle_ps(top0, top1, _MM_SHUFFLE(2, 0, 2, 0));
+                                a = _mm_add_ps(a, _mm_shuffle_ps(top0, top1, _MM_SHUFFLE(3, 1, 3, 1)));
+                                a = _mm_add_ps(a, _mm_shuffle_ps(bottom0, bottom1, _MM_SHUFFLE(2, 0, 2, 0)));
+                                a = _mm_add_ps(a, _mm_shuffle_ps(bottom0, bottom1, _MM_SHUFFLE(3, 1, 3, 1)));
+                                _mm_storeu_ps(dst, _mm_div_ps(a, divisor));
+                            }
+#elif defined(__ARM_NEON__) && (defined(__arm64__) || defined(__aarch64__))
+                            const float32x4_t divisor = vdupq_n_f32(4.0F);
+                            for (; x + 4 <= dstWidth; x += 4, pixel += 8, dst += 4)
+                            {
+                                const float32x4x2_t top = vld2q_f32(pixel);
+                                const float32x4x2_t bottom = vld2q_f32(pixel + pitch);
+
+                                float32x4_t a = vaddq_f32(top.val[0], top.val[1]);
+                                a = vaddq_f32(a, bottom.val[0]);
+                                a = vaddq_f32(a, bottom.val[1]);
+                                vst1q_f32(dst, vdivq_f32(a, divisor));
+                            }
+#endif
+                        }
+
+                        for (; x < dstWidth; ++x, pixel += 2, dst += 1)
                         {
                             float a = 0.0F;
                             a += pixel[0];
@@ -74,7 +257,10 @@ namespace ouzel
                 }
                 else if (dstHeight > 0)
                 {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2, dst += 1)
+                    const float* src = original + firstRow * pitch * 2;
+                    float* dst = resized + firstRow * 1;
+
+                    for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch * 2, dst += 1)
                     {
                         const float* pixel = src;
 
@@ -84,9 +270,10 @@ namespace ouzel
                         dst[0] = a / 2.0F;
                     }
                 }
-                else if (dstWidth > 0)
+                else if (dstWidth > 0 && firstRow == 0)
                 {
-                    const float* pixel = src;
+                    const float* pixel = original;
+                    float* dst = resized;
                     for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 2, dst += 1)
                     {
                         float a = 0.0F;
@@ -98,76 +285,67 @@ namespace ouzel
             }
 
             void downsample2x2R8(std::uint32_t width, std::uint32_t height,
-                                 const std::vector<float>& original, std::vector<float>& resized)
+                                 const float* original, float* resized,
+                                 std::uint32_t firstRow, std::uint32_t lastRow) noexcept
             {
-                std::vector<float> normalized(width * height * 1);
-
-                const std::uint32_t dstWidth = width >> 1;
-                const std::uint32_t dstHeight = height >> 1;
-                const std::uint32_t pitch = width * 1;
-                resized.resize(dstWidth * dstHeight * 1);
-                const float* src = original.data();
-                float* dst = resized.data();
-
-                if (dstWidth > 0 && dstHeight > 0)
-                {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2)
-                    {
-                        const float* pixel = src;
-                        for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 2, dst += 1)
-                        {
-                            float r = 0.0F;
-                            r += pixel[0];
-                            r += pixel[1];
-                            r += pixel[pitch + 0];
-                            r += pixel[pitch + 1];
-                            dst[0] = r / 4.0F;
-                        }
-                    }
-                }
-                else if (dstHeight > 0)
-                {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2, dst += 1)
-                    {
-                        const float* pixel = src;
-
-                        float r = 0.0F;
-                        r += pixel[0];
-                        r += pixel[pitch + 0];
-                        dst[0] = r / 2.0F;
-                    }
-                }
-                else if (dstWidth > 0)
-                {
-                    const float* pixel = src;
-                    for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 2, dst += 1)
-                    {
-                        float r = 0.0F;
-                        r += pixel[0];
-                        r += pixel[1];
-                        dst[0] = r / 2.0F;
-                    }
-                }
+                // red and alpha textures are filtered identically
+                downsample2x2A8(width, height, original, resized, firstRow, lastRow);
             }
 
             void downsample2x2Rg8(std::uint32_t width, std::uint32_t height,
-                                  const std::vector<float>& original, std::vector<float>& resized)
+                                  const float* original, float* resized,
+                                  std::uint32_t firstRow, std::uint32_t lastRow) noexcept
             {
-                std::vector<float> normalized(width * height * 2);
-
                 const std::uint32_t dstWidth = width >> 1;
                 const std::uint32_t dstHeight = height >> 1;
                 const std::uint32_t pitch = width * 2;
-                resized.resize(dstWidth * dstHeight * 2);
-                const float* src = original.data();
-                float* dst = resized.data();
 
                 if (dstWidth > 0 && dstHeight > 0)
                 {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2)
+                    const float* src = original + firstRow * pitch * 2;
+                    float* dst = resized + firstRow * dstWidth * 2;
+
+                    for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch * 2)
                     {
                         const float* pixel = src;
-                        for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 4, dst += 2)
+                        std::uint32_t x = 0;
+
+                        if (isSimdAvailable)
+                        {
+#if defined(__SSE__)
+                            const __m128 divisor = _mm_set1_ps(4.0F);
+                            for (; x + 2 <= dstWidth; x += 2, pixel += 8, dst += 4)
+                            {
+                                const __m128 top0 = _mm_loadu_ps(pixel);
+                                const __m128 top1 = _mm_loadu_ps(pixel + 4);
+                                const __m128 bottom0 = _mm_loadu_ps(pixel + pitch);
+                                const __m128 bottom1 = _mm_loadu_ps(pixel + pitch + 4);
+
+                                __m128 rg = _mm_shuffle_ps(top0, top1, _MM_SHUFFLE(1, 0, 1, 0));
+                                rg = _mm_add_ps(rg, _mm_shuffle_ps(top0, top1, _MM_SHUFFLE(3, 2, 3, 2)));
+                                rg = _mm_add_ps(rg, _mm_shuffle_ps(bottom0, bottom1, _MM_SHUFFLE(1, 0, 1, 0)));
+                                rg = _mm_add_ps(rg, _mm_shuffle_ps(bottom0, bottom1, _MM_SHUFFLE(3, 2, 3, 2)));
+                                _mm_storeu_ps(dst, _mm_div_ps(rg, divisor));
+                            }
+#elif defined(__ARM_NEON__) && (defined(__arm64__) || defined(__aarch64__))
+                            const float32x4_t divisor = vdupq_n_f32(4.0F);
+                            for (; x + 4 <= dstWidth; x += 4, pixel += 16, dst += 8)
+                            {
+                                // de-interleave into red and green planes
+                                const float32x4x4_t top = vld4q_f32(pixel);
+                                const float32x4x4_t bottom = vld4q_f32(pixel + pitch);
+
+                                float32x4x2_t rg;
+                                rg.val[0] = vaddq_f32(vaddq_f32(vaddq_f32(top.val[0], top.val[2]), bottom.val[0]), bottom.val[2]);
+                                rg.val[1] = vaddq_f32(vaddq_f32(vaddq_f32(top.val[1], top.val[3]), bottom.val[1]), bottom.val[3]);
+                                rg.val[0] = vdivq_f32(rg.val[0], divisor);
+                                rg.val[1] = vdivq_f32(rg.val[1], divisor);
+                                vst2q_f32(dst, rg);
+                            }
+#endif
+                        }
+
+                        for (; x < dstWidth; ++x, pixel += 4, dst += 2)
                         {
                             float r = 0.0F;
                             float g = 0.0F;
@@ -191,7 +369,10 @@ namespace ouzel
                 }
                 else if (dstHeight > 0)
                 {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2, dst += 2)
+                    const float* src = original + firstRow * pitch * 2;
+                    float* dst = resized + firstRow * 2;
+
+                    for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch * 2, dst += 2)
                     {
                         const float* pixel = src;
                         float r = 0.0F;
@@ -207,9 +388,10 @@ namespace ouzel
                         dst[1] = g / 2.0F;
                     }
                 }
-                else if (dstWidth > 0)
+                else if (dstWidth > 0 && firstRow == 0)
                 {
-                    const float* pixel = src;
+                    const float* pixel = original;
+                    float* dst = resized;
                     for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 4, dst += 2)
                     {
                         float r = 0.0F;
@@ -228,21 +410,103 @@ namespace ouzel
             }
 
             void downsample2x2Rgba8(std::uint32_t width, std::uint32_t height,
-                                    const std::vector<float>& original, std::vector<float>& resized)
+                                    const float* original, float* resized,
+                                    std::uint32_t firstRow, std::uint32_t lastRow) noexcept
             {
                 const std::uint32_t dstWidth = width >> 1;
                 const std::uint32_t dstHeight = height >> 1;
                 const std::uint32_t pitch = width * 4;
-                resized.resize(dstWidth * dstHeight * 4);
-                const float* src = original.data();
-                float* dst = resized.data();
 
                 if (dstWidth > 0 && dstHeight > 0)
                 {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2)
+                    const float* src = original + firstRow * pitch * 2;
+                    float* dst = resized + firstRow * dstWidth * 4;
+
+                    for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch * 2)
                     {
                         const float* pixel = src;
-                        for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 8, dst += 4)
+                        std::uint32_t x = 0;
+
+                        if (isSimdAvailable)
+                        {
+                            // color channels are averaged only over pixels with non-zero alpha,
+                            // the masked-out pixels contribute +0 so the summation order matches the scalar path
+#if defined(__SSE__)
+                            const __m128 zero = _mm_setzero_ps();
+                            const __m128 one = _mm_set1_ps(1.0F);
+                            const __m128 four = _mm_set1_ps(4.0F);
+                            const __m128 colorMask = _mm_cmpeq_ps(_mm_set_ps(0.0F, 1.0F, 1.0F, 1.0F), one);
+
+                            for (; x < dstWidth; ++x, pixel += 8, dst += 4)
+                            {
+                                const __m128 p0 = _mm_loadu_ps(pixel);
+                                const __m128 p1 = _mm_loadu_ps(pixel + 4);
+                                const __m128 p2 = _mm_loadu_ps(pixel + pitch);
+                                const __m128 p3 = _mm_loadu_ps(pixel + pitch + 4);
+
+                                const __m128 m0 = _mm_cmpgt_ps(_mm_shuffle_ps(p0, p0, _MM_SHUFFLE(3, 3, 3, 3)), zero);
+                                const __m128 m1 = _mm_cmpgt_ps(_mm_shuffle_ps(p1, p1, _MM_SHUFFLE(3, 3, 3, 3)), zero);
+                                const __m128 m2 = _mm_cmpgt_ps(_mm_shuffle_ps(p2, p2, _MM_SHUFFLE(3, 3, 3, 3)), zero);
+                                const __m128 m3 = _mm_cmpgt_ps(_mm_shuffle_ps(p3, p3, _MM_SHUFFLE(3, 3, 3, 3)), zero);
+
+                                __m128 color = _mm_and_ps(p0, m0);
+                                color = _mm_add_ps(color, _mm_and_ps(p1, m1));
+                                color = _mm_add_ps(color, _mm_and_ps(p2, m2));
+                                color = _mm_add_ps(color, _mm_and_ps(p3, m3));
+
+                                __m128 pixels = _mm_and_ps(one, m0);
+                                pixels = _mm_add_ps(pixels, _mm_and_ps(one, m1));
+                                pixels = _mm_add_ps(pixels, _mm_and_ps(one, m2));
+                                pixels = _mm_add_ps(pixels, _mm_and_ps(one, m3));
+
+                                const __m128 alpha = _mm_add_ps(_mm_add_ps(_mm_add_ps(p0, p1), p2), p3);
+
+                                const __m128 sum = _mm_or_ps(_mm_and_ps(colorMask, color), _mm_andnot_ps(colorMask, alpha));
+                                const __m128 divisor = _mm_or_ps(_mm_and_ps(colorMask, pixels), _mm_andnot_ps(colorMask, four));
+                                const __m128 hasPixels = _mm_cmpgt_ps(pixels, zero);
+
+                                _mm_storeu_ps(dst, _mm_and_ps(_mm_div_ps(sum, divisor), hasPixels));
+                            }
+#elif defined(__ARM_NEON__) && (defined(__arm64__) || defined(__aarch64__))
+                            const float32x4_t zero = vdupq_n_f32(0.0F);
+                            const float32x4_t one = vdupq_n_f32(1.0F);
+                            const float32x4_t four = vdupq_n_f32(4.0F);
+                            const uint32x4_t colorMask = {0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0U};
+
+                            for (; x < dstWidth; ++x, pixel += 8, dst += 4)
+                            {
+                                const float32x4_t p0 = vld1q_f32(pixel);
+                                const float32x4_t p1 = vld1q_f32(pixel + 4);
+                                const float32x4_t p2 = vld1q_f32(pixel + pitch);
+                                const float32x4_t p3 = vld1q_f32(pixel + pitch + 4);
+
+                                const uint32x4_t m0 = vcgtq_f32(vdupq_laneq_f32(p0, 3), zero);
+                                const uint32x4_t m1 = vcgtq_f32(vdupq_laneq_f32(p1, 3), zero);
+                                const uint32x4_t m2 = vcgtq_f32(vdupq_laneq_f32(p2, 3), zero);
+                                const uint32x4_t m3 = vcgtq_f32(vdupq_laneq_f32(p3, 3), zero);
+
+                                float32x4_t color = vbslq_f32(m0, p0, zero);
+                                color = vaddq_f32(color, vbslq_f32(m1, p1, zero));
+                                color = vaddq_f32(color, vbslq_f32(m2, p2, zero));
+                                color = vaddq_f32(color, vbslq_f32(m3, p3, zero));
+
+                                float32x4_t pixels = vbslq_f32(m0, one, zero);
+                                pixels = vaddq_f32(pixels, vbslq_f32(m1, one, zero));
+                                pixels = vaddq_f32(pixels, vbslq_f32(m2, one, zero));
+                                pixels = vaddq_f32(pixels, vbslq_f32(m3, one, zero));
+
+                                const float32x4_t alpha = vaddq_f32(vaddq_f32(vaddq_f32(p0, p1), p2), p3);
+
+                                const float32x4_t sum = vbslq_f32(colorMask, color, alpha);
+                                const float32x4_t divisor = vbslq_f32(colorMask, pixels, four);
+                                const uint32x4_t hasPixels = vcgtq_f32(pixels, zero);
+
+                                vst1q_f32(dst, vbslq_f32(hasPixels, vdivq_f32(sum, divisor), zero));
+                            }
+#endif
+                        }
+
+                        for (; x < dstWidth; ++x, pixel += 8, dst += 4)
                         {
                             float pixels = 0.0F;
                             float r = 0.0F;
@@ -305,7 +569,10 @@ namespace ouzel
                 }
                 else if (dstHeight > 0)
                 {
-                    for (std::uint32_t y = 0; y < dstHeight; ++y, src += pitch * 2, dst += 4)
+                    const float* src = original + firstRow * pitch * 2;
+                    float* dst = resized + firstRow * 4;
+
+                    for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch * 2, dst += 4)
                     {
                         const float* pixel = src;
 
@@ -349,9 +616,10 @@ namespace ouzel
                         }
                     }
                 }
-                else if (dstWidth > 0)
+                else if (dstWidth > 0 && firstRow == 0)
                 {
-                    const float* pixel = src;
+                    const float* pixel = original;
+                    float* dst = resized;
                     for (std::uint32_t x = 0; x < dstWidth; ++x, pixel += 8, dst += 4)
                     {
                         float pixels = 0.0F;
@@ -396,16 +664,112 @@ namespace ouzel
                 }
             }
 
+            void downsample2x2(std::uint32_t width, std::uint32_t height,
+                               PixelFormat pixelFormat,
+                               const std::vector<float>& original, std::vector<float>& resized)
+            {
+                const std::uint32_t channelCount = getChannelCount(pixelFormat);
+                const std::uint32_t dstWidth = std::max(width >> 1, 1U);
+                const std::uint32_t dstHeight = std::max(height >> 1, 1U);
+                resized.resize(dstWidth * dstHeight * channelCount);
+
+                void (*downsample)(std::uint32_t, std::uint32_t,
+                                   const float*, float*,
+                                   std::uint32_t, std::uint32_t) noexcept = nullptr;
+
+                switch (pixelFormat)
+                {
+                    case PixelFormat::RGBA8UNorm:
+                    case PixelFormat::RGBA8UNormSRGB:
+                        downsample = downsample2x2Rgba8;
+                        break;
+
+                    case PixelFormat::RG8UNorm:
+                        downsample = downsample2x2Rg8;
+                        break;
+
+                    case PixelFormat::R8UNorm:
+                        downsample = downsample2x2R8;
+                        break;
+
+                    case PixelFormat::A8UNorm:
+                        downsample = downsample2x2A8;
+                        break;
+
+                    default:
+                        throw std::runtime_error("Invalid pixel format");
+                }
+
+                const float* src = original.data();
+                float* dst = resized.data();
+
+                processRows(dstWidth, dstHeight,
+                            [=](std::uint32_t firstRow, std::uint32_t lastRow) noexcept {
+                                downsample(width, height, src, dst, firstRow, lastRow);
+                            });
+            }
+
             inline float gammaDecode(std::uint8_t value) noexcept
             {
                 return GAMMA_DECODE[value]; // std::pow(value / 255.0F, GAMMA);
             }
 
-            inline std::uint8_t gammaEncode(float value) noexcept
+            inline std::uint8_t gammaEncodeReference(float value) noexcept
             {
                 return static_cast<std::uint8_t>(std::round(std::pow(value, 1.0F / GAMMA) * 255.0F));
             }
 
+            // thresholds[i] is the smallest linear value that encodes to i,
+            // found by bisecting over the float bit patterns so that the table lookup
+            // returns exactly what gammaEncodeReference returns for every value in [0, 1]
+            class GammaEncodeTable final
+            {
+            public:
+                GammaEncodeTable() noexcept
+                {
+                    thresholds[0] = 0.0F;
+
+                    for (std::uint32_t i = 1; i < 256; ++i)
+                    {
+                        std::uint32_t low = 0; // bit pattern of 0.0F
+                        std::uint32_t high = 0x3F800000U; // bit pattern of 1.0F
+
+                        while (low < high)
+                        {
+                            const std::uint32_t middle = low + (high - low) / 2;
+                            float value;
+                            std::memcpy(&value, &middle, sizeof(value));
+
+                            if (gammaEncodeReference(value) >= i)
+                                high = middle;
+                            else
+                                low = middle + 1;
+                        }
+
+                        std::memcpy(&thresholds[i], &low, sizeof(float));
+                    }
+                }
+
+                inline std::uint8_t encode(float value) const noexcept
+                {
+                    std::uint32_t result = 0;
+                    for (std::uint32_t step = 128; step > 0; step >>= 1)
+                        if (value >= thresholds[result + step])
+                            result += step;
+
+                    return static_cast<std::uint8_t>(result);
+                }
+
+            private:
+                float thresholds[256];
+            };
+
+            inline std::uint8_t gammaEncode(float value) noexcept
+            {
+                static const GammaEncodeTable table;
+                return table.encode(value);
+            }
+
             void decode(const Size2U& size,
                         const std::vector<std::uint8_t>& encodedData,
                         PixelFormat pixelFormat,
@@ -414,63 +778,79 @@ namespace ouzel
                 const std::uint32_t channelCount = getChannelCount(pixelFormat);
                 const std::uint32_t pitch = size.width() * channelCount;
                 decodedData.resize(size.width() * size.height() * channelCount);
-                const std::uint8_t* src = encodedData.data();
-                float* dst = decodedData.data();
 
                 switch (pixelFormat)
                 {
                     case PixelFormat::RGBA8UNorm:
                     case PixelFormat::RGBA8UNormSRGB:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const std::uint8_t* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 4, dst += 4)
+                    case PixelFormat::RG8UNorm:
+                    case PixelFormat::R8UNorm:
+                    case PixelFormat::A8UNorm:
+                        break;
+                    default:
+                        throw std::runtime_error("Invalid pixel format");
+                }
+
+                processRows(size.width(), size.height(),
+                            [&](std::uint32_t firstRow, std::uint32_t lastRow) noexcept {
+                    const std::uint8_t* src = encodedData.data() + firstRow * pitch;
+                    float* dst = decodedData.data() + firstRow * pitch;
+
+                    switch (pixelFormat)
+                    {
+                        case PixelFormat::RGBA8UNorm:
+                        case PixelFormat::RGBA8UNormSRGB:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = gammaDecode(pixel[0]); // red
-                                dst[1] = gammaDecode(pixel[1]); // green
-                                dst[2] = gammaDecode(pixel[2]); // blue
-                                dst[3] = pixel[3] / 255.0F; // alpha
+                                const std::uint8_t* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 4, dst += 4)
+                                {
+                                    dst[0] = gammaDecode(pixel[0]); // red
+                                    dst[1] = gammaDecode(pixel[1]); // green
+                                    dst[2] = gammaDecode(pixel[2]); // blue
+                                    dst[3] = pixel[3] / 255.0F; // alpha
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    case PixelFormat::RG8UNorm:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const std::uint8_t* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 2, dst += 2)
+                        case PixelFormat::RG8UNorm:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = gammaDecode(pixel[0]); // red
-                                dst[1] = gammaDecode(pixel[1]); // green
+                                const std::uint8_t* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 2, dst += 2)
+                                {
+                                    dst[0] = gammaDecode(pixel[0]); // red
+                                    dst[1] = gammaDecode(pixel[1]); // green
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    case PixelFormat::R8UNorm:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const std::uint8_t* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 4, dst += 1)
+                        case PixelFormat::R8UNorm:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = gammaDecode(pixel[0]); // red
+                                const std::uint8_t* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 1, dst += 1)
+                                {
+                                    dst[0] = gammaDecode(pixel[0]); // red
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    case PixelFormat::A8UNorm:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const std::uint8_t* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 1, dst += 1)
+                        case PixelFormat::A8UNorm:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = pixel[0] / 255.0F; // alpha
+                                const std::uint8_t* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 1, dst += 1)
+                                {
+                                    dst[0] = pixel[0] / 255.0F; // alpha
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    default:
-                        throw std::runtime_error("Invalid pixel format");
-                }
+                        default:
+                            break;
+                    }
+                });
             }
 
             void encode(const Size2U& size,
@@ -481,63 +861,79 @@ namespace ouzel
                 const std::uint32_t pixelSize = getPixelSize(pixelFormat);
                 const std::uint32_t pitch = size.width() * pixelSize;
                 encodedData.resize(size.width() * size.height() * pixelSize);
-                const float* src = decodedData.data();
-                std::uint8_t* dst = encodedData.data();
 
                 switch (pixelFormat)
                 {
                     case PixelFormat::RGBA8UNorm:
                     case PixelFormat::RGBA8UNormSRGB:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const float* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 4, dst += 4)
+                    case PixelFormat::RG8UNorm:
+                    case PixelFormat::R8UNorm:
+                    case PixelFormat::A8UNorm:
+                        break;
+                    default:
+                        throw std::runtime_error("Invalid pixel format");
+                }
+
+                processRows(size.width(), size.height(),
+                            [&](std::uint32_t firstRow, std::uint32_t lastRow) noexcept {
+                    const float* src = decodedData.data() + firstRow * pitch;
+                    std::uint8_t* dst = encodedData.data() + firstRow * pitch;
+
+                    switch (pixelFormat)
+                    {
+                        case PixelFormat::RGBA8UNorm:
+                        case PixelFormat::RGBA8UNormSRGB:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = gammaEncode(pixel[0]); // red
-                                dst[1] = gammaEncode(pixel[1]); // green
-                                dst[2] = gammaEncode(pixel[2]); // blue
-                                dst[3] = static_cast<std::uint8_t>(std::round(pixel[3] * 255.0F)); // alpha
+                                const float* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 4, dst += 4)
+                                {
+                                    dst[0] = gammaEncode(pixel[0]); // red
+                                    dst[1] = gammaEncode(pixel[1]); // green
+                                    dst[2] = gammaEncode(pixel[2]); // blue
+                                    dst[3] = static_cast<std::uint8_t>(std::round(pixel[3] * 255.0F)); // alpha
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    case PixelFormat::RG8UNorm:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const float* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 2, dst += 2)
+                        case PixelFormat::RG8UNorm:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = gammaEncode(pixel[0]); // red
-                                dst[1] = gammaEncode(pixel[1]); // green
+                                const float* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 2, dst += 2)
+                                {
+                                    dst[0] = gammaEncode(pixel[0]); // red
+                                    dst[1] = gammaEncode(pixel[1]); // green
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    case PixelFormat::R8UNorm:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const float* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 1, dst += 1)
+                        case PixelFormat::R8UNorm:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = gammaEncode(pixel[0]); // red
+                                const float* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 1, dst += 1)
+                                {
+                                    dst[0] = gammaEncode(pixel[0]); // red
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    case PixelFormat::A8UNorm:
-                        for (std::uint32_t y = 0; y < size.height(); ++y, src += pitch)
-                        {
-                            const float* pixel = src;
-                            for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 1, dst += 1)
+                        case PixelFormat::A8UNorm:
+                            for (std::uint32_t y = firstRow; y < lastRow; ++y, src += pitch)
                             {
-                                dst[0] = static_cast<std::uint8_t>(std::round(pixel[0] * 255.0F)); // alpha
+                                const float* pixel = src;
+                                for (std::uint32_t x = 0; x < size.width(); ++x, pixel += 1, dst += 1)
+                                {
+                                    dst[0] = static_cast<std::uint8_t>(std::round(pixel[0] * 255.0F)); // alpha
+                                }
                             }
-                        }
-                        break;
+                            break;
 
-                    default:
-                        throw std::runtime_error("Invalid pixel format");
-                }
+                        default:
+                            break;
+                    }
+                });
             }
 
             std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> calculateSizes(const Size2U& size,
@@ -549,8 +945,7 @@ namespace ouzel
                 std::uint32_t newWidth = size.v[0];
                 std::uint32_t newHeight = size.v[1];
 
-                const std::uint32_t pixelSize = getPixelSize(pixelFormat);
-                std::uint32_t bufferSize = newWidth * newHeight * pixelSize;
+                std::uint32_t bufferSize = getLevelSize(pixelFormat, newWidth, newHeight);
                 levels.emplace_back(size, std::vector<std::uint8_t>(bufferSize));
 
                 while ((newWidth > 1 || newHeight > 1) &&
@@ -563,7 +958,7 @@ namespace ouzel
                     if (newHeight < 1) newHeight = 1;
 
                     auto mipMapSize = Size2U(newWidth, newHeight);
-                    bufferSize = newWidth * newHeight * pixelSize;
+                    bufferSize = getLevelSize(pixelFormat, newWidth, newHeight);
 
                     levels.emplace_back(mipMapSize, std::vector<std::uint8_t>(bufferSize));
                 }
@@ -583,6 +978,15 @@ namespace ouzel
 
                 levels.emplace_back(size, data);
 
+                // compressed textures must come with precomputed mip levels
+                if (isCompressed(pixelFormat))
+                {
+                    if (mipmaps != 1 && (newWidth > 1 || newHeight > 1))
+                        throw std::runtime_error("Mipmaps can not be generated for compressed textures");
+
+                    return levels;
+                }
+
                 std::uint32_t previousWidth = newWidth;
                 std::uint32_t previousHeight = newHeight;
                 std::vector<float> previousData;
@@ -603,33 +1007,12 @@ namespace ouzel
 
                     auto mipMapSize = Size2U(newWidth, newHeight);
 
-                    switch (pixelFormat)
-                    {
-                        case PixelFormat::RGBA8UNorm:
-                        case PixelFormat::RGBA8UNormSRGB:
-                            downsample2x2Rgba8(previousWidth, previousHeight, previousData, newData);
-                            break;
-
-                        case PixelFormat::RG8UNorm:
-                            downsample2x2Rg8(previousWidth, previousHeight, previousData, newData);
-                            break;
-
-                        case PixelFormat::R8UNorm:
-                            downsample2x2R8(previousWidth, previousHeight, previousData, newData);
-                            break;
-
-                        case PixelFormat::A8UNorm:
-                            downsample2x2A8(previousWidth, previousHeight, previousData, newData);
-                            break;
-
-                        default:
-                            throw std::runtime_error("Invalid pixel format");
-                    }
+                    downsample2x2(previousWidth, previousHeight, pixelFormat, previousData, newData);
 
                     encode(mipMapSize, newData, pixelFormat, encodedData);
                     levels.emplace_back(mipMapSize, encodedData);
 
-                    previousData = newData;
+                    std::swap(previousData, newData);
 
                     previousWidth = newWidth;
                     previousHeight = newHeight;
@@ -693,18 +1076,16 @@ namespace ouzel
             if ((flags & Flags::BindRenderTarget) && (mipmaps == 0 || mipmaps > 1))
                 throw std::runtime_error("Invalid mip map count");
 
+            if (isCompressed(pixelFormat) && !initRenderer.getDevice()->isCompressedFormatSupported(pixelFormat))
+                throw std::runtime_error("Compressed pixel format not supported");
+
             if (!initRenderer.getDevice()->isNPOTTexturesSupported() &&
                 (!isPowerOfTwo(size.v[0]) || !isPowerOfTwo(size.v[1])))
                 mipmaps = 1;
 
             std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels = calculateSizes(size, initData, mipmaps, pixelFormat);
 
-            initRenderer.addCommand(std::make_unique<InitTextureCommand>(resource,
-                                                                         levels,
-                                                                         TextureType::TwoDimensional,
-                                                                         flags,
-                                                                         sampleCount,
-                                                                         pixelFormat));
+            uploadLevels(levels);
         }
 
         Texture::Texture(Renderer& initRenderer,
@@ -723,6 +1104,9 @@ namespace ouzel
             if ((flags & Flags::BindRenderTarget) && (mipmaps == 0 || mipmaps > 1))
                 throw std::runtime_error("Invalid mip map count");
 
+            if (isCompressed(pixelFormat) && !initRenderer.getDevice()->isCompressedFormatSupported(pixelFormat))
+                throw std::runtime_error("Compressed pixel format not supported");
+
             std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels = initLevels;
 
             if (!initRenderer.getDevice()->isNPOTTexturesSupported() &&
@@ -732,12 +1116,7 @@ namespace ouzel
                 levels.resize(1);
             }
 
-            initRenderer.addCommand(std::make_unique<InitTextureCommand>(resource,
-                                                                         levels,
-                                                                         TextureType::TwoDimensional,
-                                                                         flags,
-                                                                         sampleCount,
-                                                                         pixelFormat));
+            uploadLevels(levels);
         }
 
         void Texture::setData(const std::vector<std::uint8_t>& newData, CubeFace face)
@@ -748,86 +1127,92 @@ namespace ouzel
             std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels = calculateSizes(size, newData, mipmaps, pixelFormat);
 
             if (resource)
+            {
+                auto uploadToken = std::make_shared<UploadToken>();
+                upload = uploadToken;
+
                 renderer->addCommand(std::make_unique<SetTextureDataCommand>(resource,
                                                                              levels,
-                                                                             face));
+                                                                             face,
+                                                                             std::move(uploadToken)));
+            }
         }
 
         void Texture::setFilter(SamplerFilter newFilter)
         {
             filter = newFilter;
 
-            if (resource)
-                renderer->addCommand(std::make_unique<SetTextureParametersCommand>(resource,
-                                                                                   filter,
-                                                                                   addressX,
-                                                                                   addressY,
-                                                                                   addressZ,
-                                                                                   borderColor,
-                                                                                   maxAnisotropy));
+            updateParameters();
         }
 
         void Texture::setAddressX(SamplerAddressMode newAddressX)
         {
             addressX = newAddressX;
 
-            if (resource)
-                renderer->addCommand(std::make_unique<SetTextureParametersCommand>(resource,
-                                                                                   filter,
-                                                                                   addressX,
-                                                                                   addressY,
-                                                                                   addressZ,
-                                                                                   borderColor,
-                                                                                   maxAnisotropy));
+            updateParameters();
         }
 
         void Texture::setAddressY(SamplerAddressMode newAddressY)
         {
             addressY = newAddressY;
 
-            if (resource)
-                renderer->addCommand(std::make_unique<SetTextureParametersCommand>(resource,
-                                                                                   filter,
-                                                                                   addressX,
-                                                                                   addressY,
-                                                                                   addressZ,
-                                                                                   borderColor,
-                                                                                   maxAnisotropy));
+            updateParameters();
         }
 
         void Texture::setAddressZ(SamplerAddressMode newAddressZ)
         {
             addressZ = newAddressZ;
 
-            if (resource)
-                renderer->addCommand(std::make_unique<SetTextureParametersCommand>(resource,
-                                                                                   filter,
-                                                                                   addressX,
-                                                                                   addressY,
-                                                                                   addressZ,
-                                                                                   borderColor,
-                                                                                   maxAnisotropy));
+            updateParameters();
         }
 
         void Texture::setBorderColor(Color newBorderColor)
         {
             borderColor = newBorderColor;
 
-            if (resource)
-                renderer->addCommand(std::make_unique<SetTextureParametersCommand>(resource,
-                                                                                   filter,
-                                                                                   addressX,
-                                                                                   addressY,
-                                                                                   addressZ,
-                                                                                   borderColor,
-                                                                                   maxAnisotropy));
+            updateParameters();
         }
 
         void Texture::setMaxAnisotropy(std::uint32_t newMaxAnisotropy)
         {
             maxAnisotropy = newMaxAnisotropy;
 
+            updateParameters();
+        }
+
+        void Texture::requestScreenSize(const Size2F& screenSize)
+        {
+            if (streamHandle)
+                renderer->getTextureStreamer().requestScreenSize(resource, screenSize);
+        }
+
+        void Texture::uploadLevels(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& levels)
+        {
+            TextureStreamer& textureStreamer = renderer->getTextureStreamer();
+
+            // only static textures with a mip chain can be streamed
+            if (textureStreamer.isEnabled() && levels.size() > 1 &&
+                !(flags & (Flags::Dynamic | Flags::BindRenderTarget)))
+                streamHandle = textureStreamer.addTexture(resource, levels, flags, pixelFormat);
+            else
+            {
+                auto uploadToken = std::make_shared<UploadToken>();
+                upload = uploadToken;
+
+                renderer->addCommand(std::make_unique<InitTextureCommand>(resource,
+                                                                          levels,
+                                                                          TextureType::TwoDimensional,
+                                                                          flags,
+                                                                          sampleCount,
+                                                                          pixelFormat,
+                                                                          std::move(uploadToken)));
+            }
+        }
+
+        void Texture::updateParameters()
+        {
             if (resource)
+            {
                 renderer->addCommand(std::make_unique<SetTextureParametersCommand>(resource,
                                                                                    filter,
                                                                                    addressX,
@@ -835,6 +1220,16 @@ namespace ouzel
                                                                                    addressZ,
                                                                                    borderColor,
                                                                                    maxAnisotropy));
+
+                if (streamHandle)
+                    renderer->getTextureStreamer().setParameters(resource,
+                                                                 filter,
+                                                                 addressX,
+                                                                 addressY,
+                                                                 addressZ,
+                                                                 borderColor,
+                                                                 maxAnisotropy);
+            }
         }
     } // namespace graphics
 } // namespace ouzel
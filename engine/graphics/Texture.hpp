@@ -3,6 +3,7 @@
 #ifndef OUZEL_GRAPHICS_TEXTURE_HPP
 #define OUZEL_GRAPHICS_TEXTURE_HPP
 
+#include <memory>
 #include <vector>
 #include <utility>
 #include "RenderDevice.hpp"
@@ -11,6 +12,7 @@
 #include "PixelFormat.hpp"
 #include "SamplerAddressMode.hpp"
 #include "SamplerFilter.hpp"
+#include "TextureStreamer.hpp"
 #include "TextureType.hpp"
 #include "../math/Color.hpp"
 #include "../math/Size.hpp"
@@ -76,7 +78,16 @@ namespace ouzel
 
             inline auto getPixelFormat() const noexcept { return pixelFormat; }
 
+            inline auto isStreamed() const noexcept { return static_cast<bool>(streamHandle); }
+            void requestScreenSize(const Size2F& screenSize);
+
+            // whether the render device has uploaded all the data that was given to the texture
+            inline auto isUploaded() const noexcept { return upload.expired(); }
+
         private:
+            void uploadLevels(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& levels);
+            void updateParameters();
+
             Renderer* renderer = nullptr;
             RenderDevice::Resource resource;
 
@@ -92,6 +103,9 @@ namespace ouzel
             SamplerAddressMode addressZ = SamplerAddressMode::ClampToEdge;
             Color borderColor;
             std::uint32_t maxAnisotropy = 0;
+
+            TextureStreamer::Handle streamHandle;
+            std::weak_ptr<UploadToken> upload;
         };
     } // namespace graphics
 } // namespace ouzel
@@ -0,0 +1,264 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include "TextureAtlas.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace
+        {
+            struct Node final
+            {
+                std::uint32_t x = 0;
+                std::uint32_t y = 0;
+                std::uint32_t width = 0;
+                std::uint32_t height = 0;
+            };
+
+            bool contains(const Node& a, const Node& b) noexcept
+            {
+                return b.x >= a.x && b.y >= a.y &&
+                    b.x + b.width <= a.x + a.width &&
+                    b.y + b.height <= a.y + a.height;
+            }
+
+            class Bin final
+            {
+            public:
+                Bin(std::uint32_t width, std::uint32_t height)
+                {
+                    freeNodes.push_back(Node{0, 0, width, height});
+                }
+
+                // best short side fit
+                bool find(std::uint32_t width, std::uint32_t height, Node& result) const noexcept
+                {
+                    std::uint32_t bestShortSide = std::numeric_limits<std::uint32_t>::max();
+                    std::uint32_t bestLongSide = std::numeric_limits<std::uint32_t>::max();
+
+                    for (const Node& freeNode : freeNodes)
+                    {
+                        if (freeNode.width < width || freeNode.height < height) continue;
+
+                        const std::uint32_t leftoverX = freeNode.width - width;
+                        const std::uint32_t leftoverY = freeNode.height - height;
+                        const std::uint32_t shortSide = std::min(leftoverX, leftoverY);
+                        const std::uint32_t longSide = std::max(leftoverX, leftoverY);
+
+                        if (shortSide < bestShortSide ||
+                            (shortSide == bestShortSide && longSide < bestLongSide))
+                        {
+                            result = Node{freeNode.x, freeNode.y, width, height};
+                            bestShortSide = shortSide;
+                            bestLongSide = longSide;
+                        }
+                    }
+
+                    return bestShortSide != std::numeric_limits<std::uint32_t>::max();
+                }
+
+                void place(const Node& node)
+                {
+                    std::vector<Node> newFreeNodes;
+                    newFreeNodes.reserve(freeNodes.size() + 4);
+
+                    for (const Node& freeNode : freeNodes)
+                    {
+                        if (node.x >= freeNode.x + freeNode.width || node.x + node.width <= freeNode.x ||
+                            node.y >= freeNode.y + freeNode.height || node.y + node.height <= freeNode.y)
+                        {
+                            newFreeNodes.push_back(freeNode);
+                            continue;
+                        }
+
+                        // split the free node into the maximal rectangles around the placed one
+                        if (node.x > freeNode.x)
+                            newFreeNodes.push_back(Node{freeNode.x, freeNode.y,
+                                node.x - freeNode.x, freeNode.height});
+
+                        if (node.x + node.width < freeNode.x + freeNode.width)
+                            newFreeNodes.push_back(Node{node.x + node.width, freeNode.y,
+                                freeNode.x + freeNode.width - node.x - node.width, freeNode.height});
+
+                        if (node.y > freeNode.y)
+                            newFreeNodes.push_back(Node{freeNode.x, freeNode.y,
+                                freeNode.width, node.y - freeNode.y});
+
+                        if (node.y + node.height < freeNode.y + freeNode.height)
+                            newFreeNodes.push_back(Node{freeNode.x, node.y + node.height,
+                                freeNode.width, freeNode.y + freeNode.height - node.y - node.height});
+                    }
+
+                    // remove the free nodes that are fully contained in other free nodes
+                    freeNodes.clear();
+                    for (std::size_t i = 0; i < newFreeNodes.size(); ++i)
+                    {
+                        bool redundant = false;
+                        for (std::size_t j = 0; j < newFreeNodes.size() && !redundant; ++j)
+                            if (i != j && contains(newFreeNodes[j], newFreeNodes[i]))
+                                redundant = !contains(newFreeNodes[i], newFreeNodes[j]) || j < i;
+
+                        if (!redundant) freeNodes.push_back(newFreeNodes[i]);
+                    }
+
+                    usedWidth = std::max(usedWidth, node.x + node.width);
+                    usedHeight = std::max(usedHeight, node.y + node.height);
+                }
+
+                std::uint32_t usedWidth = 0;
+                std::uint32_t usedHeight = 0;
+
+            private:
+                std::vector<Node> freeNodes;
+            };
+
+            std::uint32_t alignUp(std::uint32_t value, std::uint32_t alignment) noexcept
+            {
+                return (value + alignment - 1) / alignment * alignment;
+            }
+
+            std::uint32_t pageDimension(std::uint32_t used, std::uint32_t maximum) noexcept
+            {
+                std::uint32_t result = 1;
+                while (result < used) result <<= 1;
+                return std::min(result, maximum);
+            }
+
+            // copies the image and repeats its edge pixels into the padding
+            void blit(const Image& image, std::uint32_t padding,
+                      std::vector<std::uint8_t>& pageData, std::uint32_t pageWidth,
+                      std::uint32_t x, std::uint32_t y)
+            {
+                constexpr std::uint32_t pixelSize = 4;
+                const std::uint32_t width = image.getSize().v[0];
+                const std::uint32_t height = image.getSize().v[1];
+                const std::uint8_t* data = image.getData().data();
+
+                for (std::uint32_t row = 0; row < height + padding * 2; ++row)
+                {
+                    const std::uint32_t sourceRow = (row < padding) ? 0 : std::min(row - padding, height - 1);
+                    const std::uint8_t* source = data + sourceRow * width * pixelSize;
+                    std::uint8_t* destination = pageData.data() + ((y + row) * pageWidth + x) * pixelSize;
+
+                    for (std::uint32_t column = 0; column < padding; ++column)
+                        std::memcpy(destination + column * pixelSize, source, pixelSize);
+
+                    std::memcpy(destination + padding * pixelSize, source, width * pixelSize);
+
+                    for (std::uint32_t column = 0; column < padding; ++column)
+                        std::memcpy(destination + (padding + width + column) * pixelSize,
+                                    source + (width - 1) * pixelSize, pixelSize);
+                }
+            }
+        }
+
+        TextureAtlas::TextureAtlas(const Size2U& initMaxPageSize,
+                                   std::uint32_t initPadding,
+                                   bool initMipmaps):
+            maxPageSize(initMaxPageSize),
+            padding(initPadding),
+            alignment(initMipmaps ? 4 : 1)
+        {
+        }
+
+        void TextureAtlas::addImage(const std::string& name, const Image& image)
+        {
+            if (image.getPixelFormat() != PixelFormat::RGBA8UNorm &&
+                image.getPixelFormat() != PixelFormat::RGBA8UNormSRGB)
+                throw std::runtime_error("Only RGBA8 images can be added to an atlas");
+
+            if (image.getSize().v[0] == 0 || image.getSize().v[1] == 0)
+                throw std::runtime_error("Invalid image size");
+
+            images.emplace_back(name, image);
+        }
+
+        void TextureAtlas::pack()
+        {
+            std::vector<Node> cells(images.size());
+            for (std::size_t i = 0; i < images.size(); ++i)
+            {
+                cells[i].width = alignUp(images[i].second.getSize().v[0] + padding * 2, alignment);
+                cells[i].height = alignUp(images[i].second.getSize().v[1] + padding * 2, alignment);
+
+                if (cells[i].width > maxPageSize.v[0] || cells[i].height > maxPageSize.v[1])
+                    throw std::runtime_error("Image " + images[i].first + " does not fit in an atlas page");
+            }
+
+            // placing the largest images first gives the tightest packing
+            std::vector<std::size_t> order(images.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&cells](std::size_t a, std::size_t b) noexcept {
+                const std::uint32_t sideA = std::max(cells[a].width, cells[a].height);
+                const std::uint32_t sideB = std::max(cells[b].width, cells[b].height);
+                if (sideA != sideB) return sideA > sideB;
+                return cells[a].width * cells[a].height > cells[b].width * cells[b].height;
+            });
+
+            // linear and sRGB images are kept on separate pages, so that each page has the format of its images
+            std::vector<Bin> bins;
+            std::vector<PixelFormat> binFormats;
+            std::vector<std::size_t> binIndices(images.size());
+
+            for (const std::size_t i : order)
+            {
+                const PixelFormat pixelFormat = images[i].second.getPixelFormat();
+                Node node;
+                std::size_t binIndex = 0;
+
+                for (; binIndex < bins.size(); ++binIndex)
+                    if (binFormats[binIndex] == pixelFormat &&
+                        bins[binIndex].find(cells[i].width, cells[i].height, node))
+                        break;
+
+                if (binIndex == bins.size())
+                {
+                    bins.emplace_back(maxPageSize.v[0], maxPageSize.v[1]);
+                    binFormats.push_back(pixelFormat);
+                    bins.back().find(cells[i].width, cells[i].height, node);
+                }
+
+                bins[binIndex].place(node);
+                cells[i] = node;
+                binIndices[i] = binIndex;
+            }
+
+            const std::size_t firstPage = pages.size();
+            std::vector<std::vector<std::uint8_t>> pageData(bins.size());
+            std::vector<Size2U> pageSizes(bins.size());
+
+            for (std::size_t binIndex = 0; binIndex < bins.size(); ++binIndex)
+            {
+                pageSizes[binIndex] = Size2U(pageDimension(bins[binIndex].usedWidth, maxPageSize.v[0]),
+                                             pageDimension(bins[binIndex].usedHeight, maxPageSize.v[1]));
+                pageData[binIndex].resize(pageSizes[binIndex].v[0] * pageSizes[binIndex].v[1] * 4);
+            }
+
+            for (std::size_t i = 0; i < images.size(); ++i)
+            {
+                const Image& image = images[i].second;
+                const std::size_t binIndex = binIndices[i];
+
+                blit(image, padding, pageData[binIndex], pageSizes[binIndex].v[0], cells[i].x, cells[i].y);
+
+                Region& region = regions[images[i].first];
+                region.page = firstPage + binIndex;
+                region.rectangle = RectF(static_cast<float>(cells[i].x + padding),
+                                         static_cast<float>(cells[i].y + padding),
+                                         static_cast<float>(image.getSize().v[0]),
+                                         static_cast<float>(image.getSize().v[1]));
+            }
+
+            for (std::size_t binIndex = 0; binIndex < bins.size(); ++binIndex)
+                pages.emplace_back(binFormats[binIndex], pageSizes[binIndex], pageData[binIndex]);
+
+            images.clear();
+        }
+    } // namespace graphics
+} // namespace ouzel
@@ -0,0 +1,53 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_TEXTUREATLAS_HPP
+#define OUZEL_GRAPHICS_TEXTUREATLAS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Image.hpp"
+#include "../math/Rect.hpp"
+#include "../math/Size.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        // Packs RGBA8 images into as few pages as possible with the MaxRects algorithm, linear and
+        // sRGB images are placed on separate pages
+        class TextureAtlas final
+        {
+        public:
+            struct Region final
+            {
+                std::size_t page = 0;
+                RectF rectangle;
+            };
+
+            // padding is filled with the edge pixels of each image, so that filtering does not
+            // sample the neighbours, with mipmaps images are also aligned to four pixels
+            explicit TextureAtlas(const Size2U& initMaxPageSize = Size2U(2048, 2048),
+                                  std::uint32_t initPadding = 2,
+                                  bool initMipmaps = true);
+
+            void addImage(const std::string& name, const Image& image);
+            void pack();
+
+            inline auto& getPages() const noexcept { return pages; }
+            inline auto& getRegions() const noexcept { return regions; }
+
+        private:
+            Size2U maxPageSize;
+            std::uint32_t padding = 2;
+            std::uint32_t alignment = 1;
+
+            std::vector<std::pair<std::string, Image>> images;
+            std::vector<Image> pages;
+            std::map<std::string, Region> regions;
+        };
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_TEXTUREATLAS_HPP
@@ -0,0 +1,231 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <algorithm>
+#include <cmath>
+#include "TextureStreamer.hpp"
+#include "Commands.hpp"
+#include "Renderer.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        TextureStreamer::TextureStreamer(Renderer& initRenderer):
+            renderer(initRenderer)
+        {
+        }
+
+        TextureStreamer::Handle TextureStreamer::addTexture(std::uintptr_t texture,
+                                                            const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& levels,
+                                                            std::uint32_t flags,
+                                                            PixelFormat pixelFormat)
+        {
+            StreamedTexture& streamedTexture = textures[texture];
+            streamedTexture.levels = levels;
+            streamedTexture.flags = flags;
+            streamedTexture.pixelFormat = pixelFormat;
+
+            streamedTexture.sizes.resize(levels.size());
+            std::size_t chainSize = 0;
+            for (std::size_t level = levels.size(); level-- > 0;)
+            {
+                chainSize += getLevelSize(pixelFormat, levels[level].first.v[0], levels[level].first.v[1]);
+                streamedTexture.sizes[level] = chainSize;
+            }
+
+            // start with the largest level that fits in the minimum resident size
+            auto lowestLevel = static_cast<std::uint32_t>(levels.size() - 1);
+            while (lowestLevel > 0 &&
+                   levels[lowestLevel - 1].first.v[0] <= minResidentSize &&
+                   levels[lowestLevel - 1].first.v[1] <= minResidentSize)
+                --lowestLevel;
+
+            streamedTexture.lowestLevel = lowestLevel;
+            streamedTexture.requestedLevel = lowestLevel;
+            streamedTexture.targetLevel = lowestLevel;
+            streamedTexture.residentLevel = lowestLevel;
+            residentSize += streamedTexture.sizes[lowestLevel];
+
+            initTexture(texture, streamedTexture);
+
+            return Handle(*this, texture);
+        }
+
+        void TextureStreamer::removeTexture(std::uintptr_t texture)
+        {
+            auto i = textures.find(texture);
+
+            if (i != textures.end())
+            {
+                residentSize -= i->second.sizes[i->second.residentLevel];
+                textures.erase(i);
+            }
+        }
+
+        void TextureStreamer::setParameters(std::uintptr_t texture,
+                                            SamplerFilter filter,
+                                            SamplerAddressMode addressX,
+                                            SamplerAddressMode addressY,
+                                            SamplerAddressMode addressZ,
+                                            Color borderColor,
+                                            std::uint32_t maxAnisotropy)
+        {
+            auto i = textures.find(texture);
+
+            if (i != textures.end())
+            {
+                i->second.filter = filter;
+                i->second.addressX = addressX;
+                i->second.addressY = addressY;
+                i->second.addressZ = addressZ;
+                i->second.borderColor = borderColor;
+                i->second.maxAnisotropy = maxAnisotropy;
+            }
+        }
+
+        void TextureStreamer::requestScreenSize(std::uintptr_t texture, const Size2F& screenSize)
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+
+            auto i = textures.find(texture);
+
+            if (i == textures.end()) return;
+
+            StreamedTexture& streamedTexture = i->second;
+            const Size2U& size = streamedTexture.levels.front().first;
+
+            // one level per halving of the texel to pixel ratio
+            std::uint32_t level = streamedTexture.lowestLevel;
+            if (screenSize.v[0] > 0.0F && screenSize.v[1] > 0.0F)
+            {
+                const float ratio = std::max(static_cast<float>(size.v[0]) / screenSize.v[0],
+                                             static_cast<float>(size.v[1]) / screenSize.v[1]);
+                level = (ratio > 1.0F) ?
+                    std::min(static_cast<std::uint32_t>(std::log2(ratio)), streamedTexture.lowestLevel) : 0;
+            }
+
+            if (streamedTexture.requestFrame != frame)
+            {
+                streamedTexture.requestFrame = frame;
+                streamedTexture.requestedLevel = level;
+            }
+            else if (level < streamedTexture.requestedLevel)
+                streamedTexture.requestedLevel = level;
+        }
+
+        void TextureStreamer::markUsed(const std::vector<std::uintptr_t>& usedTextures)
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+
+            for (const std::uintptr_t texture : usedTextures)
+            {
+                auto i = textures.find(texture);
+
+                // textures drawn without a size estimate get all of their levels
+                if (i != textures.end() && i->second.requestFrame != frame)
+                {
+                    i->second.requestFrame = frame;
+                    i->second.requestedLevel = 0;
+                }
+            }
+        }
+
+        void TextureStreamer::update()
+        {
+            if (textures.empty())
+            {
+                ++frame;
+                return;
+            }
+
+            std::vector<std::pair<std::uintptr_t, StreamedTexture*>> candidates;
+            candidates.reserve(textures.size());
+
+            std::size_t totalSize = 0;
+            for (auto& texture : textures)
+            {
+                StreamedTexture& streamedTexture = texture.second;
+
+                // textures that were not drawn this frame keep their levels until the budget runs out
+                streamedTexture.targetLevel = (streamedTexture.requestFrame == frame) ?
+                    streamedTexture.requestedLevel : streamedTexture.residentLevel;
+                totalSize += streamedTexture.sizes[streamedTexture.targetLevel];
+
+                candidates.emplace_back(texture.first, &streamedTexture);
+            }
+
+            if (totalSize > budget)
+            {
+                // evict the least recently drawn textures first, the largest ones first among them
+                std::sort(candidates.begin(), candidates.end(),
+                          [](const std::pair<std::uintptr_t, StreamedTexture*>& a,
+                             const std::pair<std::uintptr_t, StreamedTexture*>& b) noexcept {
+                              if (a.second->requestFrame != b.second->requestFrame)
+                                  return a.second->requestFrame < b.second->requestFrame;
+                              return a.second->sizes[a.second->targetLevel] > b.second->sizes[b.second->targetLevel];
+                          });
+
+                for (auto& candidate : candidates)
+                {
+                    StreamedTexture& streamedTexture = *candidate.second;
+
+                    while (totalSize > budget && streamedTexture.targetLevel < streamedTexture.lowestLevel)
+                    {
+                        totalSize -= streamedTexture.sizes[streamedTexture.targetLevel];
+                        ++streamedTexture.targetLevel;
+                        totalSize += streamedTexture.sizes[streamedTexture.targetLevel];
+                    }
+
+                    if (totalSize <= budget) break;
+                }
+            }
+
+            for (auto& candidate : candidates)
+            {
+                StreamedTexture& streamedTexture = *candidate.second;
+
+                // refine one level per frame to spread the uploads, evict immediately
+                std::uint32_t level = streamedTexture.targetLevel;
+                if (level < streamedTexture.residentLevel) level = streamedTexture.residentLevel - 1;
+
+                if (level != streamedTexture.residentLevel)
+                    upload(candidate.first, streamedTexture, level);
+            }
+
+            ++frame;
+        }
+
+        void TextureStreamer::upload(std::uintptr_t texture, StreamedTexture& streamedTexture, std::uint32_t level)
+        {
+            if (streamedTexture.sizes.empty()) return;
+
+            residentSize -= streamedTexture.sizes[streamedTexture.residentLevel];
+            streamedTexture.residentLevel = level;
+            residentSize += streamedTexture.sizes[level];
+
+            initTexture(texture, streamedTexture);
+        }
+
+        void TextureStreamer::initTexture(std::uintptr_t texture, const StreamedTexture& streamedTexture)
+        {
+            const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels(streamedTexture.levels.begin() + streamedTexture.residentLevel,
+                                                                                    streamedTexture.levels.end());
+
+            renderer.addCommand(std::make_unique<InitTextureCommand>(texture,
+                                                                     levels,
+                                                                     TextureType::TwoDimensional,
+                                                                     streamedTexture.flags,
+                                                                     1,
+                                                                     streamedTexture.pixelFormat));
+
+            // the texture is recreated, so its sampler state has to be set again
+            renderer.addCommand(std::make_unique<SetTextureParametersCommand>(texture,
+                                                                              streamedTexture.filter,
+                                                                              streamedTexture.addressX,
+                                                                              streamedTexture.addressY,
+                                                                              streamedTexture.addressZ,
+                                                                              streamedTexture.borderColor,
+                                                                              streamedTexture.maxAnisotropy));
+        }
+    } // namespace graphics
+} // namespace ouzel
@@ -0,0 +1,147 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_TEXTURESTREAMER_HPP
+#define OUZEL_GRAPHICS_TEXTURESTREAMER_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "PixelFormat.hpp"
+#include "SamplerAddressMode.hpp"
+#include "SamplerFilter.hpp"
+#include "../math/Color.hpp"
+#include "../math/Size.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        class Renderer;
+
+        // Keeps the full mip chain of static textures in system memory and uploads
+        // only the levels that are needed for their on-screen size, within a budget
+        class TextureStreamer final
+        {
+        public:
+            // Removes the texture from the streamer when destroyed
+            class Handle final
+            {
+            public:
+                Handle() = default;
+                Handle(TextureStreamer& initStreamer, std::uintptr_t initTexture) noexcept:
+                    streamer(&initStreamer), texture(initTexture)
+                {
+                }
+
+                ~Handle()
+                {
+                    if (streamer) streamer->removeTexture(texture);
+                }
+
+                Handle(const Handle&) = delete;
+                Handle& operator=(const Handle&) = delete;
+
+                Handle(Handle&& other) noexcept:
+                    streamer(other.streamer),
+                    texture(other.texture)
+                {
+                    other.streamer = nullptr;
+                    other.texture = 0;
+                }
+
+                Handle& operator=(Handle&& other) noexcept
+                {
+                    if (&other == this) return *this;
+
+                    if (streamer) streamer->removeTexture(texture);
+
+                    streamer = other.streamer;
+                    texture = other.texture;
+                    other.streamer = nullptr;
+                    other.texture = 0;
+
+                    return *this;
+                }
+
+                explicit inline operator bool() const noexcept { return streamer != nullptr; }
+
+            private:
+                TextureStreamer* streamer = nullptr;
+                std::uintptr_t texture = 0;
+            };
+
+            explicit TextureStreamer(Renderer& initRenderer);
+
+            TextureStreamer(const TextureStreamer&) = delete;
+            TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+            // zero budget disables streaming
+            inline auto isEnabled() const noexcept { return budget > 0; }
+            inline auto getBudget() const noexcept { return budget; }
+            void setBudget(std::size_t newBudget) noexcept { budget = newBudget; }
+
+            // the largest level that stays resident even when the texture is not visible
+            inline auto getMinResidentSize() const noexcept { return minResidentSize; }
+            void setMinResidentSize(std::uint32_t newMinResidentSize) noexcept { minResidentSize = newMinResidentSize; }
+
+            inline auto getResidentSize() const noexcept { return residentSize; }
+
+            Handle addTexture(std::uintptr_t texture,
+                              const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& levels,
+                              std::uint32_t flags,
+                              PixelFormat pixelFormat);
+
+            void setParameters(std::uintptr_t texture,
+                               SamplerFilter filter,
+                               SamplerAddressMode addressX,
+                               SamplerAddressMode addressY,
+                               SamplerAddressMode addressZ,
+                               Color borderColor,
+                               std::uint32_t maxAnisotropy);
+
+            // can be called by the command encoder threads
+            void requestScreenSize(std::uintptr_t texture, const Size2F& screenSize);
+            void markUsed(const std::vector<std::uintptr_t>& textures);
+
+            void update();
+
+        private:
+            struct StreamedTexture final
+            {
+                std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels;
+                std::vector<std::size_t> sizes; // sizes of the chains starting at each level
+                std::uint32_t flags = 0;
+                PixelFormat pixelFormat = PixelFormat::RGBA8UNorm;
+                SamplerFilter filter = SamplerFilter::Default;
+                SamplerAddressMode addressX = SamplerAddressMode::ClampToEdge;
+                SamplerAddressMode addressY = SamplerAddressMode::ClampToEdge;
+                SamplerAddressMode addressZ = SamplerAddressMode::ClampToEdge;
+                Color borderColor;
+                std::uint32_t maxAnisotropy = 0;
+
+                std::uint32_t lowestLevel = 0;
+                std::uint32_t residentLevel = 0;
+                std::uint32_t requestedLevel = 0;
+                std::uint32_t targetLevel = 0;
+                std::uint64_t requestFrame = 0;
+            };
+
+            void removeTexture(std::uintptr_t texture);
+            void upload(std::uintptr_t texture, StreamedTexture& streamedTexture, std::uint32_t level);
+            // creates the texture from its resident level and the levels below it
+            void initTexture(std::uintptr_t texture, const StreamedTexture& streamedTexture);
+
+            Renderer& renderer;
+            std::unordered_map<std::uintptr_t, StreamedTexture> textures;
+            std::mutex requestMutex;
+            std::size_t budget = 0;
+            std::size_t residentSize = 0;
+            std::uint32_t minResidentSize = 64;
+            std::uint64_t frame = 1;
+        };
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_TEXTURESTREAMER_HPP
@@ -4,8 +4,9 @@
 #define OUZEL_GRAPHICS_VERTEX_HPP
 
 #include "DataType.hpp"
-#include "../math/Vector.hpp"
 #include "../math/Color.hpp"
+#include "../math/Matrix.hpp"
+#include "../math/Vector.hpp"
 
 namespace ouzel
 {
@@ -51,6 +52,20 @@ namespace ouzel
             Vector2F texCoords[2];
             Vector3F normal;
         };
+
+        // per-instance data of instanced draws, the transform is passed as four column attributes
+        class Instance final
+        {
+        public:
+            Instance() noexcept = default;
+            Instance(const Matrix4F& initTransform, Color initColor) noexcept:
+                transform(initTransform), color(initColor)
+            {
+            }
+
+            Matrix4F transform;
+            Color color;
+        };
     } // namespace graphics
 } // namespace ouzel
 
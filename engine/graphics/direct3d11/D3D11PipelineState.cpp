@@ -0,0 +1,58 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_DIRECT3D11
+
+#include <stdexcept>
+#include "D3D11PipelineState.hpp"
+#include "D3D11RenderDevice.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace d3d11
+        {
+            namespace
+            {
+                // indices in the rasterizer states of the render device
+                constexpr std::uint32_t getRasterizerCullModeIndex(CullMode cullMode)
+                {
+                    switch (cullMode)
+                    {
+                        case CullMode::NoCull: return 0;
+                        case CullMode::Front: return 1;
+                        case CullMode::Back: return 2;
+                        default: throw std::runtime_error("Invalid cull mode");
+                    }
+                }
+
+                constexpr std::uint32_t getRasterizerFillModeIndex(FillMode fillMode)
+                {
+                    switch (fillMode)
+                    {
+                        case FillMode::Solid: return 0;
+                        case FillMode::Wireframe: return 1;
+                        default: throw std::runtime_error("Invalid fill mode");
+                    }
+                }
+            }
+
+            PipelineState::PipelineState(RenderDevice& initRenderDevice,
+                                         std::uintptr_t initBlendState,
+                                         std::uintptr_t initShader,
+                                         CullMode cullMode,
+                                         FillMode fillMode):
+                RenderResource(initRenderDevice),
+                blendState(initBlendState),
+                shader(initShader),
+                cullModeIndex(getRasterizerCullModeIndex(cullMode)),
+                fillModeIndex(getRasterizerFillModeIndex(fillMode))
+            {
+            }
+        } // namespace d3d11
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
@@ -0,0 +1,51 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_D3D11PIPELINESTATE_HPP
+#define OUZEL_GRAPHICS_D3D11PIPELINESTATE_HPP
+
+#include <cstdint>
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_DIRECT3D11
+
+#include "D3D11RenderResource.hpp"
+#include "../RasterizerState.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace d3d11
+        {
+            class RenderDevice;
+
+            // Direct3D 11 has no pipeline state objects, so this keeps the indices of the states
+            // to bind. The blend state and the shader are looked up when the state is set.
+            class PipelineState final: public RenderResource
+            {
+            public:
+                PipelineState(RenderDevice& initRenderDevice,
+                              std::uintptr_t initBlendState,
+                              std::uintptr_t initShader,
+                              CullMode cullMode,
+                              FillMode fillMode);
+
+                inline auto getBlendState() const noexcept { return blendState; }
+                inline auto getShader() const noexcept { return shader; }
+                inline auto getCullModeIndex() const noexcept { return cullModeIndex; }
+                inline auto getFillModeIndex() const noexcept { return fillModeIndex; }
+
+            private:
+                std::uintptr_t blendState = 0;
+                std::uintptr_t shader = 0;
+                std::uint32_t cullModeIndex = 0;
+                std::uint32_t fillModeIndex = 0;
+            };
+        } // namespace d3d11
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
+
+#endif // OUZEL_GRAPHICS_D3D11PIPELINESTATE_HPP
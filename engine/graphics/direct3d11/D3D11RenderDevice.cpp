@@ -5,10 +5,12 @@
 #if OUZEL_COMPILE_DIRECT3D11
 
 #include <cassert>
+#include <cstring>
 #include "D3D11RenderDevice.hpp"
 #include "D3D11BlendState.hpp"
 #include "D3D11Buffer.hpp"
 #include "D3D11DepthStencilState.hpp"
+#include "D3D11PipelineState.hpp"
 #include "D3D11RenderTarget.hpp"
 #include "D3D11Shader.hpp"
 #include "D3D11Texture.hpp"
@@ -16,7 +18,6 @@
 #include "../../core/Window.hpp"
 #include "../../core/windows/NativeWindowWin.hpp"
 #include "../../utils/Log.hpp"
-#include "stb_image_write.h"
 
 namespace ouzel
 {
@@ -145,6 +146,7 @@ namespace ouzel
                 clampToBorderSupported = true;
                 multisamplingSupported = true;
                 uintIndicesSupported = true;
+                dxtTexturesSupported = true;
 
                 UINT deviceCreationFlags = 0;
 
@@ -171,8 +173,17 @@ namespace ouzel
 				device = newDevice;
 				context = newContext;
 
+                if (featureLevel >= D3D_FEATURE_LEVEL_9_3)
+                    instancingSupported = true;
+
                 if (featureLevel >= D3D_FEATURE_LEVEL_10_0)
+                {
                     npotTexturesSupported = true;
+                    rgtcTexturesSupported = true;
+                }
+
+                if (featureLevel >= D3D_FEATURE_LEVEL_11_0)
+                    bptcTexturesSupported = true;
 
 
 				void* dxgiDevicePtr;
@@ -416,6 +427,8 @@ namespace ouzel
                                 if (currentRenderTarget)
                                     currentRenderTarget->resolve();
 
+                                endTimerQueryFrame();
+                                captureFrame();
                                 swapChain->Present(swapInterval, 0);
                                 break;
                             }
@@ -423,7 +436,10 @@ namespace ouzel
                             case Command::Type::DeleteResource:
                             {
                                 auto deleteResourceCommand = static_cast<const DeleteResourceCommand*>(command.get());
-                                resources[deleteResourceCommand->resource - 1].reset();
+
+                                // the resource might have been released before it was initialized
+                                if (deleteResourceCommand->resource <= resources.size())
+                                    resources[deleteResourceCommand->resource - 1].reset();
                                 break;
                             }
 
@@ -611,12 +627,31 @@ namespace ouzel
                                 break;
                             }
 
+                            case Command::Type::InitPipelineState:
+                            {
+                                auto initPipelineStateCommand = static_cast<const InitPipelineStateCommand*>(command.get());
+
+                                auto pipelineState = std::make_unique<PipelineState>(*this,
+                                                                                     initPipelineStateCommand->blendState,
+                                                                                     initPipelineStateCommand->shader,
+                                                                                     initPipelineStateCommand->cullMode,
+                                                                                     initPipelineStateCommand->fillMode);
+
+                                if (initPipelineStateCommand->pipelineState > resources.size())
+                                    resources.resize(initPipelineStateCommand->pipelineState);
+                                resources[initPipelineStateCommand->pipelineState - 1] = std::move(pipelineState);
+                                break;
+                            }
+
                             case Command::Type::SetPipelineState:
                             {
                                 auto setPipelineStateCommand = static_cast<const SetPipelineStateCommand*>(command.get());
 
-                                auto blendState = getResource<BlendState>(setPipelineStateCommand->blendState);
-                                auto shader = getResource<Shader>(setPipelineStateCommand->shader);
+                                auto pipelineState = getResource<PipelineState>(setPipelineStateCommand->pipelineState);
+                                assert(pipelineState);
+
+                                auto blendState = getResource<BlendState>(pipelineState->getBlendState());
+                                auto shader = getResource<Shader>(pipelineState->getShader());
                                 currentShader = shader;
 
                                 if (blendState)
@@ -641,20 +676,8 @@ namespace ouzel
                                     context->IASetInputLayout(nullptr);
                                 }
 
-                                switch (setPipelineStateCommand->cullMode)
-                                {
-                                    case CullMode::NoCull: cullModeIndex = 0; break;
-                                    case CullMode::Front: cullModeIndex = 1; break;
-                                    case CullMode::Back: cullModeIndex = 2; break;
-                                    default: throw std::runtime_error("Invalid cull mode");
-                                }
-
-                                switch (setPipelineStateCommand->fillMode)
-                                {
-                                    case FillMode::Solid: fillModeIndex = 0; break;
-                                    case FillMode::Wireframe: fillModeIndex = 1; break;
-                                    default: throw std::runtime_error("Invalid fill mode");
-                                }
+                                cullModeIndex = pipelineState->getCullModeIndex();
+                                fillModeIndex = pipelineState->getFillModeIndex();
 
                                 const std::uint32_t rasterizerStateIndex = fillModeIndex * 6 + scissorEnableIndex * 3 + cullModeIndex;
                                 context->RSSetState(rasterizerStates[rasterizerStateIndex].get());
@@ -691,15 +714,51 @@ namespace ouzel
                                 break;
                             }
 
+                            case Command::Type::DrawInstanced:
+                            {
+                                auto drawInstancedCommand = static_cast<const DrawInstancedCommand*>(command.get());
+
+                                auto indexBuffer = getResource<Buffer>(drawInstancedCommand->indexBuffer);
+                                auto vertexBuffer = getResource<Buffer>(drawInstancedCommand->vertexBuffer);
+                                auto instanceBuffer = getResource<Buffer>(drawInstancedCommand->instanceBuffer);
+
+                                assert(indexBuffer);
+                                assert(indexBuffer->getBuffer());
+                                assert(vertexBuffer);
+                                assert(vertexBuffer->getBuffer());
+                                assert(instanceBuffer);
+                                assert(instanceBuffer->getBuffer());
+
+                                ID3D11Buffer* buffers[] = {vertexBuffer->getBuffer().get(), instanceBuffer->getBuffer().get()};
+                                UINT strides[] = {sizeof(Vertex), sizeof(Instance)};
+                                UINT offsets[] = {0, 0};
+                                context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+                                context->IASetIndexBuffer(indexBuffer->getBuffer().get(),
+                                                          getIndexFormat(drawInstancedCommand->indexSize), 0);
+                                context->IASetPrimitiveTopology(getPrimitiveTopology(drawInstancedCommand->drawMode));
+
+                                assert(drawInstancedCommand->indexCount);
+                                assert(drawInstancedCommand->instanceCount);
+                                assert(instanceBuffer->getSize() >= drawInstancedCommand->instanceCount * sizeof(Instance));
+
+                                context->DrawIndexedInstanced(drawInstancedCommand->indexCount,
+                                                              drawInstancedCommand->instanceCount,
+                                                              drawInstancedCommand->startIndex, 0, 0);
+
+                                break;
+                            }
+
                             case Command::Type::PushDebugMarker:
                             {
-                                // D3D11 does not support debug markers
+                                // D3D11 does not support debug markers, but the regions are timed
+                                auto pushDebugMarkerCommand = static_cast<const PushDebugMarkerCommand*>(command.get());
+                                beginTimerQuery(pushDebugMarkerCommand->name);
                                 break;
                             }
 
                             case Command::Type::PopDebugMarker:
                             {
-                                // D3D11 does not support debug markers
+                                endTimerQuery();
                                 break;
                             }
 
@@ -962,76 +1021,139 @@ namespace ouzel
                 return result;
             }
 
-            void RenderDevice::generateScreenshot(const std::string& filename)
+            void RenderDevice::captureFrame()
+            {
+                // a failed capture is dropped, it must not keep the frame from being presented
+                try
+                {
+                    std::vector<std::string> filenames = frameCapture.nextFrame(pendingCaptures.size());
+                    if (!filenames.empty()) copyBackBuffer(std::move(filenames));
+                }
+                catch (const std::exception& e)
+                {
+                    engine->log(Log::Level::Error) << "Failed to capture frame: " << e.what();
+                }
+
+                readCapturedFrames();
+            }
+
+            void RenderDevice::copyBackBuffer(std::vector<std::string> filenames)
             {
-				void* backBufferTexturePtr;
+                D3D11_TEXTURE2D_DESC backBufferDesc;
+                backBuffer->GetDesc(&backBufferDesc);
+
+                // reuse the staging texture of a finished read back if the size of the back buffer has not changed
+                Pointer<ID3D11Texture2D> texture;
+                while (!texture && !freeCaptureTextures.empty())
+                {
+                    D3D11_TEXTURE2D_DESC freeTextureDesc;
+                    freeCaptureTextures.back()->GetDesc(&freeTextureDesc);
+
+                    if (freeTextureDesc.Width == backBufferDesc.Width &&
+                        freeTextureDesc.Height == backBufferDesc.Height)
+                        texture = std::move(freeCaptureTextures.back());
+
+                    freeCaptureTextures.pop_back();
+                }
 
                 HRESULT hr;
-                if (FAILED(hr = backBuffer->QueryInterface(IID_ID3D11Texture2D, &backBufferTexturePtr)))
-                    throw std::system_error(hr, errorCategory, "Failed to get Direct3D 11 back buffer texture");
 
-				Pointer<ID3D11Texture2D> backBufferTexture = static_cast<ID3D11Texture2D*>(backBufferTexturePtr);
+                if (!texture)
+                {
+                    D3D11_TEXTURE2D_DESC textureDesc;
+                    textureDesc.Width = backBufferDesc.Width;
+                    textureDesc.Height = backBufferDesc.Height;
+                    textureDesc.MipLevels = 1;
+                    textureDesc.ArraySize = 1;
+                    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                    textureDesc.SampleDesc.Count = 1;
+                    textureDesc.SampleDesc.Quality = 0;
+                    textureDesc.Usage = D3D11_USAGE_STAGING;
+                    textureDesc.BindFlags = 0;
+                    textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+                    textureDesc.MiscFlags = 0;
+
+                    ID3D11Texture2D* texturePtr;
+                    if (FAILED(hr = device->CreateTexture2D(&textureDesc, nullptr, &texturePtr)))
+                        throw std::system_error(hr, errorCategory, "Failed to create Direct3D 11 texture");
 
-                D3D11_TEXTURE2D_DESC backBufferDesc;
-                backBufferTexture->GetDesc(&backBufferDesc);
-
-                D3D11_TEXTURE2D_DESC textureDesc;
-                textureDesc.Width = backBufferDesc.Width;
-                textureDesc.Height = backBufferDesc.Height;
-                textureDesc.MipLevels = 1;
-                textureDesc.ArraySize = 1;
-                textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-                textureDesc.SampleDesc.Count = 1;
-                textureDesc.SampleDesc.Quality = 0;
-                textureDesc.Usage = D3D11_USAGE_STAGING;
-                textureDesc.BindFlags = 0;
-                textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-                textureDesc.MiscFlags = 0;
-
-                ID3D11Texture2D* texturePtr;
-                if (FAILED(hr = device->CreateTexture2D(&textureDesc, nullptr, &texturePtr)))
-                    throw std::system_error(hr, errorCategory, "Failed to create Direct3D 11 texture");
-
-				Pointer<ID3D11Texture2D> texture = texturePtr;
+                    texture = texturePtr;
+                }
 
                 if (backBufferDesc.SampleDesc.Count > 1)
                 {
                     D3D11_TEXTURE2D_DESC resolveTextureDesc;
-                    resolveTextureDesc.Width = backBufferDesc.Width;
-                    resolveTextureDesc.Height = backBufferDesc.Height;
-                    resolveTextureDesc.MipLevels = 1;
-                    resolveTextureDesc.ArraySize = 1;
-                    resolveTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-                    resolveTextureDesc.SampleDesc.Count = 1;
-                    resolveTextureDesc.SampleDesc.Quality = 0;
-                    resolveTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-                    resolveTextureDesc.BindFlags = 0;
-                    resolveTextureDesc.CPUAccessFlags = 0;
-                    resolveTextureDesc.MiscFlags = 0;
-
-                    ID3D11Texture2D* resolveTexturePtr;
-                    if (FAILED(hr = device->CreateTexture2D(&resolveTextureDesc, nullptr, &resolveTexturePtr)))
-                        throw std::system_error(hr, errorCategory, "Failed to create Direct3D 11 texture");
+                    if (captureResolveTexture) captureResolveTexture->GetDesc(&resolveTextureDesc);
 
-					Pointer<ID3D11Texture2D> resolveTexture = resolveTexturePtr;
+                    if (!captureResolveTexture ||
+                        resolveTextureDesc.Width != backBufferDesc.Width ||
+                        resolveTextureDesc.Height != backBufferDesc.Height)
+                    {
+                        resolveTextureDesc.Width = backBufferDesc.Width;
+                        resolveTextureDesc.Height = backBufferDesc.Height;
+                        resolveTextureDesc.MipLevels = 1;
+                        resolveTextureDesc.ArraySize = 1;
+                        resolveTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                        resolveTextureDesc.SampleDesc.Count = 1;
+                        resolveTextureDesc.SampleDesc.Quality = 0;
+                        resolveTextureDesc.Usage = D3D11_USAGE_DEFAULT;
+                        resolveTextureDesc.BindFlags = 0;
+                        resolveTextureDesc.CPUAccessFlags = 0;
+                        resolveTextureDesc.MiscFlags = 0;
+
+                        ID3D11Texture2D* resolveTexturePtr;
+                        if (FAILED(hr = device->CreateTexture2D(&resolveTextureDesc, nullptr, &resolveTexturePtr)))
+                            throw std::system_error(hr, errorCategory, "Failed to create Direct3D 11 texture");
+
+                        captureResolveTexture = resolveTexturePtr;
+                    }
 
-                    context->ResolveSubresource(resolveTexture.get(), 0, backBuffer.get(), 0, DXGI_FORMAT_R8G8B8A8_UNORM);
-                    context->CopyResource(texture.get(), resolveTexture.get());
+                    context->ResolveSubresource(captureResolveTexture.get(), 0, backBuffer.get(), 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+                    context->CopyResource(texture.get(), captureResolveTexture.get());
                 }
                 else
                     context->CopyResource(texture.get(), backBuffer.get());
 
-                D3D11_MAPPED_SUBRESOURCE mappedSubresource;
-                if (FAILED(hr = context->Map(texture.get(), 0, D3D11_MAP_READ, 0, &mappedSubresource)))
-                    throw std::system_error(hr, errorCategory, "Failed to map Direct3D 11 resource");
+                pendingCaptures.push_back(PendingCapture{std::move(filenames), std::move(texture)});
+            }
 
-                if (!stbi_write_png(filename.c_str(), textureDesc.Width, textureDesc.Height, 4, mappedSubresource.pData, static_cast<int>(mappedSubresource.RowPitch)))
+            void RenderDevice::readCapturedFrames()
+            {
+                // the copies are mapped once the GPU has finished them, so the render thread never waits
+                while (!pendingCaptures.empty())
                 {
-                    context->Unmap(texture.get(), 0);
-                    throw std::runtime_error("Failed to save screenshot to file");
-                }
+                    D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+                    const HRESULT hr = context->Map(pendingCaptures.front().texture.get(), 0, D3D11_MAP_READ,
+                                                    D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedSubresource);
+
+                    if (hr == DXGI_ERROR_WAS_STILL_DRAWING) break;
+
+                    PendingCapture capture = std::move(pendingCaptures.front());
+                    pendingCaptures.pop_front();
+
+                    if (FAILED(hr))
+                    {
+                        engine->log(Log::Level::Error) << "Failed to capture frame: failed to map Direct3D 11 resource (" << hr << ")";
+                        continue;
+                    }
+
+                    D3D11_TEXTURE2D_DESC textureDesc;
+                    capture.texture->GetDesc(&textureDesc);
 
-                context->Unmap(texture.get(), 0);
+                    FrameCapture::Frame frame;
+                    frame.filenames = std::move(capture.filenames);
+                    frame.width = textureDesc.Width;
+                    frame.height = textureDesc.Height;
+                    frame.pitch = mappedSubresource.RowPitch;
+                    frame.data.resize(static_cast<std::size_t>(mappedSubresource.RowPitch) * textureDesc.Height);
+                    std::memcpy(frame.data.data(), mappedSubresource.pData, frame.data.size());
+
+                    context->Unmap(capture.texture.get(), 0);
+
+                    freeCaptureTextures.push_back(std::move(capture.texture));
+
+                    frameCapture.encode(std::move(frame));
+                }
             }
 
             void RenderDevice::resizeBackBuffer(UINT newWidth, UINT newHeight)
@@ -1163,6 +1285,112 @@ namespace ouzel
                 }
             }
 
+            Pointer<ID3D11Query> RenderDevice::createQuery(D3D11_QUERY type)
+            {
+                auto& freeQueries = (type == D3D11_QUERY_TIMESTAMP_DISJOINT) ? freeDisjointQueries : freeTimestampQueries;
+
+                if (!freeQueries.empty())
+                {
+                    Pointer<ID3D11Query> query = std::move(freeQueries.back());
+                    freeQueries.pop_back();
+                    return query;
+                }
+
+                D3D11_QUERY_DESC queryDesc;
+                queryDesc.Query = type;
+                queryDesc.MiscFlags = 0;
+
+                ID3D11Query* query;
+
+                HRESULT hr;
+                if (FAILED(hr = device->CreateQuery(&queryDesc, &query)))
+                    throw std::system_error(hr, errorCategory, "Failed to create Direct3D 11 query");
+
+                return query;
+            }
+
+            void RenderDevice::beginTimerQuery(const std::string& name)
+            {
+                // the frame is not timed if the results of too many frames are still pending
+                if (pendingTimerQueries.size() >= maxTimerQueryFrames) return;
+
+                if (!timerQueryFrame.disjointQuery)
+                {
+                    timerQueryFrame.disjointQuery = createQuery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+                    context->Begin(timerQueryFrame.disjointQuery.get());
+                }
+
+                TimerQuery timerQuery;
+                timerQuery.name = name;
+                timerQuery.depth = static_cast<std::uint32_t>(openTimerQueries.size());
+                timerQuery.startQuery = createQuery(D3D11_QUERY_TIMESTAMP);
+                context->End(timerQuery.startQuery.get());
+
+                openTimerQueries.push_back(timerQueryFrame.timerQueries.size());
+                timerQueryFrame.timerQueries.push_back(std::move(timerQuery));
+            }
+
+            void RenderDevice::endTimerQuery()
+            {
+                if (openTimerQueries.empty()) return;
+
+                TimerQuery& timerQuery = timerQueryFrame.timerQueries[openTimerQueries.back()];
+                openTimerQueries.pop_back();
+
+                timerQuery.endQuery = createQuery(D3D11_QUERY_TIMESTAMP);
+                context->End(timerQuery.endQuery.get());
+            }
+
+            void RenderDevice::endTimerQueryFrame()
+            {
+                // regions that were not closed end with the frame
+                while (!openTimerQueries.empty())
+                    endTimerQuery();
+
+                if (timerQueryFrame.disjointQuery)
+                {
+                    context->End(timerQueryFrame.disjointQuery.get());
+                    pendingTimerQueries.push_back(std::move(timerQueryFrame));
+                    timerQueryFrame = TimerQueryFrame();
+                }
+
+                while (!pendingTimerQueries.empty())
+                {
+                    TimerQueryFrame& frame = pendingTimerQueries.front();
+
+                    // the disjoint query ends after the last timestamp, so all of them are available with it
+                    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+                    if (context->GetData(frame.disjointQuery.get(), &disjointData, sizeof(disjointData),
+                                         D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+                        break;
+
+                    std::vector<PassTiming> newPassTimings;
+                    newPassTimings.reserve(frame.timerQueries.size());
+
+                    for (TimerQuery& timerQuery : frame.timerQueries)
+                    {
+                        UINT64 startTime = 0;
+                        UINT64 endTime = 0;
+                        context->GetData(timerQuery.startQuery.get(), &startTime, sizeof(startTime), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+                        context->GetData(timerQuery.endQuery.get(), &endTime, sizeof(endTime), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+
+                        freeTimestampQueries.push_back(std::move(timerQuery.startQuery));
+                        freeTimestampQueries.push_back(std::move(timerQuery.endQuery));
+
+                        const std::uint64_t duration = (endTime > startTime && disjointData.Frequency) ?
+                            static_cast<std::uint64_t>(static_cast<double>(endTime - startTime) * 1000000000.0 / static_cast<double>(disjointData.Frequency)) : 0;
+
+                        newPassTimings.push_back(PassTiming{timerQuery.name, timerQuery.depth, duration});
+                    }
+
+                    freeDisjointQueries.push_back(std::move(frame.disjointQuery));
+                    pendingTimerQueries.pop_front();
+
+                    // the timestamps are not valid if the GPU changed its frequency
+                    if (!disjointData.Disjoint) setPassTimings(std::move(newPassTimings));
+                }
+            }
+
             void RenderDevice::renderMain()
             {
                 Thread::setCurrentThreadName("Render");
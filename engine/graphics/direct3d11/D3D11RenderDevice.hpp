@@ -8,8 +8,10 @@
 #if OUZEL_COMPILE_DIRECT3D11
 
 #include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
+#include <string>
 #include <system_error>
 #include <thread>
 #include <vector>
@@ -75,9 +77,19 @@ namespace ouzel
                 void process() final;
                 void resizeBackBuffer(UINT newWidth, UINT newHeight);
                 void uploadBuffer(ID3D11Buffer* buffer, const void* data, std::uint32_t dataSize);
-                void generateScreenshot(const std::string& filename) final;
+                // copies the frames selected by the frame capture to staging textures and passes the
+                // copies that the GPU has finished to it, errors are logged and drop the capture
+                void captureFrame();
+                void copyBackBuffer(std::vector<std::string> filenames);
+                void readCapturedFrames();
                 void renderMain();
 
+                Pointer<ID3D11Query> createQuery(D3D11_QUERY type);
+                void beginTimerQuery(const std::string& name);
+                void endTimerQuery();
+                // reads the results of the previous frames that are available
+                void endTimerQueryFrame();
+
                 IDXGIOutput* getOutput() const;
 
                 Pointer<ID3D11Device> device;
@@ -101,6 +113,40 @@ namespace ouzel
                 Thread renderThread;
 
                 std::vector<std::unique_ptr<RenderResource>> resources;
+
+                // timestamps of the debug marker regions, which are read when the GPU has written
+                // them, so that the render thread never waits for the results
+                struct TimerQuery final
+                {
+                    std::string name;
+                    std::uint32_t depth;
+                    Pointer<ID3D11Query> startQuery;
+                    Pointer<ID3D11Query> endQuery;
+                };
+
+                struct TimerQueryFrame final
+                {
+                    Pointer<ID3D11Query> disjointQuery; // the frequency of the timestamps
+                    std::vector<TimerQuery> timerQueries;
+                };
+
+                static constexpr std::size_t maxTimerQueryFrames = 4;
+
+                std::vector<Pointer<ID3D11Query>> freeTimestampQueries;
+                std::vector<Pointer<ID3D11Query>> freeDisjointQueries;
+                TimerQueryFrame timerQueryFrame; // regions of the current frame
+                std::vector<std::size_t> openTimerQueries; // regions whose markers have not been popped
+                std::deque<TimerQueryFrame> pendingTimerQueries;
+
+                struct PendingCapture final
+                {
+                    std::vector<std::string> filenames;
+                    Pointer<ID3D11Texture2D> texture; // staging copy of the back buffer
+                };
+
+                Pointer<ID3D11Texture2D> captureResolveTexture; // used when the back buffer is multisampled
+                std::vector<Pointer<ID3D11Texture2D>> freeCaptureTextures;
+                std::deque<PendingCapture> pendingCaptures;
             };
         } // namespace d3d11
     } // namespace graphics
@@ -4,6 +4,7 @@
 
 #if OUZEL_COMPILE_DIRECT3D11
 
+#include <cstddef>
 #include <stdexcept>
 #include "D3D11Shader.hpp"
 #include "D3D11RenderDevice.hpp"
@@ -178,6 +179,25 @@ namespace ouzel
                     offset += getDataTypeSize(vertexAttribute.dataType);
                 }
 
+                // per-instance data comes from the second vertex buffer, elements that the shader does not read are ignored
+                if (renderDevice.isInstancingSupported())
+                {
+                    for (UINT column = 0; column < 4; ++column)
+                        vertexInputElements.push_back({
+                            "INSTANCETRANSFORM", column,
+                            DXGI_FORMAT_R32G32B32A32_FLOAT,
+                            1, static_cast<UINT>(offsetof(Instance, transform) + column * 4 * sizeof(float)),
+                            D3D11_INPUT_PER_INSTANCE_DATA, 1
+                        });
+
+                    vertexInputElements.push_back({
+                        "INSTANCECOLOR", 0,
+                        DXGI_FORMAT_R8G8B8A8_UNORM,
+                        1, static_cast<UINT>(offsetof(Instance, color)),
+                        D3D11_INPUT_PER_INSTANCE_DATA, 1
+                    });
+                }
+
 				ID3D11InputLayout* newInputLayout;
 
                 if (FAILED(hr = renderDevice.getDevice()->CreateInputLayout(vertexInputElements.data(),
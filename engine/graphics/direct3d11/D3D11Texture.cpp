@@ -50,6 +50,16 @@ namespace ouzel
                         case PixelFormat::RGBA32UInt: return DXGI_FORMAT_R32G32B32A32_UINT;
                         case PixelFormat::RGBA32SInt: return DXGI_FORMAT_R32G32B32A32_SINT;
                         case PixelFormat::RGBA32Float: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+                        case PixelFormat::BC1RGBAUNorm: return DXGI_FORMAT_BC1_UNORM;
+                        case PixelFormat::BC1RGBAUNormSRGB: return DXGI_FORMAT_BC1_UNORM_SRGB;
+                        case PixelFormat::BC2RGBAUNorm: return DXGI_FORMAT_BC2_UNORM;
+                        case PixelFormat::BC2RGBAUNormSRGB: return DXGI_FORMAT_BC2_UNORM_SRGB;
+                        case PixelFormat::BC3RGBAUNorm: return DXGI_FORMAT_BC3_UNORM;
+                        case PixelFormat::BC3RGBAUNormSRGB: return DXGI_FORMAT_BC3_UNORM_SRGB;
+                        case PixelFormat::BC4RUNorm: return DXGI_FORMAT_BC4_UNORM;
+                        case PixelFormat::BC5RGUNorm: return DXGI_FORMAT_BC5_UNORM;
+                        case PixelFormat::BC7RGBAUNorm: return DXGI_FORMAT_BC7_UNORM;
+                        case PixelFormat::BC7RGBAUNormSRGB: return DXGI_FORMAT_BC7_UNORM_SRGB;
                         case PixelFormat::Depth: return DXGI_FORMAT_D32_FLOAT;
                         case PixelFormat::DepthStencil: return DXGI_FORMAT_D24_UNORM_S8_UINT;
                         default: return DXGI_FORMAT_UNKNOWN;
@@ -105,7 +115,7 @@ namespace ouzel
                 mipmaps(static_cast<std::uint32_t>(levels.size())),
                 sampleCount(initSampleCount),
                 pixelFormat(d3d11::getPixelFormat(initPixelFormat)),
-                pixelSize(getPixelSize(initPixelFormat))
+                sourcePixelFormat(initPixelFormat)
             {
                 if ((flags & Flags::BindRenderTarget) && (mipmaps == 0 || mipmaps > 1))
                     throw std::runtime_error("Invalid mip map count");
@@ -182,7 +192,7 @@ namespace ouzel
                     for (std::size_t level = 0; level < levels.size(); ++level)
                     {
                         subresourceData[level].pSysMem = levels[level].second.data();
-                        subresourceData[level].SysMemPitch = static_cast<UINT>(levels[level].first.v[0] * pixelSize);
+                        subresourceData[level].SysMemPitch = static_cast<UINT>(getRowPitch(sourcePixelFormat, levels[level].first.v[0]));
                         subresourceData[level].SysMemSlicePitch = 0;
                     }
 
@@ -355,7 +365,9 @@ namespace ouzel
 
                         std::uint8_t* destination = static_cast<std::uint8_t*>(mappedSubresource.pData);
 
-                        if (mappedSubresource.RowPitch == levels[level].first.v[0] * pixelSize)
+                        const auto rowSize = getRowPitch(sourcePixelFormat, levels[level].first.v[0]);
+
+                        if (mappedSubresource.RowPitch == rowSize)
                         {
                             std::copy(levels[level].second.begin(),
                                       levels[level].second.end(),
@@ -364,8 +376,7 @@ namespace ouzel
                         else
                         {
                             auto source = levels[level].second.begin();
-                            auto rowSize = static_cast<std::uint32_t>(levels[level].first.v[0]) * pixelSize;
-                            auto rows = static_cast<UINT>(levels[level].first.v[1]);
+                            const auto rows = static_cast<UINT>(getRowCount(sourcePixelFormat, levels[level].first.v[1]));
 
                             for (UINT row = 0; row < rows; ++row)
                             {
@@ -373,7 +384,7 @@ namespace ouzel
                                           source + rowSize,
                                           destination);
 
-                                source += levels[level].first.v[0] * pixelSize;
+                                source += rowSize;
                                 destination += mappedSubresource.RowPitch;
                             }
                         }
@@ -94,7 +94,7 @@ namespace ouzel
                 std::uint32_t mipmaps = 0;
                 std::uint32_t sampleCount = 1;
                 DXGI_FORMAT pixelFormat = DXGI_FORMAT_UNKNOWN;
-                std::uint32_t pixelSize = 0;
+                PixelFormat sourcePixelFormat = PixelFormat::Default;
                 SamplerStateDesc samplerDescriptor;
 
                 Pointer<ID3D11Texture2D> texture;
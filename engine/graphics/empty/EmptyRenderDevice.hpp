@@ -17,6 +17,41 @@ namespace ouzel
                 explicit RenderDevice(const std::function<void(const Event&)>& initCallback):
                     graphics::RenderDevice(Driver::Empty, initCallback)
                 {
+                    // nothing is uploaded, so every compressed format can be accepted
+                    dxtTexturesSupported = true;
+                    rgtcTexturesSupported = true;
+                    bptcTexturesSupported = true;
+                    etc2TexturesSupported = true;
+                    astcTexturesSupported = true;
+                }
+
+                // nothing is rendered, so the command buffer is only scanned for the debug markers,
+                // whose regions are reported with zero duration
+                void submitCommandBuffer(CommandBuffer&& commandBuffer) final
+                {
+                    std::vector<PassTiming> newPassTimings;
+                    std::uint32_t markerDepth = 0;
+
+                    while (!commandBuffer.isEmpty())
+                    {
+                        const auto command = commandBuffer.popCommand();
+
+                        if (command->type == Command::Type::PushDebugMarker)
+                        {
+                            auto pushDebugMarkerCommand = static_cast<const PushDebugMarkerCommand*>(command.get());
+                            newPassTimings.push_back(PassTiming{pushDebugMarkerCommand->name, markerDepth++, 0});
+                        }
+                        else if (command->type == Command::Type::PopDebugMarker)
+                        {
+                            if (markerDepth) --markerDepth;
+                        }
+                        else if (command->type == Command::Type::Present)
+                        {
+                            setPassTimings(std::move(newPassTimings));
+                            newPassTimings.clear();
+                            markerDepth = 0;
+                        }
+                    }
                 }
 
             private:
@@ -0,0 +1,59 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_METALPIPELINESTATE_HPP
+#define OUZEL_GRAPHICS_METALPIPELINESTATE_HPP
+
+#include <cstdint>
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_METAL
+
+#if defined(__OBJC__)
+#  import <Metal/Metal.h>
+#else
+#  include <objc/objc.h>
+typedef NSUInteger MTLCullMode;
+typedef NSUInteger MTLTriangleFillMode;
+#endif
+
+#include "MetalRenderResource.hpp"
+#include "../RasterizerState.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace metal
+        {
+            class RenderDevice;
+
+            // The native pipeline state also depends on the formats of the render target, so the render device
+            // looks it up when the state is set. The blend state and the shader are looked up then too.
+            class PipelineState final: public RenderResource
+            {
+            public:
+                PipelineState(RenderDevice& initRenderDevice,
+                              std::uintptr_t initBlendState,
+                              std::uintptr_t initShader,
+                              CullMode initCullMode,
+                              FillMode fillMode);
+
+                inline auto getBlendState() const noexcept { return blendState; }
+                inline auto getShader() const noexcept { return shader; }
+                inline auto getCullMode() const noexcept { return cullMode; }
+                inline auto getTriangleFillMode() const noexcept { return triangleFillMode; }
+
+            private:
+                std::uintptr_t blendState = 0;
+                std::uintptr_t shader = 0;
+                MTLCullMode cullMode;
+                MTLTriangleFillMode triangleFillMode;
+            };
+        } // namespace metal
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
+
+#endif // OUZEL_GRAPHICS_METALPIPELINESTATE_HPP
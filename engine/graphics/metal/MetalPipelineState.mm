@@ -0,0 +1,57 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_METAL
+
+#include "MetalPipelineState.hpp"
+#include "MetalError.hpp"
+#include "MetalRenderDevice.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace metal
+        {
+            namespace
+            {
+                constexpr MTLCullMode getMetalCullMode(CullMode cullMode)
+                {
+                    switch (cullMode)
+                    {
+                        case CullMode::NoCull: return MTLCullModeNone;
+                        case CullMode::Front: return MTLCullModeFront;
+                        case CullMode::Back: return MTLCullModeBack;
+                        default: throw Error("Invalid cull mode");
+                    }
+                }
+
+                constexpr MTLTriangleFillMode getMetalFillMode(FillMode fillMode)
+                {
+                    switch (fillMode)
+                    {
+                        case FillMode::Solid: return MTLTriangleFillModeFill;
+                        case FillMode::Wireframe: return MTLTriangleFillModeLines;
+                        default: throw Error("Invalid fill mode");
+                    }
+                }
+            }
+
+            PipelineState::PipelineState(RenderDevice& initRenderDevice,
+                                         std::uintptr_t initBlendState,
+                                         std::uintptr_t initShader,
+                                         CullMode initCullMode,
+                                         FillMode fillMode):
+                RenderResource(initRenderDevice),
+                blendState(initBlendState),
+                shader(initShader),
+                cullMode(getMetalCullMode(initCullMode)),
+                triangleFillMode(getMetalFillMode(fillMode))
+            {
+            }
+        } // namespace metal
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
@@ -7,6 +7,7 @@
 
 #if OUZEL_COMPILE_METAL
 
+#include <deque>
 #include <map>
 #include <memory>
 #include <vector>
@@ -21,6 +22,7 @@ typedef id<MTLDevice> MTLDevicePtr;
 typedef id<MTLBuffer> MTLBufferPtr;
 typedef MTLRenderPassDescriptor* MTLRenderPassDescriptorPtr;
 typedef id<MTLSamplerState> MTLSamplerStatePtr;
+typedef id<MTLCommandBuffer> MTLCommandBufferPtr;
 typedef id<MTLCommandQueue> MTLCommandQueuePtr;
 typedef id<MTLRenderPipelineState> MTLRenderPipelineStatePtr;
 typedef id<MTLTexture> MTLTexturePtr;
@@ -91,7 +93,6 @@ namespace ouzel
                           bool newDebugRenderer) override;
 
                 void process() override;
-                void generateScreenshot(const std::string& filename) override;
 
                 class PipelineStateDesc final
                 {
@@ -111,6 +112,13 @@ namespace ouzel
                 };
 
                 MTLRenderPipelineStatePtr getPipelineState(const PipelineStateDesc& desc);
+                void readFrameTimes();
+                // copies the drawable to a buffer if the frame capture selects the frame, errors are logged
+                // and drop the capture
+                void captureFrame(MTLCommandBufferPtr commandBuffer);
+                void copyDrawable(MTLCommandBufferPtr commandBuffer, std::vector<std::string> filenames);
+                // passes the copies of the command buffers that have completed to the frame capture
+                void readCapturedFrames();
 
                 Pointer<MTLDevicePtr> device;
                 Pointer<MTLCommandQueuePtr> metalCommandQueue;
@@ -140,6 +148,21 @@ namespace ouzel
 
                 dispatch_semaphore_t inflightSemaphore;
 
+                // committed command buffers whose GPU time has not been read yet
+                std::deque<Pointer<MTLCommandBufferPtr>> pendingCommandBuffers;
+
+                struct PendingCapture final
+                {
+                    std::vector<std::string> filenames;
+                    std::uint32_t width = 0;
+                    std::uint32_t height = 0;
+                    Pointer<MTLBufferPtr> buffer;
+                    Pointer<MTLCommandBufferPtr> commandBuffer; // the copy is complete when it has completed
+                };
+
+                std::vector<Pointer<MTLBufferPtr>> freeCaptureBuffers;
+                std::deque<PendingCapture> pendingCaptures;
+
                 std::map<PipelineStateDesc, Pointer<MTLRenderPipelineStatePtr>> pipelineStates;
 
                 std::vector<std::unique_ptr<RenderResource>> resources;
@@ -12,6 +12,7 @@
 #include "MetalBuffer.hpp"
 #include "MetalDepthStencilState.hpp"
 #include "MetalError.hpp"
+#include "MetalPipelineState.hpp"
 #include "MetalRenderTarget.hpp"
 #include "MetalShader.hpp"
 #include "MetalTexture.hpp"
@@ -19,7 +20,6 @@
 #include "../../events/EventDispatcher.hpp"
 #include "../../utils/Log.hpp"
 #include "../../utils/Utils.hpp"
-#include "stb_image_write.h"
 
 namespace ouzel
 {
@@ -52,27 +52,6 @@ namespace ouzel
                     }
                 }
 
-                constexpr MTLCullMode getCullMode(CullMode cullMode)
-                {
-                    switch (cullMode)
-                    {
-                        case CullMode::NoCull: return MTLCullModeNone;
-                        case CullMode::Front: return MTLCullModeFront;
-                        case CullMode::Back: return MTLCullModeBack;
-                        default: throw Error("Invalid cull mode");
-                    }
-                }
-
-                constexpr MTLTriangleFillMode getFillMode(FillMode fillMode)
-                {
-                    switch (fillMode)
-                    {
-                        case FillMode::Solid: return MTLTriangleFillModeFill;
-                        case FillMode::Wireframe: return MTLTriangleFillModeLines;
-                        default: throw Error("Invalid fill mode");
-                    }
-                }
-
                 constexpr MTLSamplerAddressMode getSamplerAddressMode(SamplerAddressMode address)
                 {
                     switch (address)
@@ -137,6 +116,7 @@ namespace ouzel
                 renderTargetsSupported = true;
                 multisamplingSupported = true;
                 uintIndicesSupported = true;
+                instancingSupported = true;
 
                 inflightSemaphore = dispatch_semaphore_create(BUFFER_COUNT);
 
@@ -154,6 +134,19 @@ namespace ouzel
                     clampToBorderSupported = true;
 #endif
 
+#if TARGET_OS_TV
+                etc2TexturesSupported = true;
+                astcTexturesSupported = true;
+#elif TARGET_OS_IOS
+                etc2TexturesSupported = true;
+                // ASTC requires A8 or newer GPU
+                astcTexturesSupported = [device.get() supportsFeatureSet:MTLFeatureSet_iOS_GPUFamily2_v1];
+#else
+                dxtTexturesSupported = true;
+                rgtcTexturesSupported = true;
+                bptcTexturesSupported = true;
+#endif
+
                 metalCommandQueue = [device.get() newCommandQueue];
 
                 if (!metalCommandQueue)
@@ -317,18 +310,29 @@ namespace ouzel
                                 if (currentRenderCommandEncoder)
                                     [currentRenderCommandEncoder endEncoding];
 
+                                captureFrame(currentCommandBuffer);
+
                                 if (currentCommandBuffer)
                                 {
                                     [currentCommandBuffer presentDrawable:currentMetalDrawable];
                                     [currentCommandBuffer commit];
+
+                                    if ([currentCommandBuffer respondsToSelector:@selector(GPUStartTime)])
+                                        pendingCommandBuffers.emplace_back([currentCommandBuffer retain]);
                                 }
+
+                                readFrameTimes();
+                                readCapturedFrames();
                                 break;
                             }
 
                             case Command::Type::DeleteResource:
                             {
                                 auto deleteResourceCommand = static_cast<const DeleteResourceCommand*>(command.get());
-                                resources[deleteResourceCommand->resource - 1].reset();
+
+                                // the resource might have been released before it was initialized
+                                if (deleteResourceCommand->resource <= resources.size())
+                                    resources[deleteResourceCommand->resource - 1].reset();
                                 break;
                             }
 
@@ -528,6 +532,22 @@ namespace ouzel
                                 break;
                             }
 
+                            case Command::Type::InitPipelineState:
+                            {
+                                auto initPipelineStateCommand = static_cast<const InitPipelineStateCommand*>(command.get());
+
+                                auto pipelineState = std::make_unique<PipelineState>(*this,
+                                                                                     initPipelineStateCommand->blendState,
+                                                                                     initPipelineStateCommand->shader,
+                                                                                     initPipelineStateCommand->cullMode,
+                                                                                     initPipelineStateCommand->fillMode);
+
+                                if (initPipelineStateCommand->pipelineState > resources.size())
+                                    resources.resize(initPipelineStateCommand->pipelineState);
+                                resources[initPipelineStateCommand->pipelineState - 1] = std::move(pipelineState);
+                                break;
+                            }
+
                             case Command::Type::SetPipelineState:
                             {
                                 auto setPipelineStateCommand = static_cast<const SetPipelineStateCommand*>(command.get());
@@ -535,18 +555,21 @@ namespace ouzel
                                 if (!currentRenderCommandEncoder)
                                     throw Error("Metal render command encoder not initialized");
 
-                                auto blendState = getResource<BlendState>(setPipelineStateCommand->blendState);
-                                auto shader = getResource<Shader>(setPipelineStateCommand->shader);
+                                auto pipelineState = getResource<PipelineState>(setPipelineStateCommand->pipelineState);
+                                assert(pipelineState);
+
+                                auto blendState = getResource<BlendState>(pipelineState->getBlendState());
+                                auto shader = getResource<Shader>(pipelineState->getShader());
                                 currentShader = shader;
 
                                 currentPipelineStateDesc.blendState = blendState;
                                 currentPipelineStateDesc.shader = shader;
 
-                                MTLRenderPipelineStatePtr pipelineState = getPipelineState(currentPipelineStateDesc);
-                                if (pipelineState) [currentRenderCommandEncoder setRenderPipelineState:pipelineState];
+                                MTLRenderPipelineStatePtr renderPipelineState = getPipelineState(currentPipelineStateDesc);
+                                if (renderPipelineState) [currentRenderCommandEncoder setRenderPipelineState:renderPipelineState];
 
-                                [currentRenderCommandEncoder setCullMode:getCullMode(setPipelineStateCommand->cullMode)];
-                                [currentRenderCommandEncoder setTriangleFillMode:getFillMode(setPipelineStateCommand->fillMode)];
+                                [currentRenderCommandEncoder setCullMode:pipelineState->getCullMode()];
+                                [currentRenderCommandEncoder setTriangleFillMode:pipelineState->getTriangleFillMode()];
 
                                 break;
                             }
@@ -583,6 +606,42 @@ namespace ouzel
                                 break;
                             }
 
+                            case Command::Type::DrawInstanced:
+                            {
+                                auto drawInstancedCommand = static_cast<const DrawInstancedCommand*>(command.get());
+
+                                if (!currentRenderCommandEncoder)
+                                    throw Error("Metal render command encoder not initialized");
+
+                                auto indexBuffer = getResource<Buffer>(drawInstancedCommand->indexBuffer);
+                                auto vertexBuffer = getResource<Buffer>(drawInstancedCommand->vertexBuffer);
+                                auto instanceBuffer = getResource<Buffer>(drawInstancedCommand->instanceBuffer);
+
+                                assert(indexBuffer);
+                                assert(indexBuffer->getBuffer());
+                                assert(vertexBuffer);
+                                assert(vertexBuffer->getBuffer());
+                                assert(instanceBuffer);
+                                assert(instanceBuffer->getBuffer());
+
+                                // buffer 1 holds the shader constants
+                                [currentRenderCommandEncoder setVertexBuffer:vertexBuffer->getBuffer().get() offset:0 atIndex:0];
+                                [currentRenderCommandEncoder setVertexBuffer:instanceBuffer->getBuffer().get() offset:0 atIndex:2];
+
+                                assert(drawInstancedCommand->indexCount);
+                                assert(drawInstancedCommand->instanceCount);
+                                assert(instanceBuffer->getSize() >= drawInstancedCommand->instanceCount * sizeof(Instance));
+
+                                [currentRenderCommandEncoder drawIndexedPrimitives:getPrimitiveType(drawInstancedCommand->drawMode)
+                                                                        indexCount:drawInstancedCommand->indexCount
+                                                                         indexType:getIndexType(drawInstancedCommand->indexSize)
+                                                                       indexBuffer:indexBuffer->getBuffer().get()
+                                                                 indexBufferOffset:drawInstancedCommand->startIndex * drawInstancedCommand->indexSize
+                                                                     instanceCount:drawInstancedCommand->instanceCount];
+
+                                break;
+                            }
+
                             case Command::Type::PushDebugMarker:
                             {
                                 auto pushDebugMarkerCommand = static_cast<const PushDebugMarkerCommand*>(command.get());
@@ -857,35 +916,123 @@ namespace ouzel
                 }
             }
 
-            void RenderDevice::generateScreenshot(const std::string& filename)
+            void RenderDevice::captureFrame(MTLCommandBufferPtr commandBuffer)
+            {
+                // a failed capture is dropped, it must not keep the frame from being presented
+                try
+                {
+                    std::vector<std::string> filenames = frameCapture.nextFrame(pendingCaptures.size());
+                    if (!filenames.empty() && commandBuffer && currentMetalTexture)
+                        copyDrawable(commandBuffer, std::move(filenames));
+                }
+                catch (const std::exception& e)
+                {
+                    engine->log(Log::Level::Error) << "Failed to capture frame: " << e.what();
+                }
+            }
+
+            void RenderDevice::copyDrawable(MTLCommandBufferPtr commandBuffer, std::vector<std::string> filenames)
             {
-                if (!currentMetalTexture)
-                    throw Error("No back buffer");
+                const NSUInteger width = currentMetalTexture.get().width;
+                const NSUInteger height = currentMetalTexture.get().height;
 
-                const NSUInteger width = static_cast<NSUInteger>(currentMetalTexture.get().width);
-                const NSUInteger height = static_cast<NSUInteger>(currentMetalTexture.get().height);
+                // reuse the buffer of a finished read back if the size of the drawable has not changed
+                Pointer<MTLBufferPtr> buffer;
+                while (!buffer && !freeCaptureBuffers.empty())
+                {
+                    if (freeCaptureBuffers.back().get().length == width * height * 4)
+                        buffer = std::move(freeCaptureBuffers.back());
 
-                std::vector<std::uint8_t> data(width * height * 4);
-                [currentMetalTexture.get() getBytes:data.data()
-                                        bytesPerRow:width * 4
-                                         fromRegion:MTLRegionMake2D(0, 0, width, height)
-                                        mipmapLevel:0];
+                    freeCaptureBuffers.pop_back();
+                }
 
-                std::uint8_t temp;
-                for (std::uint32_t y = 0; y < height; ++y)
+                // the drawable is copied to a shared buffer by the GPU at the end of the frame
+                if (!buffer)
                 {
-                    for (std::uint32_t x = 0; x < width; ++x)
+                    buffer = [device.get() newBufferWithLength:width * height * 4
+                                                       options:MTLResourceStorageModeShared];
+
+                    if (!buffer)
+                        throw Error("Failed to create Metal buffer");
+                }
+
+                id<MTLBlitCommandEncoder> blitCommandEncoder = [commandBuffer blitCommandEncoder];
+
+                if (!blitCommandEncoder)
+                    throw Error("Failed to create Metal blit command encoder");
+
+                [blitCommandEncoder copyFromTexture:currentMetalTexture.get()
+                                        sourceSlice:0
+                                        sourceLevel:0
+                                       sourceOrigin:MTLOriginMake(0, 0, 0)
+                                         sourceSize:MTLSizeMake(width, height, 1)
+                                           toBuffer:buffer.get()
+                                  destinationOffset:0
+                             destinationBytesPerRow:width * 4
+                           destinationBytesPerImage:width * height * 4];
+                [blitCommandEncoder endEncoding];
+
+                PendingCapture capture;
+                capture.filenames = std::move(filenames);
+                capture.width = static_cast<std::uint32_t>(width);
+                capture.height = static_cast<std::uint32_t>(height);
+                capture.buffer = std::move(buffer);
+                capture.commandBuffer = [commandBuffer retain];
+                pendingCaptures.push_back(std::move(capture));
+            }
+
+            void RenderDevice::readCapturedFrames()
+            {
+                while (!pendingCaptures.empty())
+                {
+                    PendingCapture& capture = pendingCaptures.front();
+                    const MTLCommandBufferStatus status = capture.commandBuffer.get().status;
+
+                    if (status < MTLCommandBufferStatusCompleted) break;
+
+                    // the frame is lost if the command buffer failed
+                    if (status == MTLCommandBufferStatusCompleted)
                     {
-                        // reverse the order of channels
-                        temp = data[((y * width + x) * 4)];
-                        data[((y * width + x) * 4)] = data[((y * width + x) * 4) + 2];
-                        data[((y * width + x) * 4) + 2] = temp;
-                        data[((y * width + x) * 4) + 3] = 255;
+                        FrameCapture::Frame frame;
+                        frame.filenames = std::move(capture.filenames);
+                        frame.width = capture.width;
+                        frame.height = capture.height;
+                        frame.pitch = capture.width * 4;
+                        frame.bgra = true;
+                        frame.opaque = true;
+
+                        const auto contents = static_cast<const std::uint8_t*>(capture.buffer.get().contents);
+                        frame.data.assign(contents, contents + frame.pitch * frame.height);
+
+                        frameCapture.encode(std::move(frame));
                     }
+                    else
+                        engine->log(Log::Level::Error) << "Failed to capture frame: the command buffer failed";
+
+                    freeCaptureBuffers.push_back(std::move(capture.buffer));
+                    pendingCaptures.pop_front();
                 }
+            }
 
-                if (!stbi_write_png(filename.c_str(), static_cast<int>(width), static_cast<int>(height), 4, data.data(), static_cast<int>(width * 4)))
-                    throw Error("Failed to save image to file");
+            void RenderDevice::readFrameTimes()
+            {
+                // Metal can not sample timestamps between the draws on Apple GPUs, so the whole frame is
+                // timed with the GPU time of its command buffer instead of the debug marker regions
+                while (!pendingCommandBuffers.empty())
+                {
+                    MTLCommandBufferPtr commandBuffer = pendingCommandBuffers.front().get();
+                    const MTLCommandBufferStatus status = commandBuffer.status;
+
+                    if (status < MTLCommandBufferStatusCompleted) break;
+
+                    if (status == MTLCommandBufferStatusCompleted)
+                    {
+                        const CFTimeInterval duration = commandBuffer.GPUEndTime - commandBuffer.GPUStartTime;
+                        setPassTimings({PassTiming{"frame", 0, static_cast<std::uint64_t>(duration > 0.0 ? duration * 1000000000.0 : 0.0)}});
+                    }
+
+                    pendingCommandBuffers.pop_front();
+                }
             }
 
             MTLRenderPipelineStatePtr RenderDevice::getPipelineState(const PipelineStateDesc& desc)
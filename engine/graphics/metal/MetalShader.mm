@@ -6,6 +6,7 @@
 
 #include <TargetConditionals.h>
 #include <algorithm>
+#include <cstddef>
 #include "MetalShader.hpp"
 #include "MetalError.hpp"
 #include "MetalRenderDevice.hpp"
@@ -126,6 +127,23 @@ namespace ouzel
                 vertexDescriptor.get().layouts[0].stepRate = 1;
                 vertexDescriptor.get().layouts[0].stepFunction = MTLVertexStepFunctionPerVertex;
 
+                // per-instance data follows the vertex attributes and comes from buffer 2 (buffer 1 holds the constants)
+                for (NSUInteger column = 0; column < 4; ++column)
+                {
+                    vertexDescriptor.get().attributes[index].format = MTLVertexFormatFloat4;
+                    vertexDescriptor.get().attributes[index].offset = offsetof(Instance, transform) + column * 4 * sizeof(float);
+                    vertexDescriptor.get().attributes[index].bufferIndex = 2;
+                    ++index;
+                }
+
+                vertexDescriptor.get().attributes[index].format = MTLVertexFormatUChar4Normalized;
+                vertexDescriptor.get().attributes[index].offset = offsetof(Instance, color);
+                vertexDescriptor.get().attributes[index].bufferIndex = 2;
+
+                vertexDescriptor.get().layouts[2].stride = sizeof(Instance);
+                vertexDescriptor.get().layouts[2].stepRate = 1;
+                vertexDescriptor.get().layouts[2].stepFunction = MTLVertexStepFunctionPerInstance;
+
                 NSError* err;
 
                 dispatch_data_t fragmentShaderDispatchData = dispatch_data_create(fragmentShaderData.data(), fragmentShaderData.size(), nullptr, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
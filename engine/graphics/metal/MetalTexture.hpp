@@ -104,7 +104,7 @@ namespace ouzel
                 Pointer<MTLTexturePtr> msaaTexture;
 
                 MTLPixelFormat pixelFormat;
-                std::uint32_t pixelSize = 0;
+                PixelFormat sourcePixelFormat = PixelFormat::Default;
                 bool stencilBuffer = false;
             };
         } // namespace metal
@@ -51,6 +51,27 @@ namespace ouzel
                         case PixelFormat::RGBA32UInt: return MTLPixelFormatRGBA32Uint;
                         case PixelFormat::RGBA32SInt: return MTLPixelFormatRGBA32Sint;
                         case PixelFormat::RGBA32Float: return MTLPixelFormatRGBA32Float;
+#if TARGET_OS_IOS || TARGET_OS_TV
+                        case PixelFormat::ETC2RGB8UNorm: return MTLPixelFormatETC2_RGB8;
+                        case PixelFormat::ETC2RGB8UNormSRGB: return MTLPixelFormatETC2_RGB8_sRGB;
+                        case PixelFormat::ETC2RGBA8UNorm: return MTLPixelFormatEAC_RGBA8;
+                        case PixelFormat::ETC2RGBA8UNormSRGB: return MTLPixelFormatEAC_RGBA8_sRGB;
+                        case PixelFormat::ASTC4x4UNorm: return MTLPixelFormatASTC_4x4_LDR;
+                        case PixelFormat::ASTC4x4UNormSRGB: return MTLPixelFormatASTC_4x4_sRGB;
+                        case PixelFormat::ASTC8x8UNorm: return MTLPixelFormatASTC_8x8_LDR;
+                        case PixelFormat::ASTC8x8UNormSRGB: return MTLPixelFormatASTC_8x8_sRGB;
+#else
+                        case PixelFormat::BC1RGBAUNorm: return MTLPixelFormatBC1_RGBA;
+                        case PixelFormat::BC1RGBAUNormSRGB: return MTLPixelFormatBC1_RGBA_sRGB;
+                        case PixelFormat::BC2RGBAUNorm: return MTLPixelFormatBC2_RGBA;
+                        case PixelFormat::BC2RGBAUNormSRGB: return MTLPixelFormatBC2_RGBA_sRGB;
+                        case PixelFormat::BC3RGBAUNorm: return MTLPixelFormatBC3_RGBA;
+                        case PixelFormat::BC3RGBAUNormSRGB: return MTLPixelFormatBC3_RGBA_sRGB;
+                        case PixelFormat::BC4RUNorm: return MTLPixelFormatBC4_RUnorm;
+                        case PixelFormat::BC5RGUNorm: return MTLPixelFormatBC5_RGUnorm;
+                        case PixelFormat::BC7RGBAUNorm: return MTLPixelFormatBC7_RGBAUnorm;
+                        case PixelFormat::BC7RGBAUNormSRGB: return MTLPixelFormatBC7_RGBAUnorm_sRGB;
+#endif
                         case PixelFormat::Depth: return MTLPixelFormatDepth32Float;
                         case PixelFormat::DepthStencil: return MTLPixelFormatDepth32Float_Stencil8; // MTLPixelFormatDepth24Unorm_Stencil8 is only available on macOS
                         default: return MTLPixelFormatInvalid;
@@ -106,7 +127,7 @@ namespace ouzel
                 mipmaps(static_cast<std::uint32_t>(levels.size())),
                 sampleCount(initSampleCount),
                 pixelFormat(getMetalPixelFormat(initPixelFormat)),
-                pixelSize(getPixelSize(initPixelFormat)),
+                sourcePixelFormat(initPixelFormat),
                 stencilBuffer(initPixelFormat == PixelFormat::DepthStencil)
             {
                 if ((flags & Flags::BindRenderTarget) && (mipmaps == 0 || mipmaps > 1))
@@ -182,7 +203,7 @@ namespace ouzel
                                                                          static_cast<NSUInteger>(levels[level].first.v[1]))
                                              mipmapLevel:level
                                                withBytes:levels[level].second.data()
-                                             bytesPerRow:static_cast<NSUInteger>(levels[level].first.v[0] * pixelSize)];
+                                             bytesPerRow:static_cast<NSUInteger>(getRowPitch(sourcePixelFormat, levels[level].first.v[0]))];
                     }
                 }
 
@@ -209,7 +230,7 @@ namespace ouzel
                                                                      static_cast<NSUInteger>(levels[level].first.v[1]))
                                          mipmapLevel:level
                                            withBytes:levels[level].second.data()
-                                         bytesPerRow:static_cast<NSUInteger>(levels[level].first.v[0] * pixelSize)];
+                                         bytesPerRow:static_cast<NSUInteger>(getRowPitch(sourcePixelFormat, levels[level].first.v[0]))];
                 }
             }
 
@@ -87,6 +87,25 @@ namespace ouzel
                 if (!bufferId)
                     throw std::runtime_error("Buffer not initialized");
 
+                // writing to the stream buffer does not wait for the draws that use the previous data
+                streamed = streamBuffer &&
+                    streamBuffer->write(data.data(), static_cast<GLsizeiptr>(data.size()), allocation);
+
+                if (!streamed) uploadData();
+            }
+
+            void Buffer::makeResident()
+            {
+                if (!isResident())
+                {
+                    streamed = streamBuffer->write(data.data(), static_cast<GLsizeiptr>(data.size()), allocation);
+
+                    if (!streamed) uploadData();
+                }
+            }
+
+            void Buffer::uploadData()
+            {
                 renderDevice.bindBuffer(bufferType, bufferId);
 
                 if (static_cast<GLsizeiptr>(data.size()) > size)
@@ -131,6 +150,9 @@ namespace ouzel
                     default:
                         throw std::runtime_error("Unsupported buffer type");
                 }
+
+                if (flags & Flags::Dynamic)
+                    streamBuffer = renderDevice.getStreamBuffer(bufferType);
             }
         } // namespace opengl
     } // namespace graphics
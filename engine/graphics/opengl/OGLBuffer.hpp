@@ -20,6 +20,7 @@
 #endif
 
 #include "OGLRenderResource.hpp"
+#include "OGLStreamBuffer.hpp"
 #include "../BufferType.hpp"
 
 namespace ouzel
@@ -44,15 +45,28 @@ namespace ouzel
 
                 void setData(const std::vector<std::uint8_t>& newData);
 
+                // writes the data to the stream buffer again if it was overwritten, must be called before drawing
+                void makeResident();
+                inline auto isResident() const noexcept { return !streamed || streamBuffer->isValid(allocation); }
+
                 inline auto getFlags() const noexcept { return flags; }
                 inline auto getType() const noexcept { return type; }
-                inline auto getSize() const noexcept { return size; }
-
-                inline auto getBufferId() const noexcept { return bufferId; }
+                inline auto getSize() const noexcept { return streamed ? static_cast<GLsizeiptr>(data.size()) : size; }
+
+                // the data is at the offset in the stream buffer when it was streamed
+                inline auto getBufferId() const noexcept
+                {
+                    return streamed ? streamBuffer->getBufferId() : bufferId;
+                }
+                inline auto getOffset() const noexcept
+                {
+                    return streamed ? streamBuffer->getOffset(allocation) : GLintptr{0};
+                }
                 inline auto getBufferType() const noexcept { return bufferType; }
 
             private:
                 void createBuffer();
+                void uploadData();
 
                 BufferType type;
                 std::uint32_t flags = 0;
@@ -62,6 +76,10 @@ namespace ouzel
                 GLsizeiptr size = 0;
 
                 GLuint bufferType = 0;
+
+                StreamBuffer* streamBuffer = nullptr;
+                bool streamed = false;
+                StreamBuffer::Allocation allocation;
             };
         } // namespace opengl
     } // namespace graphics
@@ -0,0 +1,66 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_OPENGL
+
+#include <stdexcept>
+#include "OGLPipelineState.hpp"
+#include "OGLRenderDevice.hpp"
+#include "../../core/Engine.hpp"
+#include "../../utils/Log.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace opengl
+        {
+            namespace
+            {
+                constexpr GLenum getOpenGlCullFace(CullMode cullMode)
+                {
+                    switch (cullMode)
+                    {
+                        case CullMode::NoCull: return GL_NONE;
+                        case CullMode::Front: return GL_FRONT;
+                        case CullMode::Back: return GL_BACK;
+                        default: throw std::runtime_error("Invalid cull mode");
+                    }
+                }
+
+#if !OUZEL_OPENGLES
+                constexpr GLenum getOpenGlFillMode(FillMode fillMode)
+                {
+                    switch (fillMode)
+                    {
+                        case FillMode::Solid: return GL_FILL;
+                        case FillMode::Wireframe: return GL_LINE;
+                        default: throw std::runtime_error("Invalid fill mode");
+                    }
+                }
+#endif
+            }
+
+            PipelineState::PipelineState(RenderDevice& initRenderDevice,
+                                         std::uintptr_t initBlendState,
+                                         std::uintptr_t initShader,
+                                         CullMode cullMode,
+                                         FillMode fillMode):
+                RenderResource(initRenderDevice),
+                blendState(initBlendState),
+                shader(initShader),
+                cullFace(getOpenGlCullFace(cullMode))
+            {
+#if OUZEL_OPENGLES
+                if (fillMode != FillMode::Solid)
+                    engine->log(Log::Level::Warning) << "Unsupported fill mode";
+#else
+                polygonFillMode = getOpenGlFillMode(fillMode);
+#endif
+            }
+        } // namespace opengl
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_OGLPIPELINESTATE_HPP
+#define OUZEL_GRAPHICS_OGLPIPELINESTATE_HPP
+
+#include <cstdint>
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_OPENGL
+
+#include "OGL.h"
+
+#if OUZEL_OPENGLES
+#  include "GLES/gl.h"
+#  include "GLES2/gl2.h"
+#  include "GLES2/gl2ext.h"
+#  include "GLES3/gl3.h"
+#else
+#  include "GL/glcorearb.h"
+#  include "GL/glext.h"
+#endif
+
+#include "OGLRenderResource.hpp"
+#include "../RasterizerState.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace opengl
+        {
+            class RenderDevice;
+
+            // The GL values of a state combination. The blend state and the shader are looked up
+            // when the state is set, so the pipeline state can be created before them.
+            class PipelineState final: public RenderResource
+            {
+            public:
+                PipelineState(RenderDevice& initRenderDevice,
+                              std::uintptr_t initBlendState,
+                              std::uintptr_t initShader,
+                              CullMode cullMode,
+                              FillMode fillMode);
+
+                void reload() final {}
+
+                inline auto getBlendState() const noexcept { return blendState; }
+                inline auto getShader() const noexcept { return shader; }
+                inline auto getCullFace() const noexcept { return cullFace; }
+#if !OUZEL_OPENGLES
+                inline auto getPolygonFillMode() const noexcept { return polygonFillMode; }
+#endif
+
+            private:
+                std::uintptr_t blendState = 0;
+                std::uintptr_t shader = 0;
+                GLenum cullFace = GL_NONE;
+#if !OUZEL_OPENGLES
+                GLenum polygonFillMode = GL_FILL;
+#endif
+            };
+        } // namespace opengl
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
+
+#endif // OUZEL_GRAPHICS_OGLPIPELINESTATE_HPP
@@ -10,6 +10,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
 #include <stdexcept>
 
 #include "OGL.h"
@@ -37,6 +39,7 @@
 #include "OGLBlendState.hpp"
 #include "OGLBuffer.hpp"
 #include "OGLDepthStencilState.hpp"
+#include "OGLPipelineState.hpp"
 #include "OGLProcedureGetter.hpp"
 #include "OGLRenderTarget.hpp"
 #include "OGLShader.hpp"
@@ -45,7 +48,6 @@
 #include "../../core/Window.hpp"
 #include "../../utils/Log.hpp"
 #include "../../utils/Utils.hpp"
-#include "stb_image_write.h"
 
 namespace ouzel
 {
@@ -55,6 +57,9 @@ namespace ouzel
         {
             namespace
             {
+                // bytes of texture data that are uploaded from the upload queue in a frame
+                constexpr std::size_t textureUploadBudget = 4 * 1024 * 1024;
+
                 class ErrorCategory final: public std::error_category
                 {
                 public:
@@ -269,29 +274,6 @@ namespace ouzel
                         default: throw std::runtime_error("Invalid draw mode");
                     }
                 }
-
-                constexpr GLenum getCullFace(CullMode cullMode)
-                {
-                    switch (cullMode)
-                    {
-                        case CullMode::NoCull: return GL_NONE;
-                        case CullMode::Front: return GL_FRONT;
-                        case CullMode::Back: return GL_BACK;
-                        default: throw std::runtime_error("Invalid cull mode");
-                    }
-                }
-
-#if !OUZEL_OPENGLES
-                constexpr GLenum getFillMode(FillMode fillMode)
-                {
-                    switch (fillMode)
-                    {
-                        case FillMode::Solid: return GL_FILL;
-                        case FillMode::Wireframe: return GL_LINE;
-                        default: throw std::runtime_error("Invalid fill mode");
-                    }
-                }
-#endif
             }
 
             std::error_code makeErrorCode(GLenum e)
@@ -302,7 +284,9 @@ namespace ouzel
             RenderDevice::RenderDevice(const std::function<void(const Event&)>& initCallback):
                 graphics::RenderDevice(Driver::OpenGL, initCallback),
                 textureBaseLevelSupported(false),
-                textureMaxLevelSupported(false)
+                textureMaxLevelSupported(false),
+                pixelBuffersSupported(false),
+                timerQueriesSupported(false)
             {
                 projectionTransform = Matrix4F(1.0F, 0.0F, 0.0F, 0.0F,
                                                0.0F, 1.0F, 0.0F, 0.0F,
@@ -319,7 +303,35 @@ namespace ouzel
             {
                 if (vertexArrayId) glDeleteVertexArraysProc(1, &vertexArrayId);
 
+                for (const TimerQueryFrame& frame : pendingTimerQueries)
+                    for (const TimerQuery& timerQuery : frame.timerQueries)
+                    {
+                        freeQueries.push_back(timerQuery.startQuery);
+                        freeQueries.push_back(timerQuery.endQuery);
+                    }
+
+                for (const TimerQuery& timerQuery : timerQueries)
+                {
+                    freeQueries.push_back(timerQuery.startQuery);
+                    if (timerQuery.endQuery) freeQueries.push_back(timerQuery.endQuery);
+                }
+
+                if (!freeQueries.empty())
+                    glDeleteQueriesProc(static_cast<GLsizei>(freeQueries.size()), freeQueries.data());
+
+                for (const PendingCapture& capture : pendingCaptures)
+                {
+                    glDeleteSyncProc(capture.sync);
+                    freeCaptureBuffers.push_back(capture.pixelBuffer);
+                }
+
+                if (!freeCaptureBuffers.empty())
+                    glDeleteBuffersProc(static_cast<GLsizei>(freeCaptureBuffers.size()), freeCaptureBuffers.data());
+
                 resources.clear();
+                vertexStreamBuffer.reset();
+                indexStreamBuffer.reset();
+                pixelStreamBuffer.reset();
             }
 
             void RenderDevice::init(Window* newWindow,
@@ -373,8 +385,14 @@ namespace ouzel
                     getter.hasExtension("GL_IMG_multisampled_render_to_texture");
                 textureBaseLevelSupported = apiVersion >= ApiVersion(3, 0);
                 textureMaxLevelSupported = apiVersion >= ApiVersion(3, 0) || getter.hasExtension("GL_APPLE_texture_max_level");
+                pixelBuffersSupported = apiVersion >= ApiVersion(3, 0);
                 uintIndicesSupported = apiVersion >= ApiVersion(3, 0) || getter.hasExtension("OES_element_index_uint");
                 anisotropicFilteringSupported = getter.hasExtension("GL_EXT_texture_filter_anisotropic");
+                dxtTexturesSupported = getter.hasExtension("GL_EXT_texture_compression_s3tc");
+                rgtcTexturesSupported = getter.hasExtension("GL_EXT_texture_compression_rgtc");
+                bptcTexturesSupported = getter.hasExtension("GL_EXT_texture_compression_bptc");
+                etc2TexturesSupported = apiVersion >= ApiVersion(3, 0);
+                astcTexturesSupported = getter.hasExtension("GL_KHR_texture_compression_astc_ldr");
 
                 glEnableProc = getter.get<PFNGLENABLEPROC>("glEnable", ApiVersion(1, 0));
                 glDisableProc = getter.get<PFNGLDISABLEPROC>("glDisable", ApiVersion(1, 0));
@@ -388,6 +406,8 @@ namespace ouzel
                 glTexParameterfvProc = getter.get<PFNGLTEXPARAMETERFVPROC>("glTexParameterfv", ApiVersion(1, 0));
                 glTexImage2DProc = getter.get<PFNGLTEXIMAGE2DPROC>("glTexImage2D", ApiVersion(1, 0));
                 glTexSubImage2DProc = getter.get<PFNGLTEXSUBIMAGE2DPROC>("glTexSubImage2D", ApiVersion(1, 0));
+                glCompressedTexImage2DProc = getter.get<PFNGLCOMPRESSEDTEXIMAGE2DPROC>("glCompressedTexImage2D", ApiVersion(1, 0));
+                glCompressedTexSubImage2DProc = getter.get<PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC>("glCompressedTexSubImage2D", ApiVersion(1, 0));
                 glViewportProc = getter.get<PFNGLVIEWPORTPROC>("glViewport", ApiVersion(1, 0));
                 glClearProc = getter.get<PFNGLCLEARPROC>("glClear", ApiVersion(1, 0));
                 glClearColorProc = getter.get<PFNGLCLEARCOLORPROC>("glClearColor", ApiVersion(1, 0));
@@ -476,6 +496,20 @@ namespace ouzel
                 glUnmapBufferProc = getter.get<PFNGLUNMAPBUFFERPROC>("glUnmapBuffer", ApiVersion(3, 0),
                                                                      {{"glUnmapBufferOES", "GL_OES_mapbuffer"}});
 
+                glFenceSyncProc = getter.get<PFNGLFENCESYNCPROC>("glFenceSync", ApiVersion(3, 0),
+                                                                 {{"glFenceSyncAPPLE", "GL_APPLE_sync"}});
+                glClientWaitSyncProc = getter.get<PFNGLCLIENTWAITSYNCPROC>("glClientWaitSync", ApiVersion(3, 0),
+                                                                           {{"glClientWaitSyncAPPLE", "GL_APPLE_sync"}});
+                glDeleteSyncProc = getter.get<PFNGLDELETESYNCPROC>("glDeleteSync", ApiVersion(3, 0),
+                                                                   {{"glDeleteSyncAPPLE", "GL_APPLE_sync"}});
+                glBufferStorageProc = getter.get<PFNGLBUFFERSTORAGEEXTPROC>("glBufferStorageEXT", "GL_EXT_buffer_storage");
+
+                glGenQueriesProc = getter.get<PFNGLGENQUERIESEXTPROC>("glGenQueriesEXT", "GL_EXT_disjoint_timer_query");
+                glDeleteQueriesProc = getter.get<PFNGLDELETEQUERIESEXTPROC>("glDeleteQueriesEXT", "GL_EXT_disjoint_timer_query");
+                glQueryCounterProc = getter.get<PFNGLQUERYCOUNTEREXTPROC>("glQueryCounterEXT", "GL_EXT_disjoint_timer_query");
+                glGetQueryObjectuivProc = getter.get<PFNGLGETQUERYOBJECTUIVEXTPROC>("glGetQueryObjectuivEXT", "GL_EXT_disjoint_timer_query");
+                glGetQueryObjectui64vProc = getter.get<PFNGLGETQUERYOBJECTUI64VEXTPROC>("glGetQueryObjectui64vEXT", "GL_EXT_disjoint_timer_query");
+
                 glGenVertexArraysProc = getter.get<PFNGLGENVERTEXARRAYSPROC>("glGenVertexArrays", ApiVersion(3, 0),
                                                                              {{"glGenVertexArraysOES", "GL_OES_vertex_array_object"}});
                 glBindVertexArrayProc = getter.get<PFNGLBINDVERTEXARRAYPROC>("glBindVertexArray", ApiVersion(3, 0),
@@ -483,6 +517,13 @@ namespace ouzel
                 glDeleteVertexArraysProc = getter.get<PFNGLDELETEVERTEXARRAYSPROC>("glDeleteVertexArrays", ApiVersion(3, 0),
                                                                                    {{"glDeleteVertexArraysOES", "GL_OES_vertex_array_object"}});
 
+                glVertexAttribDivisorProc = getter.get<PFNGLVERTEXATTRIBDIVISORPROC>("glVertexAttribDivisor", ApiVersion(3, 0),
+                                                                                     {{"glVertexAttribDivisorEXT", "GL_EXT_instanced_arrays"},
+                                                                                      {"glVertexAttribDivisorANGLE", "GL_ANGLE_instanced_arrays"}});
+                glDrawElementsInstancedProc = getter.get<PFNGLDRAWELEMENTSINSTANCEDPROC>("glDrawElementsInstanced", ApiVersion(3, 0),
+                                                                                         {{"glDrawElementsInstancedEXT", "GL_EXT_instanced_arrays"},
+                                                                                          {"glDrawElementsInstancedANGLE", "GL_ANGLE_instanced_arrays"}});
+
                 glPushGroupMarkerEXTProc = getter.get<PFNGLPUSHGROUPMARKEREXTPROC>("glPushGroupMarkerEXT", "GL_EXT_debug_marker");
                 glPopGroupMarkerEXTProc = getter.get<PFNGLPOPGROUPMARKEREXTPROC>("glPopGroupMarkerEXT", "GL_EXT_debug_marker");
 
@@ -512,6 +553,7 @@ namespace ouzel
                 clampToBorderSupported = apiVersion >= ApiVersion(1, 3) || getter.hasExtension("GL_EXT_texture_mirror_clamp");
                 textureBaseLevelSupported = apiVersion >= ApiVersion(1, 3);
                 textureMaxLevelSupported = apiVersion >= ApiVersion(1, 3);
+                pixelBuffersSupported = apiVersion >= ApiVersion(2, 1) || getter.hasExtension("GL_ARB_pixel_buffer_object");
                 uintIndicesSupported = apiVersion >= ApiVersion(2, 0);
                 npotTexturesSupported = apiVersion >= ApiVersion(2, 0);
                 renderTargetsSupported = apiVersion >= ApiVersion(3, 0) ||
@@ -521,6 +563,11 @@ namespace ouzel
                 anisotropicFilteringSupported = apiVersion >= ApiVersion(4, 6) ||
                     getter.hasExtension("GL_EXT_texture_filter_anisotropic") ||
                     getter.hasExtension("GL_ARB_texture_filter_anisotropic");
+                dxtTexturesSupported = getter.hasExtension("GL_EXT_texture_compression_s3tc");
+                rgtcTexturesSupported = apiVersion >= ApiVersion(3, 0) || getter.hasExtension("GL_ARB_texture_compression_rgtc");
+                bptcTexturesSupported = apiVersion >= ApiVersion(4, 2) || getter.hasExtension("GL_ARB_texture_compression_bptc");
+                etc2TexturesSupported = apiVersion >= ApiVersion(4, 3) || getter.hasExtension("GL_ARB_ES3_compatibility");
+                astcTexturesSupported = getter.hasExtension("GL_KHR_texture_compression_astc_ldr");
 
                 glEnableProc = getter.get<PFNGLENABLEPROC>("glEnable", ApiVersion(1, 0));
                 glDisableProc = getter.get<PFNGLDISABLEPROC>("glDisable", ApiVersion(1, 0));
@@ -534,6 +581,8 @@ namespace ouzel
                 glTexParameterfvProc = getter.get<PFNGLTEXPARAMETERFVPROC>("glTexParameterfv", ApiVersion(1, 0));
                 glTexImage2DProc = getter.get<PFNGLTEXIMAGE2DPROC>("glTexImage2D", ApiVersion(1, 0));
                 glTexSubImage2DProc = getter.get<PFNGLTEXSUBIMAGE2DPROC>("glTexSubImage2D", ApiVersion(1, 1));
+                glCompressedTexImage2DProc = getter.get<PFNGLCOMPRESSEDTEXIMAGE2DPROC>("glCompressedTexImage2D", ApiVersion(1, 3));
+                glCompressedTexSubImage2DProc = getter.get<PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC>("glCompressedTexSubImage2D", ApiVersion(1, 3));
                 glViewportProc = getter.get<PFNGLVIEWPORTPROC>("glViewport", ApiVersion(1, 0));
                 glClearProc = getter.get<PFNGLCLEARPROC>("glClear", ApiVersion(1, 0));
                 glClearColorProc = getter.get<PFNGLCLEARCOLORPROC>("glClearColor", ApiVersion(1, 0));
@@ -608,6 +657,23 @@ namespace ouzel
                 glMapBufferRangeProc = getter.get<PFNGLMAPBUFFERRANGEPROC>("glMapBufferRange", ApiVersion(3, 0),
                                                                            {{"glMapBufferRange", "GL_ARB_map_buffer_range"}});
 
+                glFenceSyncProc = getter.get<PFNGLFENCESYNCPROC>("glFenceSync", ApiVersion(3, 2),
+                                                                 {{"glFenceSync", "GL_ARB_sync"}});
+                glClientWaitSyncProc = getter.get<PFNGLCLIENTWAITSYNCPROC>("glClientWaitSync", ApiVersion(3, 2),
+                                                                           {{"glClientWaitSync", "GL_ARB_sync"}});
+                glDeleteSyncProc = getter.get<PFNGLDELETESYNCPROC>("glDeleteSync", ApiVersion(3, 2),
+                                                                   {{"glDeleteSync", "GL_ARB_sync"}});
+                glBufferStorageProc = getter.get<PFNGLBUFFERSTORAGEPROC>("glBufferStorage", ApiVersion(4, 4),
+                                                                         {{"glBufferStorage", "GL_ARB_buffer_storage"}});
+
+                glGenQueriesProc = getter.get<PFNGLGENQUERIESPROC>("glGenQueries", ApiVersion(1, 5));
+                glDeleteQueriesProc = getter.get<PFNGLDELETEQUERIESPROC>("glDeleteQueries", ApiVersion(1, 5));
+                glQueryCounterProc = getter.get<PFNGLQUERYCOUNTERPROC>("glQueryCounter", ApiVersion(3, 3),
+                                                                       {{"glQueryCounter", "GL_ARB_timer_query"}});
+                glGetQueryObjectuivProc = getter.get<PFNGLGETQUERYOBJECTUIVPROC>("glGetQueryObjectuiv", ApiVersion(1, 5));
+                glGetQueryObjectui64vProc = getter.get<PFNGLGETQUERYOBJECTUI64VPROC>("glGetQueryObjectui64v", ApiVersion(3, 3),
+                                                                                     {{"glGetQueryObjectui64v", "GL_ARB_timer_query"}});
+
                 glGenVertexArraysProc = getter.get<PFNGLGENVERTEXARRAYSPROC>("glGenVertexArrays", ApiVersion(3, 0),
                                                                              {{"glGenVertexArrays", "GL_ARB_vertex_array_object"}});
                 glBindVertexArrayProc = getter.get<PFNGLBINDVERTEXARRAYPROC>("glBindVertexArray", ApiVersion(3, 0),
@@ -662,6 +728,11 @@ namespace ouzel
                 glDeleteVertexArraysProc = getter.get<PFNGLDELETEVERTEXARRAYSPROC>("glDeleteVertexArrays", ApiVersion(3, 0),
                                                                                    {{"glDeleteVertexArrays", "GL_ARB_vertex_array_object"}});
 
+                glVertexAttribDivisorProc = getter.get<PFNGLVERTEXATTRIBDIVISORPROC>("glVertexAttribDivisor", ApiVersion(3, 3),
+                                                                                     {{"glVertexAttribDivisorARB", "GL_ARB_instanced_arrays"}});
+                glDrawElementsInstancedProc = getter.get<PFNGLDRAWELEMENTSINSTANCEDPROC>("glDrawElementsInstanced", ApiVersion(3, 1),
+                                                                                         {{"glDrawElementsInstancedARB", "GL_ARB_draw_instanced"}});
+
                 glCopyImageSubDataProc = getter.get<PFNGLCOPYIMAGESUBDATAPROC>("glCopyImageSubData", ApiVersion(4, 3),
                                                                                {{"glCopyImageSubData", "GL_ARB_copy_image"}, {"glCopyImageSubDataEXT", "GL_EXT_copy_image"}});
 
@@ -669,6 +740,19 @@ namespace ouzel
                 glPopGroupMarkerEXTProc = getter.get<PFNGLPOPGROUPMARKEREXTPROC>("glPopGroupMarkerEXT", "GL_EXT_debug_marker");
 #endif
 
+                timerQueriesSupported = glGenQueriesProc && glDeleteQueriesProc && glQueryCounterProc &&
+                    glGetQueryObjectuivProc && glGetQueryObjectui64vProc;
+
+                // the instance attributes are placed after the vertex attributes
+                GLint maxVertexAttributes = 0;
+                glGetIntegervProc(GL_MAX_VERTEX_ATTRIBS, &maxVertexAttributes);
+
+                if ((error = glGetErrorProc()) != GL_NO_ERROR)
+                    throw std::system_error(makeErrorCode(error), "Failed to get maximum vertex attribute count");
+
+                instancingSupported = glVertexAttribDivisorProc && glDrawElementsInstancedProc &&
+                    static_cast<std::size_t>(maxVertexAttributes) >= RenderDevice::VERTEX_ATTRIBUTES.size() + 5;
+
                 if (!multisamplingSupported) sampleCount = 1;
 
                 glDisableProc(GL_DITHER);
@@ -702,6 +786,18 @@ namespace ouzel
                         throw std::system_error(makeErrorCode(error), "Failed to bind vertex array");
                 }
 
+                vertexStreamBuffer = std::make_unique<StreamBuffer>(*this, GL_ARRAY_BUFFER, 4 * 1024 * 1024);
+                indexStreamBuffer = std::make_unique<StreamBuffer>(*this, GL_ELEMENT_ARRAY_BUFFER, 1024 * 1024);
+
+                if (pixelBuffersSupported)
+                {
+                    // four times the upload budget of a frame
+                    pixelStreamBuffer = std::make_unique<StreamBuffer>(*this, GL_PIXEL_UNPACK_BUFFER, 4 * textureUploadBudget);
+
+                    // texture uploads outside the upload queue pass client memory
+                    bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+
                 setFrontFace(GL_CW);
             }
 
@@ -709,6 +805,140 @@ namespace ouzel
             {
             }
 
+            void RenderDevice::queueTextureUpload(Texture& texture, std::uint32_t level)
+            {
+                textureUploads.push_back(TextureUpload{&texture, level});
+            }
+
+            void RenderDevice::cancelTextureUploads(const Texture& texture)
+            {
+                textureUploads.erase(std::remove_if(textureUploads.begin(), textureUploads.end(),
+                                                    [&texture](const TextureUpload& upload) noexcept {
+                                                        return upload.texture == &texture;
+                                                    }), textureUploads.end());
+            }
+
+            GLuint RenderDevice::writeTimestamp()
+            {
+                if (freeQueries.empty())
+                {
+                    freeQueries.resize(16);
+                    glGenQueriesProc(static_cast<GLsizei>(freeQueries.size()), freeQueries.data());
+
+                    GLenum error;
+                    if ((error = glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to create queries");
+                }
+
+                const GLuint query = freeQueries.back();
+                freeQueries.pop_back();
+
+#if OUZEL_OPENGLES
+                glQueryCounterProc(query, GL_TIMESTAMP_EXT);
+#else
+                glQueryCounterProc(query, GL_TIMESTAMP);
+#endif
+                lastTimestampQuery = query;
+
+                return query;
+            }
+
+            void RenderDevice::beginTimerQuery(const std::string& name)
+            {
+                // the frame is not timed if the results of too many frames are still pending
+                if (!timerQueriesSupported || pendingTimerQueries.size() >= maxTimerQueryFrames) return;
+
+                TimerQuery timerQuery;
+                timerQuery.name = name;
+                timerQuery.depth = static_cast<std::uint32_t>(openTimerQueries.size());
+                timerQuery.startQuery = writeTimestamp();
+
+                openTimerQueries.push_back(timerQueries.size());
+                timerQueries.push_back(std::move(timerQuery));
+            }
+
+            void RenderDevice::endTimerQuery()
+            {
+                if (openTimerQueries.empty()) return;
+
+                const std::size_t index = openTimerQueries.back();
+                openTimerQueries.pop_back();
+
+                timerQueries[index].endQuery = writeTimestamp();
+            }
+
+            void RenderDevice::endTimerQueryFrame()
+            {
+                // regions that were not closed end with the frame
+                while (!openTimerQueries.empty())
+                    endTimerQuery();
+
+                if (!timerQueries.empty())
+                {
+                    pendingTimerQueries.push_back(TimerQueryFrame{std::move(timerQueries), lastTimestampQuery});
+                    timerQueries.clear();
+                }
+
+                while (!pendingTimerQueries.empty())
+                {
+                    TimerQueryFrame& frame = pendingTimerQueries.front();
+
+                    // the timestamps are written in order, so the others are available with the last one
+                    GLuint available = GL_FALSE;
+#if OUZEL_OPENGLES
+                    glGetQueryObjectuivProc(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+
+                    // the timestamps are not valid if the GPU changed its frequency or was reset
+                    GLint disjoint = GL_FALSE;
+                    if (available) glGetIntegervProc(GL_GPU_DISJOINT_EXT, &disjoint);
+#else
+                    glGetQueryObjectuivProc(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+                    const GLint disjoint = GL_FALSE;
+#endif
+                    if (!available) break;
+
+                    std::vector<PassTiming> newPassTimings;
+                    newPassTimings.reserve(frame.timerQueries.size());
+
+                    for (const TimerQuery& timerQuery : frame.timerQueries)
+                    {
+                        GLuint64 startTime = 0;
+                        GLuint64 endTime = 0;
+#if OUZEL_OPENGLES
+                        glGetQueryObjectui64vProc(timerQuery.startQuery, GL_QUERY_RESULT_EXT, &startTime);
+                        glGetQueryObjectui64vProc(timerQuery.endQuery, GL_QUERY_RESULT_EXT, &endTime);
+#else
+                        glGetQueryObjectui64vProc(timerQuery.startQuery, GL_QUERY_RESULT, &startTime);
+                        glGetQueryObjectui64vProc(timerQuery.endQuery, GL_QUERY_RESULT, &endTime);
+#endif
+                        freeQueries.push_back(timerQuery.startQuery);
+                        freeQueries.push_back(timerQuery.endQuery);
+
+                        newPassTimings.push_back(PassTiming{timerQuery.name, timerQuery.depth,
+                                                            endTime > startTime ? endTime - startTime : 0});
+                    }
+
+                    pendingTimerQueries.pop_front();
+
+                    if (!disjoint) setPassTimings(std::move(newPassTimings));
+                }
+            }
+
+            void RenderDevice::uploadTextures()
+            {
+                std::size_t uploadedSize = 0;
+
+                // at least one level is uploaded every frame, even if it is larger than the budget
+                while (!textureUploads.empty() && uploadedSize < textureUploadBudget)
+                {
+                    const TextureUpload upload = textureUploads.front();
+                    textureUploads.pop_front();
+
+                    uploadedSize += upload.texture->uploadLevel(upload.level);
+                }
+            }
+
             void RenderDevice::setUniform(GLint location, DataType dataType, const void* data)
             {
                 switch (dataType)
@@ -800,6 +1030,12 @@ namespace ouzel
 
                             case Command::Type::Present:
                             {
+                                uploadTextures();
+                                endTimerQueryFrame();
+                                if (pixelStreamBuffer) pixelStreamBuffer->endFrame();
+                                if (vertexStreamBuffer) vertexStreamBuffer->endFrame();
+                                if (indexStreamBuffer) indexStreamBuffer->endFrame();
+                                captureFrame();
                                 present();
                                 break;
                             }
@@ -807,7 +1043,10 @@ namespace ouzel
                             case Command::Type::DeleteResource:
                             {
                                 auto deleteResourceCommand = static_cast<const DeleteResourceCommand*>(command.get());
-                                resources[deleteResourceCommand->resource - 1].reset();
+
+                                // the resource might have been released before it was initialized
+                                if (deleteResourceCommand->resource <= resources.size())
+                                    resources[deleteResourceCommand->resource - 1].reset();
                                 break;
                             }
 
@@ -1030,12 +1269,31 @@ namespace ouzel
                                 break;
                             }
 
+                            case Command::Type::InitPipelineState:
+                            {
+                                auto initPipelineStateCommand = static_cast<const InitPipelineStateCommand*>(command.get());
+
+                                auto pipelineState = std::make_unique<PipelineState>(*this,
+                                                                                     initPipelineStateCommand->blendState,
+                                                                                     initPipelineStateCommand->shader,
+                                                                                     initPipelineStateCommand->cullMode,
+                                                                                     initPipelineStateCommand->fillMode);
+
+                                if (initPipelineStateCommand->pipelineState > resources.size())
+                                    resources.resize(initPipelineStateCommand->pipelineState);
+                                resources[initPipelineStateCommand->pipelineState - 1] = std::move(pipelineState);
+                                break;
+                            }
+
                             case Command::Type::SetPipelineState:
                             {
                                 auto setPipelineStateCommand = static_cast<const SetPipelineStateCommand*>(command.get());
 
-                                auto blendState = getResource<BlendState>(setPipelineStateCommand->blendState);
-                                auto shader = getResource<Shader>(setPipelineStateCommand->shader);
+                                auto pipelineState = getResource<PipelineState>(setPipelineStateCommand->pipelineState);
+                                assert(pipelineState);
+
+                                auto blendState = getResource<BlendState>(pipelineState->getBlendState());
+                                auto shader = getResource<Shader>(pipelineState->getShader());
                                 currentShader = shader;
 
                                 if (blendState)
@@ -1067,14 +1325,10 @@ namespace ouzel
                                 else
                                     useProgram(0);
 
-                                const GLenum cullFace = getCullFace(setPipelineStateCommand->cullMode);
-                                setCullFace(cullFace != GL_NONE, cullFace);
+                                setCullFace(pipelineState->getCullFace() != GL_NONE, pipelineState->getCullFace());
 
-#if OUZEL_OPENGLES
-                                if (setPipelineStateCommand->fillMode != FillMode::Solid)
-                                    engine->log(Log::Level::Warning) << "Unsupported fill mode";
-#else
-                                setPolygonFillMode(getFillMode(setPipelineStateCommand->fillMode));
+#if !OUZEL_OPENGLES
+                                setPolygonFillMode(pipelineState->getPolygonFillMode());
 #endif
 
                                 break;
@@ -1093,11 +1347,14 @@ namespace ouzel
                                 assert(vertexBuffer);
                                 assert(vertexBuffer->getBufferId());
 
+                                indexBuffer->makeResident();
+                                vertexBuffer->makeResident();
+
                                 // draw
                                 bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->getBufferId());
                                 bindBuffer(GL_ARRAY_BUFFER, vertexBuffer->getBufferId());
 
-                                std::uintptr_t vertexOffset = 0;
+                                auto vertexOffset = static_cast<std::uintptr_t>(vertexBuffer->getOffset());
 
                                 for (GLuint index = 0; index < RenderDevice::VERTEX_ATTRIBUTES.size(); ++index)
                                 {
@@ -1125,7 +1382,8 @@ namespace ouzel
                                 assert(indexBuffer->getSize());
                                 assert(vertexBuffer->getSize());
 
-                                std::uintptr_t indexOffset = drawCommand->startIndex * drawCommand->indexSize;
+                                const std::uintptr_t indexOffset = static_cast<std::uintptr_t>(indexBuffer->getOffset()) +
+                                    drawCommand->startIndex * drawCommand->indexSize;
 
                                 void* indexOffsetPointer;
                                 memcpy(&indexOffsetPointer, &indexOffset, sizeof(indexOffset));
@@ -1141,15 +1399,126 @@ namespace ouzel
                                 break;
                             }
 
+                            case Command::Type::DrawInstanced:
+                            {
+                                auto drawInstancedCommand = static_cast<const DrawInstancedCommand*>(command.get());
+
+                                auto indexBuffer = getResource<Buffer>(drawInstancedCommand->indexBuffer);
+                                auto vertexBuffer = getResource<Buffer>(drawInstancedCommand->vertexBuffer);
+                                auto instanceBuffer = getResource<Buffer>(drawInstancedCommand->instanceBuffer);
+
+                                assert(indexBuffer);
+                                assert(indexBuffer->getBufferId());
+                                assert(vertexBuffer);
+                                assert(vertexBuffer->getBufferId());
+                                assert(instanceBuffer);
+                                assert(instanceBuffer->getBufferId());
+
+                                indexBuffer->makeResident();
+                                vertexBuffer->makeResident();
+                                instanceBuffer->makeResident();
+
+                                // writing the instances can overwrite the vertices in the stream buffer, but not the other way around
+                                vertexBuffer->makeResident();
+
+                                bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->getBufferId());
+                                bindBuffer(GL_ARRAY_BUFFER, vertexBuffer->getBufferId());
+
+                                auto vertexOffset = static_cast<std::uintptr_t>(vertexBuffer->getOffset());
+
+                                for (GLuint index = 0; index < RenderDevice::VERTEX_ATTRIBUTES.size(); ++index)
+                                {
+                                    const Vertex::Attribute& vertexAttribute = RenderDevice::VERTEX_ATTRIBUTES[index];
+
+                                    void* vertexOffsetPointer;
+                                    memcpy(&vertexOffsetPointer, &vertexOffset, sizeof(vertexOffset));
+
+                                    glEnableVertexAttribArrayProc(index);
+                                    glVertexAttribPointerProc(index,
+                                                              getArraySize(vertexAttribute.dataType),
+                                                              getVertexType(vertexAttribute.dataType),
+                                                              isNormalized(vertexAttribute.dataType),
+                                                              static_cast<GLsizei>(sizeof(Vertex)),
+                                                              vertexOffsetPointer);
+
+                                    vertexOffset += getDataTypeSize(vertexAttribute.dataType);
+                                }
+
+                                // the instance attributes follow the vertex attributes, the transform takes four locations
+                                bindBuffer(GL_ARRAY_BUFFER, instanceBuffer->getBufferId());
+
+                                const auto instanceAttributeIndex = static_cast<GLuint>(RenderDevice::VERTEX_ATTRIBUTES.size());
+
+                                for (GLuint column = 0; column < 4; ++column)
+                                {
+                                    const std::uintptr_t columnOffset = static_cast<std::uintptr_t>(instanceBuffer->getOffset()) +
+                                        offsetof(Instance, transform) + column * 4 * sizeof(float);
+
+                                    void* columnOffsetPointer;
+                                    memcpy(&columnOffsetPointer, &columnOffset, sizeof(columnOffset));
+
+                                    glEnableVertexAttribArrayProc(instanceAttributeIndex + column);
+                                    glVertexAttribPointerProc(instanceAttributeIndex + column,
+                                                              4, GL_FLOAT, GL_FALSE,
+                                                              static_cast<GLsizei>(sizeof(Instance)),
+                                                              columnOffsetPointer);
+                                    glVertexAttribDivisorProc(instanceAttributeIndex + column, 1);
+                                }
+
+                                const std::uintptr_t colorOffset = static_cast<std::uintptr_t>(instanceBuffer->getOffset()) +
+                                    offsetof(Instance, color);
+
+                                void* colorOffsetPointer;
+                                memcpy(&colorOffsetPointer, &colorOffset, sizeof(colorOffset));
+
+                                glEnableVertexAttribArrayProc(instanceAttributeIndex + 4);
+                                glVertexAttribPointerProc(instanceAttributeIndex + 4,
+                                                          4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                                          static_cast<GLsizei>(sizeof(Instance)),
+                                                          colorOffsetPointer);
+                                glVertexAttribDivisorProc(instanceAttributeIndex + 4, 1);
+
+                                GLenum error;
+                                if ((error = glGetErrorProc()) != GL_NO_ERROR)
+                                    throw std::system_error(makeErrorCode(error), "Failed to update instance attributes");
+
+                                assert(drawInstancedCommand->indexCount);
+                                assert(drawInstancedCommand->instanceCount);
+                                assert(static_cast<std::size_t>(instanceBuffer->getSize()) >= drawInstancedCommand->instanceCount * sizeof(Instance));
+
+                                const std::uintptr_t indexOffset = static_cast<std::uintptr_t>(indexBuffer->getOffset()) +
+                                    drawInstancedCommand->startIndex * drawInstancedCommand->indexSize;
+
+                                void* indexOffsetPointer;
+                                memcpy(&indexOffsetPointer, &indexOffset, sizeof(indexOffset));
+
+                                glDrawElementsInstancedProc(getDrawMode(drawInstancedCommand->drawMode),
+                                                            static_cast<GLsizei>(drawInstancedCommand->indexCount),
+                                                            getIndexType(drawInstancedCommand->indexSize),
+                                                            indexOffsetPointer,
+                                                            static_cast<GLsizei>(drawInstancedCommand->instanceCount));
+
+                                // plain draws do not set these attributes
+                                for (GLuint index = instanceAttributeIndex; index < instanceAttributeIndex + 5; ++index)
+                                    glDisableVertexAttribArrayProc(index);
+
+                                if ((error = glGetErrorProc()) != GL_NO_ERROR)
+                                    throw std::system_error(makeErrorCode(error), "Failed to draw instanced elements");
+
+                                break;
+                            }
+
                             case Command::Type::PushDebugMarker:
                             {
                                 auto pushDebugMarkerCommand = static_cast<const PushDebugMarkerCommand*>(command.get());
                                 if (glPushGroupMarkerEXTProc) glPushGroupMarkerEXTProc(0, pushDebugMarkerCommand->name.c_str());
+                                beginTimerQuery(pushDebugMarkerCommand->name);
                                 break;
                             }
 
                             case Command::Type::PopDebugMarker:
                             {
+                                endTimerQuery();
                                 if (glPopGroupMarkerEXTProc) glPopGroupMarkerEXTProc();
                                 break;
                             }
@@ -1269,7 +1638,8 @@ namespace ouzel
                                                                          initTextureCommand->textureType,
                                                                          initTextureCommand->flags,
                                                                          initTextureCommand->sampleCount,
-                                                                         initTextureCommand->pixelFormat);
+                                                                         initTextureCommand->pixelFormat,
+                                                                         initTextureCommand->uploadToken);
 
                                 if (initTextureCommand->texture > resources.size())
                                     resources.resize(initTextureCommand->texture);
@@ -1282,7 +1652,7 @@ namespace ouzel
                                 auto setTextureDataCommand = static_cast<const SetTextureDataCommand*>(command.get());
 
                                 auto texture = getResource<Texture>(setTextureDataCommand->texture);
-                                texture->setData(setTextureDataCommand->levels);
+                                texture->setData(setTextureDataCommand->levels, setTextureDataCommand->uploadToken);
 
                                 break;
                             }
@@ -1328,45 +1698,145 @@ namespace ouzel
             {
             }
 
-            void RenderDevice::generateScreenshot(const std::string& filename)
+            void RenderDevice::captureFrame()
             {
-                bindFrameBuffer(frameBufferId);
+                // a failed capture is dropped, it must not keep the frame from being presented
+                try
+                {
+                    std::vector<std::string> filenames = frameCapture.nextFrame(pendingCaptures.size());
+                    if (!filenames.empty()) readFrameBuffer(std::move(filenames));
+                }
+                catch (const std::exception& e)
+                {
+                    engine->log(Log::Level::Error) << "Failed to capture frame: " << e.what();
+                }
 
-                const GLsizei pixelSize = 4;
+                readCapturedFrames();
+            }
 
-                std::vector<std::uint8_t> data(static_cast<std::size_t>(frameBufferWidth * frameBufferHeight * pixelSize));
+            void RenderDevice::readFrameBuffer(std::vector<std::string> filenames)
+            {
+                bindFrameBuffer(frameBufferId);
 
-                glReadPixelsProc(0, 0, frameBufferWidth, frameBufferHeight,
-                                 GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+                const auto rowSize = static_cast<std::size_t>(frameBufferWidth) * 4;
 
                 GLenum error;
 
-                if ((error = glGetErrorProc()) != GL_NO_ERROR)
-                    throw std::system_error(makeErrorCode(error), "Failed to read pixels from frame buffer");
+#if !defined(__EMSCRIPTEN__)
+                // WebGL does not allow waiting for fences on the client
+                const bool pixelBufferReadback = pixelBuffersSupported &&
+                    glMapBufferRangeProc && glUnmapBufferProc &&
+                    glFenceSyncProc && glClientWaitSyncProc && glDeleteSyncProc;
+#else
+                const bool pixelBufferReadback = false;
+#endif
 
-                // flip the image vertically
-                const auto rowSize = frameBufferWidth * pixelSize;
-                std::vector<std::uint8_t> temp(static_cast<std::size_t>(rowSize));
-                for (GLsizei row = 0; row < frameBufferHeight / 2; ++row)
+                if (pixelBufferReadback)
                 {
-                    const auto topRowOffset = row * rowSize;
-                    const auto bottomRowOffset = (frameBufferHeight - row - 1) * rowSize;
+                    // the pixels are copied to a pixel buffer by the GPU and mapped after the fence has passed
+                    GLuint pixelBuffer;
+                    if (freeCaptureBuffers.empty())
+                        glGenBuffersProc(1, &pixelBuffer);
+                    else
+                    {
+                        pixelBuffer = freeCaptureBuffers.back();
+                        freeCaptureBuffers.pop_back();
+                    }
+
+                    glBindBufferProc(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+                    glBufferDataProc(GL_PIXEL_PACK_BUFFER,
+                                     static_cast<GLsizeiptr>(rowSize * static_cast<std::size_t>(frameBufferHeight)),
+                                     nullptr, GL_STREAM_READ);
+                    glReadPixelsProc(0, 0, frameBufferWidth, frameBufferHeight,
+                                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                    glBindBufferProc(GL_PIXEL_PACK_BUFFER, 0);
+
+                    if ((error = glGetErrorProc()) != GL_NO_ERROR)
+                    {
+                        freeCaptureBuffers.push_back(pixelBuffer);
+                        throw std::system_error(makeErrorCode(error), "Failed to read pixels from frame buffer");
+                    }
 
-                    std::copy(data.begin() + topRowOffset,
-                              data.begin() + topRowOffset + rowSize,
-                              temp.begin());
+                    const GLsync sync = glFenceSyncProc(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
-                    std::copy(data.begin() + bottomRowOffset,
-                              data.begin() + bottomRowOffset + rowSize,
-                              data.begin() + topRowOffset);
+                    if (!sync)
+                    {
+                        freeCaptureBuffers.push_back(pixelBuffer);
+                        throw std::system_error(makeErrorCode(glGetErrorProc()), "Failed to create fence");
+                    }
 
-                    std::copy(temp.begin(), temp.end(),
-                              data.begin() + bottomRowOffset);
+                    pendingCaptures.push_back(PendingCapture{std::move(filenames),
+                                                             frameBufferWidth, frameBufferHeight,
+                                                             pixelBuffer, sync});
+                }
+                else
+                {
+                    // the read waits for the GPU, only the encoding is done on the capture thread
+                    FrameCapture::Frame frame;
+                    frame.filenames = std::move(filenames);
+                    frame.width = static_cast<std::uint32_t>(frameBufferWidth);
+                    frame.height = static_cast<std::uint32_t>(frameBufferHeight);
+                    frame.pitch = static_cast<std::uint32_t>(rowSize);
+                    frame.data.resize(rowSize * static_cast<std::size_t>(frameBufferHeight));
+                    frame.bottomUp = true;
+
+                    glReadPixelsProc(0, 0, frameBufferWidth, frameBufferHeight,
+                                     GL_RGBA, GL_UNSIGNED_BYTE, frame.data.data());
 
+                    if ((error = glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to read pixels from frame buffer");
+
+                    frameCapture.encode(std::move(frame));
                 }
+            }
+
+            void RenderDevice::readCapturedFrames()
+            {
+                while (!pendingCaptures.empty())
+                {
+                    const GLenum result = glClientWaitSyncProc(pendingCaptures.front().sync, 0, 0);
+                    if (result == GL_TIMEOUT_EXPIRED) break;
 
-                if (!stbi_write_png(filename.c_str(), frameBufferWidth, frameBufferHeight, pixelSize, data.data(), frameBufferWidth * pixelSize))
-                    throw std::runtime_error("Failed to save image to file");
+                    PendingCapture capture = std::move(pendingCaptures.front());
+                    pendingCaptures.pop_front();
+
+                    glDeleteSyncProc(capture.sync);
+                    freeCaptureBuffers.push_back(capture.pixelBuffer);
+
+                    if (result == GL_WAIT_FAILED)
+                    {
+                        engine->log(Log::Level::Error) << "Failed to capture frame: failed to wait for fence";
+                        continue;
+                    }
+
+                    const auto rowSize = static_cast<std::size_t>(capture.width) * 4;
+
+                    FrameCapture::Frame frame;
+                    frame.filenames = std::move(capture.filenames);
+                    frame.width = static_cast<std::uint32_t>(capture.width);
+                    frame.height = static_cast<std::uint32_t>(capture.height);
+                    frame.pitch = static_cast<std::uint32_t>(rowSize);
+                    frame.data.resize(rowSize * static_cast<std::size_t>(capture.height));
+                    frame.bottomUp = true;
+
+                    glBindBufferProc(GL_PIXEL_PACK_BUFFER, capture.pixelBuffer);
+
+                    const void* data = glMapBufferRangeProc(GL_PIXEL_PACK_BUFFER, 0,
+                                                            static_cast<GLsizeiptr>(frame.data.size()),
+                                                            GL_MAP_READ_BIT);
+                    if (data)
+                    {
+                        std::memcpy(frame.data.data(), data, frame.data.size());
+                        glUnmapBufferProc(GL_PIXEL_PACK_BUFFER);
+                    }
+
+                    glBindBufferProc(GL_PIXEL_PACK_BUFFER, 0);
+
+                    if (data)
+                        frameCapture.encode(std::move(frame));
+                    else
+                        engine->log(Log::Level::Error) << "Failed to capture frame: failed to map pixel buffer (" << glGetErrorProc() << ")";
+                }
             }
         } // namespace opengl
     } // namespace graphics
@@ -10,8 +10,10 @@
 #include <cstring>
 #include <array>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <queue>
+#include <string>
 #include <system_error>
 #include <unordered_map>
 #include <utility>
@@ -33,6 +35,7 @@
 
 #include "../RenderDevice.hpp"
 #include "OGLShader.hpp"
+#include "OGLStreamBuffer.hpp"
 
 namespace ouzel
 {
@@ -42,6 +45,8 @@ namespace ouzel
         {
             std::error_code makeErrorCode(GLenum e);
 
+            class Texture;
+
             class RenderDevice: public graphics::RenderDevice
             {
                 friend Renderer;
@@ -61,6 +66,8 @@ namespace ouzel
                 PFNGLTEXPARAMETERFVPROC glTexParameterfvProc = nullptr;
                 PFNGLTEXIMAGE2DPROC glTexImage2DProc = nullptr;
                 PFNGLTEXSUBIMAGE2DPROC glTexSubImage2DProc = nullptr;
+                PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2DProc = nullptr;
+                PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC glCompressedTexSubImage2DProc = nullptr;
                 PFNGLVIEWPORTPROC glViewportProc = nullptr;
                 PFNGLCLEARPROC glClearProc = nullptr;
                 PFNGLCLEARCOLORPROC glClearColorProc = nullptr;
@@ -114,6 +121,9 @@ namespace ouzel
 
                 PFNGLMAPBUFFERRANGEPROC glMapBufferRangeProc = nullptr;
                 PFNGLUNMAPBUFFERPROC glUnmapBufferProc = nullptr;
+                PFNGLFENCESYNCPROC glFenceSyncProc = nullptr;
+                PFNGLCLIENTWAITSYNCPROC glClientWaitSyncProc = nullptr;
+                PFNGLDELETESYNCPROC glDeleteSyncProc = nullptr;
 
                 PFNGLCOPYIMAGESUBDATAPROC glCopyImageSubDataProc = nullptr;
 
@@ -121,6 +131,12 @@ namespace ouzel
                 PFNGLCLEARDEPTHFPROC glClearDepthfProc = nullptr;
                 PFNGLMAPBUFFEROESPROC glMapBufferProc = nullptr;
                 PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleProc = nullptr;
+                PFNGLBUFFERSTORAGEEXTPROC glBufferStorageProc = nullptr;
+                PFNGLGENQUERIESEXTPROC glGenQueriesProc = nullptr;
+                PFNGLDELETEQUERIESEXTPROC glDeleteQueriesProc = nullptr;
+                PFNGLQUERYCOUNTEREXTPROC glQueryCounterProc = nullptr;
+                PFNGLGETQUERYOBJECTUIVEXTPROC glGetQueryObjectuivProc = nullptr;
+                PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64vProc = nullptr;
 #  if OUZEL_OPENGL_INTERFACE_EAGL
                 PFNGLDISCARDFRAMEBUFFEREXTPROC glDiscardFramebufferEXTProc = nullptr;
                 PFNGLRESOLVEMULTISAMPLEFRAMEBUFFERAPPLEPROC glResolveMultisampleFramebufferAPPLEProc = nullptr;
@@ -129,6 +145,12 @@ namespace ouzel
                 PFNGLPOLYGONMODEPROC glPolygonModeProc = nullptr;
                 PFNGLCLEARDEPTHPROC glClearDepthProc = nullptr;
                 PFNGLMAPBUFFERPROC glMapBufferProc = nullptr;
+                PFNGLBUFFERSTORAGEPROC glBufferStorageProc = nullptr;
+                PFNGLGENQUERIESPROC glGenQueriesProc = nullptr;
+                PFNGLDELETEQUERIESPROC glDeleteQueriesProc = nullptr;
+                PFNGLQUERYCOUNTERPROC glQueryCounterProc = nullptr;
+                PFNGLGETQUERYOBJECTUIVPROC glGetQueryObjectuivProc = nullptr;
+                PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64vProc = nullptr;
 #endif
 
                 PFNGLCREATESHADERPROC glCreateShaderProc = nullptr;
@@ -161,6 +183,8 @@ namespace ouzel
                 PFNGLENABLEVERTEXATTRIBARRAYPROC glEnableVertexAttribArrayProc = nullptr;
                 PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArrayProc = nullptr;
                 PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointerProc = nullptr;
+                PFNGLVERTEXATTRIBDIVISORPROC glVertexAttribDivisorProc = nullptr;
+                PFNGLDRAWELEMENTSINSTANCEDPROC glDrawElementsInstancedProc = nullptr;
 
                 PFNGLGETSTRINGIPROC glGetStringiProc = nullptr;
                 PFNGLPUSHGROUPMARKEREXTPROC glPushGroupMarkerEXTProc = nullptr;
@@ -595,6 +619,18 @@ namespace ouzel
                     return id ? static_cast<T*>(resources[id - 1].get()) : nullptr;
                 }
 
+                // dynamic buffers write their data here, null when streaming is not used
+                inline StreamBuffer* getStreamBuffer(GLenum bufferType) const noexcept
+                {
+                    return (bufferType == GL_ELEMENT_ARRAY_BUFFER) ? indexStreamBuffer.get() : vertexStreamBuffer.get();
+                }
+
+                // texture data is staged here, null when pixel buffers are not supported
+                inline StreamBuffer* getPixelStreamBuffer() const noexcept { return pixelStreamBuffer.get(); }
+
+                void queueTextureUpload(Texture& texture, std::uint32_t level);
+                void cancelTextureUploads(const Texture& texture);
+
             protected:
                 void init(Window* newWindow,
                           const Size2U& newSize,
@@ -611,16 +647,76 @@ namespace ouzel
 
                 void process() override;
                 virtual void present();
-                void generateScreenshot(const std::string& filename) override;
+                // reads the frames selected by the frame capture to pixel buffers and passes the ones
+                // that the GPU has finished to it, errors are logged and drop the capture
+                void captureFrame();
+                void readFrameBuffer(std::vector<std::string> filenames);
+                void readCapturedFrames();
                 void setUniform(GLint location, DataType dataType, const void* data);
+                void uploadTextures();
+                GLuint writeTimestamp();
+                void beginTimerQuery(const std::string& name);
+                void endTimerQuery();
+                // reads the results of the previous frames that are available
+                void endTimerQueryFrame();
 
                 GLuint frameBufferId = 0;
                 GLsizei frameBufferWidth = 0;
                 GLsizei frameBufferHeight = 0;
                 GLuint vertexArrayId = 0;
 
+                std::unique_ptr<StreamBuffer> vertexStreamBuffer;
+                std::unique_ptr<StreamBuffer> indexStreamBuffer;
+                std::unique_ptr<StreamBuffer> pixelStreamBuffer;
+
+                struct TextureUpload final
+                {
+                    Texture* texture;
+                    std::uint32_t level;
+                };
+
+                std::deque<TextureUpload> textureUploads;
+
+                // timestamps of the debug marker regions, which are read when the GPU has written
+                // them, so that the render thread never waits for the results
+                struct TimerQuery final
+                {
+                    std::string name;
+                    std::uint32_t depth;
+                    GLuint startQuery;
+                    GLuint endQuery = 0;
+                };
+
+                struct TimerQueryFrame final
+                {
+                    std::vector<TimerQuery> timerQueries;
+                    GLuint lastQuery;
+                };
+
+                static constexpr std::size_t maxTimerQueryFrames = 4;
+
+                std::vector<GLuint> freeQueries;
+                std::vector<TimerQuery> timerQueries; // regions of the current frame
+                std::vector<std::size_t> openTimerQueries; // regions whose markers have not been popped
+                std::deque<TimerQueryFrame> pendingTimerQueries;
+                GLuint lastTimestampQuery = 0;
+
+                struct PendingCapture final
+                {
+                    std::vector<std::string> filenames;
+                    GLsizei width;
+                    GLsizei height;
+                    GLuint pixelBuffer;
+                    GLsync sync; // signaled when the pixels have been copied to the buffer
+                };
+
+                std::vector<GLuint> freeCaptureBuffers;
+                std::deque<PendingCapture> pendingCaptures;
+
                 bool textureBaseLevelSupported:1;
                 bool textureMaxLevelSupported:1;
+                bool pixelBuffersSupported:1;
+                bool timerQueriesSupported:1;
 
                 struct StateCache
                 {
@@ -168,6 +168,14 @@ namespace ouzel
                     }
                 }
 
+                // instanced shaders take the per-instance data after all the vertex attributes
+                if (renderDevice.isInstancingSupported())
+                {
+                    const auto instanceAttributeIndex = static_cast<GLuint>(RenderDevice::VERTEX_ATTRIBUTES.size());
+                    renderDevice.glBindAttribLocationProc(programId, instanceAttributeIndex, "instanceTransform0");
+                    renderDevice.glBindAttribLocationProc(programId, instanceAttributeIndex + 4, "instanceColor0");
+                }
+
                 renderDevice.glLinkProgramProc(programId);
 
                 renderDevice.glGetProgramivProc(programId, GL_LINK_STATUS, &status);
@@ -0,0 +1,229 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_OPENGL
+
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include "OGLStreamBuffer.hpp"
+#include "OGLRenderDevice.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace opengl
+        {
+            namespace
+            {
+                // enough for vertex attributes and all index sizes
+                constexpr std::uint64_t alignment = 16;
+
+#if OUZEL_OPENGLES
+                constexpr GLbitfield persistentMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+#else
+                constexpr GLbitfield persistentMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+#endif
+            }
+
+            StreamBuffer::StreamBuffer(RenderDevice& initRenderDevice,
+                                       GLenum initBufferType,
+                                       GLsizeiptr initCapacity):
+                renderDevice(initRenderDevice),
+                bufferType(initBufferType),
+                capacity(static_cast<std::uint64_t>(initCapacity))
+            {
+#if !defined(__EMSCRIPTEN__)
+                // WebGL does not allow waiting for fences on the client
+                fenced = renderDevice.glFenceSyncProc &&
+                    renderDevice.glClientWaitSyncProc &&
+                    renderDevice.glDeleteSyncProc;
+#endif
+
+                createBuffer();
+            }
+
+            StreamBuffer::~StreamBuffer()
+            {
+                while (!fences.empty())
+                {
+                    renderDevice.glDeleteSyncProc(fences.front().sync);
+                    fences.pop();
+                }
+
+                if (bufferId)
+                    renderDevice.deleteBuffer(bufferId);
+            }
+
+            bool StreamBuffer::write(const void* data, GLsizeiptr size, Allocation& allocation)
+            {
+                const auto dataSize = static_cast<std::uint64_t>(size);
+
+                // large writes would have to wait for most of the ring
+                if (dataSize > capacity / 4) return false;
+
+                // the data is never split at the end of the ring
+                std::uint64_t start = (head + alignment - 1) / alignment * alignment;
+                if (start % capacity + dataSize > capacity) start = (start / capacity + 1) * capacity;
+
+                if (fenced)
+                {
+                    while (completed + capacity < start + dataSize)
+                    {
+                        // the ring is too small for the current frame
+                        if (fences.empty()) return false;
+
+                        waitForFence();
+                    }
+                }
+                else if (completed + capacity < start + dataSize)
+                {
+                    // the GPU keeps using the old storage until it is done with it
+                    renderDevice.bindBuffer(bufferType, bufferId);
+                    renderDevice.glBufferDataProc(bufferType, static_cast<GLsizeiptr>(capacity), nullptr, GL_STREAM_DRAW);
+
+                    GLenum error;
+
+                    if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to orphan stream buffer");
+
+                    ++generation;
+                    completed = start;
+                }
+
+                const auto offset = static_cast<GLintptr>(start % capacity);
+
+                if (mappedData)
+                    std::memcpy(mappedData + offset, data, static_cast<std::size_t>(size));
+                else if (renderDevice.glMapBufferRangeProc && renderDevice.glUnmapBufferProc)
+                {
+                    renderDevice.bindBuffer(bufferType, bufferId);
+
+                    void* mappedRange = renderDevice.glMapBufferRangeProc(bufferType, offset, size,
+                                                                          GL_MAP_WRITE_BIT |
+                                                                          GL_MAP_UNSYNCHRONIZED_BIT |
+                                                                          GL_MAP_INVALIDATE_RANGE_BIT);
+                    if (!mappedRange)
+                        throw std::system_error(makeErrorCode(renderDevice.glGetErrorProc()), "Failed to map stream buffer");
+
+                    std::memcpy(mappedRange, data, static_cast<std::size_t>(size));
+
+                    if (renderDevice.glUnmapBufferProc(bufferType) != GL_TRUE)
+                        throw std::runtime_error("Failed to unmap stream buffer");
+                }
+                else
+                {
+                    renderDevice.bindBuffer(bufferType, bufferId);
+                    renderDevice.glBufferSubDataProc(bufferType, offset, size, data);
+
+                    GLenum error;
+
+                    if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to upload stream buffer");
+                }
+
+                head = start + dataSize;
+                allocation.position = start;
+                allocation.generation = generation;
+
+                return true;
+            }
+
+            void StreamBuffer::endFrame()
+            {
+                if (!fenced) return;
+
+                // release the fences that have already passed, so they do not pile up while the ring is not full
+                while (!fences.empty())
+                {
+                    const GLenum result = renderDevice.glClientWaitSyncProc(fences.front().sync, 0, 0);
+                    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+
+                    renderDevice.glDeleteSyncProc(fences.front().sync);
+                    completed = fences.front().position;
+                    fences.pop();
+                }
+
+                // nothing was written since the last fence
+                if ((fences.empty() ? completed : fences.back().position) == head) return;
+
+                const GLsync sync = renderDevice.glFenceSyncProc(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+                if (!sync)
+                    throw std::system_error(makeErrorCode(renderDevice.glGetErrorProc()), "Failed to create fence");
+
+                fences.push(Fence{sync, head});
+            }
+
+            void StreamBuffer::reload()
+            {
+                // the fences and the buffer were destroyed with the context
+                while (!fences.empty()) fences.pop();
+
+                bufferId = 0;
+                mappedData = nullptr;
+                completed = head;
+                ++generation;
+
+                createBuffer();
+            }
+
+            void StreamBuffer::createBuffer()
+            {
+                renderDevice.glGenBuffersProc(1, &bufferId);
+
+                GLenum error;
+
+                if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                    throw std::system_error(makeErrorCode(error), "Failed to create stream buffer");
+
+                renderDevice.bindBuffer(bufferType, bufferId);
+
+                // persistent mapping needs fences, because the writes are never synchronized
+                if (fenced && renderDevice.glBufferStorageProc && renderDevice.glMapBufferRangeProc)
+                {
+                    renderDevice.glBufferStorageProc(bufferType, static_cast<GLsizeiptr>(capacity), nullptr, persistentMapFlags);
+
+                    if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to create stream buffer storage");
+
+                    mappedData = static_cast<std::uint8_t*>(renderDevice.glMapBufferRangeProc(bufferType, 0,
+                                                                                               static_cast<GLsizeiptr>(capacity),
+                                                                                               persistentMapFlags));
+                    if (!mappedData)
+                        throw std::system_error(makeErrorCode(renderDevice.glGetErrorProc()), "Failed to map stream buffer");
+                }
+                else
+                {
+                    renderDevice.glBufferDataProc(bufferType, static_cast<GLsizeiptr>(capacity), nullptr, GL_STREAM_DRAW);
+
+                    if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to create stream buffer storage");
+                }
+            }
+
+            void StreamBuffer::waitForFence()
+            {
+                const Fence& fence = fences.front();
+
+                for (;;)
+                {
+                    const GLenum result = renderDevice.glClientWaitSyncProc(fence.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+                    if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+
+                    if (result == GL_WAIT_FAILED)
+                        throw std::system_error(makeErrorCode(renderDevice.glGetErrorProc()), "Failed to wait for fence");
+                }
+
+                renderDevice.glDeleteSyncProc(fence.sync);
+                completed = fence.position;
+                fences.pop();
+            }
+        } // namespace opengl
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
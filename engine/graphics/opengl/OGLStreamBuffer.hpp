@@ -0,0 +1,107 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_OGLSTREAMBUFFER_HPP
+#define OUZEL_GRAPHICS_OGLSTREAMBUFFER_HPP
+
+#include "../../core/Setup.h"
+
+#if OUZEL_COMPILE_OPENGL
+
+#include <cstdint>
+#include <queue>
+
+#include "OGL.h"
+
+#if OUZEL_OPENGLES
+#  include "GLES/gl.h"
+#  include "GLES2/gl2.h"
+#  include "GLES2/gl2ext.h"
+#  include "GLES3/gl3.h"
+#else
+#  include "GL/glcorearb.h"
+#  include "GL/glext.h"
+#endif
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace opengl
+        {
+            class RenderDevice;
+
+            // Ring buffer that dynamic buffers write their data to instead of updating their own storage.
+            // It is mapped persistently when buffer storage is supported, otherwise ranges are mapped
+            // without synchronization or written with glBufferSubData. Fences at the end of every frame
+            // keep the writes from overwriting data that the GPU still uses. Without fences the storage
+            // is orphaned every time the ring wraps.
+            class StreamBuffer final
+            {
+            public:
+                struct Allocation final
+                {
+                    std::uint64_t position = 0; // position since the creation of the ring
+                    std::uint64_t generation = 0;
+                };
+
+                StreamBuffer(RenderDevice& initRenderDevice,
+                             GLenum initBufferType,
+                             GLsizeiptr initCapacity);
+                ~StreamBuffer();
+
+                StreamBuffer(const StreamBuffer&) = delete;
+                StreamBuffer& operator=(const StreamBuffer&) = delete;
+                StreamBuffer(StreamBuffer&&) = delete;
+                StreamBuffer& operator=(StreamBuffer&&) = delete;
+
+                // returns false if the data is too large or would overwrite data of the current frame
+                bool write(const void* data, GLsizeiptr size, Allocation& allocation);
+
+                // whether the data of the allocation has not been overwritten yet
+                inline auto isValid(const Allocation& allocation) const noexcept
+                {
+                    return allocation.generation == generation && head - allocation.position <= capacity;
+                }
+
+                inline auto getOffset(const Allocation& allocation) const noexcept
+                {
+                    return static_cast<GLintptr>(allocation.position % capacity);
+                }
+
+                inline auto getBufferId() const noexcept { return bufferId; }
+
+                void endFrame();
+
+                // recreates the storage after the context was lost
+                void reload();
+
+            private:
+                void createBuffer();
+                void waitForFence();
+
+                struct Fence final
+                {
+                    GLsync sync;
+                    std::uint64_t position; // everything before this was written before the fence
+                };
+
+                RenderDevice& renderDevice;
+                GLenum bufferType;
+                std::uint64_t capacity;
+
+                bool fenced = false;
+                GLuint bufferId = 0;
+                std::uint8_t* mappedData = nullptr; // set when the storage is mapped persistently
+
+                std::uint64_t head = 0;
+                std::uint64_t completed = 0; // the GPU has finished with everything before this
+                std::uint64_t generation = 0;
+                std::queue<Fence> fences;
+            };
+        } // namespace opengl
+    } // namespace graphics
+} // namespace ouzel
+
+#endif
+
+#endif // OUZEL_GRAPHICS_OGLSTREAMBUFFER_HPP
@@ -4,6 +4,7 @@
 
 #if OUZEL_COMPILE_OPENGL
 
+#include <algorithm>
 #include <stdexcept>
 #include "OGLTexture.hpp"
 #include "OGLRenderDevice.hpp"
@@ -16,6 +17,9 @@ namespace ouzel
         {
             namespace
             {
+                // data up to this size is uploaded right away instead of waiting in the upload queue
+                constexpr std::size_t immediateUploadSize = 64 * 1024;
+
                 constexpr GLenum getOpenGlInternalPixelFormat(PixelFormat pixelFormat, std::uint32_t openGLVersion)
                 {
 #if OUZEL_OPENGLES
@@ -112,6 +116,39 @@ namespace ouzel
 #endif
                 }
 
+                constexpr GLenum getOpenGlCompressedPixelFormat(PixelFormat pixelFormat)
+                {
+                    switch (pixelFormat)
+                    {
+                        case PixelFormat::BC1RGBAUNorm: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+                        case PixelFormat::BC1RGBAUNormSRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+                        case PixelFormat::BC2RGBAUNorm: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+                        case PixelFormat::BC2RGBAUNormSRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+                        case PixelFormat::BC3RGBAUNorm: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                        case PixelFormat::BC3RGBAUNormSRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+#if OUZEL_OPENGLES
+                        case PixelFormat::BC4RUNorm: return GL_COMPRESSED_RED_RGTC1_EXT;
+                        case PixelFormat::BC5RGUNorm: return GL_COMPRESSED_RED_GREEN_RGTC2_EXT;
+                        case PixelFormat::BC7RGBAUNorm: return GL_COMPRESSED_RGBA_BPTC_UNORM_EXT;
+                        case PixelFormat::BC7RGBAUNormSRGB: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_EXT;
+#else
+                        case PixelFormat::BC4RUNorm: return GL_COMPRESSED_RED_RGTC1;
+                        case PixelFormat::BC5RGUNorm: return GL_COMPRESSED_RG_RGTC2;
+                        case PixelFormat::BC7RGBAUNorm: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+                        case PixelFormat::BC7RGBAUNormSRGB: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+#endif
+                        case PixelFormat::ETC2RGB8UNorm: return GL_COMPRESSED_RGB8_ETC2;
+                        case PixelFormat::ETC2RGB8UNormSRGB: return GL_COMPRESSED_SRGB8_ETC2;
+                        case PixelFormat::ETC2RGBA8UNorm: return GL_COMPRESSED_RGBA8_ETC2_EAC;
+                        case PixelFormat::ETC2RGBA8UNormSRGB: return GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+                        case PixelFormat::ASTC4x4UNorm: return GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
+                        case PixelFormat::ASTC4x4UNormSRGB: return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR;
+                        case PixelFormat::ASTC8x8UNorm: return GL_COMPRESSED_RGBA_ASTC_8x8_KHR;
+                        case PixelFormat::ASTC8x8UNormSRGB: return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR;
+                        default: return GL_NONE;
+                    }
+                }
+
                 constexpr GLenum getOpenGlPixelFormat(PixelFormat pixelFormat)
                 {
                     switch (pixelFormat)
@@ -260,14 +297,18 @@ namespace ouzel
                              TextureType type,
                              std::uint32_t initFlags,
                              std::uint32_t initSampleCount,
-                             PixelFormat initPixelFormat):
+                             PixelFormat initPixelFormat,
+                             std::shared_ptr<UploadToken> uploadToken):
                 RenderResource(initRenderDevice),
                 levels(initLevels),
                 flags(initFlags),
                 mipmaps(static_cast<std::uint32_t>(initLevels.size())),
                 sampleCount(initSampleCount),
                 textureTarget(getTextureTarget(type)),
-                internalPixelFormat(getOpenGlInternalPixelFormat(initPixelFormat, renderDevice.getAPIMajorVersion())),
+                sourcePixelFormat(initPixelFormat),
+                compressed(isCompressed(initPixelFormat)),
+                internalPixelFormat(compressed ? getOpenGlCompressedPixelFormat(initPixelFormat) :
+                                    getOpenGlInternalPixelFormat(initPixelFormat, renderDevice.getAPIMajorVersion())),
                 pixelFormat(getOpenGlPixelFormat(initPixelFormat)),
                 pixelType(getOpenGlPixelType(initPixelFormat))
             {
@@ -277,11 +318,20 @@ namespace ouzel
                 if (internalPixelFormat == GL_NONE)
                     throw std::runtime_error("Invalid pixel format");
 
-                if (pixelFormat == GL_NONE)
-                    throw std::runtime_error("Invalid pixel format");
+                if (compressed)
+                {
+                    // compressed data is uploaded as-is, so there is no client pixel format and type
+                    if (flags & Flags::BindRenderTarget)
+                        throw std::runtime_error("Compressed textures can not be render targets");
+                }
+                else
+                {
+                    if (pixelFormat == GL_NONE)
+                        throw std::runtime_error("Invalid pixel format");
 
-                if (pixelType == GL_NONE)
-                    throw std::runtime_error("Invalid pixel format");
+                    if (pixelType == GL_NONE)
+                        throw std::runtime_error("Invalid pixel format");
+                }
 
                 createTexture();
 
@@ -300,24 +350,10 @@ namespace ouzel
                             throw std::system_error(makeErrorCode(error), "Failed to set texture base and max levels");
                     }
 
-                    for (std::size_t level = 0; level < levels.size(); ++level)
-                    {
-                        if (!levels[level].second.empty())
-                            renderDevice.glTexImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(internalPixelFormat),
-                                                          static_cast<GLsizei>(levels[level].first.v[0]),
-                                                          static_cast<GLsizei>(levels[level].first.v[1]), 0,
-                                                          pixelFormat, pixelType, levels[level].second.data());
-                        else
-                            renderDevice.glTexImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(internalPixelFormat),
-                                                          static_cast<GLsizei>(levels[level].first.v[0]),
-                                                          static_cast<GLsizei>(levels[level].first.v[1]), 0,
-                                                          pixelFormat, pixelType, nullptr);
-                    }
+                    uploadLevels();
 
-                    GLenum error;
-
-                    if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
-                        throw std::system_error(makeErrorCode(error), "Failed to upload texture data");
+                    if (uploadToken && std::find(pendingLevels.begin(), pendingLevels.end(), true) != pendingLevels.end())
+                        uploadTokens.push_back(std::move(uploadToken));
                 }
 
                 setTextureParameters();
@@ -325,6 +361,8 @@ namespace ouzel
 
             Texture::~Texture()
             {
+                renderDevice.cancelTextureUploads(*this);
+
                 if (bufferId)
                     renderDevice.deleteRenderBuffer(bufferId);
 
@@ -354,44 +392,190 @@ namespace ouzel
                             throw std::system_error(makeErrorCode(error), "Failed to set texture base and max levels");
                     }
 
-                    for (std::size_t level = 0; level < levels.size(); ++level)
+                    uploadLevels();
+
+                    setTextureParameters();
+                }
+            }
+
+            void Texture::uploadLevels()
+            {
+                pendingLevels.resize(levels.size());
+
+                // levels from this one to the smallest are uploaded right away, so that the texture always has
+                // content, the larger ones are queued and the base level moves down as they arrive
+                std::size_t immediateLevel = 0;
+
+                if (renderDevice.getPixelStreamBuffer() && renderDevice.isTextureBaseLevelSupported())
+                {
+                    immediateLevel = levels.size();
+                    std::size_t immediateSize = 0;
+
+                    while (immediateLevel > 0)
                     {
-                        if (!levels[level].second.empty())
-                            renderDevice.glTexImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(internalPixelFormat),
-                                                          static_cast<GLsizei>(levels[level].first.v[0]),
-                                                          static_cast<GLsizei>(levels[level].first.v[1]), 0,
-                                                          pixelFormat, pixelType, levels[level].second.data());
-                        else
-                            renderDevice.glTexImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(internalPixelFormat),
-                                                          static_cast<GLsizei>(levels[level].first.v[0]),
-                                                          static_cast<GLsizei>(levels[level].first.v[1]), 0,
-                                                          pixelFormat, pixelType, nullptr);
+                        const std::size_t levelSize = levels[immediateLevel - 1].second.size();
+                        if (immediateLevel < levels.size() && immediateSize + levelSize > immediateUploadSize) break;
+
+                        immediateSize += levelSize;
+                        --immediateLevel;
                     }
+                }
+
+                for (std::size_t level = 0; level < levels.size(); ++level)
+                {
+                    const auto levelWidth = static_cast<GLsizei>(levels[level].first.v[0]);
+                    const auto levelHeight = static_cast<GLsizei>(levels[level].first.v[1]);
+                    const void* data = (levels[level].second.empty() || level < immediateLevel) ? nullptr : levels[level].second.data();
+
+                    if (compressed)
+                        renderDevice.glCompressedTexImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), internalPixelFormat,
+                                                                levelWidth, levelHeight, 0,
+                                                                static_cast<GLsizei>(getLevelSize(sourcePixelFormat,
+                                                                                                  levels[level].first.v[0],
+                                                                                                  levels[level].first.v[1])),
+                                                                data);
+                    else
+                        renderDevice.glTexImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(internalPixelFormat),
+                                                      levelWidth, levelHeight, 0,
+                                                      pixelFormat, pixelType, data);
+                }
+
+                GLenum error;
+
+                if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                    throw std::system_error(makeErrorCode(error), "Failed to upload texture data");
+
+                if (immediateLevel > 0)
+                {
+                    baseLevel = static_cast<GLint>(immediateLevel);
+                    renderDevice.glTexParameteriProc(textureTarget, GL_TEXTURE_BASE_LEVEL, baseLevel);
+
+                    if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to set texture base level");
+
+                    // the smallest levels first
+                    for (std::size_t level = immediateLevel; level > 0; --level)
+                        queueUpload(static_cast<std::uint32_t>(level - 1));
+                }
+                else
+                    baseLevel = 0;
+            }
+
+            void Texture::queueUpload(std::uint32_t level)
+            {
+                if (pendingLevels[level]) return; // the queued upload reads the latest data
+
+                pendingLevels[level] = true;
+                renderDevice.queueTextureUpload(*this, level);
+            }
+
+            std::size_t Texture::uploadLevel(std::uint32_t level)
+            {
+                if (level >= levels.size()) return 0;
+
+                pendingLevels[level] = false;
+                const auto& data = levels[level].second;
+
+                if (!data.empty())
+                {
+                    renderDevice.bindTexture(textureTarget, 0, textureId);
+
+                    // levels that do not fit in the ring are uploaded from the client memory
+                    StreamBuffer* pixelStreamBuffer = renderDevice.getPixelStreamBuffer();
+                    StreamBuffer::Allocation allocation;
+                    const void* pixels = data.data();
+
+                    if (pixelStreamBuffer->write(data.data(), static_cast<GLsizeiptr>(data.size()), allocation))
+                    {
+                        renderDevice.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelStreamBuffer->getBufferId());
+                        pixels = reinterpret_cast<const void*>(pixelStreamBuffer->getOffset(allocation));
+                    }
+                    else
+                        renderDevice.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+                    if (compressed)
+                        renderDevice.glCompressedTexSubImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0,
+                                                                   static_cast<GLsizei>(levels[level].first.v[0]),
+                                                                   static_cast<GLsizei>(levels[level].first.v[1]),
+                                                                   internalPixelFormat,
+                                                                   static_cast<GLsizei>(data.size()),
+                                                                   pixels);
+                    else
+                        renderDevice.glTexSubImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0,
+                                                         static_cast<GLsizei>(levels[level].first.v[0]),
+                                                         static_cast<GLsizei>(levels[level].first.v[1]),
+                                                         pixelFormat, pixelType,
+                                                         pixels);
+
+                    // other uploads pass client memory
+                    renderDevice.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
                     GLenum error;
 
                     if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
                         throw std::system_error(makeErrorCode(error), "Failed to upload texture data");
+                }
 
-                    setTextureParameters();
+                if (static_cast<GLint>(level) < baseLevel)
+                {
+                    while (baseLevel > 0 && !pendingLevels[static_cast<std::size_t>(baseLevel - 1)]) --baseLevel;
+
+                    renderDevice.bindTexture(textureTarget, 0, textureId);
+                    renderDevice.glTexParameteriProc(textureTarget, GL_TEXTURE_BASE_LEVEL, baseLevel);
+
+                    GLenum error;
+
+                    if ((error = renderDevice.glGetErrorProc()) != GL_NO_ERROR)
+                        throw std::system_error(makeErrorCode(error), "Failed to set texture base level");
                 }
+
+                if (std::find(pendingLevels.begin(), pendingLevels.end(), true) == pendingLevels.end())
+                    uploadTokens.clear();
+
+                return data.size();
             }
 
-            void Texture::setData(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels)
+            void Texture::setData(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels,
+                                  std::shared_ptr<UploadToken> uploadToken)
             {
                 if (!(flags & Flags::Dynamic) || flags & Flags::BindRenderTarget)
                     throw std::runtime_error("Texture is not dynamic");
 
                 levels = newLevels;
+                pendingLevels.resize(levels.size());
 
                 if (!textureId)
                     throw std::runtime_error("Texture not initialized");
 
+                std::size_t dataSize = 0;
+                for (const auto& level : levels)
+                    dataSize += level.second.size();
+
+                // the old content is shown until the queued levels are uploaded
+                if (renderDevice.getPixelStreamBuffer() && dataSize > immediateUploadSize)
+                {
+                    for (std::size_t level = 0; level < levels.size(); ++level)
+                        if (!levels[level].second.empty())
+                            queueUpload(static_cast<std::uint32_t>(level));
+
+                    if (uploadToken) uploadTokens.push_back(std::move(uploadToken));
+                    return;
+                }
+
                 renderDevice.bindTexture(textureTarget, 0, textureId);
 
                 for (std::size_t level = 0; level < levels.size(); ++level)
                 {
-                    if (!levels[level].second.empty())
+                    if (levels[level].second.empty()) continue;
+
+                    if (compressed)
+                        renderDevice.glCompressedTexSubImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0,
+                                                                   static_cast<GLsizei>(levels[level].first.v[0]),
+                                                                   static_cast<GLsizei>(levels[level].first.v[1]),
+                                                                   internalPixelFormat,
+                                                                   static_cast<GLsizei>(levels[level].second.size()),
+                                                                   levels[level].second.data());
+                    else
                         renderDevice.glTexSubImage2DProc(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0,
                                                          static_cast<GLsizei>(levels[level].first.v[0]),
                                                          static_cast<GLsizei>(levels[level].first.v[1]),
@@ -4,7 +4,9 @@
 #define OUZEL_GRAPHICS_OGLTEXTURE_HPP
 
 #include <array>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "../../core/Setup.h"
 
@@ -33,6 +35,8 @@ namespace ouzel
 {
     namespace graphics
     {
+        struct UploadToken;
+
         namespace opengl
         {
             class RenderDevice;
@@ -45,12 +49,14 @@ namespace ouzel
                         TextureType type,
                         std::uint32_t initFlags = 0,
                         std::uint32_t initSampleCount = 1,
-                        PixelFormat initPixelFormat = PixelFormat::RGBA8UNorm);
+                        PixelFormat initPixelFormat = PixelFormat::RGBA8UNorm,
+                        std::shared_ptr<UploadToken> uploadToken = nullptr);
                 ~Texture() override;
 
                 void reload() final;
 
-                void setData(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels);
+                void setData(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels,
+                             std::shared_ptr<UploadToken> uploadToken = nullptr);
                 void setFilter(SamplerFilter newFilter);
                 void setAddressX(SamplerAddressMode newAddressX);
                 void setAddressY(SamplerAddressMode newAddressY);
@@ -74,9 +80,14 @@ namespace ouzel
 
                 inline auto getPixelFormat() const noexcept { return pixelFormat; }
 
+                // uploads a queued level through the pixel stream buffer and returns its size
+                std::size_t uploadLevel(std::uint32_t level);
+
             private:
                 void createTexture();
                 void setTextureParameters();
+                void uploadLevels();
+                void queueUpload(std::uint32_t level);
 
                 std::vector<std::pair<Size2U, std::vector<std::uint8_t>>> levels;
                 std::uint32_t flags = 0;
@@ -94,9 +105,15 @@ namespace ouzel
 
                 GLsizei width = 0;
                 GLsizei height = 0;
+                PixelFormat sourcePixelFormat = PixelFormat::Default;
+                bool compressed = false;
                 GLenum internalPixelFormat = GL_NONE;
                 GLenum pixelFormat = GL_NONE;
                 GLenum pixelType = GL_NONE;
+
+                std::vector<bool> pendingLevels; // levels that wait in the upload queue of the render device
+                GLint baseLevel = 0; // the largest level that has been uploaded together with all smaller ones
+                std::vector<std::shared_ptr<UploadToken>> uploadTokens; // released when no levels are pending
             };
         } // namespace opengl
     } // namespace graphics
@@ -295,6 +295,24 @@ namespace ouzel
 
                 if (glGenVertexArraysProc) glGenVertexArraysProc(1, &vertexArrayId);
 
+                if (vertexStreamBuffer) vertexStreamBuffer->reload();
+                if (indexStreamBuffer) indexStreamBuffer->reload();
+                if (pixelStreamBuffer)
+                {
+                    pixelStreamBuffer->reload();
+                    bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+
+                // the queries were deleted with the old context
+                freeQueries.clear();
+                timerQueries.clear();
+                openTimerQueries.clear();
+                pendingTimerQueries.clear();
+
+                // so were the pixel buffers and the fences of the frame captures
+                freeCaptureBuffers.clear();
+                pendingCaptures.clear();
+
                 for (const auto& resource : resources)
                     if (resource) resource->invalidate();
 
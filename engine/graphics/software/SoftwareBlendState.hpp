@@ -0,0 +1,58 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWAREBLENDSTATE_HPP
+#define OUZEL_GRAPHICS_SOFTWAREBLENDSTATE_HPP
+
+#include "SoftwareRenderResource.hpp"
+#include "../BlendFactor.hpp"
+#include "../BlendOperation.hpp"
+#include "../ColorMask.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            struct BlendDesc final
+            {
+                bool enabled = false;
+                BlendFactor colorBlendSource = BlendFactor::One;
+                BlendFactor colorBlendDest = BlendFactor::Zero;
+                BlendOperation colorOperation = BlendOperation::Add;
+                BlendFactor alphaBlendSource = BlendFactor::One;
+                BlendFactor alphaBlendDest = BlendFactor::Zero;
+                BlendOperation alphaOperation = BlendOperation::Add;
+                ColorMask colorMask = ColorMask::All;
+            };
+
+            class BlendState final: public RenderResource
+            {
+            public:
+                BlendState(RenderDevice& initRenderDevice,
+                           bool enableBlending,
+                           BlendFactor colorBlendSource,
+                           BlendFactor colorBlendDest,
+                           BlendOperation colorOperation,
+                           BlendFactor alphaBlendSource,
+                           BlendFactor alphaBlendDest,
+                           BlendOperation alphaOperation,
+                           ColorMask colorMask):
+                    RenderResource(initRenderDevice),
+                    desc{enableBlending,
+                        colorBlendSource, colorBlendDest, colorOperation,
+                        alphaBlendSource, alphaBlendDest, alphaOperation,
+                        colorMask}
+                {
+                }
+
+                inline auto& getDesc() const noexcept { return desc; }
+
+            private:
+                BlendDesc desc;
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWAREBLENDSTATE_HPP
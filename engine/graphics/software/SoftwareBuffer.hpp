@@ -0,0 +1,64 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWAREBUFFER_HPP
+#define OUZEL_GRAPHICS_SOFTWAREBUFFER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "SoftwareRenderResource.hpp"
+#include "../BufferType.hpp"
+#include "../Flags.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            class Buffer final: public RenderResource
+            {
+            public:
+                Buffer(RenderDevice& initRenderDevice,
+                       BufferType initType,
+                       std::uint32_t initFlags,
+                       const std::vector<std::uint8_t>& initData,
+                       std::uint32_t initSize):
+                    RenderResource(initRenderDevice),
+                    type(initType),
+                    flags(initFlags),
+                    data(initData)
+                {
+                    if (data.size() < initSize) data.resize(initSize);
+                }
+
+                void setData(const std::vector<std::uint8_t>& newData)
+                {
+                    if (!(flags & Flags::Dynamic))
+                        throw std::runtime_error("Buffer is not dynamic");
+
+                    if (newData.empty())
+                        throw std::runtime_error("Data is empty");
+
+                    if (newData.size() > data.size())
+                        data.resize(newData.size());
+
+                    std::copy(newData.begin(), newData.end(), data.begin());
+                }
+
+                inline auto getFlags() const noexcept { return flags; }
+                inline auto getType() const noexcept { return type; }
+                inline auto getSize() const noexcept { return static_cast<std::uint32_t>(data.size()); }
+                inline auto& getData() const noexcept { return data; }
+
+            private:
+                BufferType type;
+                std::uint32_t flags = 0;
+                std::vector<std::uint8_t> data;
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWAREBUFFER_HPP
@@ -0,0 +1,83 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWAREDEPTHSTENCILSTATE_HPP
+#define OUZEL_GRAPHICS_SOFTWAREDEPTHSTENCILSTATE_HPP
+
+#include <cstdint>
+#include "SoftwareRenderResource.hpp"
+#include "../CompareFunction.hpp"
+#include "../StencilOperation.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            struct StencilDesc final
+            {
+                StencilOperation failureOperation = StencilOperation::Keep;
+                StencilOperation depthFailureOperation = StencilOperation::Keep;
+                StencilOperation passOperation = StencilOperation::Keep;
+                CompareFunction compareFunction = CompareFunction::AlwaysPass;
+            };
+
+            // the default state has both the depth and the stencil test disabled
+            struct DepthStencilDesc final
+            {
+                bool depthTest = false;
+                bool depthWrite = false;
+                CompareFunction compareFunction = CompareFunction::AlwaysPass;
+                bool stencilEnabled = false;
+                std::uint8_t stencilReadMask = 0xFF;
+                std::uint8_t stencilWriteMask = 0xFF;
+                StencilDesc frontFaceStencil;
+                StencilDesc backFaceStencil;
+            };
+
+            class DepthStencilState final: public RenderResource
+            {
+            public:
+                DepthStencilState(RenderDevice& initRenderDevice,
+                                  bool initDepthTest,
+                                  bool initDepthWrite,
+                                  CompareFunction initCompareFunction,
+                                  bool initStencilEnabled,
+                                  std::uint32_t initStencilReadMask,
+                                  std::uint32_t initStencilWriteMask,
+                                  StencilOperation initFrontFaceStencilFailureOperation,
+                                  StencilOperation initFrontFaceStencilDepthFailureOperation,
+                                  StencilOperation initFrontFaceStencilPassOperation,
+                                  CompareFunction initFrontFaceStencilCompareFunction,
+                                  StencilOperation initBackFaceStencilFailureOperation,
+                                  StencilOperation initBackFaceStencilDepthFailureOperation,
+                                  StencilOperation initBackFaceStencilPassOperation,
+                                  CompareFunction initBackFaceStencilCompareFunction):
+                    RenderResource(initRenderDevice),
+                    desc{initDepthTest,
+                        initDepthWrite,
+                        initCompareFunction,
+                        initStencilEnabled,
+                        static_cast<std::uint8_t>(initStencilReadMask),
+                        static_cast<std::uint8_t>(initStencilWriteMask),
+                        StencilDesc{initFrontFaceStencilFailureOperation,
+                            initFrontFaceStencilDepthFailureOperation,
+                            initFrontFaceStencilPassOperation,
+                            initFrontFaceStencilCompareFunction},
+                        StencilDesc{initBackFaceStencilFailureOperation,
+                            initBackFaceStencilDepthFailureOperation,
+                            initBackFaceStencilPassOperation,
+                            initBackFaceStencilCompareFunction}}
+                {
+                }
+
+                inline auto& getDesc() const noexcept { return desc; }
+
+            private:
+                DepthStencilDesc desc;
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWAREDEPTHSTENCILSTATE_HPP
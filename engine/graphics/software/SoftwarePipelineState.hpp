@@ -0,0 +1,48 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWAREPIPELINESTATE_HPP
+#define OUZEL_GRAPHICS_SOFTWAREPIPELINESTATE_HPP
+
+#include <cstdint>
+#include "SoftwareRenderResource.hpp"
+#include "../RasterizerState.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            // the blend state and the shader are looked up when the state is set
+            class PipelineState final: public RenderResource
+            {
+            public:
+                PipelineState(RenderDevice& initRenderDevice,
+                              std::uintptr_t initBlendState,
+                              std::uintptr_t initShader,
+                              CullMode initCullMode,
+                              FillMode initFillMode):
+                    RenderResource(initRenderDevice),
+                    blendState(initBlendState),
+                    shader(initShader),
+                    cullMode(initCullMode),
+                    fillMode(initFillMode)
+                {
+                }
+
+                inline auto getBlendState() const noexcept { return blendState; }
+                inline auto getShader() const noexcept { return shader; }
+                inline auto getCullMode() const noexcept { return cullMode; }
+                inline auto getFillMode() const noexcept { return fillMode; }
+
+            private:
+                std::uintptr_t blendState = 0;
+                std::uintptr_t shader = 0;
+                CullMode cullMode = CullMode::NoCull;
+                FillMode fillMode = FillMode::Solid;
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWAREPIPELINESTATE_HPP
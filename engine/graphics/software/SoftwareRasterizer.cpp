@@ -0,0 +1,782 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#if defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+#include "SoftwareRasterizer.hpp"
+#include "../../math/MathUtils.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            namespace
+            {
+                constexpr std::size_t planeCount = 7;
+                constexpr std::size_t maxClipVertices = 3 + planeCount;
+
+                // screen coordinates stay within this many pixels from the origin, so that the edge functions
+                // of the pixels in a tile that an edge crosses fit into 32 bits
+                constexpr float maxCoordinate = 16384.0F;
+
+                inline float getPlaneDistance(std::size_t plane, const Vector4F& position,
+                                              float guardBandX, float guardBandY) noexcept
+                {
+                    switch (plane)
+                    {
+                        case 0: return position.v[2]; // near
+                        case 1: return position.v[3] - position.v[2]; // far
+                        case 2: return position.v[0] + guardBandX * position.v[3];
+                        case 3: return guardBandX * position.v[3] - position.v[0];
+                        case 4: return position.v[1] + guardBandY * position.v[3];
+                        case 5: return guardBandY * position.v[3] - position.v[1];
+                        default: return position.v[3] - 1e-6F; // keeps the perspective divide finite
+                    }
+                }
+
+                std::uint32_t getOutCode(const ClipVertex& vertex, float guardBandX, float guardBandY) noexcept
+                {
+                    std::uint32_t result = 0;
+                    for (std::size_t plane = 0; plane < planeCount; ++plane)
+                        if (!(getPlaneDistance(plane, vertex.position, guardBandX, guardBandY) >= 0.0F))
+                            result |= 1U << plane;
+                    return result;
+                }
+
+                ClipVertex interpolate(const ClipVertex& v0, const ClipVertex& v1, float t) noexcept
+                {
+                    ClipVertex result;
+                    for (std::size_t i = 0; i < 4; ++i)
+                    {
+                        result.position.v[i] = v0.position.v[i] + (v1.position.v[i] - v0.position.v[i]) * t;
+                        result.color[i] = v0.color[i] + (v1.color[i] - v0.color[i]) * t;
+                    }
+                    for (std::size_t i = 0; i < 2; ++i)
+                        result.texCoord[i] = v0.texCoord[i] + (v1.texCoord[i] - v0.texCoord[i]) * t;
+                    return result;
+                }
+
+                template <class T>
+                bool compare(CompareFunction compareFunction, T a, T b) noexcept
+                {
+                    switch (compareFunction)
+                    {
+                        case CompareFunction::NeverPass: return false;
+                        case CompareFunction::PassIfLess: return a < b;
+                        case CompareFunction::PassIfEqual: return a == b;
+                        case CompareFunction::PassIfLessEqual: return a <= b;
+                        case CompareFunction::PassIfGreater: return a > b;
+                        case CompareFunction::PassIfNotEqual: return a != b;
+                        case CompareFunction::PassIfGreaterEqual: return a >= b;
+                        case CompareFunction::AlwaysPass: return true;
+                        default: return false;
+                    }
+                }
+
+                void updateStencil(std::uint8_t& value, StencilOperation operation,
+                                   std::uint8_t reference, std::uint8_t writeMask) noexcept
+                {
+                    std::uint8_t result = value;
+
+                    switch (operation)
+                    {
+                        case StencilOperation::Keep: return;
+                        case StencilOperation::Zero: result = 0; break;
+                        case StencilOperation::Replace: result = reference; break;
+                        case StencilOperation::IncrementClamp: if (result < 255) ++result; break;
+                        case StencilOperation::DecrementClamp: if (result > 0) --result; break;
+                        case StencilOperation::Invert: result = static_cast<std::uint8_t>(~result); break;
+                        case StencilOperation::IncrementWrap: ++result; break;
+                        case StencilOperation::DecrementWrap: --result; break;
+                        default: return;
+                    }
+
+                    value = static_cast<std::uint8_t>((value & ~writeMask) | (result & writeMask));
+                }
+
+                // the blend factor constant is always white, like in the other render devices
+                float getBlendFactor(BlendFactor blendFactor, const float source[4],
+                                     const float destination[4], std::size_t channel) noexcept
+                {
+                    switch (blendFactor)
+                    {
+                        case BlendFactor::Zero: return 0.0F;
+                        case BlendFactor::One: return 1.0F;
+                        case BlendFactor::SrcColor: return source[channel];
+                        case BlendFactor::InvSrcColor: return 1.0F - source[channel];
+                        case BlendFactor::SrcAlpha: return source[3];
+                        case BlendFactor::InvSrcAlpha: return 1.0F - source[3];
+                        case BlendFactor::DestAlpha: return destination[3];
+                        case BlendFactor::InvDestAlpha: return 1.0F - destination[3];
+                        case BlendFactor::DestColor: return destination[channel];
+                        case BlendFactor::InvDestColor: return 1.0F - destination[channel];
+                        case BlendFactor::SrcAlphaSat: return (channel == 3) ? 1.0F : std::min(source[3], 1.0F - destination[3]);
+                        case BlendFactor::BlendFactor: return 1.0F;
+                        case BlendFactor::InvBlendFactor: return 0.0F;
+                        default: return 0.0F;
+                    }
+                }
+
+                float blend(BlendOperation operation, float source, float destination) noexcept
+                {
+                    switch (operation)
+                    {
+                        case BlendOperation::Add: return source + destination;
+                        case BlendOperation::Subtract: return source - destination;
+                        case BlendOperation::RevSubtract: return destination - source;
+                        case BlendOperation::Min: return std::min(source, destination);
+                        case BlendOperation::Max: return std::max(source, destination);
+                        default: return source;
+                    }
+                }
+
+                constexpr std::uint32_t getWriteMask(ColorMask colorMask) noexcept
+                {
+                    return ((colorMask & ColorMask::Red) == ColorMask::Red ? 0x000000FFU : 0U) |
+                        ((colorMask & ColorMask::Green) == ColorMask::Green ? 0x0000FF00U : 0U) |
+                        ((colorMask & ColorMask::Blue) == ColorMask::Blue ? 0x00FF0000U : 0U) |
+                        ((colorMask & ColorMask::Alpha) == ColorMask::Alpha ? 0xFF000000U : 0U);
+                }
+
+                // bit i is set if the pixel i of the four is inside all the edges
+                inline std::uint32_t getCoverageMask(const std::int32_t values[3], const std::int32_t steps[3]) noexcept
+                {
+#if defined(__ARM_NEON__) || defined(__SSE2__)
+                    if (isSimdAvailable)
+                    {
+#  if defined(__ARM_NEON__)
+                        static const std::int32_t laneData[4] = {0, 1, 2, 3};
+                        const int32x4_t lanes = vld1q_s32(laneData);
+
+                        int32x4_t any = vmlaq_n_s32(vdupq_n_s32(values[0]), lanes, steps[0]);
+                        any = vorrq_s32(any, vmlaq_n_s32(vdupq_n_s32(values[1]), lanes, steps[1]));
+                        any = vorrq_s32(any, vmlaq_n_s32(vdupq_n_s32(values[2]), lanes, steps[2]));
+
+                        const uint32x4_t negative = vshrq_n_u32(vreinterpretq_u32_s32(any), 31);
+                        return ~(vgetq_lane_u32(negative, 0) |
+                                 (vgetq_lane_u32(negative, 1) << 1) |
+                                 (vgetq_lane_u32(negative, 2) << 2) |
+                                 (vgetq_lane_u32(negative, 3) << 3)) & 0x0F;
+#  else
+                        __m128i any = _mm_add_epi32(_mm_set1_epi32(values[0]),
+                                                    _mm_set_epi32(steps[0] * 3, steps[0] * 2, steps[0], 0));
+                        any = _mm_or_si128(any, _mm_add_epi32(_mm_set1_epi32(values[1]),
+                                                              _mm_set_epi32(steps[1] * 3, steps[1] * 2, steps[1], 0)));
+                        any = _mm_or_si128(any, _mm_add_epi32(_mm_set1_epi32(values[2]),
+                                                              _mm_set_epi32(steps[2] * 3, steps[2] * 2, steps[2], 0)));
+
+                        // the sign bit of a lane is set if any of the edge functions is negative
+                        return ~static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(any))) & 0x0F;
+#  endif
+                    }
+#endif
+
+                    std::uint32_t result = 0;
+                    for (std::int32_t i = 0; i < 4; ++i)
+                        if (((values[0] + steps[0] * i) | (values[1] + steps[1] * i) | (values[2] + steps[2] * i)) >= 0)
+                            result |= 1U << i;
+                    return result;
+                }
+            }
+
+            Rasterizer::Rasterizer()
+            {
+#if !defined(__EMSCRIPTEN__)
+                // the render thread rasterizes too
+                const std::size_t hardwareThreads = std::thread::hardware_concurrency();
+                if (hardwareThreads > 1) maxWorkerThreads = std::min(hardwareThreads - 1, std::size_t{7});
+#endif
+
+                drawStates.emplace_back();
+            }
+
+            Rasterizer::~Rasterizer()
+            {
+                std::unique_lock<std::mutex> lock(workerMutex);
+                workerRunning = false;
+                lock.unlock();
+                workerCondition.notify_all();
+
+                workerThreads.clear(); // joins the threads
+            }
+
+            void Rasterizer::setSurface(const Surface& newSurface)
+            {
+                flush();
+
+                surface = newSurface;
+                tileCountX = (surface.width + tileSize - 1) / tileSize;
+                tileCountY = (surface.height + tileSize - 1) / tileSize;
+                bins.resize(tileCountX * tileCountY);
+            }
+
+            void Rasterizer::clear(bool clearColor, std::uint32_t color,
+                                   bool clearDepth, float depth,
+                                   bool clearStencil, std::uint8_t stencil)
+            {
+                flush();
+
+                const std::size_t pixelCount = surface.width * surface.height;
+
+                if (clearColor && surface.color)
+                    std::fill(surface.color, surface.color + pixelCount, color);
+                if (clearDepth && surface.depth)
+                    std::fill(surface.depth, surface.depth + pixelCount, depth);
+                if (clearStencil && surface.stencil)
+                    std::fill(surface.stencil, surface.stencil + pixelCount, stencil);
+            }
+
+            void Rasterizer::setDrawState(const DrawState& drawState)
+            {
+                drawStates.push_back(drawState);
+
+                const float halfWidth = drawState.viewport.size.v[0] / 2.0F;
+                const float halfHeight = drawState.viewport.size.v[1] / 2.0F;
+                const float centerX = drawState.viewport.position.v[0] + halfWidth;
+                const float centerY = drawState.viewport.position.v[1] + halfHeight;
+
+                guardBandX = (halfWidth > 0.0F) ? std::max((maxCoordinate - std::fabs(centerX)) / halfWidth, 1.0F) : 1.0F;
+                guardBandY = (halfHeight > 0.0F) ? std::max((maxCoordinate - std::fabs(centerY)) / halfHeight, 1.0F) : 1.0F;
+            }
+
+            void Rasterizer::drawTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+            {
+                const DrawState& drawState = drawStates.back();
+                if (drawState.minX >= drawState.maxX || drawState.minY >= drawState.maxY) return;
+
+                ClipVertex polygon[maxClipVertices] = {v0, v1, v2};
+                const std::size_t count = clipPolygon(polygon, 3);
+                if (count < 3) return;
+
+                ScreenVertex screenVertices[maxClipVertices];
+                float area = 0.0F;
+                for (std::size_t i = 0; i < count; ++i)
+                    screenVertices[i] = project(polygon[i]);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    const ScreenVertex& current = screenVertices[i];
+                    const ScreenVertex& next = screenVertices[(i + 1) % count];
+                    area += current.x * next.y - next.x * current.y;
+                }
+
+                // clockwise triangles face the viewer, like with Direct3D
+                const bool frontFacing = area > 0.0F;
+                if (area == 0.0F ||
+                    (drawState.cullMode == CullMode::Back && !frontFacing) ||
+                    (drawState.cullMode == CullMode::Front && frontFacing))
+                    return;
+
+                if (drawState.fillMode == FillMode::Wireframe)
+                {
+                    for (std::size_t i = 0; i < count; ++i)
+                        addLine(screenVertices[i], screenVertices[(i + 1) % count]);
+                }
+                else
+                {
+                    for (std::size_t i = 1; i + 1 < count; ++i)
+                        addTriangle(screenVertices[0], screenVertices[i], screenVertices[i + 1], frontFacing);
+                }
+            }
+
+            void Rasterizer::drawLine(const ClipVertex& v0, const ClipVertex& v1)
+            {
+                const DrawState& drawState = drawStates.back();
+                if (drawState.minX >= drawState.maxX || drawState.minY >= drawState.maxY) return;
+
+                float start = 0.0F;
+                float end = 1.0F;
+
+                for (std::size_t plane = 0; plane < planeCount; ++plane)
+                {
+                    const float d0 = getPlaneDistance(plane, v0.position, guardBandX, guardBandY);
+                    const float d1 = getPlaneDistance(plane, v1.position, guardBandX, guardBandY);
+
+                    if (d0 < 0.0F && d1 < 0.0F) return;
+                    if (d0 < 0.0F) start = std::max(start, d0 / (d0 - d1));
+                    else if (d1 < 0.0F) end = std::min(end, d0 / (d0 - d1));
+                }
+
+                if (start > end) return;
+
+                addLine(project(start > 0.0F ? interpolate(v0, v1, start) : v0),
+                        project(end < 1.0F ? interpolate(v0, v1, end) : v1));
+            }
+
+            void Rasterizer::drawPoint(const ClipVertex& v)
+            {
+                const DrawState& drawState = drawStates.back();
+                if (drawState.minX >= drawState.maxX || drawState.minY >= drawState.maxY) return;
+
+                if (getOutCode(v, guardBandX, guardBandY)) return;
+
+                // a square of one pixel
+                const ScreenVertex center = project(v);
+                ScreenVertex corners[4] = {center, center, center, center};
+                corners[0].x -= 0.5F; corners[0].y -= 0.5F;
+                corners[1].x += 0.5F; corners[1].y -= 0.5F;
+                corners[2].x += 0.5F; corners[2].y += 0.5F;
+                corners[3].x -= 0.5F; corners[3].y += 0.5F;
+
+                addTriangle(corners[0], corners[1], corners[2], true);
+                addTriangle(corners[0], corners[2], corners[3], true);
+            }
+
+            void Rasterizer::flush()
+            {
+                if (!activeTiles.empty())
+                {
+                    nextTile = 0;
+
+                    if (activeTiles.size() > 1 && maxWorkerThreads)
+                    {
+                        if (workerThreads.empty())
+                            for (std::size_t i = 0; i < maxWorkerThreads; ++i)
+                                workerThreads.emplace_back(&Rasterizer::workerLoop, this);
+
+                        std::unique_lock<std::mutex> lock(workerMutex);
+                        pendingWorkers = workerThreads.size();
+                        ++workGeneration;
+                        lock.unlock();
+                        workerCondition.notify_all();
+
+                        rasterizeTiles();
+
+                        lock.lock();
+                        while (pendingWorkers) workerDoneCondition.wait(lock);
+                    }
+                    else
+                        rasterizeTiles();
+
+                    for (const std::size_t tile : activeTiles)
+                        bins[tile].clear();
+                    activeTiles.clear();
+                }
+
+                triangles.clear();
+
+                // the following primitives still use the current state
+                if (drawStates.size() > 1)
+                {
+                    drawStates.front() = drawStates.back();
+                    drawStates.resize(1);
+                }
+            }
+
+            std::size_t Rasterizer::clipPolygon(ClipVertex* vertices, std::size_t count) const
+            {
+                std::uint32_t outCodes[maxClipVertices];
+                std::uint32_t anyOutside = 0;
+                std::uint32_t allOutside = ~0U;
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    outCodes[i] = getOutCode(vertices[i], guardBandX, guardBandY);
+                    anyOutside |= outCodes[i];
+                    allOutside &= outCodes[i];
+                }
+
+                if (allOutside) return 0;
+                if (!anyOutside) return count;
+
+                // Sutherland-Hodgman against the planes that any of the vertices is outside of
+                ClipVertex buffer[maxClipVertices];
+                ClipVertex* input = vertices;
+                ClipVertex* output = buffer;
+
+                for (std::size_t plane = 0; plane < planeCount && count >= 3; ++plane)
+                {
+                    if (!(anyOutside & (1U << plane))) continue;
+
+                    std::size_t outputCount = 0;
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        const ClipVertex& current = input[i];
+                        const ClipVertex& next = input[(i + 1) % count];
+                        const float d0 = getPlaneDistance(plane, current.position, guardBandX, guardBandY);
+                        const float d1 = getPlaneDistance(plane, next.position, guardBandX, guardBandY);
+
+                        if (d0 >= 0.0F) output[outputCount++] = current;
+                        if ((d0 >= 0.0F) != (d1 >= 0.0F))
+                            output[outputCount++] = interpolate(current, next, d0 / (d0 - d1));
+                    }
+
+                    count = outputCount;
+                    std::swap(input, output);
+                }
+
+                if (input != vertices)
+                    std::copy(input, input + count, vertices);
+
+                return count;
+            }
+
+            Rasterizer::ScreenVertex Rasterizer::project(const ClipVertex& vertex) const
+            {
+                const RectF& viewport = drawStates.back().viewport;
+                const float invW = 1.0F / vertex.position.v[3];
+
+                // the origin is at the top left corner of the viewport
+                ScreenVertex result;
+                result.x = viewport.position.v[0] + (vertex.position.v[0] * invW + 1.0F) * viewport.size.v[0] / 2.0F;
+                result.y = viewport.position.v[1] + (1.0F - vertex.position.v[1] * invW) * viewport.size.v[1] / 2.0F;
+                result.z = vertex.position.v[2] * invW;
+                result.invW = invW;
+                for (std::size_t i = 0; i < 4; ++i)
+                    result.attributes[i] = vertex.color[i] * invW;
+                for (std::size_t i = 0; i < 2; ++i)
+                    result.attributes[4 + i] = vertex.texCoord[i] * invW;
+                return result;
+            }
+
+            void Rasterizer::addLine(const ScreenVertex& v0, const ScreenVertex& v1)
+            {
+                // a quad that is one pixel wide across the major axis
+                const bool xMajor = std::fabs(v1.x - v0.x) >= std::fabs(v1.y - v0.y);
+                const float offsetX = xMajor ? 0.0F : 0.5F;
+                const float offsetY = xMajor ? 0.5F : 0.0F;
+
+                ScreenVertex corners[4] = {v0, v0, v1, v1};
+                corners[0].x -= offsetX; corners[0].y -= offsetY;
+                corners[1].x += offsetX; corners[1].y += offsetY;
+                corners[2].x += offsetX; corners[2].y += offsetY;
+                corners[3].x -= offsetX; corners[3].y -= offsetY;
+
+                addTriangle(corners[0], corners[1], corners[2], true);
+                addTriangle(corners[0], corners[2], corners[3], true);
+            }
+
+            void Rasterizer::addTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2,
+                                         bool frontFacing)
+            {
+                if (triangles.size() >= maxTriangles) flush();
+
+                const ScreenVertex* vertices[3] = {&v0, &v1, &v2};
+                std::int32_t x[3];
+                std::int32_t y[3];
+
+                for (std::size_t i = 0; i < 3; ++i)
+                {
+                    // the clipping keeps the coordinates in range, unless the viewport itself is out of it
+                    if (!(std::fabs(vertices[i]->x) <= maxCoordinate * 2.0F) ||
+                        !(std::fabs(vertices[i]->y) <= maxCoordinate * 2.0F))
+                        return;
+
+                    x[i] = static_cast<std::int32_t>(std::lround(vertices[i]->x * (1 << subpixelBits)));
+                    y[i] = static_cast<std::int32_t>(std::lround(vertices[i]->y * (1 << subpixelBits)));
+                }
+
+                std::int64_t area = static_cast<std::int64_t>(x[1] - x[0]) * (y[2] - y[0]) -
+                    static_cast<std::int64_t>(x[2] - x[0]) * (y[1] - y[0]);
+                if (area == 0) return;
+
+                // the edge functions are positive inside of clockwise triangles
+                if (area < 0)
+                {
+                    std::swap(vertices[1], vertices[2]);
+                    std::swap(x[1], x[2]);
+                    std::swap(y[1], y[2]);
+                    area = -area;
+                }
+
+                const auto drawStateIndex = static_cast<std::uint32_t>(drawStates.size() - 1);
+                const DrawState& drawState = drawStates.back();
+
+                // pixels whose centers are within the bounds of the vertices
+                constexpr float subpixels = 1 << subpixelBits;
+                const float minX = static_cast<float>(std::min({x[0], x[1], x[2]})) / subpixels;
+                const float maxX = static_cast<float>(std::max({x[0], x[1], x[2]})) / subpixels;
+                const float minY = static_cast<float>(std::min({y[0], y[1], y[2]})) / subpixels;
+                const float maxY = static_cast<float>(std::max({y[0], y[1], y[2]})) / subpixels;
+
+                Triangle triangle;
+                triangle.minX = std::max(drawState.minX, static_cast<std::int32_t>(std::ceil(minX - 0.5F)));
+                triangle.maxX = std::min(drawState.maxX, static_cast<std::int32_t>(std::floor(maxX - 0.5F)) + 1);
+                triangle.minY = std::max(drawState.minY, static_cast<std::int32_t>(std::ceil(minY - 0.5F)));
+                triangle.maxY = std::min(drawState.maxY, static_cast<std::int32_t>(std::floor(maxY - 0.5F)) + 1);
+
+                if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) return;
+
+                // edge k is opposite to vertex k
+                for (std::size_t k = 0; k < 3; ++k)
+                {
+                    const std::size_t start = (k + 1) % 3;
+                    const std::size_t end = (k + 2) % 3;
+                    const std::int32_t deltaX = x[end] - x[start];
+                    const std::int32_t deltaY = y[end] - y[start];
+
+                    triangle.a[k] = -deltaY;
+                    triangle.b[k] = deltaX;
+                    triangle.c[k] = static_cast<std::int64_t>(deltaY) * x[start] - static_cast<std::int64_t>(deltaX) * y[start];
+
+                    // top-left fill rule, pixels on the other edges are left out
+                    const bool topLeft = deltaY < 0 || (deltaY == 0 && deltaX > 0);
+                    if (!topLeft) --triangle.c[k];
+                }
+
+                // the interpolants are planes relative to the first vertex
+                triangle.originX = static_cast<float>(x[0]) / subpixels;
+                triangle.originY = static_cast<float>(y[0]) / subpixels;
+
+                const float deltaX1 = static_cast<float>(x[1] - x[0]) / subpixels;
+                const float deltaY1 = static_cast<float>(y[1] - y[0]) / subpixels;
+                const float deltaX2 = static_cast<float>(x[2] - x[0]) / subpixels;
+                const float deltaY2 = static_cast<float>(y[2] - y[0]) / subpixels;
+                const float determinant = deltaX1 * deltaY2 - deltaX2 * deltaY1;
+
+                for (std::size_t i = 0; i < interpolantCount; ++i)
+                {
+                    float values[3];
+                    for (std::size_t v = 0; v < 3; ++v)
+                    {
+                        if (i == 0) values[v] = vertices[v]->z;
+                        else if (i == 1) values[v] = vertices[v]->invW;
+                        else values[v] = vertices[v]->attributes[i - 2];
+                    }
+
+                    const float delta1 = values[1] - values[0];
+                    const float delta2 = values[2] - values[0];
+                    triangle.interpolants[i] = values[0];
+                    triangle.gradientsX[i] = (delta1 * deltaY2 - delta2 * deltaY1) / determinant;
+                    triangle.gradientsY[i] = (delta2 * deltaX1 - delta1 * deltaX2) / determinant;
+                }
+
+                // one level of detail for the whole triangle, from the ratio of its texel and pixel areas
+                triangle.lod = 0.0F;
+                if (drawState.texture)
+                {
+                    float u[3];
+                    float v[3];
+                    for (std::size_t i = 0; i < 3; ++i)
+                    {
+                        u[i] = vertices[i]->attributes[4] / vertices[i]->invW;
+                        v[i] = vertices[i]->attributes[5] / vertices[i]->invW;
+                    }
+
+                    const float texelArea = std::fabs((u[1] - u[0]) * (v[2] - v[0]) - (u[2] - u[0]) * (v[1] - v[0])) *
+                        static_cast<float>(drawState.texture->getWidth()) * static_cast<float>(drawState.texture->getHeight());
+
+                    if (texelArea > 0.0F)
+                        triangle.lod = 0.5F * std::log2(texelArea / determinant);
+                }
+
+                triangle.drawState = drawStateIndex;
+                triangle.frontFacing = frontFacing;
+
+                const auto triangleIndex = static_cast<std::uint32_t>(triangles.size());
+                triangles.push_back(triangle);
+
+                const auto lastTileX = static_cast<std::size_t>(triangle.maxX - 1) >> tileSizeBits;
+                const auto lastTileY = static_cast<std::size_t>(triangle.maxY - 1) >> tileSizeBits;
+
+                for (auto tileY = static_cast<std::size_t>(triangle.minY) >> tileSizeBits; tileY <= lastTileY; ++tileY)
+                    for (auto tileX = static_cast<std::size_t>(triangle.minX) >> tileSizeBits; tileX <= lastTileX; ++tileX)
+                    {
+                        const std::size_t tile = tileY * tileCountX + tileX;
+                        if (bins[tile].empty()) activeTiles.push_back(tile);
+                        bins[tile].push_back(triangleIndex);
+                    }
+            }
+
+            void Rasterizer::rasterizeTiles()
+            {
+                for (std::size_t i = nextTile++; i < activeTiles.size(); i = nextTile++)
+                    rasterizeTile(activeTiles[i]);
+            }
+
+            void Rasterizer::rasterizeTile(std::size_t tile)
+            {
+                const auto tileX = static_cast<std::int32_t>((tile % tileCountX) << tileSizeBits);
+                const auto tileY = static_cast<std::int32_t>((tile / tileCountX) << tileSizeBits);
+
+                for (const std::uint32_t triangleIndex : bins[tile])
+                {
+                    const Triangle& triangle = triangles[triangleIndex];
+                    const DrawState& drawState = drawStates[triangle.drawState];
+
+                    const std::int32_t startX = std::max(tileX, triangle.minX);
+                    const std::int32_t endX = std::min(tileX + tileSize, triangle.maxX);
+                    const std::int32_t startY = std::max(tileY, triangle.minY);
+                    const std::int32_t endY = std::min(tileY + tileSize, triangle.maxY);
+
+                    // Edges that the region is completely inside of are left out of the per-pixel test.
+                    // The others cross the region, so their values within it fit into 32 bits.
+                    std::int32_t rowValues[3];
+                    std::int32_t stepsX[3];
+                    std::int32_t stepsY[3];
+                    bool outside = false;
+
+                    for (std::size_t k = 0; k < 3 && !outside; ++k)
+                    {
+                        const std::int64_t stepX = static_cast<std::int64_t>(triangle.a[k]) * (std::int64_t{1} << subpixelBits);
+                        const std::int64_t stepY = static_cast<std::int64_t>(triangle.b[k]) * (std::int64_t{1} << subpixelBits);
+                        const std::int64_t origin = static_cast<std::int64_t>(triangle.a[k]) * ((static_cast<std::int64_t>(startX) << subpixelBits) + (1 << (subpixelBits - 1))) +
+                            static_cast<std::int64_t>(triangle.b[k]) * ((static_cast<std::int64_t>(startY) << subpixelBits) + (1 << (subpixelBits - 1))) +
+                            triangle.c[k];
+                        const std::int64_t spanX = stepX * (endX - 1 - startX);
+                        const std::int64_t spanY = stepY * (endY - 1 - startY);
+
+                        const std::int64_t minValue = origin + std::min(spanX, std::int64_t{0}) + std::min(spanY, std::int64_t{0});
+                        const std::int64_t maxValue = origin + std::max(spanX, std::int64_t{0}) + std::max(spanY, std::int64_t{0});
+
+                        if (maxValue < 0)
+                            outside = true;
+                        else if (minValue >= 0)
+                        {
+                            rowValues[k] = 0;
+                            stepsX[k] = 0;
+                            stepsY[k] = 0;
+                        }
+                        else
+                        {
+                            rowValues[k] = static_cast<std::int32_t>(origin);
+                            stepsX[k] = static_cast<std::int32_t>(stepX);
+                            stepsY[k] = static_cast<std::int32_t>(stepY);
+                        }
+                    }
+
+                    if (outside) continue;
+
+                    for (std::int32_t y = startY; y < endY; ++y)
+                    {
+                        std::int32_t values[3] = {rowValues[0], rowValues[1], rowValues[2]};
+
+                        for (std::int32_t x = startX; x < endX; x += 4)
+                        {
+                            std::uint32_t mask = getCoverageMask(values, stepsX);
+                            if (endX - x < 4) mask &= (1U << (endX - x)) - 1;
+
+                            for (std::int32_t i = 0; mask; ++i, mask >>= 1)
+                                if (mask & 1) shadePixel(triangle, drawState, x + i, y);
+
+                            for (std::size_t k = 0; k < 3; ++k)
+                                values[k] += stepsX[k] * 4;
+                        }
+
+                        for (std::size_t k = 0; k < 3; ++k)
+                            rowValues[k] += stepsY[k];
+                    }
+                }
+            }
+
+            void Rasterizer::shadePixel(const Triangle& triangle, const DrawState& drawState,
+                                        std::int32_t x, std::int32_t y) const
+            {
+                const float offsetX = static_cast<float>(x) + 0.5F - triangle.originX;
+                const float offsetY = static_cast<float>(y) + 0.5F - triangle.originY;
+                const auto interpolate = [&triangle, offsetX, offsetY](std::size_t i) noexcept {
+                    return triangle.interpolants[i] + triangle.gradientsX[i] * offsetX + triangle.gradientsY[i] * offsetY;
+                };
+
+                const std::size_t index = static_cast<std::size_t>(y) * surface.width + static_cast<std::size_t>(x);
+                const DepthStencilDesc& depthStencilDesc = drawState.depthStencilDesc;
+                const float z = std::min(std::max(interpolate(0), 0.0F), 1.0F);
+
+                const bool depthTest = depthStencilDesc.depthTest && surface.depth;
+                const bool depthPassed = !depthTest || compare(depthStencilDesc.compareFunction, z, surface.depth[index]);
+
+                if (depthStencilDesc.stencilEnabled && surface.stencil)
+                {
+                    const StencilDesc& stencilDesc = triangle.frontFacing ?
+                        depthStencilDesc.frontFaceStencil : depthStencilDesc.backFaceStencil;
+                    std::uint8_t& stencilValue = surface.stencil[index];
+
+                    if (!compare(stencilDesc.compareFunction,
+                                 static_cast<std::uint8_t>(drawState.stencilReference & depthStencilDesc.stencilReadMask),
+                                 static_cast<std::uint8_t>(stencilValue & depthStencilDesc.stencilReadMask)))
+                    {
+                        updateStencil(stencilValue, stencilDesc.failureOperation,
+                                      drawState.stencilReference, depthStencilDesc.stencilWriteMask);
+                        return;
+                    }
+
+                    updateStencil(stencilValue, depthPassed ? stencilDesc.passOperation : stencilDesc.depthFailureOperation,
+                                  drawState.stencilReference, depthStencilDesc.stencilWriteMask);
+                }
+
+                if (!depthPassed) return;
+                if (depthTest && depthStencilDesc.depthWrite) surface.depth[index] = z;
+
+                if (!surface.color) return;
+
+                // the built-in shaders: vertex color * color constant (* texture)
+                const float w = 1.0F / interpolate(1);
+                float color[4];
+                for (std::size_t c = 0; c < 4; ++c)
+                    color[c] = interpolate(2 + c) * w * drawState.color[c];
+
+                if (drawState.texture)
+                {
+                    float texel[4];
+                    drawState.texture->sample(interpolate(6) * w, interpolate(7) * w, triangle.lod, texel);
+                    for (std::size_t c = 0; c < 4; ++c)
+                        color[c] *= texel[c];
+                }
+
+                for (float& channel : color)
+                    channel = std::min(std::max(channel, 0.0F), 1.0F);
+
+                std::uint32_t& pixel = surface.color[index];
+                const BlendDesc& blendDesc = drawState.blendDesc;
+
+                if (blendDesc.enabled)
+                {
+                    float destination[4];
+                    for (std::size_t c = 0; c < 4; ++c)
+                        destination[c] = static_cast<float>((pixel >> (c * 8)) & 0xFF) / 255.0F;
+
+                    float result[4];
+                    for (std::size_t c = 0; c < 3; ++c)
+                        result[c] = blend(blendDesc.colorOperation,
+                                          color[c] * getBlendFactor(blendDesc.colorBlendSource, color, destination, c),
+                                          destination[c] * getBlendFactor(blendDesc.colorBlendDest, color, destination, c));
+                    result[3] = blend(blendDesc.alphaOperation,
+                                      color[3] * getBlendFactor(blendDesc.alphaBlendSource, color, destination, 3),
+                                      destination[3] * getBlendFactor(blendDesc.alphaBlendDest, color, destination, 3));
+
+                    for (std::size_t c = 0; c < 4; ++c)
+                        color[c] = std::min(std::max(result[c], 0.0F), 1.0F);
+                }
+
+                std::uint32_t packed = 0;
+                for (std::size_t c = 0; c < 4; ++c)
+                    packed |= static_cast<std::uint32_t>(color[c] * 255.0F + 0.5F) << (c * 8);
+
+                const std::uint32_t writeMask = getWriteMask(blendDesc.colorMask);
+                pixel = (pixel & ~writeMask) | (packed & writeMask);
+            }
+
+            void Rasterizer::workerLoop()
+            {
+                Thread::setCurrentThreadName("Rasterizer");
+
+                std::uint64_t generation = 0;
+
+                for (;;)
+                {
+                    std::unique_lock<std::mutex> lock(workerMutex);
+                    while (workerRunning && workGeneration == generation) workerCondition.wait(lock);
+                    if (!workerRunning) return;
+
+                    generation = workGeneration;
+                    lock.unlock();
+
+                    rasterizeTiles();
+
+                    lock.lock();
+                    if (--pendingWorkers == 0)
+                    {
+                        lock.unlock();
+                        workerDoneCondition.notify_all();
+                    }
+                }
+            }
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
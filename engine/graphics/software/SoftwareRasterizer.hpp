@@ -0,0 +1,172 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWARERASTERIZER_HPP
+#define OUZEL_GRAPHICS_SOFTWARERASTERIZER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "SoftwareBlendState.hpp"
+#include "SoftwareDepthStencilState.hpp"
+#include "SoftwareTexture.hpp"
+#include "../RasterizerState.hpp"
+#include "../../math/Rect.hpp"
+#include "../../math/Vector.hpp"
+#include "../../utils/Thread.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            // color is RGBA8 with red in the lowest byte, the depth and the stencil buffers are optional
+            struct Surface final
+            {
+                std::uint32_t width = 0;
+                std::uint32_t height = 0;
+                std::uint32_t* color = nullptr;
+                float* depth = nullptr;
+                std::uint8_t* stencil = nullptr;
+            };
+
+            // output of the vertex shader
+            struct ClipVertex final
+            {
+                Vector4F position;
+                float color[4];
+                float texCoord[2];
+            };
+
+            // everything that the pixels of a draw call depend on, copied, because the states
+            // can change before the binned triangles are rasterized
+            struct DrawState final
+            {
+                BlendDesc blendDesc;
+                DepthStencilDesc depthStencilDesc;
+                std::uint8_t stencilReference = 0;
+                const Texture* texture = nullptr; // not set for the color shader
+                float color[4]{1.0F, 1.0F, 1.0F, 1.0F};
+                CullMode cullMode = CullMode::NoCull;
+                FillMode fillMode = FillMode::Solid;
+                RectF viewport;
+                // pixels that can be written, the intersection of the viewport, the scissor rectangle and the surface
+                std::int32_t minX = 0;
+                std::int32_t minY = 0;
+                std::int32_t maxX = 0;
+                std::int32_t maxY = 0;
+            };
+
+            // Clips the primitives, sets up the triangles and bins them to 64x64 pixel tiles. The tiles are
+            // rasterized in parallel when the rasterizer is flushed, each by a single thread, so the
+            // triangles of a tile are drawn in the order they were submitted. Coverage is tested with
+            // fixed point edge functions four pixels at a time.
+            class Rasterizer final
+            {
+            public:
+                Rasterizer();
+                ~Rasterizer();
+
+                Rasterizer(const Rasterizer&) = delete;
+                Rasterizer& operator=(const Rasterizer&) = delete;
+                Rasterizer(Rasterizer&&) = delete;
+                Rasterizer& operator=(Rasterizer&&) = delete;
+
+                void setSurface(const Surface& newSurface);
+                inline auto& getSurface() const noexcept { return surface; }
+
+                // clears the whole surface, ignoring the scissor rectangle
+                void clear(bool clearColor, std::uint32_t color,
+                           bool clearDepth, float depth,
+                           bool clearStencil, std::uint8_t stencil);
+
+                // the state of the following primitives
+                void setDrawState(const DrawState& drawState);
+
+                void drawTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+                void drawLine(const ClipVertex& v0, const ClipVertex& v1);
+                void drawPoint(const ClipVertex& v);
+
+                // rasterizes the binned triangles
+                void flush();
+
+            private:
+                static constexpr std::int32_t tileSizeBits = 6;
+                static constexpr std::int32_t tileSize = 1 << tileSizeBits;
+                static constexpr std::int32_t subpixelBits = 4;
+                static constexpr std::size_t maxTriangles = 65536;
+
+                // perspective divided vertex in pixels, the attributes are divided by w
+                struct ScreenVertex final
+                {
+                    float x;
+                    float y;
+                    float z;
+                    float invW;
+                    float attributes[6]; // color and texture coordinates
+                };
+
+                // z, 1/w and the attributes as planes over the screen
+                static constexpr std::size_t interpolantCount = 8;
+
+                struct Triangle final
+                {
+                    std::int32_t a[3]; // edge function x coefficients
+                    std::int32_t b[3]; // edge function y coefficients
+                    std::int64_t c[3];
+                    std::int32_t minX;
+                    std::int32_t minY;
+                    std::int32_t maxX; // exclusive
+                    std::int32_t maxY; // exclusive
+                    float originX;
+                    float originY;
+                    float interpolants[interpolantCount];
+                    float gradientsX[interpolantCount];
+                    float gradientsY[interpolantCount];
+                    float lod;
+                    std::uint32_t drawState;
+                    bool frontFacing;
+                };
+
+                std::size_t clipPolygon(ClipVertex* vertices, std::size_t count) const;
+                ScreenVertex project(const ClipVertex& vertex) const;
+                void addLine(const ScreenVertex& v0, const ScreenVertex& v1);
+                void addTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2,
+                                 bool frontFacing);
+                void rasterizeTiles();
+                void rasterizeTile(std::size_t tile);
+                void shadePixel(const Triangle& triangle, const DrawState& drawState,
+                                std::int32_t x, std::int32_t y) const;
+                void workerLoop();
+
+                Surface surface;
+                std::size_t tileCountX = 0;
+                std::size_t tileCountY = 0;
+
+                std::vector<DrawState> drawStates;
+                // ratio of the guard band to the viewport, primitives are clipped only against it,
+                // which keeps the fixed point coordinates within range
+                float guardBandX = 1.0F;
+                float guardBandY = 1.0F;
+
+                std::vector<Triangle> triangles;
+                std::vector<std::vector<std::uint32_t>> bins; // triangle indices of every tile
+                std::vector<std::size_t> activeTiles;
+                std::atomic<std::size_t> nextTile{0};
+
+                std::size_t maxWorkerThreads = 0;
+                std::vector<Thread> workerThreads;
+                std::mutex workerMutex;
+                std::condition_variable workerCondition;
+                std::condition_variable workerDoneCondition;
+                bool workerRunning = true;
+                std::uint64_t workGeneration = 0;
+                std::size_t pendingWorkers = 0;
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWARERASTERIZER_HPP
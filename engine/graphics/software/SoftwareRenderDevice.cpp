@@ -0,0 +1,748 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "SoftwareRenderDevice.hpp"
+#include "SoftwareBlendState.hpp"
+#include "SoftwareBuffer.hpp"
+#include "SoftwareDepthStencilState.hpp"
+#include "SoftwarePipelineState.hpp"
+#include "SoftwareRenderTarget.hpp"
+#include "SoftwareShader.hpp"
+#include "SoftwareTexture.hpp"
+#include "../../core/Engine.hpp"
+#include "../../math/Batch.hpp"
+#include "../../utils/Log.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            namespace
+            {
+                ClipVertex getClipVertex(const Vertex& vertex, const Vector4F& position) noexcept
+                {
+                    ClipVertex result;
+                    result.position = position;
+                    result.color[0] = vertex.color.normR();
+                    result.color[1] = vertex.color.normG();
+                    result.color[2] = vertex.color.normB();
+                    result.color[3] = vertex.color.normA();
+                    result.texCoord[0] = vertex.texCoords[0].v[0];
+                    result.texCoord[1] = vertex.texCoords[0].v[1];
+                    return result;
+                }
+            }
+
+            RenderDevice::RenderDevice(const std::function<void(const Event&)>& initCallback):
+                graphics::RenderDevice(Driver::Software, initCallback)
+            {
+                apiVersion = ApiVersion(1, 0);
+            }
+
+            RenderDevice::~RenderDevice()
+            {
+                running = false;
+                CommandBuffer commandBuffer;
+                commandBuffer.pushCommand(std::make_unique<PresentCommand>());
+                submitCommandBuffer(std::move(commandBuffer));
+
+                if (renderThread.isJoinable()) renderThread.join();
+            }
+
+            void RenderDevice::init(Window* newWindow,
+                                    const Size2U& newSize,
+                                    std::uint32_t,
+                                    SamplerFilter newTextureFilter,
+                                    std::uint32_t newMaxAnisotropy,
+                                    bool newSrgb,
+                                    bool newVerticalSync,
+                                    bool newDepth,
+                                    bool newStencil,
+                                    bool newDebugRenderer)
+            {
+                // multisampling is not supported
+                graphics::RenderDevice::init(newWindow,
+                                             newSize,
+                                             1,
+                                             newTextureFilter,
+                                             newMaxAnisotropy,
+                                             newSrgb,
+                                             newVerticalSync,
+                                             newDepth,
+                                             newStencil,
+                                             newDebugRenderer);
+
+                npotTexturesSupported = true;
+                renderTargetsSupported = true;
+                clampToBorderSupported = true;
+                uintIndicesSupported = true;
+
+                resizeFrameBuffer(newSize.v[0], newSize.v[1]);
+
+                running = true;
+                renderThread = Thread(&RenderDevice::renderMain, this);
+            }
+
+            void RenderDevice::process()
+            {
+                graphics::RenderDevice::process();
+                executeAll();
+
+                CommandBuffer commandBuffer;
+                std::unique_ptr<Command> command;
+
+                for (;;)
+                {
+                    std::unique_lock<std::mutex> lock(commandQueueMutex);
+                    while (commandQueue.empty()) commandQueueCondition.wait(lock);
+                    commandBuffer = std::move(commandQueue.front());
+                    commandQueue.pop();
+                    lock.unlock();
+
+                    while (!commandBuffer.isEmpty())
+                    {
+                        command = commandBuffer.popCommand();
+
+                        switch (command->type)
+                        {
+                            case Command::Type::Resize:
+                            {
+                                auto resizeCommand = static_cast<const ResizeCommand*>(command.get());
+                                resizeFrameBuffer(resizeCommand->size.v[0], resizeCommand->size.v[1]);
+                                break;
+                            }
+
+                            case Command::Type::Present:
+                            {
+                                rasterizer.flush();
+
+                                while (!openTimerRegions.empty())
+                                    endTimerRegion();
+
+                                setPassTimings(std::move(frameTimings));
+                                frameTimings.clear();
+
+                                captureFrame();
+                                break;
+                            }
+
+                            case Command::Type::DeleteResource:
+                            {
+                                auto deleteResourceCommand = static_cast<const DeleteResourceCommand*>(command.get());
+
+                                // the binned triangles can refer to the textures
+                                rasterizer.flush();
+
+                                // the resource might have been released before it was initialized
+                                if (deleteResourceCommand->resource <= resources.size())
+                                {
+                                    auto& resource = resources[deleteResourceCommand->resource - 1];
+
+                                    if (resource.get() == currentRenderTarget) setRenderTarget(nullptr);
+                                    if (resource.get() == currentShader) currentShader = nullptr;
+                                    if (resource.get() == currentTexture) currentTexture = nullptr;
+
+                                    resource.reset();
+                                }
+                                break;
+                            }
+
+                            case Command::Type::InitRenderTarget:
+                            {
+                                auto initRenderTargetCommand = static_cast<const InitRenderTargetCommand*>(command.get());
+
+                                std::set<Texture*> colorTextures;
+                                for (const auto colorTextureId : initRenderTargetCommand->colorTextures)
+                                    colorTextures.insert(getResource<Texture>(colorTextureId));
+
+                                auto renderTarget = std::make_unique<RenderTarget>(*this,
+                                                                                   colorTextures,
+                                                                                   getResource<Texture>(initRenderTargetCommand->depthTexture));
+
+                                if (initRenderTargetCommand->renderTarget > resources.size())
+                                    resources.resize(initRenderTargetCommand->renderTarget);
+                                resources[initRenderTargetCommand->renderTarget - 1] = std::move(renderTarget);
+                                break;
+                            }
+
+                            case Command::Type::SetRenderTarget:
+                            {
+                                auto setRenderTargetCommand = static_cast<const SetRenderTargetCommand*>(command.get());
+                                setRenderTarget(getResource<RenderTarget>(setRenderTargetCommand->renderTarget));
+                                break;
+                            }
+
+                            case Command::Type::ClearRenderTarget:
+                            {
+                                auto clearCommand = static_cast<const ClearRenderTargetCommand*>(command.get());
+
+                                const std::uint32_t clearColor = clearCommand->clearColor.v[0] |
+                                    (static_cast<std::uint32_t>(clearCommand->clearColor.v[1]) << 8) |
+                                    (static_cast<std::uint32_t>(clearCommand->clearColor.v[2]) << 16) |
+                                    (static_cast<std::uint32_t>(clearCommand->clearColor.v[3]) << 24);
+
+                                rasterizer.clear(clearCommand->clearColorBuffer, clearColor,
+                                                 clearCommand->clearDepthBuffer, clearCommand->clearDepth,
+                                                 clearCommand->clearStencilBuffer, static_cast<std::uint8_t>(clearCommand->clearStencil));
+                                break;
+                            }
+
+                            case Command::Type::Blit:
+                            {
+                                auto blitCommand = static_cast<const BlitCommand*>(command.get());
+
+                                auto sourceTexture = getResource<Texture>(blitCommand->sourceTexture);
+                                auto destinationTexture = getResource<Texture>(blitCommand->destinationTexture);
+
+                                rasterizer.flush();
+                                destinationTexture->copyRegion(*sourceTexture,
+                                                               blitCommand->sourceLevel,
+                                                               blitCommand->sourceX,
+                                                               blitCommand->sourceY,
+                                                               blitCommand->sourceWidth,
+                                                               blitCommand->sourceHeight,
+                                                               blitCommand->destinationLevel,
+                                                               blitCommand->destinationX,
+                                                               blitCommand->destinationY);
+                                break;
+                            }
+
+                            case Command::Type::Compute:
+                                // compute shaders are not supported
+                                break;
+
+                            case Command::Type::SetScissorTest:
+                            {
+                                auto setScissorTestCommand = static_cast<const SetScissorTestCommand*>(command.get());
+
+                                scissorTest = setScissorTestCommand->enabled;
+                                if (scissorTest) scissorRectangle = setScissorTestCommand->rectangle;
+                                updateClipRectangle();
+                                break;
+                            }
+
+                            case Command::Type::SetViewport:
+                            {
+                                auto setViewportCommand = static_cast<const SetViewportCommand*>(command.get());
+
+                                drawState.viewport = setViewportCommand->viewport;
+                                updateClipRectangle();
+                                break;
+                            }
+
+                            case Command::Type::InitDepthStencilState:
+                            {
+                                auto initDepthStencilStateCommand = static_cast<const InitDepthStencilStateCommand*>(command.get());
+                                auto depthStencilState = std::make_unique<DepthStencilState>(*this,
+                                                                                             initDepthStencilStateCommand->depthTest,
+                                                                                             initDepthStencilStateCommand->depthWrite,
+                                                                                             initDepthStencilStateCommand->compareFunction,
+                                                                                             initDepthStencilStateCommand->stencilEnabled,
+                                                                                             initDepthStencilStateCommand->stencilReadMask,
+                                                                                             initDepthStencilStateCommand->stencilWriteMask,
+                                                                                             initDepthStencilStateCommand->frontFaceStencilFailureOperation,
+                                                                                             initDepthStencilStateCommand->frontFaceStencilDepthFailureOperation,
+                                                                                             initDepthStencilStateCommand->frontFaceStencilPassOperation,
+                                                                                             initDepthStencilStateCommand->frontFaceStencilCompareFunction,
+                                                                                             initDepthStencilStateCommand->backFaceStencilFailureOperation,
+                                                                                             initDepthStencilStateCommand->backFaceStencilDepthFailureOperation,
+                                                                                             initDepthStencilStateCommand->backFaceStencilPassOperation,
+                                                                                             initDepthStencilStateCommand->backFaceStencilCompareFunction);
+
+                                if (initDepthStencilStateCommand->depthStencilState > resources.size())
+                                    resources.resize(initDepthStencilStateCommand->depthStencilState);
+                                resources[initDepthStencilStateCommand->depthStencilState - 1] = std::move(depthStencilState);
+                                break;
+                            }
+
+                            case Command::Type::SetDepthStencilState:
+                            {
+                                auto setDepthStencilStateCommand = static_cast<const SetDepthStencilStateCommand*>(command.get());
+
+                                if (auto depthStencilState = getResource<DepthStencilState>(setDepthStencilStateCommand->depthStencilState))
+                                    drawState.depthStencilDesc = depthStencilState->getDesc();
+                                else
+                                    drawState.depthStencilDesc = DepthStencilDesc();
+
+                                drawState.stencilReference = static_cast<std::uint8_t>(setDepthStencilStateCommand->stencilReferenceValue);
+                                break;
+                            }
+
+                            case Command::Type::InitPipelineState:
+                            {
+                                auto initPipelineStateCommand = static_cast<const InitPipelineStateCommand*>(command.get());
+
+                                auto pipelineState = std::make_unique<PipelineState>(*this,
+                                                                                     initPipelineStateCommand->blendState,
+                                                                                     initPipelineStateCommand->shader,
+                                                                                     initPipelineStateCommand->cullMode,
+                                                                                     initPipelineStateCommand->fillMode);
+
+                                if (initPipelineStateCommand->pipelineState > resources.size())
+                                    resources.resize(initPipelineStateCommand->pipelineState);
+                                resources[initPipelineStateCommand->pipelineState - 1] = std::move(pipelineState);
+                                break;
+                            }
+
+                            case Command::Type::SetPipelineState:
+                            {
+                                auto setPipelineStateCommand = static_cast<const SetPipelineStateCommand*>(command.get());
+
+                                auto pipelineState = getResource<PipelineState>(setPipelineStateCommand->pipelineState);
+                                if (!pipelineState)
+                                    throw std::runtime_error("Invalid pipeline state");
+
+                                if (auto blendState = getResource<BlendState>(pipelineState->getBlendState()))
+                                    drawState.blendDesc = blendState->getDesc();
+                                else
+                                    drawState.blendDesc = BlendDesc();
+
+                                currentShader = getResource<Shader>(pipelineState->getShader());
+                                drawState.cullMode = pipelineState->getCullMode();
+                                drawState.fillMode = pipelineState->getFillMode();
+                                break;
+                            }
+
+                            case Command::Type::Draw:
+                            {
+                                auto drawCommand = static_cast<const DrawCommand*>(command.get());
+
+                                if (!currentShader)
+                                    throw std::runtime_error("No shader set");
+
+                                auto indexBuffer = getResource<Buffer>(drawCommand->indexBuffer);
+                                auto vertexBuffer = getResource<Buffer>(drawCommand->vertexBuffer);
+
+                                if (!indexBuffer || !vertexBuffer)
+                                    throw std::runtime_error("Invalid buffer");
+
+                                draw(*indexBuffer,
+                                     drawCommand->indexCount,
+                                     drawCommand->indexSize,
+                                     *vertexBuffer,
+                                     drawCommand->drawMode,
+                                     drawCommand->startIndex,
+                                     currentShader->getTransform(),
+                                     currentShader->getColor());
+                                break;
+                            }
+
+                            case Command::Type::DrawInstanced:
+                            {
+                                auto drawInstancedCommand = static_cast<const DrawInstancedCommand*>(command.get());
+
+                                if (!currentShader)
+                                    throw std::runtime_error("No shader set");
+
+                                auto indexBuffer = getResource<Buffer>(drawInstancedCommand->indexBuffer);
+                                auto vertexBuffer = getResource<Buffer>(drawInstancedCommand->vertexBuffer);
+                                auto instanceBuffer = getResource<Buffer>(drawInstancedCommand->instanceBuffer);
+
+                                if (!indexBuffer || !vertexBuffer || !instanceBuffer)
+                                    throw std::runtime_error("Invalid buffer");
+
+                                if (instanceBuffer->getSize() < drawInstancedCommand->instanceCount * sizeof(Instance))
+                                    throw std::runtime_error("Invalid instance count");
+
+                                // the vertex shader constant is the view projection matrix, which is combined
+                                // with the transform of every instance, like the instanced shaders do
+                                for (std::uint32_t i = 0; i < drawInstancedCommand->instanceCount; ++i)
+                                {
+                                    Instance instance;
+                                    std::memcpy(&instance, instanceBuffer->getData().data() + i * sizeof(Instance), sizeof(Instance));
+
+                                    const float color[4]{
+                                        currentShader->getColor()[0] * instance.color.normR(),
+                                        currentShader->getColor()[1] * instance.color.normG(),
+                                        currentShader->getColor()[2] * instance.color.normB(),
+                                        currentShader->getColor()[3] * instance.color.normA()
+                                    };
+
+                                    draw(*indexBuffer,
+                                         drawInstancedCommand->indexCount,
+                                         drawInstancedCommand->indexSize,
+                                         *vertexBuffer,
+                                         drawInstancedCommand->drawMode,
+                                         drawInstancedCommand->startIndex,
+                                         currentShader->getTransform() * instance.transform,
+                                         color);
+                                }
+                                break;
+                            }
+
+                            case Command::Type::PushDebugMarker:
+                            {
+                                auto pushDebugMarkerCommand = static_cast<const PushDebugMarkerCommand*>(command.get());
+                                beginTimerRegion(pushDebugMarkerCommand->name);
+                                break;
+                            }
+
+                            case Command::Type::PopDebugMarker:
+                            {
+                                endTimerRegion();
+                                break;
+                            }
+
+                            case Command::Type::InitBlendState:
+                            {
+                                auto initBlendStateCommand = static_cast<const InitBlendStateCommand*>(command.get());
+
+                                auto blendState = std::make_unique<BlendState>(*this,
+                                                                               initBlendStateCommand->enableBlending,
+                                                                               initBlendStateCommand->colorBlendSource,
+                                                                               initBlendStateCommand->colorBlendDest,
+                                                                               initBlendStateCommand->colorOperation,
+                                                                               initBlendStateCommand->alphaBlendSource,
+                                                                               initBlendStateCommand->alphaBlendDest,
+                                                                               initBlendStateCommand->alphaOperation,
+                                                                               initBlendStateCommand->colorMask);
+
+                                if (initBlendStateCommand->blendState > resources.size())
+                                    resources.resize(initBlendStateCommand->blendState);
+                                resources[initBlendStateCommand->blendState - 1] = std::move(blendState);
+                                break;
+                            }
+
+                            case Command::Type::InitBuffer:
+                            {
+                                auto initBufferCommand = static_cast<const InitBufferCommand*>(command.get());
+
+                                auto buffer = std::make_unique<Buffer>(*this,
+                                                                       initBufferCommand->bufferType,
+                                                                       initBufferCommand->flags,
+                                                                       initBufferCommand->data,
+                                                                       initBufferCommand->size);
+
+                                if (initBufferCommand->buffer > resources.size())
+                                    resources.resize(initBufferCommand->buffer);
+                                resources[initBufferCommand->buffer - 1] = std::move(buffer);
+                                break;
+                            }
+
+                            case Command::Type::SetBufferData:
+                            {
+                                auto setBufferDataCommand = static_cast<const SetBufferDataCommand*>(command.get());
+
+                                // the vertices are transformed when they are drawn, so the data can be replaced
+                                auto buffer = getResource<Buffer>(setBufferDataCommand->buffer);
+                                buffer->setData(setBufferDataCommand->data);
+                                break;
+                            }
+
+                            case Command::Type::InitShader:
+                            {
+                                auto initShaderCommand = static_cast<const InitShaderCommand*>(command.get());
+
+                                auto shader = std::make_unique<Shader>(*this,
+                                                                       initShaderCommand->vertexAttributes,
+                                                                       initShaderCommand->fragmentShaderConstantInfo,
+                                                                       initShaderCommand->vertexShaderConstantInfo);
+
+                                if (initShaderCommand->shader > resources.size())
+                                    resources.resize(initShaderCommand->shader);
+                                resources[initShaderCommand->shader - 1] = std::move(shader);
+                                break;
+                            }
+
+                            case Command::Type::SetShaderConstants:
+                            {
+                                auto setShaderConstantsCommand = static_cast<const SetShaderConstantsCommand*>(command.get());
+
+                                if (!currentShader)
+                                    throw std::runtime_error("No shader set");
+
+                                currentShader->setConstants(setShaderConstantsCommand->fragmentShaderConstants,
+                                                            setShaderConstantsCommand->vertexShaderConstants);
+                                break;
+                            }
+
+                            case Command::Type::InitTexture:
+                            {
+                                auto initTextureCommand = static_cast<const InitTextureCommand*>(command.get());
+
+                                auto texture = std::make_unique<Texture>(*this,
+                                                                         initTextureCommand->levels,
+                                                                         initTextureCommand->textureType,
+                                                                         initTextureCommand->flags,
+                                                                         initTextureCommand->sampleCount,
+                                                                         initTextureCommand->pixelFormat);
+
+                                if (initTextureCommand->texture > resources.size())
+                                    resources.resize(initTextureCommand->texture);
+                                resources[initTextureCommand->texture - 1] = std::move(texture);
+                                break;
+                            }
+
+                            case Command::Type::SetTextureData:
+                            {
+                                auto setTextureDataCommand = static_cast<const SetTextureDataCommand*>(command.get());
+
+                                // the binned triangles might sample the old data
+                                rasterizer.flush();
+
+                                auto texture = getResource<Texture>(setTextureDataCommand->texture);
+                                texture->setData(setTextureDataCommand->levels);
+                                break;
+                            }
+
+                            case Command::Type::SetTextureParameters:
+                            {
+                                auto setTextureParametersCommand = static_cast<const SetTextureParametersCommand*>(command.get());
+
+                                rasterizer.flush();
+
+                                auto texture = getResource<Texture>(setTextureParametersCommand->texture);
+                                texture->setFilter((setTextureParametersCommand->filter == SamplerFilter::Default) ? textureFilter : setTextureParametersCommand->filter);
+                                texture->setAddressX(setTextureParametersCommand->addressX);
+                                texture->setAddressY(setTextureParametersCommand->addressY);
+                                texture->setBorderColor(setTextureParametersCommand->borderColor);
+                                break;
+                            }
+
+                            case Command::Type::SetTextures:
+                            {
+                                auto setTexturesCommand = static_cast<const SetTexturesCommand*>(command.get());
+
+                                // the built-in shaders sample only the first texture
+                                currentTexture = setTexturesCommand->textures.empty() ? nullptr :
+                                    getResource<Texture>(setTexturesCommand->textures.front());
+                                break;
+                            }
+
+                            default:
+                                throw std::runtime_error("Invalid command");
+                        }
+
+                        if (command->type == Command::Type::Present) return;
+                    }
+                }
+            }
+
+            void RenderDevice::resizeFrameBuffer(std::uint32_t newWidth, std::uint32_t newHeight)
+            {
+                if (frameBufferWidth != newWidth || frameBufferHeight != newHeight)
+                {
+                    rasterizer.flush();
+
+                    frameBufferWidth = newWidth;
+                    frameBufferHeight = newHeight;
+
+                    const std::size_t pixelCount = static_cast<std::size_t>(frameBufferWidth) * frameBufferHeight;
+                    frameBuffer.assign(pixelCount, 0);
+                    if (depth) depthBuffer.assign(pixelCount, 1.0F);
+                    if (stencil) stencilBuffer.assign(pixelCount, 0);
+
+                    if (!currentRenderTarget) setRenderTarget(nullptr);
+                }
+            }
+
+            void RenderDevice::setRenderTarget(RenderTarget* renderTarget)
+            {
+                currentRenderTarget = renderTarget;
+
+                if (currentRenderTarget)
+                    rasterizer.setSurface(currentRenderTarget->getSurface());
+                else
+                {
+                    Surface surface;
+                    surface.width = frameBufferWidth;
+                    surface.height = frameBufferHeight;
+                    surface.color = frameBuffer.data();
+                    surface.depth = depthBuffer.empty() ? nullptr : depthBuffer.data();
+                    surface.stencil = stencilBuffer.empty() ? nullptr : stencilBuffer.data();
+                    rasterizer.setSurface(surface);
+                }
+
+                updateClipRectangle();
+            }
+
+            void RenderDevice::updateClipRectangle()
+            {
+                float minX = drawState.viewport.position.v[0];
+                float minY = drawState.viewport.position.v[1];
+                float maxX = minX + drawState.viewport.size.v[0];
+                float maxY = minY + drawState.viewport.size.v[1];
+
+                if (scissorTest)
+                {
+                    minX = std::max(minX, scissorRectangle.position.v[0]);
+                    minY = std::max(minY, scissorRectangle.position.v[1]);
+                    maxX = std::min(maxX, scissorRectangle.position.v[0] + scissorRectangle.size.v[0]);
+                    maxY = std::min(maxY, scissorRectangle.position.v[1] + scissorRectangle.size.v[1]);
+                }
+
+                const Surface& surface = rasterizer.getSurface();
+                const auto width = static_cast<float>(surface.width);
+                const auto height = static_cast<float>(surface.height);
+
+                drawState.minX = static_cast<std::int32_t>(std::lround(std::min(std::max(minX, 0.0F), width)));
+                drawState.minY = static_cast<std::int32_t>(std::lround(std::min(std::max(minY, 0.0F), height)));
+                drawState.maxX = static_cast<std::int32_t>(std::lround(std::min(std::max(maxX, 0.0F), width)));
+                drawState.maxY = static_cast<std::int32_t>(std::lround(std::min(std::max(maxY, 0.0F), height)));
+            }
+
+            void RenderDevice::draw(const Buffer& indexBuffer,
+                                    std::uint32_t indexCount,
+                                    std::uint32_t indexSize,
+                                    const Buffer& vertexBuffer,
+                                    DrawMode drawMode,
+                                    std::uint32_t startIndex,
+                                    const Matrix4F& transform,
+                                    const float color[4])
+            {
+                if (indexSize != 2 && indexSize != 4)
+                    throw std::runtime_error("Invalid index size");
+
+                if ((static_cast<std::size_t>(startIndex) + indexCount) * indexSize > indexBuffer.getSize())
+                    throw std::runtime_error("Invalid index count");
+
+                const std::size_t vertexCount = vertexBuffer.getSize() / sizeof(Vertex);
+
+                // only the vertices between the smallest and the largest index are transformed
+                indices.resize(indexCount);
+                std::uint32_t minIndex = ~0U;
+                std::uint32_t maxIndex = 0;
+                const std::uint8_t* indexData = indexBuffer.getData().data() + static_cast<std::size_t>(startIndex) * indexSize;
+
+                for (std::uint32_t i = 0; i < indexCount; ++i)
+                {
+                    if (indexSize == 2)
+                    {
+                        std::uint16_t index;
+                        std::memcpy(&index, indexData + i * 2, sizeof(index));
+                        indices[i] = index;
+                    }
+                    else
+                        std::memcpy(&indices[i], indexData + i * 4, sizeof(std::uint32_t));
+
+                    if (indices[i] >= vertexCount)
+                        throw std::runtime_error("Invalid index");
+
+                    minIndex = std::min(minIndex, indices[i]);
+                    maxIndex = std::max(maxIndex, indices[i]);
+                }
+
+                if (indices.empty()) return;
+
+                const std::size_t rangeSize = maxIndex - minIndex + 1;
+                positions.resize(rangeSize);
+                clipVertices.resize(rangeSize);
+
+                const std::uint8_t* vertexData = vertexBuffer.getData().data() + minIndex * sizeof(Vertex);
+                for (std::size_t i = 0; i < rangeSize; ++i)
+                {
+                    Vertex vertex;
+                    std::memcpy(&vertex, vertexData + i * sizeof(Vertex), sizeof(Vertex));
+                    positions[i] = Vector4F(vertex.position.v[0], vertex.position.v[1], vertex.position.v[2], 1.0F);
+                    clipVertices[i] = getClipVertex(vertex, positions[i]);
+                }
+
+                transformVectors(transform, positions.data(), positions.data(), rangeSize);
+
+                for (std::size_t i = 0; i < rangeSize; ++i)
+                    clipVertices[i].position = positions[i];
+
+                drawState.texture = currentShader->isTextured() ? currentTexture : nullptr;
+                std::copy(color, color + 4, drawState.color);
+                rasterizer.setDrawState(drawState);
+
+                const auto vertex = [this, minIndex](std::size_t i) -> const ClipVertex& {
+                    return clipVertices[indices[i] - minIndex];
+                };
+
+                switch (drawMode)
+                {
+                    case DrawMode::PointList:
+                        for (std::size_t i = 0; i < indices.size(); ++i)
+                            rasterizer.drawPoint(vertex(i));
+                        break;
+                    case DrawMode::LineList:
+                        for (std::size_t i = 0; i + 1 < indices.size(); i += 2)
+                            rasterizer.drawLine(vertex(i), vertex(i + 1));
+                        break;
+                    case DrawMode::LineStrip:
+                        for (std::size_t i = 0; i + 1 < indices.size(); ++i)
+                            rasterizer.drawLine(vertex(i), vertex(i + 1));
+                        break;
+                    case DrawMode::TriangleList:
+                        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+                            rasterizer.drawTriangle(vertex(i), vertex(i + 1), vertex(i + 2));
+                        break;
+                    case DrawMode::TriangleStrip:
+                        // every other triangle is flipped to keep the winding
+                        for (std::size_t i = 0; i + 2 < indices.size(); ++i)
+                            if (i % 2)
+                                rasterizer.drawTriangle(vertex(i + 1), vertex(i), vertex(i + 2));
+                            else
+                                rasterizer.drawTriangle(vertex(i), vertex(i + 1), vertex(i + 2));
+                        break;
+                    default:
+                        throw std::runtime_error("Invalid draw mode");
+                }
+            }
+
+            void RenderDevice::beginTimerRegion(const std::string& name)
+            {
+                rasterizer.flush();
+
+                PassTiming passTiming;
+                passTiming.name = name;
+                passTiming.depth = static_cast<std::uint32_t>(openTimerRegions.size());
+                frameTimings.push_back(passTiming);
+
+                openTimerRegions.push_back(TimerRegion{frameTimings.size() - 1, std::chrono::steady_clock::now()});
+            }
+
+            void RenderDevice::endTimerRegion()
+            {
+                if (openTimerRegions.empty()) return;
+
+                rasterizer.flush();
+
+                const TimerRegion& timerRegion = openTimerRegions.back();
+                const auto duration = std::chrono::steady_clock::now() - timerRegion.start;
+                frameTimings[timerRegion.passTiming].duration = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+                openTimerRegions.pop_back();
+            }
+
+            void RenderDevice::captureFrame()
+            {
+                std::vector<std::string> filenames = frameCapture.nextFrame(0);
+                if (filenames.empty()) return;
+
+                // the frame buffer is in memory, so only the copy is made on the render thread
+                FrameCapture::Frame frame;
+                frame.filenames = std::move(filenames);
+                frame.width = frameBufferWidth;
+                frame.height = frameBufferHeight;
+                frame.pitch = frameBufferWidth * sizeof(std::uint32_t);
+                frame.data.resize(frame.pitch * frameBufferHeight);
+                std::memcpy(frame.data.data(), frameBuffer.data(), frame.data.size());
+
+                frameCapture.encode(std::move(frame));
+            }
+
+            void RenderDevice::renderMain()
+            {
+                Thread::setCurrentThreadName("Render");
+
+                while (running)
+                {
+                    try
+                    {
+                        process();
+                    }
+                    catch (const std::exception& e)
+                    {
+                        engine->log(Log::Level::Error) << e.what();
+                    }
+                }
+            }
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
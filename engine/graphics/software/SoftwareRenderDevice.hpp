@@ -0,0 +1,109 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWARERENDERDEVICE_HPP
+#define OUZEL_GRAPHICS_SOFTWARERENDERDEVICE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "../RenderDevice.hpp"
+#include "SoftwareRasterizer.hpp"
+#include "SoftwareRenderResource.hpp"
+#include "../../utils/Thread.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            class Buffer;
+            class RenderTarget;
+            class Shader;
+
+            // Renders to a frame buffer in memory, which is not presented, but can be saved with a
+            // screenshot. Only the built-in shaders are supported, see Shader.
+            class RenderDevice final: public graphics::RenderDevice
+            {
+                friend Renderer;
+            public:
+                explicit RenderDevice(const std::function<void(const Event&)>& initCallback);
+                ~RenderDevice() override;
+
+                template <class T>
+                inline auto getResource(std::uintptr_t id) const
+                {
+                    return id ? static_cast<T*>(resources[id - 1].get()) : nullptr;
+                }
+
+            private:
+                void init(Window* newWindow,
+                          const Size2U& newSize,
+                          std::uint32_t newSampleCount,
+                          SamplerFilter newTextureFilter,
+                          std::uint32_t newMaxAnisotropy,
+                          bool newSrgb,
+                          bool newVerticalSync,
+                          bool newDepth,
+                          bool newStencil,
+                          bool newDebugRenderer) final;
+
+                void process() final;
+                void resizeFrameBuffer(std::uint32_t newWidth, std::uint32_t newHeight);
+                void setRenderTarget(RenderTarget* renderTarget);
+                void updateClipRectangle();
+                void draw(const Buffer& indexBuffer,
+                          std::uint32_t indexCount,
+                          std::uint32_t indexSize,
+                          const Buffer& vertexBuffer,
+                          DrawMode drawMode,
+                          std::uint32_t startIndex,
+                          const Matrix4F& transform,
+                          const float color[4]);
+                void captureFrame();
+                void renderMain();
+
+                // the regions are timed on the CPU, the rasterizer is flushed at their boundaries
+                void beginTimerRegion(const std::string& name);
+                void endTimerRegion();
+
+                std::uint32_t frameBufferWidth = 0;
+                std::uint32_t frameBufferHeight = 0;
+                std::vector<std::uint32_t> frameBuffer;
+                std::vector<float> depthBuffer;
+                std::vector<std::uint8_t> stencilBuffer;
+
+                Rasterizer rasterizer;
+
+                // state of the following draw calls
+                RenderTarget* currentRenderTarget = nullptr;
+                Shader* currentShader = nullptr;
+                const Texture* currentTexture = nullptr;
+                DrawState drawState; // the texture and the color are set by every draw call
+                bool scissorTest = false;
+                RectF scissorRectangle;
+
+                std::vector<std::uint32_t> indices;
+                std::vector<Vector4F> positions;
+                std::vector<ClipVertex> clipVertices;
+
+                std::atomic_bool running{false};
+                Thread renderThread;
+
+                std::vector<std::unique_ptr<RenderResource>> resources;
+
+                struct TimerRegion final
+                {
+                    std::size_t passTiming;
+                    std::chrono::steady_clock::time_point start;
+                };
+
+                std::vector<PassTiming> frameTimings; // regions of the current frame
+                std::vector<TimerRegion> openTimerRegions; // regions whose markers have not been popped
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWARERENDERDEVICE_HPP
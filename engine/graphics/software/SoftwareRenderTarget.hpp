@@ -0,0 +1,72 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWARERENDERTARGET_HPP
+#define OUZEL_GRAPHICS_SOFTWARERENDERTARGET_HPP
+
+#include <set>
+#include <stdexcept>
+#include "SoftwareRasterizer.hpp"
+#include "SoftwareRenderResource.hpp"
+#include "SoftwareTexture.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            // the shader has a single output, so only the first color texture is drawn to
+            class RenderTarget final: public RenderResource
+            {
+            public:
+                RenderTarget(RenderDevice& initRenderDevice,
+                             const std::set<Texture*>& initColorTextures,
+                             Texture* initDepthTexture):
+                    RenderResource(initRenderDevice),
+                    colorTextures(initColorTextures),
+                    depthTexture(initDepthTexture)
+                {
+                }
+
+                Surface getSurface() const
+                {
+                    Surface surface;
+
+                    if (!colorTextures.empty())
+                    {
+                        Texture* colorTexture = *colorTextures.begin();
+                        surface.width = colorTexture->getWidth();
+                        surface.height = colorTexture->getHeight();
+                        surface.color = colorTexture->getPixels();
+                    }
+
+                    if (depthTexture)
+                    {
+                        if (!surface.color)
+                        {
+                            surface.width = depthTexture->getWidth();
+                            surface.height = depthTexture->getHeight();
+                        }
+                        else if (surface.width != depthTexture->getWidth() ||
+                                 surface.height != depthTexture->getHeight())
+                            throw std::runtime_error("Render target textures must have the same size");
+
+                        surface.depth = depthTexture->getDepth();
+                        surface.stencil = depthTexture->getStencil();
+                    }
+
+                    return surface;
+                }
+
+                inline auto& getColorTextures() const noexcept { return colorTextures; }
+                inline auto getDepthTexture() const noexcept { return depthTexture; }
+
+            private:
+                std::set<Texture*> colorTextures;
+                Texture* depthTexture = nullptr;
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWARERENDERTARGET_HPP
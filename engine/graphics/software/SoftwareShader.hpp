@@ -0,0 +1,105 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWARESHADER_HPP
+#define OUZEL_GRAPHICS_SOFTWARESHADER_HPP
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SoftwareRenderResource.hpp"
+#include "../DataType.hpp"
+#include "../Vertex.hpp"
+#include "../../math/Matrix.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            // The shader code is ignored and the built-in texture and color shaders are emulated,
+            // depending on whether the vertices have texture coordinates. The vertices are transformed
+            // by the first matrix constant of the vertex shader and the color is multiplied by the
+            // first vector constant of the fragment shader.
+            class Shader final: public RenderResource
+            {
+            public:
+                Shader(RenderDevice& initRenderDevice,
+                       const std::set<Vertex::Attribute::Usage>& initVertexAttributes,
+                       const std::vector<std::pair<std::string, DataType>>& initFragmentShaderConstantInfo,
+                       const std::vector<std::pair<std::string, DataType>>& initVertexShaderConstantInfo):
+                    RenderResource(initRenderDevice),
+                    vertexAttributes(initVertexAttributes),
+                    fragmentShaderConstantInfo(initFragmentShaderConstantInfo),
+                    vertexShaderConstantInfo(initVertexShaderConstantInfo)
+                {
+                    textured = vertexAttributes.find(Vertex::Attribute::Usage::TextureCoordinates0) != vertexAttributes.end();
+
+                    const auto colorConstant = std::find_if(fragmentShaderConstantInfo.begin(), fragmentShaderConstantInfo.end(),
+                                                            [](const std::pair<std::string, DataType>& info) noexcept {
+                                                                return info.second == DataType::FloatVector4;
+                                                            });
+                    colorConstantIndex = static_cast<std::size_t>(colorConstant - fragmentShaderConstantInfo.begin());
+
+                    const auto transformConstant = std::find_if(vertexShaderConstantInfo.begin(), vertexShaderConstantInfo.end(),
+                                                                [](const std::pair<std::string, DataType>& info) noexcept {
+                                                                    return info.second == DataType::FloatMatrix4;
+                                                                });
+                    transformConstantIndex = static_cast<std::size_t>(transformConstant - vertexShaderConstantInfo.begin());
+                }
+
+                void setConstants(const std::vector<std::vector<float>>& fragmentShaderConstants,
+                                  const std::vector<std::vector<float>>& vertexShaderConstants)
+                {
+                    if (fragmentShaderConstants.size() > fragmentShaderConstantInfo.size())
+                        throw std::runtime_error("Invalid pixel shader constant size");
+
+                    for (std::size_t i = 0; i < fragmentShaderConstants.size(); ++i)
+                        if (sizeof(float) * fragmentShaderConstants[i].size() != getDataTypeSize(fragmentShaderConstantInfo[i].second))
+                            throw std::runtime_error("Invalid pixel shader constant size");
+
+                    if (vertexShaderConstants.size() > vertexShaderConstantInfo.size())
+                        throw std::runtime_error("Invalid vertex shader constant size");
+
+                    for (std::size_t i = 0; i < vertexShaderConstants.size(); ++i)
+                        if (sizeof(float) * vertexShaderConstants[i].size() != getDataTypeSize(vertexShaderConstantInfo[i].second))
+                            throw std::runtime_error("Invalid vertex shader constant size");
+
+                    if (colorConstantIndex < fragmentShaderConstants.size())
+                        std::copy(fragmentShaderConstants[colorConstantIndex].begin(),
+                                  fragmentShaderConstants[colorConstantIndex].end(),
+                                  std::begin(color));
+
+                    if (transformConstantIndex < vertexShaderConstants.size())
+                        std::copy(vertexShaderConstants[transformConstantIndex].begin(),
+                                  vertexShaderConstants[transformConstantIndex].end(),
+                                  std::begin(transform.m));
+                }
+
+                inline auto& getVertexAttributes() const noexcept { return vertexAttributes; }
+                inline auto isTextured() const noexcept { return textured; }
+
+                inline auto& getColor() const noexcept { return color; }
+                inline auto& getTransform() const noexcept { return transform; }
+
+            private:
+                std::set<Vertex::Attribute::Usage> vertexAttributes;
+
+                std::vector<std::pair<std::string, DataType>> fragmentShaderConstantInfo;
+                std::vector<std::pair<std::string, DataType>> vertexShaderConstantInfo;
+
+                bool textured = false;
+                std::size_t colorConstantIndex = 0;
+                std::size_t transformConstantIndex = 0;
+
+                float color[4]{1.0F, 1.0F, 1.0F, 1.0F};
+                Matrix4F transform = Matrix4F::identity();
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWARESHADER_HPP
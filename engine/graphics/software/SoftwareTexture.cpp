@@ -0,0 +1,386 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "SoftwareTexture.hpp"
+#include "../Flags.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            namespace
+            {
+                constexpr std::uint32_t packPixel(std::uint32_t red, std::uint32_t green,
+                                                  std::uint32_t blue, std::uint32_t alpha) noexcept
+                {
+                    return red | (green << 8) | (blue << 16) | (alpha << 24);
+                }
+
+                std::uint32_t packFloat(float value) noexcept
+                {
+                    return static_cast<std::uint32_t>(std::min(std::max(value, 0.0F), 1.0F) * 255.0F + 0.5F);
+                }
+
+                float readFloat(const std::uint8_t* data) noexcept
+                {
+                    float result;
+                    std::memcpy(&result, data, sizeof(result));
+                    return result;
+                }
+
+                bool isConvertible(PixelFormat pixelFormat) noexcept
+                {
+                    switch (pixelFormat)
+                    {
+                        case PixelFormat::A8UNorm:
+                        case PixelFormat::R8UNorm:
+                        case PixelFormat::RG8UNorm:
+                        case PixelFormat::RGBA8UNorm:
+                        case PixelFormat::RGBA8UNormSRGB:
+                        case PixelFormat::R32Float:
+                        case PixelFormat::RGBA32Float:
+                            return true;
+                        default:
+                            return false;
+                    }
+                }
+
+                // sRGB data is kept as it is, because the framebuffer is not converted either
+                void convertPixels(PixelFormat pixelFormat, const std::uint8_t* source,
+                                   std::size_t count, std::uint32_t* destination) noexcept
+                {
+                    switch (pixelFormat)
+                    {
+                        case PixelFormat::A8UNorm:
+                            for (std::size_t i = 0; i < count; ++i)
+                                destination[i] = packPixel(0, 0, 0, source[i]);
+                            break;
+                        case PixelFormat::R8UNorm:
+                            for (std::size_t i = 0; i < count; ++i)
+                                destination[i] = packPixel(source[i], 0, 0, 255);
+                            break;
+                        case PixelFormat::RG8UNorm:
+                            for (std::size_t i = 0; i < count; ++i)
+                                destination[i] = packPixel(source[i * 2], source[i * 2 + 1], 0, 255);
+                            break;
+                        case PixelFormat::RGBA8UNorm:
+                        case PixelFormat::RGBA8UNormSRGB:
+                            for (std::size_t i = 0; i < count; ++i)
+                                destination[i] = packPixel(source[i * 4], source[i * 4 + 1],
+                                                           source[i * 4 + 2], source[i * 4 + 3]);
+                            break;
+                        case PixelFormat::R32Float:
+                            for (std::size_t i = 0; i < count; ++i)
+                                destination[i] = packPixel(packFloat(readFloat(source + i * 4)), 0, 0, 255);
+                            break;
+                        case PixelFormat::RGBA32Float:
+                            for (std::size_t i = 0; i < count; ++i)
+                                destination[i] = packPixel(packFloat(readFloat(source + i * 16)),
+                                                           packFloat(readFloat(source + i * 16 + 4)),
+                                                           packFloat(readFloat(source + i * 16 + 8)),
+                                                           packFloat(readFloat(source + i * 16 + 12)));
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                // returns -1 for coordinates outside of a border clamped texture
+                std::int32_t getTexelIndex(std::int32_t i, std::int32_t size, SamplerAddressMode address) noexcept
+                {
+                    switch (address)
+                    {
+                        case SamplerAddressMode::ClampToEdge:
+                            return std::min(std::max(i, 0), size - 1);
+                        case SamplerAddressMode::ClampToBorder:
+                            return (i < 0 || i >= size) ? -1 : i;
+                        case SamplerAddressMode::Repeat:
+                            return ((i % size) + size) % size;
+                        case SamplerAddressMode::MirrorRepeat:
+                        {
+                            const std::int32_t period = size * 2;
+                            const std::int32_t m = ((i % period) + period) % period;
+                            return (m < size) ? m : period - 1 - m;
+                        }
+                        default:
+                            return -1;
+                    }
+                }
+
+                // converts the texture coordinate to texels without overflowing the integer conversion
+                float toTexels(float coordinate, std::uint32_t size) noexcept
+                {
+                    constexpr float limit = 16777216.0F;
+                    const float result = coordinate * static_cast<float>(size);
+                    return std::isnan(result) ? 0.0F : std::min(std::max(result, -limit), limit);
+                }
+            }
+
+            Texture::Texture(RenderDevice& initRenderDevice,
+                             const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& initLevels,
+                             TextureType type,
+                             std::uint32_t initFlags,
+                             std::uint32_t,
+                             PixelFormat initPixelFormat):
+                RenderResource(initRenderDevice),
+                flags(initFlags),
+                pixelFormat(initPixelFormat)
+            {
+                if (type != TextureType::TwoDimensional)
+                    throw std::runtime_error("Unsupported texture type");
+
+                if ((flags & Flags::BindRenderTarget) && initLevels.size() != 1)
+                    throw std::runtime_error("Invalid mip map count");
+
+                if (initLevels.empty() || !initLevels.front().first.v[0] || !initLevels.front().first.v[1])
+                    throw std::runtime_error("Invalid texture size");
+
+                const std::uint32_t width = initLevels.front().first.v[0];
+                const std::uint32_t height = initLevels.front().first.v[1];
+
+                if (pixelFormat == PixelFormat::Depth || pixelFormat == PixelFormat::DepthStencil)
+                {
+                    levels.resize(1);
+                    levels.front().width = width;
+                    levels.front().height = height;
+                    depth.resize(width * height, 1.0F);
+                    if (pixelFormat == PixelFormat::DepthStencil)
+                        stencil.resize(width * height, 0);
+                    return;
+                }
+
+                if (!isConvertible(pixelFormat))
+                    throw std::runtime_error("Invalid pixel format");
+
+                levels.resize(initLevels.size());
+                for (std::size_t i = 0; i < initLevels.size(); ++i)
+                {
+                    levels[i].width = std::max(initLevels[i].first.v[0], 1U);
+                    levels[i].height = std::max(initLevels[i].first.v[1], 1U);
+                    levels[i].pixels.resize(levels[i].width * levels[i].height);
+                }
+
+                uploadLevels(initLevels);
+            }
+
+            void Texture::setData(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels)
+            {
+                if (!(flags & Flags::Dynamic) || flags & Flags::BindRenderTarget)
+                    throw std::runtime_error("Texture is not dynamic");
+
+                uploadLevels(newLevels);
+            }
+
+            void Texture::uploadLevels(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels)
+            {
+                for (std::size_t i = 0; i < newLevels.size() && i < levels.size(); ++i)
+                {
+                    const auto& data = newLevels[i].second;
+                    if (data.empty()) continue;
+
+                    Level& level = levels[i];
+                    if (data.size() < getLevelSize(pixelFormat, level.width, level.height))
+                        throw std::runtime_error("Invalid texture data size");
+
+                    convertPixels(pixelFormat, data.data(), level.pixels.size(), level.pixels.data());
+                }
+            }
+
+            void Texture::setFilter(SamplerFilter filter)
+            {
+                samplerDesc.filter = filter;
+            }
+
+            void Texture::setAddressX(SamplerAddressMode addressX)
+            {
+                samplerDesc.addressX = addressX;
+            }
+
+            void Texture::setAddressY(SamplerAddressMode addressY)
+            {
+                samplerDesc.addressY = addressY;
+            }
+
+            void Texture::setBorderColor(Color color)
+            {
+                samplerDesc.borderColor[0] = color.normR();
+                samplerDesc.borderColor[1] = color.normG();
+                samplerDesc.borderColor[2] = color.normB();
+                samplerDesc.borderColor[3] = color.normA();
+            }
+
+            void Texture::copyRegion(const Texture& source,
+                                     std::uint32_t sourceLevel,
+                                     std::uint32_t sourceX,
+                                     std::uint32_t sourceY,
+                                     std::uint32_t width,
+                                     std::uint32_t height,
+                                     std::uint32_t destinationLevel,
+                                     std::uint32_t destinationX,
+                                     std::uint32_t destinationY)
+            {
+                if (source.depth.empty() != depth.empty())
+                    throw std::runtime_error("Incompatible texture formats");
+
+                if (sourceLevel >= source.levels.size() || destinationLevel >= levels.size())
+                    throw std::runtime_error("Invalid texture level");
+
+                const Level& sourceLevelData = source.levels[sourceLevel];
+                Level& destinationLevelData = levels[destinationLevel];
+
+                if (sourceX + width > sourceLevelData.width || sourceY + height > sourceLevelData.height ||
+                    destinationX + width > destinationLevelData.width || destinationY + height > destinationLevelData.height)
+                    throw std::runtime_error("Invalid blit region");
+
+                for (std::uint32_t y = 0; y < height; ++y)
+                {
+                    const std::size_t sourceIndex = (sourceY + y) * sourceLevelData.width + sourceX;
+                    const std::size_t destinationIndex = (destinationY + y) * destinationLevelData.width + destinationX;
+
+                    if (depth.empty())
+                        std::copy(sourceLevelData.pixels.begin() + sourceIndex,
+                                  sourceLevelData.pixels.begin() + sourceIndex + width,
+                                  destinationLevelData.pixels.begin() + destinationIndex);
+                    else
+                    {
+                        std::copy(source.depth.begin() + sourceIndex,
+                                  source.depth.begin() + sourceIndex + width,
+                                  depth.begin() + destinationIndex);
+
+                        if (!stencil.empty() && !source.stencil.empty())
+                            std::copy(source.stencil.begin() + sourceIndex,
+                                      source.stencil.begin() + sourceIndex + width,
+                                      stencil.begin() + destinationIndex);
+                    }
+                }
+            }
+
+            void Texture::sample(float u, float v, float lod, float result[4]) const
+            {
+                // depth textures return the depth in every color channel
+                if (!depth.empty())
+                {
+                    const Level& level = levels.front();
+                    const auto x = getTexelIndex(static_cast<std::int32_t>(std::floor(toTexels(u, level.width))),
+                                                 static_cast<std::int32_t>(level.width), samplerDesc.addressX);
+                    const auto y = getTexelIndex(static_cast<std::int32_t>(std::floor(toTexels(v, level.height))),
+                                                 static_cast<std::int32_t>(level.height), samplerDesc.addressY);
+
+                    const float value = (x < 0 || y < 0) ? samplerDesc.borderColor[0] :
+                        depth[static_cast<std::size_t>(y) * level.width + static_cast<std::size_t>(x)];
+                    result[0] = result[1] = result[2] = value;
+                    result[3] = 1.0F;
+                    return;
+                }
+
+                const float maxLevel = static_cast<float>(levels.size() - 1);
+                lod = std::min(std::max(lod, 0.0F), maxLevel);
+
+                switch (samplerDesc.filter)
+                {
+                    case SamplerFilter::Linear: // point filtered levels, blended
+                    case SamplerFilter::Trilinear:
+                    {
+                        const auto first = static_cast<std::size_t>(lod);
+                        const float t = lod - static_cast<float>(first);
+
+                        if (samplerDesc.filter == SamplerFilter::Linear)
+                            samplePoint(levels[first], u, v, result);
+                        else
+                            sampleBilinear(levels[first], u, v, result);
+
+                        if (t > 0.0F && first + 1 < levels.size())
+                        {
+                            float next[4];
+                            if (samplerDesc.filter == SamplerFilter::Linear)
+                                samplePoint(levels[first + 1], u, v, next);
+                            else
+                                sampleBilinear(levels[first + 1], u, v, next);
+
+                            for (std::size_t c = 0; c < 4; ++c)
+                                result[c] += (next[c] - result[c]) * t;
+                        }
+                        break;
+                    }
+                    case SamplerFilter::Bilinear:
+                        sampleBilinear(levels[static_cast<std::size_t>(lod + 0.5F)], u, v, result);
+                        break;
+                    default:
+                        samplePoint(levels[static_cast<std::size_t>(lod + 0.5F)], u, v, result);
+                        break;
+                }
+            }
+
+            void Texture::samplePoint(const Level& level, float u, float v, float result[4]) const
+            {
+                const auto x = getTexelIndex(static_cast<std::int32_t>(std::floor(toTexels(u, level.width))),
+                                             static_cast<std::int32_t>(level.width), samplerDesc.addressX);
+                const auto y = getTexelIndex(static_cast<std::int32_t>(std::floor(toTexels(v, level.height))),
+                                             static_cast<std::int32_t>(level.height), samplerDesc.addressY);
+
+                if (x < 0 || y < 0)
+                {
+                    std::copy(samplerDesc.borderColor, samplerDesc.borderColor + 4, result);
+                    return;
+                }
+
+                const std::uint32_t pixel = level.pixels[static_cast<std::size_t>(y) * level.width + static_cast<std::size_t>(x)];
+                for (std::size_t c = 0; c < 4; ++c)
+                    result[c] = static_cast<float>((pixel >> (c * 8)) & 0xFF) / 255.0F;
+            }
+
+            void Texture::sampleBilinear(const Level& level, float u, float v, float result[4]) const
+            {
+                const float x = toTexels(u, level.width) - 0.5F;
+                const float y = toTexels(v, level.height) - 0.5F;
+                const float floorX = std::floor(x);
+                const float floorY = std::floor(y);
+                const float fractionX = x - floorX;
+                const float fractionY = y - floorY;
+
+                const auto x0 = static_cast<std::int32_t>(floorX);
+                const auto y0 = static_cast<std::int32_t>(floorY);
+                const auto width = static_cast<std::int32_t>(level.width);
+                const auto height = static_cast<std::int32_t>(level.height);
+
+                const std::int32_t xs[2]{
+                    getTexelIndex(x0, width, samplerDesc.addressX),
+                    getTexelIndex(x0 + 1, width, samplerDesc.addressX)
+                };
+                const std::int32_t ys[2]{
+                    getTexelIndex(y0, height, samplerDesc.addressY),
+                    getTexelIndex(y0 + 1, height, samplerDesc.addressY)
+                };
+                const float weights[4]{
+                    (1.0F - fractionX) * (1.0F - fractionY), fractionX * (1.0F - fractionY),
+                    (1.0F - fractionX) * fractionY, fractionX * fractionY
+                };
+
+                result[0] = result[1] = result[2] = result[3] = 0.0F;
+
+                for (std::size_t i = 0; i < 4; ++i)
+                {
+                    const std::int32_t texelX = xs[i % 2];
+                    const std::int32_t texelY = ys[i / 2];
+
+                    if (texelX < 0 || texelY < 0)
+                    {
+                        for (std::size_t c = 0; c < 4; ++c)
+                            result[c] += samplerDesc.borderColor[c] * weights[i];
+                    }
+                    else
+                    {
+                        const std::uint32_t pixel = level.pixels[static_cast<std::size_t>(texelY) * level.width + static_cast<std::size_t>(texelX)];
+                        for (std::size_t c = 0; c < 4; ++c)
+                            result[c] += static_cast<float>((pixel >> (c * 8)) & 0xFF) / 255.0F * weights[i];
+                    }
+                }
+            }
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
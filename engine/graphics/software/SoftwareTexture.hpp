@@ -0,0 +1,99 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_GRAPHICS_SOFTWARETEXTURE_HPP
+#define OUZEL_GRAPHICS_SOFTWARETEXTURE_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "SoftwareRenderResource.hpp"
+#include "../PixelFormat.hpp"
+#include "../SamplerAddressMode.hpp"
+#include "../SamplerFilter.hpp"
+#include "../TextureType.hpp"
+#include "../../math/Color.hpp"
+#include "../../math/Size.hpp"
+
+namespace ouzel
+{
+    namespace graphics
+    {
+        namespace software
+        {
+            struct SamplerDesc final
+            {
+                SamplerFilter filter = SamplerFilter::Point;
+                SamplerAddressMode addressX = SamplerAddressMode::ClampToEdge;
+                SamplerAddressMode addressY = SamplerAddressMode::ClampToEdge;
+                float borderColor[4]{0.0F, 0.0F, 0.0F, 0.0F};
+            };
+
+            // Color textures are stored as RGBA8 with red in the lowest byte, whatever their source format.
+            // Depth textures keep a float depth and an 8-bit stencil value per pixel.
+            class Texture final: public RenderResource
+            {
+            public:
+                struct Level final
+                {
+                    std::uint32_t width = 0;
+                    std::uint32_t height = 0;
+                    std::vector<std::uint32_t> pixels;
+                };
+
+                Texture(RenderDevice& initRenderDevice,
+                        const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& initLevels,
+                        TextureType type,
+                        std::uint32_t initFlags = 0,
+                        std::uint32_t initSampleCount = 1,
+                        PixelFormat initPixelFormat = PixelFormat::RGBA8UNorm);
+
+                void setData(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels);
+                void setFilter(SamplerFilter filter);
+                void setAddressX(SamplerAddressMode addressX);
+                void setAddressY(SamplerAddressMode addressY);
+                void setBorderColor(Color color);
+
+                // copies a rectangle of a level of the source texture, depth textures have a single level
+                void copyRegion(const Texture& source,
+                                std::uint32_t sourceLevel,
+                                std::uint32_t sourceX,
+                                std::uint32_t sourceY,
+                                std::uint32_t width,
+                                std::uint32_t height,
+                                std::uint32_t destinationLevel,
+                                std::uint32_t destinationX,
+                                std::uint32_t destinationY);
+
+                // the level of detail is log2 of the texels per pixel
+                void sample(float u, float v, float lod, float result[4]) const;
+
+                inline auto getFlags() const noexcept { return flags; }
+                inline auto getPixelFormat() const noexcept { return pixelFormat; }
+                inline auto& getSamplerDesc() const noexcept { return samplerDesc; }
+                inline auto& getLevels() const noexcept { return levels; }
+
+                inline auto getWidth() const noexcept { return levels.empty() ? 0U : levels.front().width; }
+                inline auto getHeight() const noexcept { return levels.empty() ? 0U : levels.front().height; }
+
+                inline auto getPixels() noexcept { return depth.empty() ? levels.front().pixels.data() : nullptr; }
+                inline auto getDepth() noexcept { return depth.empty() ? nullptr : depth.data(); }
+                inline auto getStencil() noexcept { return stencil.empty() ? nullptr : stencil.data(); }
+
+            private:
+                void uploadLevels(const std::vector<std::pair<Size2U, std::vector<std::uint8_t>>>& newLevels);
+                void samplePoint(const Level& level, float u, float v, float result[4]) const;
+                void sampleBilinear(const Level& level, float u, float v, float result[4]) const;
+
+                std::uint32_t flags = 0;
+                PixelFormat pixelFormat = PixelFormat::RGBA8UNorm;
+                SamplerDesc samplerDesc;
+
+                std::vector<Level> levels;
+                std::vector<float> depth;
+                std::vector<std::uint8_t> stencil;
+            };
+        } // namespace software
+    } // namespace graphics
+} // namespace ouzel
+
+#endif // OUZEL_GRAPHICS_SOFTWARETEXTURE_HPP
@@ -0,0 +1,495 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <cmath>
+#include <limits>
+#if defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#elif defined(__SSE__)
+#  include <xmmintrin.h>
+#endif
+#include "Batch.hpp"
+#include "MathUtils.hpp"
+
+namespace ouzel
+{
+    static_assert(sizeof(Vector3F) == 3 * sizeof(float), "Vector3F must be tightly packed");
+    static_assert(sizeof(Box3F) == 6 * sizeof(float), "Box3F must be tightly packed");
+    static_assert(sizeof(QuaternionF) == 4 * sizeof(float), "QuaternionF must be tightly packed");
+
+    namespace
+    {
+        template <bool point>
+        void transform(const Matrix4F& matrix, const Vector3F* vectors,
+                       Vector3F* result, std::size_t count) noexcept
+        {
+            const float* m = matrix.m;
+            std::size_t i = 0;
+
+            // four vectors at a time with the coordinates split into separate registers
+            if (isSimdAvailable)
+            {
+#if defined(__ARM_NEON__)
+                // the matrix is splatted once, result could alias it as far as the compiler knows
+                const float32x4_t m0 = vdupq_n_f32(m[0]), m1 = vdupq_n_f32(m[1]), m2 = vdupq_n_f32(m[2]);
+                const float32x4_t m4 = vdupq_n_f32(m[4]), m5 = vdupq_n_f32(m[5]), m6 = vdupq_n_f32(m[6]);
+                const float32x4_t m8 = vdupq_n_f32(m[8]), m9 = vdupq_n_f32(m[9]), m10 = vdupq_n_f32(m[10]);
+                const float32x4_t m12 = vdupq_n_f32(point ? m[12] : 0.0F);
+                const float32x4_t m13 = vdupq_n_f32(point ? m[13] : 0.0F);
+                const float32x4_t m14 = vdupq_n_f32(point ? m[14] : 0.0F);
+
+                for (; i + 4 <= count; i += 4)
+                {
+                    const float32x4x3_t v = vld3q_f32(vectors[i].v);
+                    float32x4x3_t r;
+                    r.val[0] = vmlaq_f32(vmlaq_f32(vmlaq_f32(m12, v.val[0], m0), v.val[1], m4), v.val[2], m8);
+                    r.val[1] = vmlaq_f32(vmlaq_f32(vmlaq_f32(m13, v.val[0], m1), v.val[1], m5), v.val[2], m9);
+                    r.val[2] = vmlaq_f32(vmlaq_f32(vmlaq_f32(m14, v.val[0], m2), v.val[1], m6), v.val[2], m10);
+                    vst3q_f32(result[i].v, r);
+                }
+#elif defined(__SSE__)
+                // the matrix is splatted once, result could alias it as far as the compiler knows
+                const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+                const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+                const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+                const __m128 m12 = _mm_set1_ps(point ? m[12] : 0.0F);
+                const __m128 m13 = _mm_set1_ps(point ? m[13] : 0.0F);
+                const __m128 m14 = _mm_set1_ps(point ? m[14] : 0.0F);
+
+                for (; i + 4 <= count; i += 4)
+                {
+                    // x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+                    const float* input = vectors[i].v;
+                    const __m128 a = _mm_loadu_ps(input);
+                    const __m128 b = _mm_loadu_ps(input + 4);
+                    const __m128 c = _mm_loadu_ps(input + 8);
+
+                    const __m128 xyz2x3 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2));
+                    const __m128 yz01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+                    const __m128 yz23 = _mm_shuffle_ps(xyz2x3, c, _MM_SHUFFLE(3, 2, 2, 1));
+                    const __m128 x = _mm_shuffle_ps(a, xyz2x3, _MM_SHUFFLE(3, 0, 3, 0));
+                    const __m128 y = _mm_shuffle_ps(yz01, yz23, _MM_SHUFFLE(2, 0, 2, 0));
+                    const __m128 z = _mm_shuffle_ps(yz01, yz23, _MM_SHUFFLE(3, 1, 3, 1));
+
+                    const __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m4)), _mm_mul_ps(z, m8)), m12);
+                    const __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m5)), _mm_mul_ps(z, m9)), m13);
+                    const __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m2), _mm_mul_ps(y, m6)), _mm_mul_ps(z, m10)), m14);
+
+                    const __m128 ryz01 = _mm_unpacklo_ps(ry, rz);
+                    const __m128 ryz23 = _mm_unpackhi_ps(ry, rz);
+                    float* output = result[i].v;
+                    _mm_storeu_ps(output, _mm_shuffle_ps(_mm_unpacklo_ps(rx, ry), _mm_unpacklo_ps(rz, rx), _MM_SHUFFLE(3, 0, 1, 0)));
+                    _mm_storeu_ps(output + 4, _mm_shuffle_ps(ryz01, _mm_unpackhi_ps(rx, ry), _MM_SHUFFLE(1, 0, 3, 2)));
+                    _mm_storeu_ps(output + 8, _mm_shuffle_ps(_mm_unpackhi_ps(rz, rx), ryz23, _MM_SHUFFLE(3, 2, 3, 0)));
+                }
+#endif
+            }
+
+            for (; i < count; ++i)
+            {
+                const Vector3F v = vectors[i];
+                for (std::size_t e = 0; e < 3; ++e)
+                {
+                    result[i].v[e] = v.v[0] * m[e] + v.v[1] * m[4 + e] + v.v[2] * m[8 + e];
+                    if (point) result[i].v[e] += m[12 + e];
+                }
+            }
+        }
+
+#if defined(__ARM_NEON__)
+        // a0..a3 * v
+        inline float32x4_t column(const float32x4_t a0, const float32x4_t a1,
+                                  const float32x4_t a2, const float32x4_t a3,
+                                  const float32x4_t v) noexcept
+        {
+            return vmlaq_lane_f32(vmlaq_lane_f32(vmlaq_lane_f32(vmulq_lane_f32(a0, vget_low_f32(v), 0),
+                                                                a1, vget_low_f32(v), 1),
+                                                 a2, vget_high_f32(v), 0),
+                                  a3, vget_high_f32(v), 1);
+        }
+#elif defined(__SSE__)
+        // a0..a3 * v, summed in pairs like Matrix::multiply
+        inline __m128 column(const __m128 a0, const __m128 a1,
+                             const __m128 a2, const __m128 a3,
+                             const __m128 v) noexcept
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0))),
+                                         _mm_mul_ps(a1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)))),
+                              _mm_add_ps(_mm_mul_ps(a2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))),
+                                         _mm_mul_ps(a3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)))));
+        }
+#endif
+
+        // stores the product of a and b in result, result may be the same as a or b
+        inline void multiply(const float* a, const float* b, float* result) noexcept
+        {
+#if defined(__ARM_NEON__)
+            const float32x4_t a0 = vld1q_f32(a);
+            const float32x4_t a1 = vld1q_f32(a + 4);
+            const float32x4_t a2 = vld1q_f32(a + 8);
+            const float32x4_t a3 = vld1q_f32(a + 12);
+
+            const float32x4_t b0 = vld1q_f32(b);
+            const float32x4_t b1 = vld1q_f32(b + 4);
+            const float32x4_t b2 = vld1q_f32(b + 8);
+            const float32x4_t b3 = vld1q_f32(b + 12);
+
+            vst1q_f32(result, column(a0, a1, a2, a3, b0));
+            vst1q_f32(result + 4, column(a0, a1, a2, a3, b1));
+            vst1q_f32(result + 8, column(a0, a1, a2, a3, b2));
+            vst1q_f32(result + 12, column(a0, a1, a2, a3, b3));
+#elif defined(__SSE__)
+            const __m128 a0 = _mm_load_ps(a);
+            const __m128 a1 = _mm_load_ps(a + 4);
+            const __m128 a2 = _mm_load_ps(a + 8);
+            const __m128 a3 = _mm_load_ps(a + 12);
+
+            const __m128 b0 = _mm_load_ps(b);
+            const __m128 b1 = _mm_load_ps(b + 4);
+            const __m128 b2 = _mm_load_ps(b + 8);
+            const __m128 b3 = _mm_load_ps(b + 12);
+
+            _mm_store_ps(result, column(a0, a1, a2, a3, b0));
+            _mm_store_ps(result + 4, column(a0, a1, a2, a3, b1));
+            _mm_store_ps(result + 8, column(a0, a1, a2, a3, b2));
+            _mm_store_ps(result + 12, column(a0, a1, a2, a3, b3));
+#else
+            static_cast<void>(a);
+            static_cast<void>(b);
+            static_cast<void>(result);
+#endif
+        }
+    }
+
+    void transformPoints(const Matrix4F& matrix, const Vector3F* points,
+                         Vector3F* result, std::size_t count) noexcept
+    {
+        transform<true>(matrix, points, result, count);
+    }
+
+    void transformVectors(const Matrix4F& matrix, const Vector3F* vectors,
+                          Vector3F* result, std::size_t count) noexcept
+    {
+        transform<false>(matrix, vectors, result, count);
+    }
+
+    void transformVectors(const Matrix4F& matrix, const Vector4F* vectors,
+                          Vector4F* result, std::size_t count) noexcept
+    {
+        const float* m = matrix.m;
+
+        if (isSimdAvailable)
+        {
+#if defined(__ARM_NEON__)
+            const float32x4_t c0 = vld1q_f32(m);
+            const float32x4_t c1 = vld1q_f32(m + 4);
+            const float32x4_t c2 = vld1q_f32(m + 8);
+            const float32x4_t c3 = vld1q_f32(m + 12);
+
+            for (std::size_t i = 0; i < count; ++i)
+                vst1q_f32(result[i].v, column(c0, c1, c2, c3, vld1q_f32(vectors[i].v)));
+            return;
+#elif defined(__SSE__)
+            const __m128 c0 = _mm_load_ps(m);
+            const __m128 c1 = _mm_load_ps(m + 4);
+            const __m128 c2 = _mm_load_ps(m + 8);
+            const __m128 c3 = _mm_load_ps(m + 12);
+
+            // summed in the same order as Matrix::transformVector
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const __m128 v = _mm_load_ps(vectors[i].v);
+                const __m128 r = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0))),
+                                                                  _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)))),
+                                                       _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)))),
+                                            _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+                _mm_store_ps(result[i].v, r);
+            }
+            return;
+#endif
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const Vector4F v = vectors[i];
+            matrix.transformVector(v, result[i]);
+        }
+    }
+
+    void multiplyMatrices(const Matrix4F& matrix, const Matrix4F* matrices,
+                          Matrix4F* result, std::size_t count) noexcept
+    {
+        if (isSimdAvailable)
+        {
+#if defined(__ARM_NEON__)
+            const float32x4_t a0 = vld1q_f32(matrix.m);
+            const float32x4_t a1 = vld1q_f32(matrix.m + 4);
+            const float32x4_t a2 = vld1q_f32(matrix.m + 8);
+            const float32x4_t a3 = vld1q_f32(matrix.m + 12);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const float* b = matrices[i].m;
+                const float32x4_t b0 = vld1q_f32(b);
+                const float32x4_t b1 = vld1q_f32(b + 4);
+                const float32x4_t b2 = vld1q_f32(b + 8);
+                const float32x4_t b3 = vld1q_f32(b + 12);
+
+                float* r = result[i].m;
+                vst1q_f32(r, column(a0, a1, a2, a3, b0));
+                vst1q_f32(r + 4, column(a0, a1, a2, a3, b1));
+                vst1q_f32(r + 8, column(a0, a1, a2, a3, b2));
+                vst1q_f32(r + 12, column(a0, a1, a2, a3, b3));
+            }
+            return;
+#elif defined(__SSE__)
+            const __m128 a0 = _mm_load_ps(matrix.m);
+            const __m128 a1 = _mm_load_ps(matrix.m + 4);
+            const __m128 a2 = _mm_load_ps(matrix.m + 8);
+            const __m128 a3 = _mm_load_ps(matrix.m + 12);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const float* b = matrices[i].m;
+                const __m128 b0 = _mm_load_ps(b);
+                const __m128 b1 = _mm_load_ps(b + 4);
+                const __m128 b2 = _mm_load_ps(b + 8);
+                const __m128 b3 = _mm_load_ps(b + 12);
+
+                float* r = result[i].m;
+                _mm_store_ps(r, column(a0, a1, a2, a3, b0));
+                _mm_store_ps(r + 4, column(a0, a1, a2, a3, b1));
+                _mm_store_ps(r + 8, column(a0, a1, a2, a3, b2));
+                _mm_store_ps(r + 12, column(a0, a1, a2, a3, b3));
+            }
+            return;
+#endif
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const Matrix4F m = matrices[i];
+            matrix.multiply(m, result[i]);
+        }
+    }
+
+    void multiplyMatrices(const Matrix4F* first, const Matrix4F* second,
+                          Matrix4F* result, std::size_t count) noexcept
+    {
+        if (isSimdAvailable)
+        {
+#if defined(__ARM_NEON__) || defined(__SSE__)
+            for (std::size_t i = 0; i < count; ++i)
+                multiply(first[i].m, second[i].m, result[i].m);
+            return;
+#endif
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const Matrix4F m = second[i];
+            first[i].multiply(m, result[i]);
+        }
+    }
+
+    void normalizeQuaternions(QuaternionF* quaternions, std::size_t count) noexcept
+    {
+        std::size_t i = 0;
+
+        // four quaternions at a time with the components split into separate registers
+        if (isSimdAvailable)
+        {
+#if defined(__ARM_NEON__) && (defined(__arm64__) || defined(__aarch64__))
+            const float32x4_t one = vdupq_n_f32(1.0F);
+            const float32x4_t minimum = vdupq_n_f32(std::numeric_limits<float>::min());
+
+            for (; i + 4 <= count; i += 4)
+            {
+                float32x4x4_t q = vld4q_f32(quaternions[i].v);
+                const float32x4_t squared = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(q.val[0], q.val[0]),
+                                                                          vmulq_f32(q.val[1], q.val[1])),
+                                                                vmulq_f32(q.val[2], q.val[2])),
+                                                      vmulq_f32(q.val[3], q.val[3]));
+                const float32x4_t length = vsqrtq_f32(squared);
+                const float32x4_t multiplier = vbslq_f32(vcleq_f32(length, minimum), one, vdivq_f32(one, length));
+
+                q.val[0] = vmulq_f32(q.val[0], multiplier);
+                q.val[1] = vmulq_f32(q.val[1], multiplier);
+                q.val[2] = vmulq_f32(q.val[2], multiplier);
+                q.val[3] = vmulq_f32(q.val[3], multiplier);
+
+                vst4q_f32(quaternions[i].v, q);
+            }
+#elif defined(__SSE__)
+            const __m128 one = _mm_set1_ps(1.0F);
+            const __m128 minimum = _mm_set1_ps(std::numeric_limits<float>::min());
+
+            for (; i + 4 <= count; i += 4)
+            {
+                float* data = quaternions[i].v;
+                __m128 x = _mm_loadu_ps(data);
+                __m128 y = _mm_loadu_ps(data + 4);
+                __m128 z = _mm_loadu_ps(data + 8);
+                __m128 w = _mm_loadu_ps(data + 12);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                const __m128 squared = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                                             _mm_mul_ps(z, z)),
+                                                  _mm_mul_ps(w, w));
+                const __m128 length = _mm_sqrt_ps(squared);
+
+                // lengths that are not above the minimum (NaN is) keep the quaternion unchanged
+                const __m128 mask = _mm_cmpnle_ps(length, minimum);
+                const __m128 multiplier = _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(one, length)),
+                                                    _mm_andnot_ps(mask, one));
+
+                x = _mm_mul_ps(x, multiplier);
+                y = _mm_mul_ps(y, multiplier);
+                z = _mm_mul_ps(z, multiplier);
+                w = _mm_mul_ps(w, multiplier);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                _mm_storeu_ps(data, x);
+                _mm_storeu_ps(data + 4, y);
+                _mm_storeu_ps(data + 8, z);
+                _mm_storeu_ps(data + 12, w);
+            }
+#endif
+        }
+
+        for (; i < count; ++i)
+        {
+            float* v = quaternions[i].v;
+            const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+            if (length <= std::numeric_limits<float>::min()) // too close to zero
+                continue;
+
+            const float multiplier = 1.0F / length;
+            v[0] *= multiplier;
+            v[1] *= multiplier;
+            v[2] *= multiplier;
+            v[3] *= multiplier;
+        }
+    }
+
+    void transformBoxes(const Matrix4F& matrix, const Box3F* boxes,
+                        Box3F* result, std::size_t count) noexcept
+    {
+        const float* m = matrix.m;
+
+        // the center is transformed as a point and the half size by the absolute values of the rotation and scale
+        if (isSimdAvailable)
+        {
+#if defined(__ARM_NEON__)
+            const float32x4_t c0 = vld1q_f32(m);
+            const float32x4_t c1 = vld1q_f32(m + 4);
+            const float32x4_t c2 = vld1q_f32(m + 8);
+            const float32x4_t c3 = vld1q_f32(m + 12);
+            const float32x4_t abs0 = vabsq_f32(c0);
+            const float32x4_t abs1 = vabsq_f32(c1);
+            const float32x4_t abs2 = vabsq_f32(c2);
+            const float32x4_t half = vdupq_n_f32(0.5F);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (boxes[i].isEmpty())
+                {
+                    result[i].reset();
+                    continue;
+                }
+
+                const float* input = boxes[i].min.v;
+                const float32x4_t low = vld1q_f32(input); // min x, y, z and max x
+                const float32x4_t high = vld1q_f32(input + 2); // min z and max x, y, z
+                const float32x4_t max = vextq_f32(high, high, 1);
+                const float32x4_t center = vmulq_f32(vaddq_f32(low, max), half);
+                const float32x4_t extent = vmulq_f32(vsubq_f32(max, low), half);
+
+                const float32x4_t newCenter = vaddq_f32(vmlaq_lane_f32(vmlaq_lane_f32(vmulq_lane_f32(c0, vget_low_f32(center), 0),
+                                                                                      c1, vget_low_f32(center), 1),
+                                                                       c2, vget_high_f32(center), 0),
+                                                        c3);
+                const float32x4_t newExtent = vmlaq_lane_f32(vmlaq_lane_f32(vmulq_lane_f32(abs0, vget_low_f32(extent), 0),
+                                                                            abs1, vget_low_f32(extent), 1),
+                                                             abs2, vget_high_f32(extent), 0);
+
+                const float32x4_t newMin = vsubq_f32(newCenter, newExtent);
+                const float32x4_t newMax = vaddq_f32(newCenter, newExtent);
+
+                float* output = result[i].min.v;
+                vst1q_f32(output, vsetq_lane_f32(vgetq_lane_f32(newMax, 0), newMin, 3));
+                vst1q_f32(output + 2, vextq_f32(vextq_f32(newMin, newMin, 3), newMax, 3));
+            }
+            return;
+#elif defined(__SSE__)
+            const __m128 signMask = _mm_set1_ps(-0.0F);
+            const __m128 c0 = _mm_load_ps(m);
+            const __m128 c1 = _mm_load_ps(m + 4);
+            const __m128 c2 = _mm_load_ps(m + 8);
+            const __m128 c3 = _mm_load_ps(m + 12);
+            const __m128 abs0 = _mm_andnot_ps(signMask, c0);
+            const __m128 abs1 = _mm_andnot_ps(signMask, c1);
+            const __m128 abs2 = _mm_andnot_ps(signMask, c2);
+            const __m128 half = _mm_set1_ps(0.5F);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (boxes[i].isEmpty())
+                {
+                    result[i].reset();
+                    continue;
+                }
+
+                const float* input = boxes[i].min.v;
+                const __m128 low = _mm_loadu_ps(input); // min x, y, z and max x
+                const __m128 high = _mm_loadu_ps(input + 2); // min z and max x, y, z
+                const __m128 max = _mm_shuffle_ps(high, high, _MM_SHUFFLE(3, 3, 2, 1));
+                const __m128 center = _mm_mul_ps(_mm_add_ps(low, max), half);
+                const __m128 extent = _mm_mul_ps(_mm_sub_ps(max, low), half);
+
+                const __m128 newCenter = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0))),
+                                                                          _mm_mul_ps(c1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1)))),
+                                                               _mm_mul_ps(c2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2)))),
+                                                    c3);
+                const __m128 newExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(abs0, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(0, 0, 0, 0))),
+                                                               _mm_mul_ps(abs1, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(1, 1, 1, 1)))),
+                                                    _mm_mul_ps(abs2, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(2, 2, 2, 2))));
+
+                const __m128 newMin = _mm_sub_ps(newCenter, newExtent);
+                const __m128 newMax = _mm_add_ps(newCenter, newExtent);
+
+                float* output = result[i].min.v;
+                const __m128 middle = _mm_shuffle_ps(newMin, newMax, _MM_SHUFFLE(0, 0, 2, 2)); // min z, min z, max x, max x
+                _mm_storeu_ps(output, _mm_shuffle_ps(newMin, middle, _MM_SHUFFLE(2, 0, 1, 0)));
+                _mm_storeu_ps(output + 2, _mm_shuffle_ps(middle, newMax, _MM_SHUFFLE(2, 1, 2, 0)));
+            }
+            return;
+#endif
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (boxes[i].isEmpty())
+            {
+                result[i].reset();
+                continue;
+            }
+
+            const Box3F box = boxes[i];
+            float center[3];
+            float extent[3];
+            for (std::size_t c = 0; c < 3; ++c)
+            {
+                center[c] = (box.min.v[c] + box.max.v[c]) * 0.5F;
+                extent[c] = (box.max.v[c] - box.min.v[c]) * 0.5F;
+            }
+
+            for (std::size_t e = 0; e < 3; ++e)
+            {
+                const float newCenter = m[e] * center[0] + m[4 + e] * center[1] + m[8 + e] * center[2] + m[12 + e];
+                const float newExtent = std::fabs(m[e]) * extent[0] + std::fabs(m[4 + e]) * extent[1] + std::fabs(m[8 + e]) * extent[2];
+                result[i].min.v[e] = newCenter - newExtent;
+                result[i].max.v[e] = newCenter + newExtent;
+            }
+        }
+    }
+}
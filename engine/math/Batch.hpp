@@ -0,0 +1,45 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_MATH_BATCH_HPP
+#define OUZEL_MATH_BATCH_HPP
+
+#include <cstddef>
+#include "Box.hpp"
+#include "Matrix.hpp"
+#include "Quaternion.hpp"
+#include "Vector.hpp"
+
+namespace ouzel
+{
+    // Functions that process arrays of math types with SIMD when it is available.
+    // The source and destination arrays may be the same, but must not partially overlap.
+
+    // result[i] = matrix * (points[i], 1)
+    void transformPoints(const Matrix4F& matrix, const Vector3F* points,
+                         Vector3F* result, std::size_t count) noexcept;
+
+    // result[i] = matrix * (vectors[i], 0)
+    void transformVectors(const Matrix4F& matrix, const Vector3F* vectors,
+                          Vector3F* result, std::size_t count) noexcept;
+
+    // result[i] = matrix * vectors[i]
+    void transformVectors(const Matrix4F& matrix, const Vector4F* vectors,
+                          Vector4F* result, std::size_t count) noexcept;
+
+    // result[i] = matrix * matrices[i]
+    void multiplyMatrices(const Matrix4F& matrix, const Matrix4F* matrices,
+                          Matrix4F* result, std::size_t count) noexcept;
+
+    // result[i] = first[i] * second[i]
+    void multiplyMatrices(const Matrix4F* first, const Matrix4F* second,
+                          Matrix4F* result, std::size_t count) noexcept;
+
+    // quaternions that are too close to zero are left unchanged
+    void normalizeQuaternions(QuaternionF* quaternions, std::size_t count) noexcept;
+
+    // calculates the axis-aligned boxes that enclose the transformed boxes, empty boxes stay empty
+    void transformBoxes(const Matrix4F& matrix, const Box3F* boxes,
+                        Box3F* result, std::size_t count) noexcept;
+}
+
+#endif // OUZEL_MATH_BATCH_HPP
@@ -3,6 +3,7 @@
 #ifndef OUZEL_MATH_BOX_HPP
 #define OUZEL_MATH_BOX_HPP
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include "Size.hpp"
@@ -8,6 +8,37 @@
 
 namespace ouzel
 {
+#if defined(__SSE__)
+    namespace
+    {
+        // 2x2 matrices are stored in one register as (m00, m01, m10, m11)
+
+        // a * b
+        inline __m128 multiply2(const __m128 a, const __m128 b) noexcept
+        {
+            return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+                              _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                                         _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+        }
+
+        // adjugate(a) * b
+        inline __m128 adjugateMultiply2(const __m128 a, const __m128 b) noexcept
+        {
+            return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+                              _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)),
+                                         _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+
+        // a * adjugate(b)
+        inline __m128 multiplyAdjugate2(const __m128 a, const __m128 b) noexcept
+        {
+            return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+                              _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                                         _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+        }
+    }
+#endif
+
     template <>
     void Matrix<4, 4, float>::add(float scalar, Matrix& dst) const noexcept
     {
@@ -659,5 +690,110 @@ namespace ouzel
         }
     }
 
+    // the SIMD version inverts the four 2x2 blocks of the matrix, the columns are treated as rows,
+    // because the inverse of the transpose is the transpose of the inverse
+    template <>
+    template <>
+    void Matrix<4, 4, float>::invert<4, 4, nullptr>() noexcept
+    {
+        if (isSimdAvailable)
+        {
+#if defined(__SSE__)
+            const __m128 c0 = _mm_load_ps(&m[0]);
+            const __m128 c1 = _mm_load_ps(&m[4]);
+            const __m128 c2 = _mm_load_ps(&m[8]);
+            const __m128 c3 = _mm_load_ps(&m[12]);
+
+            const __m128 a = _mm_movelh_ps(c0, c1);
+            const __m128 b = _mm_movehl_ps(c1, c0);
+            const __m128 c = _mm_movelh_ps(c2, c3);
+            const __m128 d = _mm_movehl_ps(c3, c2);
+
+            // determinants of a, b, c and d
+            const __m128 determinants = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(2, 0, 2, 0)),
+                                                              _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1))),
+                                                   _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(3, 1, 3, 1)),
+                                                              _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0))));
+            const __m128 determinantA = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 determinantB = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(1, 1, 1, 1));
+            const __m128 determinantC = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(2, 2, 2, 2));
+            const __m128 determinantD = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(3, 3, 3, 3));
+
+            const __m128 dc = adjugateMultiply2(d, c);
+            const __m128 ab = adjugateMultiply2(a, b);
+
+            // adjugates of the blocks of the inverse
+            const __m128 x = _mm_sub_ps(_mm_mul_ps(determinantD, a), multiply2(b, dc));
+            const __m128 w = _mm_sub_ps(_mm_mul_ps(determinantA, d), multiply2(c, ab));
+            const __m128 y = _mm_sub_ps(_mm_mul_ps(determinantB, c), multiplyAdjugate2(d, ab));
+            const __m128 z = _mm_sub_ps(_mm_mul_ps(determinantC, b), multiplyAdjugate2(a, dc));
+
+            // |a| * |d| + |b| * |c| - trace(ab * dc)
+            __m128 trace = _mm_mul_ps(ab, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 1, 2, 0)));
+            trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(2, 3, 0, 1)));
+            trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(1, 0, 3, 2)));
+            const __m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determinantA, determinantD),
+                                                             _mm_mul_ps(determinantB, determinantC)),
+                                                  trace);
+
+            // Close to zero, can't invert
+            if (std::fabs(_mm_cvtss_f32(determinant)) <= std::numeric_limits<float>::min()) return;
+
+            const __m128 reciprocal = _mm_div_ps(_mm_setr_ps(1.0F, -1.0F, -1.0F, 1.0F), determinant);
+            const __m128 rx = _mm_mul_ps(x, reciprocal);
+            const __m128 ry = _mm_mul_ps(y, reciprocal);
+            const __m128 rz = _mm_mul_ps(z, reciprocal);
+            const __m128 rw = _mm_mul_ps(w, reciprocal);
+
+            _mm_store_ps(&m[0], _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(1, 3, 1, 3)));
+            _mm_store_ps(&m[4], _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(0, 2, 0, 2)));
+            _mm_store_ps(&m[8], _mm_shuffle_ps(rz, rw, _MM_SHUFFLE(1, 3, 1, 3)));
+            _mm_store_ps(&m[12], _mm_shuffle_ps(rz, rw, _MM_SHUFFLE(0, 2, 0, 2)));
+            return;
+#endif
+        }
+
+        const float a0 = m[0] * m[5] - m[1] * m[4];
+        const float a1 = m[0] * m[6] - m[2] * m[4];
+        const float a2 = m[0] * m[7] - m[3] * m[4];
+        const float a3 = m[1] * m[6] - m[2] * m[5];
+        const float a4 = m[1] * m[7] - m[3] * m[5];
+        const float a5 = m[2] * m[7] - m[3] * m[6];
+        const float b0 = m[8] * m[13] - m[9] * m[12];
+        const float b1 = m[8] * m[14] - m[10] * m[12];
+        const float b2 = m[8] * m[15] - m[11] * m[12];
+        const float b3 = m[9] * m[14] - m[10] * m[13];
+        const float b4 = m[9] * m[15] - m[11] * m[13];
+        const float b5 = m[10] * m[15] - m[11] * m[14];
+
+        const float determinant = a0 * b5 - a1 * b4 + a2 * b3 + a3 * b2 - a4 * b1 + a5 * b0;
+
+        // Close to zero, can't invert
+        if (std::fabs(determinant) <= std::numeric_limits<float>::min()) return;
+
+        Matrix adjugate;
+        adjugate.m[0] = m[5] * b5 - m[6] * b4 + m[7] * b3;
+        adjugate.m[1] = -m[1] * b5 + m[2] * b4 - m[3] * b3;
+        adjugate.m[2] = m[13] * a5 - m[14] * a4 + m[15] * a3;
+        adjugate.m[3] = -m[9] * a5 + m[10] * a4 - m[11] * a3;
+
+        adjugate.m[4] = -m[4] * b5 + m[6] * b2 - m[7] * b1;
+        adjugate.m[5] = m[0] * b5 - m[2] * b2 + m[3] * b1;
+        adjugate.m[6] = -m[12] * a5 + m[14] * a2 - m[15] * a1;
+        adjugate.m[7] = m[8] * a5 - m[10] * a2 + m[11] * a1;
+
+        adjugate.m[8] = m[4] * b4 - m[5] * b2 + m[7] * b0;
+        adjugate.m[9] = -m[0] * b4 + m[1] * b2 - m[3] * b0;
+        adjugate.m[10] = m[12] * a4 - m[13] * a2 + m[15] * a0;
+        adjugate.m[11] = -m[8] * a4 + m[9] * a2 - m[11] * a0;
+
+        adjugate.m[12] = -m[4] * b3 + m[5] * b1 - m[6] * b0;
+        adjugate.m[13] = m[0] * b3 - m[1] * b1 + m[2] * b0;
+        adjugate.m[14] = -m[12] * a3 + m[13] * a1 - m[14] * a0;
+        adjugate.m[15] = m[8] * a3 - m[9] * a1 + m[10] * a0;
+
+        adjugate.multiply(1.0F / determinant, *this);
+    }
+
     template class Matrix<4, 4, float>;
 }
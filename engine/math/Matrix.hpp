@@ -646,6 +646,51 @@ namespace ouzel
             adjugate.multiply(T(1) / determinant, *this);
         }
 
+        // faster than invert, but only for matrices whose last row is (0, 0, 0, 1),
+        // e.g. combinations of translation, rotation and scale
+        template <std::size_t X = C, std::size_t Y = R, typename std::enable_if<(X == 4 && Y == 4)>::type* = nullptr>
+        void invertAffine() noexcept
+        {
+            // the rows of the inverse of the upper-left 3x3 part are the cross products of its columns
+            const T r00 = m[5] * m[10] - m[6] * m[9];
+            const T r01 = m[6] * m[8] - m[4] * m[10];
+            const T r02 = m[4] * m[9] - m[5] * m[8];
+
+            const T determinant = m[0] * r00 + m[1] * r01 + m[2] * r02;
+
+            // Close to zero, can't invert
+            if (std::fabs(determinant) <= std::numeric_limits<T>::min()) return;
+
+            const T r10 = m[9] * m[2] - m[10] * m[1];
+            const T r11 = m[10] * m[0] - m[8] * m[2];
+            const T r12 = m[8] * m[1] - m[9] * m[0];
+            const T r20 = m[1] * m[6] - m[2] * m[5];
+            const T r21 = m[2] * m[4] - m[0] * m[6];
+            const T r22 = m[0] * m[5] - m[1] * m[4];
+
+            const T scale = T(1) / determinant;
+            const T x = m[12];
+            const T y = m[13];
+            const T z = m[14];
+
+            m[0] = r00 * scale;
+            m[1] = r10 * scale;
+            m[2] = r20 * scale;
+            m[3] = T(0);
+            m[4] = r01 * scale;
+            m[5] = r11 * scale;
+            m[6] = r21 * scale;
+            m[7] = T(0);
+            m[8] = r02 * scale;
+            m[9] = r12 * scale;
+            m[10] = r22 * scale;
+            m[11] = T(0);
+            m[12] = -(m[0] * x + m[4] * y + m[8] * z);
+            m[13] = -(m[1] * x + m[5] * y + m[9] * z);
+            m[14] = -(m[2] * x + m[6] * y + m[10] * z);
+            m[15] = T(1);
+        }
+
         template <std::size_t X = C, std::size_t Y = R, typename std::enable_if<(X == Y)>::type* = nullptr>
         inline auto isIdentity() const noexcept
         {
@@ -1020,6 +1065,10 @@ namespace ouzel
 
     // TODO: scalar * matrix
 
+    template <>
+    template <>
+    void Matrix<4, 4, float>::invert<4, 4, nullptr>() noexcept;
+
     using Matrix4F = Matrix<4, 4, float>;
 }
 
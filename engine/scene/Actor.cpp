@@ -247,10 +247,10 @@ namespace ouzel
                 component->setActor(nullptr);
         }
 
-        void Actor::visit(std::vector<Actor*>& drawQueue,
+        void Actor::visit(const std::vector<Camera*>& cameras,
+                          std::vector<std::vector<Actor*>>& drawQueues,
                           const Matrix4F& newParentTransform,
                           bool parentTransformDirty,
-                          Camera* camera,
                           Order parentOrder,
                           bool parentHidden)
         {
@@ -264,19 +264,14 @@ namespace ouzel
             {
                 const Box3F boundingBox = getBoundingBox();
 
-                if (cullDisabled || (!boundingBox.isEmpty() && camera->checkVisibility(getTransform(), boundingBox)))
-                {
-                    auto upperBound = std::upper_bound(drawQueue.begin(), drawQueue.end(), this,
-                                                       [](const auto a, const auto b) noexcept {
-                                                           return a->worldOrder > b->worldOrder;
-                                                       });
-
-                    drawQueue.insert(upperBound, this);
-                }
+                // the layer sorts the queues after all the actors were visited
+                for (std::size_t i = 0; i < cameras.size(); ++i)
+                    if (cullDisabled || (!boundingBox.isEmpty() && cameras[i]->checkVisibility(getTransform(), boundingBox)))
+                        drawQueues[i].push_back(this);
             }
 
             for (Actor* actor : children)
-                actor->visit(drawQueue, transform, updateChildrenTransform, camera, worldOrder, worldHidden);
+                actor->visit(cameras, drawQueues, transform, updateChildrenTransform, worldOrder, worldHidden);
 
             updateChildrenTransform = false;
         }
@@ -494,7 +489,7 @@ namespace ouzel
         void Actor::calculateInverseTransform() const
         {
             inverseTransform = getTransform();
-            inverseTransform.invert();
+            inverseTransform.invertAffine();
             inverseTransformDirty = false;
         }
 
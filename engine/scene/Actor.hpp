@@ -72,10 +72,11 @@ namespace ouzel
             Actor() = default;
             ~Actor() override;
 
-            virtual void visit(std::vector<Actor*>& drawQueue,
+            // updates the transforms and adds the actor and its children to the draw queues of the cameras that see them
+            virtual void visit(const std::vector<Camera*>& cameras,
+                               std::vector<std::vector<Actor*>>& drawQueues,
                                const Matrix4F& newParentTransform,
                                bool parentTransformDirty,
-                               Camera* camera,
                                Order parentOrder,
                                bool parentHidden);
             virtual void draw(Camera* camera, bool wireframe);
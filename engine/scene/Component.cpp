@@ -1,7 +1,11 @@
 // Copyright 2015-2020 Elviss Strazdins. All rights reserved.
 
+#include <algorithm>
+#include <limits>
 #include "Component.hpp"
 #include "Actor.hpp"
+#include "Layer.hpp"
+#include "../core/Engine.hpp"
 #include "../math/MathUtils.hpp"
 
 namespace ouzel
@@ -18,6 +22,8 @@ namespace ouzel
                              const Matrix4F&,
                              bool)
         {
+            // instanced draws that were added before this component must be submitted first
+            if (layer) layer->getInstanceBatch().flush();
         }
 
         bool Component::pointOn(const Vector2F& position) const
@@ -107,5 +113,41 @@ namespace ouzel
         void Component::updateTransform()
         {
         }
+
+        Size2F Component::getScreenSize(const Matrix4F& modelViewProj) const
+        {
+            if (boundingBox.isEmpty()) return Size2F();
+
+            const Size2U& renderSize = engine->getRenderer()->getSize();
+
+            Vector2F min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+            Vector2F max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+
+            for (std::uint32_t corner = 0; corner < 8; ++corner)
+            {
+                const Vector4F point((corner & 1) ? boundingBox.max.v[0] : boundingBox.min.v[0],
+                                     (corner & 2) ? boundingBox.max.v[1] : boundingBox.min.v[1],
+                                     (corner & 4) ? boundingBox.max.v[2] : boundingBox.min.v[2],
+                                     1.0F);
+                Vector4F clipPoint;
+                modelViewProj.transformVector(point, clipPoint);
+
+                // the box crosses the near plane, so it covers the whole screen
+                if (clipPoint.v[3] <= 0.0F)
+                    return Size2F(static_cast<float>(renderSize.v[0]), static_cast<float>(renderSize.v[1]));
+
+                const float x = clipPoint.v[0] / clipPoint.v[3];
+                const float y = clipPoint.v[1] / clipPoint.v[3];
+
+                min.v[0] = std::min(min.v[0], x);
+                min.v[1] = std::min(min.v[1], y);
+                max.v[0] = std::max(max.v[0], x);
+                max.v[1] = std::max(max.v[1], y);
+            }
+
+            // normalized device coordinates span two units
+            return Size2F((max.v[0] - min.v[0]) * renderSize.v[0] / 2.0F,
+                          (max.v[1] - min.v[1]) * renderSize.v[1] / 2.0F);
+        }
     } // namespace scene
 } // namespace ouzel
@@ -9,10 +9,16 @@
 #include "../math/Matrix.hpp"
 #include "../math/Color.hpp"
 #include "../math/Rect.hpp"
+#include "../math/Size.hpp"
 #include "../graphics/Texture.hpp"
 
 namespace ouzel
 {
+    namespace graphics
+    {
+        class Material;
+    }
+
     namespace scene
     {
         class Actor;
@@ -31,11 +37,15 @@ namespace ouzel
             Component(Component&&) = delete;
             Component& operator=(Component&&) = delete;
 
+            // overrides must call this before drawing to keep the draw order of instanced components
             virtual void draw(const Matrix4F& transformMatrix,
                               float opacity,
                               const Matrix4F& renderViewProjection,
                               bool wireframe);
 
+            // material whose state is used to order the draws of the layer, if the component has one
+            virtual const graphics::Material* getDrawMaterial() const noexcept { return nullptr; }
+
             virtual const Box3F& getBoundingBox() const noexcept { return boundingBox; }
             virtual void setBoundingBox(const Box3F& newBoundingBox) { boundingBox = newBoundingBox; }
 
@@ -53,6 +63,9 @@ namespace ouzel
             virtual void setLayer(Layer* newLayer);
             virtual void updateTransform();
 
+            // size of the projected bounding box in render target pixels
+            Size2F getScreenSize(const Matrix4F& modelViewProj) const;
+
             Box3F boundingBox;
             bool hidden = false;
 
@@ -0,0 +1,87 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include "InstanceBatch.hpp"
+#include "../core/Engine.hpp"
+#include "../graphics/Renderer.hpp"
+
+namespace ouzel
+{
+    namespace scene
+    {
+        void InstanceBatch::add(const Draw& draw, const Matrix4F& transform, Color color)
+        {
+            if (!instances.empty() && draw != current)
+                flush();
+
+            if (instances.empty()) current = draw;
+
+            instances.emplace_back(transform, color);
+        }
+
+        void InstanceBatch::flush()
+        {
+            if (instances.empty()) return;
+
+            auto renderer = engine->getRenderer();
+
+            std::vector<std::vector<float>> fragmentShaderConstants(1);
+            std::vector<std::vector<float>> vertexShaderConstants(1);
+
+            // a single instance does not need the instance buffer
+            if (instances.size() == 1)
+            {
+                const graphics::Instance& instance = instances.front();
+                const Matrix4F modelViewProj = current.viewProjection * instance.transform;
+
+                fragmentShaderConstants[0] = {
+                    current.color[0] * instance.color.normR(),
+                    current.color[1] * instance.color.normG(),
+                    current.color[2] * instance.color.normB(),
+                    current.color[3] * instance.color.normA()
+                };
+                vertexShaderConstants[0] = {std::begin(modelViewProj.m), std::end(modelViewProj.m)};
+
+                renderer->setPipelineState(pipelineState.get(*renderer, current.blendState, current.shader,
+                                                             current.cullMode, current.fillMode));
+                renderer->setShaderConstants(fragmentShaderConstants, vertexShaderConstants);
+                renderer->setTextures(current.textures);
+                renderer->draw(current.indexBuffer,
+                               current.indexCount,
+                               current.indexSize,
+                               current.vertexBuffer,
+                               graphics::DrawMode::TriangleList,
+                               0);
+            }
+            else
+            {
+                // each flush of the frame gets its own buffer, because the data of the previous draws must not be overwritten
+                if (usedBuffers == buffers.size())
+                    buffers.push_back(std::make_unique<graphics::Buffer>(*renderer,
+                                                                         graphics::BufferType::Vertex,
+                                                                         graphics::Flags::Dynamic));
+
+                graphics::Buffer& buffer = *buffers[usedBuffers++];
+                buffer.setData(instances.data(),
+                               static_cast<std::uint32_t>(instances.size() * sizeof(graphics::Instance)));
+
+                fragmentShaderConstants[0] = {current.color.begin(), current.color.end()};
+                vertexShaderConstants[0] = {std::begin(current.viewProjection.m), std::end(current.viewProjection.m)};
+
+                renderer->setPipelineState(instancedPipelineState.get(*renderer, current.blendState, current.instancedShader,
+                                                                      current.cullMode, current.fillMode));
+                renderer->setShaderConstants(fragmentShaderConstants, vertexShaderConstants);
+                renderer->setTextures(current.textures);
+                renderer->drawInstanced(current.indexBuffer,
+                                        current.indexCount,
+                                        current.indexSize,
+                                        current.vertexBuffer,
+                                        buffer.getResource(),
+                                        static_cast<std::uint32_t>(instances.size()),
+                                        graphics::DrawMode::TriangleList,
+                                        0);
+            }
+
+            instances.clear();
+        }
+    } // namespace scene
+} // namespace ouzel
@@ -0,0 +1,81 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_SCENE_INSTANCEBATCH_HPP
+#define OUZEL_SCENE_INSTANCEBATCH_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../graphics/Buffer.hpp"
+#include "../graphics/CachedPipelineState.hpp"
+#include "../graphics/RasterizerState.hpp"
+#include "../graphics/Vertex.hpp"
+#include "../math/Matrix.hpp"
+
+namespace ouzel
+{
+    namespace scene
+    {
+        // Merges draws that follow each other in the draw queue and differ only in the transform
+        // and the color of the instance into one instanced draw, so the draw order does not change
+        class InstanceBatch final
+        {
+        public:
+            class Draw final
+            {
+            public:
+                bool operator==(const Draw& other) const
+                {
+                    return indexBuffer == other.indexBuffer &&
+                        indexCount == other.indexCount &&
+                        indexSize == other.indexSize &&
+                        vertexBuffer == other.vertexBuffer &&
+                        blendState == other.blendState &&
+                        shader == other.shader &&
+                        instancedShader == other.instancedShader &&
+                        cullMode == other.cullMode &&
+                        fillMode == other.fillMode &&
+                        color == other.color &&
+                        textures == other.textures &&
+                        viewProjection == other.viewProjection;
+                }
+
+                bool operator!=(const Draw& other) const
+                {
+                    return !(*this == other);
+                }
+
+                std::uintptr_t indexBuffer = 0;
+                std::uint32_t indexCount = 0;
+                std::uint32_t indexSize = 0;
+                std::uintptr_t vertexBuffer = 0;
+                std::uintptr_t blendState = 0;
+                std::uintptr_t shader = 0; // used when there is only one instance
+                std::uintptr_t instancedShader = 0;
+                graphics::CullMode cullMode = graphics::CullMode::NoCull;
+                graphics::FillMode fillMode = graphics::FillMode::Solid;
+                std::array<float, 4> color{}; // multiplied by the instance color
+                std::vector<std::uintptr_t> textures;
+                Matrix4F viewProjection;
+            };
+
+            // submits the pending instances first if they were added with a different draw
+            void add(const Draw& draw, const Matrix4F& transform, Color color);
+            void flush();
+
+            // the instance buffers can be reused once the previous frame was submitted
+            inline void reset() noexcept { usedBuffers = 0; }
+
+        private:
+            Draw current;
+            graphics::CachedPipelineState pipelineState;
+            graphics::CachedPipelineState instancedPipelineState;
+            std::vector<graphics::Instance> instances;
+            std::vector<std::unique_ptr<graphics::Buffer>> buffers;
+            std::size_t usedBuffers = 0;
+        };
+    } // namespace scene
+} // namespace ouzel
+
+#endif // OUZEL_SCENE_INSTANCEBATCH_HPP
@@ -2,12 +2,14 @@
 
 #include <cassert>
 #include <algorithm>
+#include <cstring>
 #include "Layer.hpp"
 #include "Actor.hpp"
 #include "Camera.hpp"
 #include "Scene.hpp"
 #include "Component.hpp"
 #include "../core/Engine.hpp"
+#include "../graphics/Material.hpp"
 #include "../graphics/Renderer.hpp"
 #include "../math/Matrix.hpp"
 
@@ -15,6 +17,85 @@ namespace ouzel
 {
     namespace scene
     {
+        namespace
+        {
+            // smaller chunks cost more to merge than they save
+            constexpr std::size_t minDrawsPerChunk = 256;
+
+            thread_local InstanceBatch* currentInstanceBatch = nullptr;
+
+            // Higher orders are drawn first. With depth test the actors of the same order are split into
+            // opaque ones, grouped by the shader and the texture, followed by transparent ones from back to front.
+            // Without depth test they are drawn in the order they were visited.
+            std::uint64_t getSortKey(const Actor& actor, bool depthTest, const Matrix4F& viewProjection)
+            {
+                const std::uint64_t key = static_cast<std::uint64_t>(~(static_cast<std::uint32_t>(actor.getWorldOrder()) ^ 0x80000000U)) << 32;
+
+                if (!depthTest) return key;
+
+                const graphics::Material* material = nullptr;
+                for (const Component* component : actor.getComponents())
+                    if (!component->isHidden() && (material = component->getDrawMaterial()) != nullptr)
+                        break;
+
+                if (material && material->blendState && !material->blendState->isBlendingEnabled())
+                {
+                    const std::uint64_t shader = material->shader ? material->shader->getResource() : 0;
+                    const std::uint64_t texture = material->textures[0] ? material->textures[0]->getResource() : 0;
+                    return key | ((shader & 0x7FFFU) << 16) | (texture & 0xFFFFU);
+                }
+
+                const Matrix4F& transform = actor.getTransform();
+                const float x = transform.m[12];
+                const float y = transform.m[13];
+                const float z = transform.m[14];
+                const float clipZ = viewProjection.m[2] * x + viewProjection.m[6] * y + viewProjection.m[10] * z + viewProjection.m[14];
+                const float clipW = viewProjection.m[3] * x + viewProjection.m[7] * y + viewProjection.m[11] * z + viewProjection.m[15];
+                const float depth = clipW > 0.0F ? clipZ / clipW : clipZ;
+
+                // flip the bits so that the unsigned order matches the float order, then invert it to draw far actors first
+                std::uint32_t depthBits;
+                std::memcpy(&depthBits, &depth, sizeof(depthBits));
+                depthBits = (depthBits & 0x80000000U) ? ~depthBits : (depthBits | 0x80000000U);
+
+                return key | 0x80000000U | (~depthBits >> 1);
+            }
+
+            // stable LSD radix sort by the 64-bit key, the passes where all the keys have the same byte are skipped
+            template <class T>
+            void radixSort(std::vector<T>& items, std::vector<T>& buffer)
+            {
+                if (items.size() < 2) return;
+
+                std::size_t counts[8][256]{};
+                for (const T& item : items)
+                    for (std::size_t pass = 0; pass < 8; ++pass)
+                        ++counts[pass][(item.key >> (pass * 8)) & 0xFFU];
+
+                buffer.resize(items.size());
+
+                for (std::size_t pass = 0; pass < 8; ++pass)
+                {
+                    std::size_t* count = counts[pass];
+                    if (count[(items.front().key >> (pass * 8)) & 0xFFU] == items.size())
+                        continue;
+
+                    std::size_t offset = 0;
+                    for (std::size_t digit = 0; digit < 256; ++digit)
+                    {
+                        const std::size_t digitCount = count[digit];
+                        count[digit] = offset;
+                        offset += digitCount;
+                    }
+
+                    for (const T& item : items)
+                        buffer[count[(item.key >> (pass * 8)) & 0xFFU]++] = item;
+
+                    items.swap(buffer);
+                }
+            }
+        }
+
         Layer::Layer()
         {
             layer = this;
@@ -27,23 +108,86 @@ namespace ouzel
 
         void Layer::draw()
         {
-            for (Camera* camera : cameras)
+            instanceBatch.reset();
+            for (InstanceBatch& chunkInstanceBatch : chunkInstanceBatches)
+                chunkInstanceBatch.reset();
+
+            if (cameras.empty()) return;
+
+            // one traversal updates the transforms and tests the actors against all the cameras
+            drawQueues.resize(cameras.size());
+            for (std::vector<Actor*>& drawQueue : drawQueues)
+                drawQueue.clear();
+
+            for (Actor* actor : children)
+                actor->visit(cameras, drawQueues, Matrix4F::identity(), false, 0, false);
+
+            for (std::size_t cameraIndex = 0; cameraIndex < cameras.size(); ++cameraIndex)
             {
-                std::vector<Actor*> drawQueue;
+                Camera* camera = cameras[cameraIndex];
+                const std::vector<Actor*>& drawQueue = drawQueues[cameraIndex];
+
+                const bool depthTest = camera->getDepthTest();
+                const Matrix4F& viewProjection = camera->getRenderViewProjection();
+
+                drawItems.clear();
+                drawItems.reserve(drawQueue.size());
+                for (Actor* actor : drawQueue)
+                    drawItems.push_back(DrawItem{getSortKey(*actor, depthTest, viewProjection), actor});
 
-                for (Actor* actor : children)
-                    actor->visit(drawQueue, Matrix4F::identity(), false, camera, 0, false);
+                radixSort(drawItems, sortBuffer);
 
                 engine->getRenderer()->setRenderTarget(camera->getRenderTarget() ? camera->getRenderTarget()->getResource() : 0);
                 engine->getRenderer()->setViewport(camera->getRenderViewport());
                 engine->getRenderer()->setDepthStencilState(camera->getDepthStencilState() ? camera->getDepthStencilState()->getResource() : 0,
                                                             camera->getStencilReferenceValue());
 
-                for (Actor* actor : drawQueue)
-                    actor->draw(camera, camera->getWireframe());
+                const std::size_t chunkCount = parallelEncoding ?
+                    std::min(drawItems.size() / minDrawsPerChunk, engine->getRenderer()->getEncoderCount()) : 0;
+
+                if (chunkCount > 1)
+                {
+                    if (chunkInstanceBatches.size() < chunkCount) chunkInstanceBatches.resize(chunkCount);
+
+                    engine->getRenderer()->encodeParallel(chunkCount, [this, camera, chunkCount](std::size_t chunk) {
+                        const std::size_t begin = drawItems.size() * chunk / chunkCount;
+                        const std::size_t end = drawItems.size() * (chunk + 1) / chunkCount;
+
+                        // instances are not merged across chunks, because every chunk has its own command buffer
+                        InstanceBatch& chunkInstanceBatch = chunkInstanceBatches[chunk];
+                        currentInstanceBatch = &chunkInstanceBatch;
+
+                        try
+                        {
+                            for (std::size_t i = begin; i < end; ++i)
+                                drawItems[i].actor->draw(camera, camera->getWireframe());
+
+                            chunkInstanceBatch.flush();
+                        }
+                        catch (...)
+                        {
+                            currentInstanceBatch = nullptr;
+                            throw;
+                        }
+
+                        currentInstanceBatch = nullptr;
+                    });
+                }
+                else
+                {
+                    for (const DrawItem& drawItem : drawItems)
+                        drawItem.actor->draw(camera, camera->getWireframe());
+
+                    instanceBatch.flush();
+                }
             }
         }
 
+        InstanceBatch& Layer::getInstanceBatch() noexcept
+        {
+            return currentInstanceBatch ? *currentInstanceBatch : instanceBatch;
+        }
+
         void Layer::addChild(Actor* actor)
         {
             ActorContainer::addChild(actor);
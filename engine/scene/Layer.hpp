@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <vector>
 #include "../scene/Actor.hpp"
+#include "../scene/InstanceBatch.hpp"
 #include "../math/Vector.hpp"
 
 namespace ouzel
@@ -32,6 +33,13 @@ namespace ouzel
             void addChild(Actor* actor) override;
 
             inline auto& getCameras() const noexcept { return cameras; }
+            // each encoder thread has its own batch while the layer is encoded in parallel
+            InstanceBatch& getInstanceBatch() noexcept;
+
+            // Large draw queues are split into chunks that are recorded on the encoder threads of the renderer.
+            // Components of the actors in the layer must not change state that they share with other actors while drawing.
+            inline auto isParallelEncoding() const noexcept { return parallelEncoding; }
+            inline void setParallelEncoding(bool newParallelEncoding) noexcept { parallelEncoding = newParallelEncoding; }
 
             std::pair<Actor*, Vector3F> pickActor(const Vector2F& position, bool renderTargets = false) const;
             std::vector<std::pair<Actor*, Vector3F>> pickActors(const Vector2F& position, bool renderTargets = false) const;
@@ -59,6 +67,22 @@ namespace ouzel
             std::vector<Light*> lights;
 
             Order order = 0;
+
+            InstanceBatch instanceBatch;
+            bool parallelEncoding = false;
+
+        private:
+            struct DrawItem final
+            {
+                std::uint64_t key;
+                Actor* actor;
+            };
+
+            // reused between frames
+            std::vector<std::vector<Actor*>> drawQueues; // one for each camera
+            std::vector<DrawItem> drawItems;
+            std::vector<DrawItem> sortBuffer;
+            std::vector<InstanceBatch> chunkInstanceBatches;
         };
     } // namespace scene
 } // namespace ouzel
@@ -2,7 +2,13 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <limits>
 #include <stdexcept>
+#if defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#elif defined(__SSE__)
+#  include <xmmintrin.h>
+#endif
 #include "ParticleSystem.hpp"
 #include "SceneManager.hpp"
 #include "Actor.hpp"
@@ -11,6 +17,7 @@
 #include "../assets/Cache.hpp"
 #include "../core/Engine.hpp"
 #include "../storage/FileSystem.hpp"
+#include "../utils/Thread.hpp"
 #include "../utils/Utils.hpp"
 #include "../math/MathUtils.hpp"
 
@@ -21,6 +28,279 @@ namespace ouzel
         namespace
         {
             constexpr float UPDATE_STEP = 1.0F / 60.0F;
+
+            // particle systems smaller than this are not worth distributing across threads
+            constexpr std::size_t MIN_PARALLEL_PARTICLES = 16 * 1024;
+            constexpr std::size_t MIN_PARTICLES_PER_THREAD = 4 * 1024;
+
+            // calls function(first, last) for disjoint ranges, in parallel for large particle systems
+            template <class F>
+            void processParticles(std::size_t count, F function)
+            {
+                const std::size_t hardwareThreads = std::thread::hardware_concurrency();
+                std::size_t threadCount = (count >= MIN_PARALLEL_PARTICLES && hardwareThreads > 1) ?
+                    std::min(hardwareThreads, count / MIN_PARTICLES_PER_THREAD) : 1;
+                if (threadCount < 1) threadCount = 1;
+
+                if (threadCount == 1)
+                {
+                    function(std::size_t{0}, count);
+                    return;
+                }
+
+                // ranges are multiples of 16 floats (64 bytes), so neighbouring threads write to at most one
+                // shared cache line of each array, at the boundary between their ranges
+                const std::size_t particlesPerThread = ((count + threadCount - 1) / threadCount + 15) & ~std::size_t{15};
+
+                std::vector<Thread> threads;
+                threads.reserve(threadCount - 1);
+
+                // the calling thread processes the first range itself
+                for (std::size_t first = particlesPerThread; first < count; first += particlesPerThread)
+                    threads.emplace_back(function, first, std::min(first + particlesPerThread, count));
+
+                function(std::size_t{0}, std::min(particlesPerThread, count));
+
+                for (auto& thread : threads) thread.join();
+            }
+
+            // values[i] += deltas[i] * UPDATE_STEP
+            void advance(float* values, const float* deltas, std::size_t count) noexcept
+            {
+                std::size_t i = 0;
+
+                if (isSimdAvailable)
+                {
+#if defined(__ARM_NEON__)
+                    const float32x4_t step = vdupq_n_f32(UPDATE_STEP);
+                    for (; i + 4 <= count; i += 4)
+                        vst1q_f32(values + i, vaddq_f32(vld1q_f32(values + i), vmulq_f32(vld1q_f32(deltas + i), step)));
+#elif defined(__SSE__)
+                    const __m128 step = _mm_set1_ps(UPDATE_STEP);
+                    for (; i + 4 <= count; i += 4)
+                        _mm_storeu_ps(values + i, _mm_add_ps(_mm_loadu_ps(values + i), _mm_mul_ps(_mm_loadu_ps(deltas + i), step)));
+#endif
+                }
+
+                for (; i < count; ++i)
+                    values[i] += deltas[i] * UPDATE_STEP;
+            }
+
+            // values[i] = max(0, values[i] + deltas[i] * UPDATE_STEP)
+            void advanceNonNegative(float* values, const float* deltas, std::size_t count) noexcept
+            {
+                std::size_t i = 0;
+
+                if (isSimdAvailable)
+                {
+#if defined(__ARM_NEON__)
+                    const float32x4_t step = vdupq_n_f32(UPDATE_STEP);
+                    const float32x4_t zero = vdupq_n_f32(0.0F);
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        const float32x4_t value = vaddq_f32(vld1q_f32(values + i), vmulq_f32(vld1q_f32(deltas + i), step));
+                        // std::max(0, NaN) is 0
+                        vst1q_f32(values + i, vbslq_f32(vcltq_f32(zero, value), value, zero));
+                    }
+#elif defined(__SSE__)
+                    const __m128 step = _mm_set1_ps(UPDATE_STEP);
+                    const __m128 zero = _mm_setzero_ps();
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        const __m128 value = _mm_add_ps(_mm_loadu_ps(values + i), _mm_mul_ps(_mm_loadu_ps(deltas + i), step));
+                        // std::max(0, NaN) is 0
+                        _mm_storeu_ps(values + i, _mm_and_ps(_mm_cmplt_ps(zero, value), value));
+                    }
+#endif
+                }
+
+                for (; i < count; ++i)
+                    values[i] = std::max(0.0F, values[i] + deltas[i] * UPDATE_STEP);
+            }
+
+            // values[i] -= UPDATE_STEP
+            void decrease(float* values, std::size_t count) noexcept
+            {
+                std::size_t i = 0;
+
+                if (isSimdAvailable)
+                {
+#if defined(__ARM_NEON__)
+                    const float32x4_t step = vdupq_n_f32(UPDATE_STEP);
+                    for (; i + 4 <= count; i += 4)
+                        vst1q_f32(values + i, vsubq_f32(vld1q_f32(values + i), step));
+#elif defined(__SSE__)
+                    const __m128 step = _mm_set1_ps(UPDATE_STEP);
+                    for (; i + 4 <= count; i += 4)
+                        _mm_storeu_ps(values + i, _mm_sub_ps(_mm_loadu_ps(values + i), step));
+#endif
+                }
+
+                for (; i < count; ++i)
+                    values[i] -= UPDATE_STEP;
+            }
+
+            struct GravityParticles final
+            {
+                float* positionX;
+                float* positionY;
+                float* directionX;
+                float* directionY;
+                const float* radialAcceleration;
+                const float* tangentialAcceleration;
+            };
+
+            // moves the particles by the gravity and their radial and tangential acceleration
+            void applyGravity(const GravityParticles& p, std::size_t count,
+                              const Vector2F& gravity, float positionMultiplier) noexcept
+            {
+                std::size_t i = 0;
+
+                if (isSimdAvailable)
+                {
+#if defined(__ARM_NEON__) && (defined(__arm64__) || defined(__aarch64__))
+                    const float32x4_t zero = vdupq_n_f32(0.0F);
+                    const float32x4_t one = vdupq_n_f32(1.0F);
+                    const float32x4_t minimum = vdupq_n_f32(std::numeric_limits<float>::min());
+                    const float32x4_t step = vdupq_n_f32(UPDATE_STEP);
+                    const float32x4_t gravityX = vdupq_n_f32(gravity.v[0]);
+                    const float32x4_t gravityY = vdupq_n_f32(gravity.v[1]);
+                    const float32x4_t multiplier = vdupq_n_f32(positionMultiplier);
+
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        const float32x4_t x = vld1q_f32(p.positionX + i);
+                        const float32x4_t y = vld1q_f32(p.positionY + i);
+
+                        // the normalized position for particles on an axis, otherwise zero
+                        const float32x4_t squared = vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y));
+                        const float32x4_t length = vsqrtq_f32(squared);
+                        const float32x4_t scale = vdivq_f32(one, length);
+                        const uint32x4_t unchanged = vorrq_u32(vceqq_f32(squared, one), vcleq_f32(length, minimum));
+                        const uint32x4_t onAxis = vorrq_u32(vceqq_f32(x, zero), vceqq_f32(y, zero));
+                        const float32x4_t normalX = vbslq_f32(onAxis, vbslq_f32(unchanged, x, vmulq_f32(x, scale)), zero);
+                        const float32x4_t normalY = vbslq_f32(onAxis, vbslq_f32(unchanged, y, vmulq_f32(y, scale)), zero);
+
+                        const float32x4_t radial = vld1q_f32(p.radialAcceleration + i);
+                        const float32x4_t tangential = vld1q_f32(p.tangentialAcceleration + i);
+
+                        const float32x4_t accelerationX = vmulq_f32(vaddq_f32(vaddq_f32(vmulq_f32(normalX, radial),
+                                                                                        vmulq_f32(normalY, vnegq_f32(tangential))),
+                                                                              gravityX), step);
+                        const float32x4_t accelerationY = vmulq_f32(vaddq_f32(vaddq_f32(vmulq_f32(normalY, radial),
+                                                                                        vmulq_f32(normalX, tangential)),
+                                                                              gravityY), step);
+
+                        const float32x4_t directionX = vaddq_f32(vld1q_f32(p.directionX + i), accelerationX);
+                        const float32x4_t directionY = vaddq_f32(vld1q_f32(p.directionY + i), accelerationY);
+                        vst1q_f32(p.directionX + i, directionX);
+                        vst1q_f32(p.directionY + i, directionY);
+
+                        vst1q_f32(p.positionX + i, vaddq_f32(x, vmulq_f32(vmulq_f32(directionX, step), multiplier)));
+                        vst1q_f32(p.positionY + i, vaddq_f32(y, vmulq_f32(vmulq_f32(directionY, step), multiplier)));
+                    }
+#elif defined(__SSE__)
+                    const __m128 zero = _mm_setzero_ps();
+                    const __m128 one = _mm_set1_ps(1.0F);
+                    const __m128 minimum = _mm_set1_ps(std::numeric_limits<float>::min());
+                    const __m128 signMask = _mm_set1_ps(-0.0F);
+                    const __m128 step = _mm_set1_ps(UPDATE_STEP);
+                    const __m128 gravityX = _mm_set1_ps(gravity.v[0]);
+                    const __m128 gravityY = _mm_set1_ps(gravity.v[1]);
+                    const __m128 multiplier = _mm_set1_ps(positionMultiplier);
+
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        const __m128 x = _mm_loadu_ps(p.positionX + i);
+                        const __m128 y = _mm_loadu_ps(p.positionY + i);
+
+                        // the normalized position for particles on an axis, otherwise zero
+                        const __m128 squared = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+                        const __m128 length = _mm_sqrt_ps(squared);
+                        const __m128 scale = _mm_div_ps(one, length);
+                        const __m128 unchanged = _mm_or_ps(_mm_cmpeq_ps(squared, one), _mm_cmple_ps(length, minimum));
+                        const __m128 onAxis = _mm_or_ps(_mm_cmpeq_ps(x, zero), _mm_cmpeq_ps(y, zero));
+                        const __m128 normalX = _mm_and_ps(onAxis, _mm_or_ps(_mm_and_ps(unchanged, x),
+                                                                            _mm_andnot_ps(unchanged, _mm_mul_ps(x, scale))));
+                        const __m128 normalY = _mm_and_ps(onAxis, _mm_or_ps(_mm_and_ps(unchanged, y),
+                                                                            _mm_andnot_ps(unchanged, _mm_mul_ps(y, scale))));
+
+                        const __m128 radial = _mm_loadu_ps(p.radialAcceleration + i);
+                        const __m128 tangential = _mm_loadu_ps(p.tangentialAcceleration + i);
+
+                        const __m128 accelerationX = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, radial),
+                                                                                      _mm_mul_ps(normalY, _mm_xor_ps(tangential, signMask))),
+                                                                           gravityX), step);
+                        const __m128 accelerationY = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalY, radial),
+                                                                                      _mm_mul_ps(normalX, tangential)),
+                                                                           gravityY), step);
+
+                        const __m128 directionX = _mm_add_ps(_mm_loadu_ps(p.directionX + i), accelerationX);
+                        const __m128 directionY = _mm_add_ps(_mm_loadu_ps(p.directionY + i), accelerationY);
+                        _mm_storeu_ps(p.directionX + i, directionX);
+                        _mm_storeu_ps(p.directionY + i, directionY);
+
+                        _mm_storeu_ps(p.positionX + i, _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(directionX, step), multiplier)));
+                        _mm_storeu_ps(p.positionY + i, _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(directionY, step), multiplier)));
+                    }
+#endif
+                }
+
+                for (; i < count; ++i)
+                {
+                    const Vector2F position(p.positionX[i], p.positionY[i]);
+
+                    // radial acceleration
+                    Vector2F normal;
+                    if (position.v[0] == 0.0F || position.v[1] == 0.0F)
+                        normal = position.normalized();
+
+                    // (gravity + radial + tangential) * UPDATE_STEP
+                    const float accelerationX = (normal.v[0] * p.radialAcceleration[i] + normal.v[1] * -p.tangentialAcceleration[i] + gravity.v[0]) * UPDATE_STEP;
+                    const float accelerationY = (normal.v[1] * p.radialAcceleration[i] + normal.v[0] * p.tangentialAcceleration[i] + gravity.v[1]) * UPDATE_STEP;
+
+                    p.directionX[i] += accelerationX;
+                    p.directionY[i] += accelerationY;
+                    p.positionX[i] += p.directionX[i] * UPDATE_STEP * positionMultiplier;
+                    p.positionY[i] += p.directionY[i] * UPDATE_STEP * positionMultiplier;
+                }
+            }
+        }
+
+        std::vector<float> ParticleSystem::Particles::* const ParticleSystem::Particles::fields[] = {
+            &Particles::life,
+            &Particles::positionX,
+            &Particles::positionY,
+            &Particles::colorRed,
+            &Particles::colorGreen,
+            &Particles::colorBlue,
+            &Particles::colorAlpha,
+            &Particles::deltaColorRed,
+            &Particles::deltaColorGreen,
+            &Particles::deltaColorBlue,
+            &Particles::deltaColorAlpha,
+            &Particles::angle,
+            &Particles::size,
+            &Particles::deltaSize,
+            &Particles::rotation,
+            &Particles::deltaRotation,
+            &Particles::radialAcceleration,
+            &Particles::tangentialAcceleration,
+            &Particles::directionX,
+            &Particles::directionY,
+            &Particles::radius,
+            &Particles::degreesPerSecond,
+            &Particles::deltaRadius
+        };
+
+        void ParticleSystem::Particles::resize(std::size_t newSize)
+        {
+            for (auto field : fields) (this->*field).resize(newSize);
+        }
+
+        void ParticleSystem::Particles::copy(std::size_t from, std::size_t to)
+        {
+            for (auto field : fields) (this->*field)[to] = (this->*field)[from];
         }
 
         ParticleSystem::ParticleSystem():
@@ -75,10 +355,11 @@ namespace ouzel
                 std::vector<std::vector<float>> vertexShaderConstants(1);
                 vertexShaderConstants[0] = {std::begin(transform.m), std::end(transform.m)};
 
-                engine->getRenderer()->setPipelineState(blendState->getResource(),
-                                                        shader->getResource(),
-                                                        graphics::CullMode::NoCull,
-                                                        wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid);
+                engine->getRenderer()->setPipelineState(pipelineState.get(*engine->getRenderer(),
+                                                                          blendState->getResource(),
+                                                                          shader->getResource(),
+                                                                          graphics::CullMode::NoCull,
+                                                                          wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid));
                 engine->getRenderer()->setShaderConstants(pixelShaderConstants,
                                                           vertexShaderConstants);
                 engine->getRenderer()->setTextures({wireframe ? whitePixelTexture->getResource() : texture->getResource()});
@@ -140,68 +421,18 @@ namespace ouzel
 
                 if (active)
                 {
+                    processParticles(particleCount, [this](std::size_t first, std::size_t last) {
+                        updateParticles(first, last);
+                    });
+
+                    // dead particles are replaced by the last one
                     for (std::uint32_t counter = particleCount; counter > 0; --counter)
                     {
                         const std::size_t i = counter - 1;
 
-                        particles[i].life -= UPDATE_STEP;
-
-                        if (particles[i].life >= 0.0F)
-                        {
-                            if (particleSystemData.emitterType == ParticleSystemData::EmitterType::Gravity)
-                            {
-                                Vector2F tmp;
-                                Vector2F radial;
-                                Vector2F tangential;
-
-                                // radial acceleration
-                                if (particles[i].position.v[0] == 0.0F || particles[i].position.v[1] == 0.0F)
-                                    radial = particles[i].position.normalized();
-
-                                tangential = radial;
-                                radial *= particles[i].radialAcceleration;
-
-                                // tangential acceleration
-                                std::swap(tangential.v[0], tangential.v[1]);
-                                tangential.v[0] *= - particles[i].tangentialAcceleration;
-                                tangential.v[1] *= particles[i].tangentialAcceleration;
-
-                                // (gravity + radial + tangential) * UPDATE_STEP
-                                tmp.v[0] = radial.v[0] + tangential.v[0] + particleSystemData.gravity.v[0];
-                                tmp.v[1] = radial.v[1] + tangential.v[1] + particleSystemData.gravity.v[1];
-                                tmp *= UPDATE_STEP;
-
-                                particles[i].direction.v[0] += tmp.v[0];
-                                particles[i].direction.v[1] += tmp.v[1];
-                                tmp.v[0] = particles[i].direction.v[0] * UPDATE_STEP * (particleSystemData.yCoordFlipped ? 1.0F : 0.0F);
-                                tmp.v[1] = particles[i].direction.v[1] * UPDATE_STEP * (particleSystemData.yCoordFlipped ? 1.0F : 0.0F);
-                                particles[i].position.v[0] += tmp.v[0];
-                                particles[i].position.v[1] += tmp.v[1];
-                            }
-                            else
-                            {
-                                particles[i].angle += particles[i].degreesPerSecond * UPDATE_STEP;
-                                particles[i].radius += particles[i].deltaRadius * UPDATE_STEP;
-                                particles[i].position.v[0] = -std::cos(particles[i].angle) * particles[i].radius;
-                                particles[i].position.v[1] = -std::sin(particles[i].angle) * particles[i].radius * (particleSystemData.yCoordFlipped ? 1.0F : 0.0F);
-                            }
-
-                            // color r,g,b,a
-                            particles[i].colorRed += particles[i].deltaColorRed * UPDATE_STEP;
-                            particles[i].colorGreen += particles[i].deltaColorGreen * UPDATE_STEP;
-                            particles[i].colorBlue += particles[i].deltaColorBlue * UPDATE_STEP;
-                            particles[i].colorAlpha += particles[i].deltaColorAlpha * UPDATE_STEP;
-
-                            // size
-                            particles[i].size += (particles[i].deltaSize * UPDATE_STEP);
-                            particles[i].size = std::max(0.0F, particles[i].size);
-
-                            // angle
-                            particles[i].rotation += particles[i].deltaRotation * UPDATE_STEP;
-                        }
-                        else
+                        if (!(particles.life[i] >= 0.0F))
                         {
-                            particles[i] = particles[particleCount - 1];
+                            particles.copy(particleCount - 1, i);
                             --particleCount;
                         }
                     }
@@ -225,7 +456,7 @@ namespace ouzel
 
                         for (std::uint32_t i = 0; i < particleCount; ++i)
                         {
-                            auto position = Vector3F(particles[i].position);
+                            Vector3F position(particles.positionX[i], particles.positionY[i], 0.0F);
                             inverseTransform.transformPoint(position);
                             boundingBox.insertPoint(position);
                         }
@@ -234,9 +465,50 @@ namespace ouzel
                 else if (particleSystemData.positionType == ParticleSystemData::PositionType::Grouped)
                 {
                     for (std::uint32_t i = 0; i < particleCount; ++i)
-                        boundingBox.insertPoint(Vector3F(particles[i].position));
+                        boundingBox.insertPoint(Vector3F(particles.positionX[i], particles.positionY[i], 0.0F));
+                }
+            }
+        }
+
+        void ParticleSystem::updateParticles(std::size_t first, std::size_t last)
+        {
+            const std::size_t count = last - first;
+            const float positionMultiplier = particleSystemData.yCoordFlipped ? 1.0F : 0.0F;
+
+            decrease(&particles.life[first], count);
+
+            if (particleSystemData.emitterType == ParticleSystemData::EmitterType::Gravity)
+            {
+                GravityParticles gravityParticles;
+                gravityParticles.positionX = &particles.positionX[first];
+                gravityParticles.positionY = &particles.positionY[first];
+                gravityParticles.directionX = &particles.directionX[first];
+                gravityParticles.directionY = &particles.directionY[first];
+                gravityParticles.radialAcceleration = &particles.radialAcceleration[first];
+                gravityParticles.tangentialAcceleration = &particles.tangentialAcceleration[first];
+
+                applyGravity(gravityParticles, count, particleSystemData.gravity, positionMultiplier);
+            }
+            else
+            {
+                advance(&particles.angle[first], &particles.degreesPerSecond[first], count);
+                advance(&particles.radius[first], &particles.deltaRadius[first], count);
+
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    particles.positionX[i] = -std::cos(particles.angle[i]) * particles.radius[i];
+                    particles.positionY[i] = -std::sin(particles.angle[i]) * particles.radius[i] * positionMultiplier;
                 }
             }
+
+            advance(&particles.colorRed[first], &particles.deltaColorRed[first], count);
+            advance(&particles.colorGreen[first], &particles.deltaColorGreen[first], count);
+            advance(&particles.colorBlue[first], &particles.deltaColorBlue[first], count);
+            advance(&particles.colorAlpha[first], &particles.deltaColorAlpha[first], count);
+
+            advanceNonNegative(&particles.size[first], &particles.deltaSize[first], count);
+
+            advance(&particles.rotation[first], &particles.deltaRotation[first], count);
         }
 
         void ParticleSystem::init(const ParticleSystemData& newParticleSystemData)
@@ -331,50 +603,61 @@ namespace ouzel
         {
             if (actor)
             {
-                for (std::uint32_t counter = particleCount; counter > 0; --counter)
-                {
-                    const std::size_t i = counter - 1;
+                const Vector2F offset = (particleSystemData.positionType == ParticleSystemData::PositionType::Free) ?
+                    Vector2F() :
+                    (particleSystemData.positionType == ParticleSystemData::PositionType::Parent) ?
+                    Vector2F(actor->getPosition()) :
+                    (particleSystemData.positionType == ParticleSystemData::PositionType::Grouped) ?
+                    Vector2F() :
+                    throw std::runtime_error("Invalid position type");
+
+                processParticles(particleCount, [this, &offset](std::size_t first, std::size_t last) {
+                    updateVertices(first, last, offset);
+                });
 
-                    const Vector2F position = (particleSystemData.positionType == ParticleSystemData::PositionType::Free) ?
-                        particles[i].position :
-                        (particleSystemData.positionType == ParticleSystemData::PositionType::Parent) ?
-                        Vector2F(actor->getPosition()) + particles[i].position :
-                        (particleSystemData.positionType == ParticleSystemData::PositionType::Grouped) ?
-                        Vector2F() :
-                        throw std::runtime_error("Invalid position type");
+                // only the vertices of the live particles are uploaded
+                vertexBuffer->setData(vertices.data(), static_cast<std::uint32_t>(particleCount * 4 * sizeof(graphics::Vertex)));
+            }
+        }
+
+        void ParticleSystem::updateVertices(std::size_t first, std::size_t last, const Vector2F& offset)
+        {
+            const bool grouped = particleSystemData.positionType == ParticleSystemData::PositionType::Grouped;
 
-                    const float halfSize = particles[i].size / 2.0F;
-                    Vector2F v1(-halfSize, -halfSize);
-                    Vector2F v2(halfSize, halfSize);
+            for (std::size_t i = first; i < last; ++i)
+            {
+                const Vector2F position = grouped ? offset : Vector2F(particles.positionX[i] + offset.v[0],
+                                                                      particles.positionY[i] + offset.v[1]);
 
-                    const float r = -degToRad(particles[i].rotation);
-                    const float cr = std::cos(r);
-                    const float sr = std::sin(r);
+                const float halfSize = particles.size[i] / 2.0F;
+                const Vector2F v1(-halfSize, -halfSize);
+                const Vector2F v2(halfSize, halfSize);
 
-                    const Vector2F a(v1.v[0] * cr - v1.v[1] * sr, v1.v[0] * sr + v1.v[1] * cr);
-                    const Vector2F b(v2.v[0] * cr - v1.v[1] * sr, v2.v[0] * sr + v1.v[1] * cr);
-                    const Vector2F c(v2.v[0] * cr - v2.v[1] * sr, v2.v[0] * sr + v2.v[1] * cr);
-                    const Vector2F d(v1.v[0] * cr - v2.v[1] * sr, v1.v[0] * sr + v2.v[1] * cr);
+                const float r = -degToRad(particles.rotation[i]);
+                const float cr = std::cos(r);
+                const float sr = std::sin(r);
 
-                    const Color color(static_cast<std::uint8_t>(particles[i].colorRed * 255),
-                                      static_cast<std::uint8_t>(particles[i].colorGreen * 255),
-                                      static_cast<std::uint8_t>(particles[i].colorBlue * 255),
-                                      static_cast<std::uint8_t>(particles[i].colorAlpha * 255));
+                const Vector2F a(v1.v[0] * cr - v1.v[1] * sr, v1.v[0] * sr + v1.v[1] * cr);
+                const Vector2F b(v2.v[0] * cr - v1.v[1] * sr, v2.v[0] * sr + v1.v[1] * cr);
+                const Vector2F c(v2.v[0] * cr - v2.v[1] * sr, v2.v[0] * sr + v2.v[1] * cr);
+                const Vector2F d(v1.v[0] * cr - v2.v[1] * sr, v1.v[0] * sr + v2.v[1] * cr);
 
-                    vertices[i * 4 + 0].position = Vector3F(a + position);
-                    vertices[i * 4 + 0].color = color;
+                const Color color(static_cast<std::uint8_t>(particles.colorRed[i] * 255),
+                                  static_cast<std::uint8_t>(particles.colorGreen[i] * 255),
+                                  static_cast<std::uint8_t>(particles.colorBlue[i] * 255),
+                                  static_cast<std::uint8_t>(particles.colorAlpha[i] * 255));
 
-                    vertices[i * 4 + 1].position = Vector3F(b + position);
-                    vertices[i * 4 + 1].color = color;
+                vertices[i * 4 + 0].position = Vector3F(a + position);
+                vertices[i * 4 + 0].color = color;
 
-                    vertices[i * 4 + 2].position = Vector3F(d + position);
-                    vertices[i * 4 + 2].color = color;
+                vertices[i * 4 + 1].position = Vector3F(b + position);
+                vertices[i * 4 + 1].color = color;
 
-                    vertices[i * 4 + 3].position = Vector3F(c + position);
-                    vertices[i * 4 + 3].color = color;
-                }
+                vertices[i * 4 + 2].position = Vector3F(d + position);
+                vertices[i * 4 + 2].color = color;
 
-                vertexBuffer->setData(vertices.data(), static_cast<std::uint32_t>(getVectorSize(vertices)));
+                vertices[i * 4 + 3].position = Vector3F(c + position);
+                vertices[i * 4 + 3].color = color;
             }
         }
 
@@ -397,38 +680,40 @@ namespace ouzel
                 {
                     if (particleSystemData.emitterType == ParticleSystemData::EmitterType::Gravity)
                     {
-                        particles[i].life = std::max(particleSystemData.particleLifespan + particleSystemData.particleLifespanVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F);
+                        particles.life[i] = std::max(particleSystemData.particleLifespan + particleSystemData.particleLifespanVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F);
 
-                        particles[i].position = particleSystemData.sourcePosition + position + Vector2F(particleSystemData.sourcePositionVariance.v[0] * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine),
-                                                                                                        particleSystemData.sourcePositionVariance.v[1] * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine));
+                        const Vector2F particlePosition = particleSystemData.sourcePosition + position + Vector2F(particleSystemData.sourcePositionVariance.v[0] * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine),
+                                                                                                                  particleSystemData.sourcePositionVariance.v[1] * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine));
+                        particles.positionX[i] = particlePosition.v[0];
+                        particles.positionY[i] = particlePosition.v[1];
 
-                        particles[i].size = std::max(particleSystemData.startParticleSize + particleSystemData.startParticleSizeVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F);
+                        particles.size[i] = std::max(particleSystemData.startParticleSize + particleSystemData.startParticleSizeVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F);
 
                         const float finishSize = std::max(particleSystemData.finishParticleSize + particleSystemData.finishParticleSizeVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F);
-                        particles[i].deltaSize = (finishSize - particles[i].size) / particles[i].life;
+                        particles.deltaSize[i] = (finishSize - particles.size[i]) / particles.life[i];
 
-                        particles[i].colorRed = clamp(particleSystemData.startColorRed + particleSystemData.startColorRedVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
-                        particles[i].colorGreen = clamp(particleSystemData.startColorGreen + particleSystemData.startColorGreenVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
-                        particles[i].colorBlue = clamp(particleSystemData.startColorBlue + particleSystemData.startColorBlueVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
-                        particles[i].colorAlpha = clamp(particleSystemData.startColorAlpha + particleSystemData.startColorAlphaVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
+                        particles.colorRed[i] = clamp(particleSystemData.startColorRed + particleSystemData.startColorRedVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
+                        particles.colorGreen[i] = clamp(particleSystemData.startColorGreen + particleSystemData.startColorGreenVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
+                        particles.colorBlue[i] = clamp(particleSystemData.startColorBlue + particleSystemData.startColorBlueVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
+                        particles.colorAlpha[i] = clamp(particleSystemData.startColorAlpha + particleSystemData.startColorAlphaVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
 
                         const float finishColorRed = clamp(particleSystemData.finishColorRed + particleSystemData.finishColorRedVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
                         const float finishColorGreen = clamp(particleSystemData.finishColorGreen + particleSystemData.finishColorGreenVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
                         const float finishColorBlue = clamp(particleSystemData.finishColorBlue + particleSystemData.finishColorBlueVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
                         const float finishColorAlpha = clamp(particleSystemData.finishColorAlpha + particleSystemData.finishColorAlphaVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine), 0.0F, 1.0F);
 
-                        particles[i].deltaColorRed = (finishColorRed - particles[i].colorRed) / particles[i].life;
-                        particles[i].deltaColorGreen = (finishColorGreen - particles[i].colorGreen) / particles[i].life;
-                        particles[i].deltaColorBlue = (finishColorBlue - particles[i].colorBlue) / particles[i].life;
-                        particles[i].deltaColorAlpha = (finishColorAlpha - particles[i].colorAlpha) / particles[i].life;
+                        particles.deltaColorRed[i] = (finishColorRed - particles.colorRed[i]) / particles.life[i];
+                        particles.deltaColorGreen[i] = (finishColorGreen - particles.colorGreen[i]) / particles.life[i];
+                        particles.deltaColorBlue[i] = (finishColorBlue - particles.colorBlue[i]) / particles.life[i];
+                        particles.deltaColorAlpha[i] = (finishColorAlpha - particles.colorAlpha[i]) / particles.life[i];
 
-                        particles[i].rotation = particleSystemData.startRotation + particleSystemData.startRotationVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
+                        particles.rotation[i] = particleSystemData.startRotation + particleSystemData.startRotationVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
 
                         const float finishRotation = particleSystemData.finishRotation + particleSystemData.finishRotationVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
-                        particles[i].deltaRotation = (finishRotation - particles[i].rotation) / particles[i].life;
+                        particles.deltaRotation[i] = (finishRotation - particles.rotation[i]) / particles.life[i];
 
-                        particles[i].radialAcceleration = particleSystemData.radialAcceleration + particleSystemData.radialAcceleration * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
-                        particles[i].tangentialAcceleration = particleSystemData.tangentialAcceleration + particleSystemData.tangentialAcceleration * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
+                        particles.radialAcceleration[i] = particleSystemData.radialAcceleration + particleSystemData.radialAcceleration * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
+                        particles.tangentialAcceleration[i] = particleSystemData.tangentialAcceleration + particleSystemData.tangentialAcceleration * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
 
                         if (particleSystemData.rotationIsDir)
                         {
@@ -436,8 +721,9 @@ namespace ouzel
                             const Vector2F v(std::cos(a), std::sin(a));
                             const float s = particleSystemData.speed + particleSystemData.speedVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
                             const Vector2F dir = v * s;
-                            particles[i].direction = dir;
-                            particles[i].rotation = -radToDeg(dir.getAngle());
+                            particles.directionX[i] = dir.v[0];
+                            particles.directionY[i] = dir.v[1];
+                            particles.rotation[i] = -radToDeg(dir.getAngle());
                         }
                         else
                         {
@@ -445,17 +731,18 @@ namespace ouzel
                             const Vector2F v(std::cos(a), std::sin(a));
                             const float s = particleSystemData.speed + particleSystemData.speedVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
                             const Vector2F dir = v * s;
-                            particles[i].direction = dir;
+                            particles.directionX[i] = dir.v[0];
+                            particles.directionY[i] = dir.v[1];
                         }
                     }
                     else
                     {
-                        particles[i].radius = particleSystemData.maxRadius + particleSystemData.maxRadiusVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
-                        particles[i].angle = degToRad(particleSystemData.angle + particleSystemData.angleVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine));
-                        particles[i].degreesPerSecond = degToRad(particleSystemData.rotatePerSecond + particleSystemData.rotatePerSecondVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine));
+                        particles.radius[i] = particleSystemData.maxRadius + particleSystemData.maxRadiusVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
+                        particles.angle[i] = degToRad(particleSystemData.angle + particleSystemData.angleVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine));
+                        particles.degreesPerSecond[i] = degToRad(particleSystemData.rotatePerSecond + particleSystemData.rotatePerSecondVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine));
 
                         const float endRadius = particleSystemData.minRadius + particleSystemData.minRadiusVariance * std::uniform_real_distribution<float>{-1.0F, 1.0F}(randomEngine);
-                        particles[i].deltaRadius = (endRadius - particles[i].radius) / particles[i].life;
+                        particles.deltaRadius[i] = (endRadius - particles.radius[i]) / particles.life[i];
                     }
                 }
 
@@ -13,6 +13,7 @@
 #include "../graphics/Vertex.hpp"
 #include "../graphics/BlendState.hpp"
 #include "../graphics/Buffer.hpp"
+#include "../graphics/CachedPipelineState.hpp"
 #include "../graphics/Shader.hpp"
 #include "../graphics/Texture.hpp"
 
@@ -151,50 +152,63 @@ namespace ouzel
             void createParticleMesh();
             void updateParticleMesh();
 
+            // the ranges are processed on multiple threads for large particle systems
+            void updateParticles(std::size_t first, std::size_t last);
+            void updateVertices(std::size_t first, std::size_t last, const Vector2F& offset);
+
             void emitParticles(std::uint32_t count);
 
             ParticleSystemData particleSystemData;
 
             const graphics::Shader* shader = nullptr;
             const graphics::BlendState* blendState = nullptr;
+            graphics::CachedPipelineState pipelineState;
             std::shared_ptr<graphics::Texture> texture;
             std::shared_ptr<graphics::Texture> whitePixelTexture;
 
-            struct Particle final
+            // particle state stored as one array per field
+            struct Particles final
             {
-                float life = 0.0F;
+                void resize(std::size_t size);
+                void copy(std::size_t from, std::size_t to);
+
+                std::vector<float> life;
+
+                std::vector<float> positionX;
+                std::vector<float> positionY;
 
-                Vector2F position;
+                std::vector<float> colorRed;
+                std::vector<float> colorGreen;
+                std::vector<float> colorBlue;
+                std::vector<float> colorAlpha;
 
-                float colorRed = 0.0F;
-                float colorGreen = 0.0F;
-                float colorBlue = 0.0F;
-                float colorAlpha = 0.0F;
+                std::vector<float> deltaColorRed;
+                std::vector<float> deltaColorGreen;
+                std::vector<float> deltaColorBlue;
+                std::vector<float> deltaColorAlpha;
 
-                float deltaColorRed = 0.0F;
-                float deltaColorGreen = 0.0F;
-                float deltaColorBlue = 0.0F;
-                float deltaColorAlpha = 0.0F;
+                std::vector<float> angle;
 
-                float angle = 0.0F;
-                float speed = 0.0F;
+                std::vector<float> size;
+                std::vector<float> deltaSize;
 
-                float size = 0.0F;
-                float deltaSize = 0.0F;
+                std::vector<float> rotation;
+                std::vector<float> deltaRotation;
 
-                float rotation = 0.0F;
-                float deltaRotation = 0.0F;
+                std::vector<float> radialAcceleration;
+                std::vector<float> tangentialAcceleration;
 
-                float radialAcceleration = 0.0F;
-                float tangentialAcceleration = 0.0F;
+                std::vector<float> directionX;
+                std::vector<float> directionY;
+                std::vector<float> radius;
+                std::vector<float> degreesPerSecond;
+                std::vector<float> deltaRadius;
 
-                Vector2F direction;
-                float radius = 0.0F;
-                float degreesPerSecond = 0.0F;
-                float deltaRadius = 0.0F;
+            private:
+                static std::vector<float> Particles::* const fields[];
             };
 
-            std::vector<Particle> particles;
+            Particles particles;
 
             std::unique_ptr<graphics::Buffer> indexBuffer;
             std::unique_ptr<graphics::Buffer> vertexBuffer;
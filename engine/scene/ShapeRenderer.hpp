@@ -8,6 +8,7 @@
 #include "../graphics/Renderer.hpp"
 #include "../graphics/BlendState.hpp"
 #include "../graphics/Buffer.hpp"
+#include "../graphics/CachedPipelineState.hpp"
 #include "../graphics/Shader.hpp"
 #include "../math/Color.hpp"
 
@@ -76,6 +77,7 @@ namespace ouzel
 
             const graphics::Shader* shader = nullptr;
             const graphics::BlendState* blendState = nullptr;
+            graphics::CachedPipelineState pipelineState;
             graphics::Buffer indexBuffer;
             graphics::Buffer vertexBuffer;
 
@@ -324,10 +324,16 @@ namespace ouzel
                                   const Matrix4F& renderViewProjection,
                                   bool wireframe)
         {
-            Component::draw(transformMatrix,
-                            opacity,
-                            renderViewProjection,
-                            wireframe);
+            const graphics::Shader* instancedShader = (instancing && layer && material &&
+                                                       material->shader == engine->getCache().getShader(SHADER_TEXTURE)) ?
+                engine->getCache().getShader(SHADER_TEXTURE_INSTANCED) : nullptr;
+
+            // the batch is submitted by the next component that is not instanced
+            if (!instancedShader)
+                Component::draw(transformMatrix,
+                                opacity,
+                                renderViewProjection,
+                                wireframe);
 
             if (currentAnimation != animationQueue.end() &&
                 currentAnimation->animation->frameInterval > 0.0F &&
@@ -337,6 +343,54 @@ namespace ouzel
                 auto currentFrame = static_cast<std::size_t>(currentTime / currentAnimation->animation->frameInterval);
                 if (currentFrame >= currentAnimation->animation->frames.size()) currentFrame = currentAnimation->animation->frames.size() - 1;
 
+                std::vector<std::uintptr_t> textures;
+                textures.reserve(graphics::Material::TEXTURE_LAYERS);
+                for (const std::shared_ptr<graphics::Texture>& texture : material->textures)
+                    textures.push_back(texture ? texture->getResource() : 0);
+
+                // sprite vertices are in source pixels, so the texture is scaled the same as the frame
+                if (engine->getRenderer()->getTextureStreamer().isEnabled() &&
+                    boundingBox.max.v[0] > boundingBox.min.v[0] &&
+                    boundingBox.max.v[1] > boundingBox.min.v[1])
+                {
+                    const Size2F screenSize = getScreenSize(renderViewProjection * transformMatrix);
+                    const float scaleX = screenSize.v[0] / (boundingBox.max.v[0] - boundingBox.min.v[0]);
+                    const float scaleY = screenSize.v[1] / (boundingBox.max.v[1] - boundingBox.min.v[1]);
+
+                    for (const std::shared_ptr<graphics::Texture>& texture : material->textures)
+                        if (texture)
+                            texture->requestScreenSize(Size2F(texture->getSize().v[0] * scaleX,
+                                                              texture->getSize().v[1] * scaleY));
+                }
+
+                const SpriteData::Frame& frame = currentAnimation->animation->frames[currentFrame];
+
+                if (instancedShader)
+                {
+                    InstanceBatch::Draw instanceDraw;
+                    instanceDraw.indexBuffer = frame.getIndexBuffer()->getResource();
+                    instanceDraw.indexCount = frame.getIndexCount();
+                    instanceDraw.indexSize = sizeof(std::uint16_t);
+                    instanceDraw.vertexBuffer = frame.getVertexBuffer()->getResource();
+                    instanceDraw.blendState = material->blendState->getResource();
+                    instanceDraw.shader = material->shader->getResource();
+                    instanceDraw.instancedShader = instancedShader->getResource();
+                    instanceDraw.cullMode = graphics::CullMode::NoCull;
+                    instanceDraw.fillMode = wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid;
+                    instanceDraw.color = {
+                        material->diffuseColor.normR(),
+                        material->diffuseColor.normG(),
+                        material->diffuseColor.normB(),
+                        material->diffuseColor.normA() * material->opacity
+                    };
+                    instanceDraw.textures = std::move(textures);
+                    instanceDraw.viewProjection = renderViewProjection;
+
+                    layer->getInstanceBatch().add(instanceDraw, transformMatrix * offsetMatrix,
+                                                  Color(Vector4F(1.0F, 1.0F, 1.0F, opacity)));
+                    return;
+                }
+
                 const Matrix4F modelViewProj = renderViewProjection * transformMatrix * offsetMatrix;
                 const float colorVector[] = {
                     material->diffuseColor.normR(),
@@ -351,21 +405,14 @@ namespace ouzel
                 std::vector<std::vector<float>> vertexShaderConstants(1);
                 vertexShaderConstants[0] = {std::begin(modelViewProj.m), std::end(modelViewProj.m)};
 
-                std::vector<std::uintptr_t> textures;
-                textures.reserve(graphics::Material::TEXTURE_LAYERS);
-                for (const std::shared_ptr<graphics::Texture>& texture : material->textures)
-                    textures.push_back(texture ? texture->getResource() : 0);
-
-                engine->getRenderer()->setPipelineState(material->blendState->getResource(),
-                                                        material->shader->getResource(),
-                                                        graphics::CullMode::NoCull,
-                                                        wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid);
+                engine->getRenderer()->setPipelineState(pipelineState.get(*engine->getRenderer(),
+                                                                          material->blendState->getResource(),
+                                                                          material->shader->getResource(),
+                                                                          graphics::CullMode::NoCull,
+                                                                          wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid));
                 engine->getRenderer()->setShaderConstants(fragmentShaderConstants,
                                                           vertexShaderConstants);
                 engine->getRenderer()->setTextures(textures);
-
-                const SpriteData::Frame& frame = currentAnimation->animation->frames[currentFrame];
-
                 engine->getRenderer()->draw(frame.getIndexBuffer()->getResource(),
                                             frame.getIndexCount(),
                                             sizeof(std::uint16_t),
@@ -15,6 +15,7 @@
 #include "../events/EventHandler.hpp"
 #include "../graphics/BlendState.hpp"
 #include "../graphics/Buffer.hpp"
+#include "../graphics/CachedPipelineState.hpp"
 #include "../graphics/Material.hpp"
 #include "../graphics/Shader.hpp"
 #include "../graphics/Texture.hpp"
@@ -101,9 +102,15 @@ namespace ouzel
                       const Matrix4F& renderViewProjection,
                       bool wireframe) override;
 
+            const graphics::Material* getDrawMaterial() const noexcept override { return material.get(); }
+
             inline auto& getMaterial() const noexcept { return material; }
             inline void setMaterial(const std::shared_ptr<graphics::Material>& newMaterial) { material = newMaterial; }
 
+            // sprites with the texture shader that draw the same frame one after another are drawn as one instanced draw
+            inline auto isInstancing() const noexcept { return instancing; }
+            inline void setInstancing(bool newInstancing) { instancing = newInstancing; }
+
             inline auto& getOffset() const noexcept { return offset; }
             void setOffset(const Vector2F& newOffset);
 
@@ -125,6 +132,7 @@ namespace ouzel
             void updateBoundingBox();
 
             std::shared_ptr<graphics::Material> material;
+            graphics::CachedPipelineState pipelineState;
             std::map<std::string, SpriteData::Animation> animations;
 
             struct QueuedAnimation final
@@ -142,6 +150,7 @@ namespace ouzel
             bool playing = false;
             bool running = false;
             float currentTime = 0.0F;
+            bool instancing = false;
 
             EventHandler updateHandler;
         };
@@ -2,6 +2,8 @@
 
 #include <limits>
 #include "StaticMeshRenderer.hpp"
+#include "Layer.hpp"
+#include "../assets/Cache.hpp"
 #include "../core/Engine.hpp"
 #include "../utils/Utils.hpp"
 
@@ -72,12 +74,55 @@ namespace ouzel
                                       const Matrix4F& renderViewProjection,
                                       bool wireframe)
         {
+            const Matrix4F modelViewProj = renderViewProjection * transformMatrix;
+
+            // mesh texture coordinates are assumed to span the whole texture
+            if (engine->getRenderer()->getTextureStreamer().isEnabled())
+            {
+                const Size2F screenSize = getScreenSize(modelViewProj);
+                for (const std::shared_ptr<graphics::Texture>& texture : material->textures)
+                    if (texture) texture->requestScreenSize(screenSize);
+            }
+
+            std::vector<std::uintptr_t> textures;
+            for (const std::shared_ptr<graphics::Texture>& texture : material->textures)
+                textures.push_back(texture ? texture->getResource() : 0);
+
+            const graphics::Shader* instancedShader = (instancing && layer &&
+                                                       material->shader == engine->getCache().getShader(SHADER_TEXTURE)) ?
+                engine->getCache().getShader(SHADER_TEXTURE_INSTANCED) : nullptr;
+
+            if (instancedShader)
+            {
+                InstanceBatch::Draw instanceDraw;
+                instanceDraw.indexBuffer = indexBuffer->getResource();
+                instanceDraw.indexCount = indexCount;
+                instanceDraw.indexSize = indexSize;
+                instanceDraw.vertexBuffer = vertexBuffer->getResource();
+                instanceDraw.blendState = material->blendState->getResource();
+                instanceDraw.shader = material->shader->getResource();
+                instanceDraw.instancedShader = instancedShader->getResource();
+                instanceDraw.cullMode = material->cullMode;
+                instanceDraw.fillMode = wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid;
+                instanceDraw.color = {
+                    material->diffuseColor.normR(),
+                    material->diffuseColor.normG(),
+                    material->diffuseColor.normB(),
+                    material->diffuseColor.normA() * material->opacity
+                };
+                instanceDraw.textures = std::move(textures);
+                instanceDraw.viewProjection = renderViewProjection;
+
+                layer->getInstanceBatch().add(instanceDraw, transformMatrix,
+                                              Color(Vector4F(1.0F, 1.0F, 1.0F, opacity)));
+                return;
+            }
+
             Component::draw(transformMatrix,
                             opacity,
                             renderViewProjection,
                             wireframe);
 
-            const Matrix4F modelViewProj = renderViewProjection * transformMatrix;
             const float colorVector[] = {
                 material->diffuseColor.normR(),
                 material->diffuseColor.normG(),
@@ -91,14 +136,11 @@ namespace ouzel
             std::vector<std::vector<float>> vertexShaderConstants(1);
             vertexShaderConstants[0] = {std::begin(modelViewProj.m), std::end(modelViewProj.m)};
 
-            std::vector<std::uintptr_t> textures;
-            for (const std::shared_ptr<graphics::Texture>& texture : material->textures)
-                textures.push_back(texture ? texture->getResource() : 0);
-
-            engine->getRenderer()->setPipelineState(material->blendState->getResource(),
-                                                    material->shader->getResource(),
-                                                    material->cullMode,
-                                                    wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid);
+            engine->getRenderer()->setPipelineState(pipelineState.get(*engine->getRenderer(),
+                                                                      material->blendState->getResource(),
+                                                                      material->shader->getResource(),
+                                                                      material->cullMode,
+                                                                      wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid));
             engine->getRenderer()->setShaderConstants(fragmentShaderConstants,
                                                       vertexShaderConstants);
             engine->getRenderer()->setTextures(textures);
@@ -6,6 +6,7 @@
 #include <vector>
 #include "Component.hpp"
 #include "../graphics/Buffer.hpp"
+#include "../graphics/CachedPipelineState.hpp"
 #include "../graphics/Material.hpp"
 #include "../graphics/Vertex.hpp"
 
@@ -43,18 +44,26 @@ namespace ouzel
                       const Matrix4F& renderViewProjection,
                       bool wireframe) override;
 
+            const graphics::Material* getDrawMaterial() const noexcept override { return material; }
+
             inline auto& getMaterial() const noexcept { return material; }
             inline void setMaterial(const graphics::Material* newMaterial)
             {
                 material = newMaterial;
             }
 
+            // renderers with the texture shader that draw the same mesh one after another are drawn as one instanced draw
+            inline auto isInstancing() const noexcept { return instancing; }
+            inline void setInstancing(bool newInstancing) { instancing = newInstancing; }
+
         private:
             const graphics::Material* material = nullptr;
+            graphics::CachedPipelineState pipelineState;
             std::uint32_t indexCount = 0;
             std::uint32_t indexSize = 0;
             const graphics::Buffer* indexBuffer = nullptr;
             const graphics::Buffer* vertexBuffer = nullptr;
+            bool instancing = false;
         };
     } // namespace scene
 } // namespace ouzel
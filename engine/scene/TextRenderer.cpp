@@ -84,10 +84,11 @@ namespace ouzel
             std::vector<std::vector<float>> vertexShaderConstants(1);
             vertexShaderConstants[0] = {std::begin(modelViewProj.m), std::end(modelViewProj.m)};
 
-            engine->getRenderer()->setPipelineState(blendState->getResource(),
-                                                    shader->getResource(),
-                                                    graphics::CullMode::NoCull,
-                                                    wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid);
+            engine->getRenderer()->setPipelineState(pipelineState.get(*engine->getRenderer(),
+                                                                      blendState->getResource(),
+                                                                      shader->getResource(),
+                                                                      graphics::CullMode::NoCull,
+                                                                      wireframe ? graphics::FillMode::Wireframe : graphics::FillMode::Solid));
             engine->getRenderer()->setShaderConstants(fragmentShaderConstants,
                                                       vertexShaderConstants);
             engine->getRenderer()->setTextures({wireframe ? whitePixelTexture->getResource() : texture->getResource()});
@@ -9,6 +9,7 @@
 #include "../gui/BMFont.hpp"
 #include "../graphics/BlendState.hpp"
 #include "../graphics/Buffer.hpp"
+#include "../graphics/CachedPipelineState.hpp"
 #include "../graphics/Shader.hpp"
 #include "../graphics/Texture.hpp"
 
@@ -61,6 +62,7 @@ namespace ouzel
 
             const graphics::Shader* shader = nullptr;
             const graphics::BlendState* blendState = nullptr;
+            graphics::CachedPipelineState pipelineState;
 
             graphics::Buffer indexBuffer;
             graphics::Buffer vertexBuffer;
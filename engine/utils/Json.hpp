@@ -5,6 +5,11 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
 #include <map>
 #include <stdexcept>
 #include <string>
@@ -70,215 +75,475 @@ namespace ouzel
                 }
             }
 
-            struct Token final
+            inline bool isWhitespace(const char c) noexcept
             {
-                enum class Type
-                {
-                    LiteralInteger, // integer
-                    LiteralFloat, // float
-                    LiteralString, // string
-                    KeywordTrue, // true
-                    KeywordFalse, // false
-                    KeywordNull, // null
-                    LeftBrace, // {
-                    RightBrace, // }
-                    LeftBracket, // [
-                    RightBracket, // ]
-                    Comma, // ,
-                    Colon // :
-                };
-
-                Type type;
-                std::u32string value;
-            };
+                return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+            }
 
-            inline std::vector<Token> tokenize(const std::u32string& str)
+            inline bool isDigit(const char c) noexcept
             {
-                std::vector<Token> tokens;
+                return c >= '0' && c <= '9';
+            }
 
-                static const std::map<std::u32string, Token::Type> keywordMap{
-                    {{'t', 'r', 'u', 'e'}, Token::Type::KeywordTrue},
-                    {{'f', 'a', 'l', 's', 'e'}, Token::Type::KeywordFalse},
-                    {{'n', 'u', 'l', 'l'}, Token::Type::KeywordNull}
-                };
+            // returns the first quote, backslash or control character, testing eight bytes at a time
+            inline const char* skipPlainCharacters(const char* iterator, const char* end) noexcept
+            {
+                constexpr std::uint64_t ones = 0x0101010101010101ULL;
+                constexpr std::uint64_t highBits = 0x8080808080808080ULL;
 
-                // tokenize
-                for (auto iterator = str.cbegin(); iterator != str.cend();)
+                while (end - iterator >= 8)
                 {
-                    Token token;
+                    std::uint64_t word;
+                    std::memcpy(&word, iterator, sizeof(word));
 
-                    if (*iterator == '-' ||
-                        (*iterator >= '0' && *iterator <= '9'))
-                    {
-                        token.type = Token::Type::LiteralInteger;
+                    const std::uint64_t quotes = word ^ (ones * '"');
+                    const std::uint64_t backslashes = word ^ (ones * '\\');
 
-                        if (*iterator == '-')
-                        {
-                            token.value.push_back(*iterator);
-                            if (++iterator == str.cend() ||
-                                *iterator < '0' || *iterator > '9')
-                                throw ParseError("Invalid number");
-                        }
+                    // the high bit of a byte gets set if it is zero (or below 0x20 for the control characters)
+                    const std::uint64_t special = ((quotes - ones) & ~quotes) |
+                        ((backslashes - ones) & ~backslashes) |
+                        ((word - ones * 0x20) & ~word);
 
-                        while (iterator != str.cend() &&
-                            (*iterator >= '0' && *iterator <= '9'))
-                        {
-                            token.value.push_back(*iterator);
-                            ++iterator;
-                        }
+                    if (special & highBits) break;
+                    iterator += 8;
+                }
 
-                        if (iterator != str.cend() && *iterator == '.')
-                        {
-                            token.type = Token::Type::LiteralFloat;
+                return iterator;
+            }
 
-                            token.value.push_back(*iterator);
-                            ++iterator;
+            inline char32_t decodeHex(const char*& iterator, const char* end)
+            {
+                if (end - iterator < 4)
+                    throw ParseError("Unexpected end of data");
 
-                            while (iterator != str.cend() &&
-                                (*iterator >= '0' && *iterator <= '9'))
-                            {
-                                token.value.push_back(*iterator);
-                                ++iterator;
-                            }
-                        }
+                char32_t c = 0;
 
-                        // parse exponent
-                        if (iterator != str.cend() &&
-                            (*iterator == 'e' || *iterator == 'E'))
-                        {
-                            token.value.push_back(*iterator);
+                for (std::uint32_t i = 0; i < 4; ++i, ++iterator)
+                {
+                    std::uint8_t code = 0;
 
-                            if (++iterator == str.cend())
-                                throw ParseError("Invalid exponent");
+                    if (*iterator >= '0' && *iterator <= '9') code = static_cast<std::uint8_t>(*iterator) - '0';
+                    else if (*iterator >= 'a' && *iterator <='f') code = static_cast<std::uint8_t>(*iterator) - 'a' + 10;
+                    else if (*iterator >= 'A' && *iterator <='F') code = static_cast<std::uint8_t>(*iterator) - 'A' + 10;
+                    else
+                        throw ParseError("Invalid character code");
 
-                            if (*iterator == '+' || *iterator == '-')
-                                token.value.push_back(*iterator++);
+                    c = (c << 4) | code;
+                }
 
-                            if (iterator == str.cend() || *iterator < '0' || *iterator > '9')
-                                throw ParseError("Invalid exponent");
+                return c;
+            }
 
-                            while (iterator != str.cend() && *iterator >= '0' && *iterator <= '9')
-                            {
-                                token.value.push_back(*iterator);
-                                ++iterator;
-                            }
-                        }
-                    }
-                    else if (*iterator == '"') // string literal
+            // decodes the escape sequences of a string literal, the result is never longer than the source
+            inline char* decodeString(const char* iterator, const char* end, char* result)
+            {
+                while (iterator != end)
+                {
+                    if (*iterator != '\\')
                     {
-                        token.type = Token::Type::LiteralString;
+                        *result++ = *iterator++;
+                        continue;
+                    }
 
-                        for (;;)
+                    if (++iterator == end)
+                        throw ParseError("Unterminated string literal");
+
+                    switch (*iterator++)
+                    {
+                        case '"': *result++ = '"'; break;
+                        case '\\': *result++ = '\\'; break;
+                        case '/': *result++ = '/'; break;
+                        case 'b': *result++ = '\b'; break;
+                        case 'f': *result++ = '\f'; break;
+                        case 'n': *result++ = '\n'; break;
+                        case 'r': *result++ = '\r'; break;
+                        case 't': *result++ = '\t'; break;
+                        case 'u':
                         {
-                            if (++iterator == str.cend())
-                                throw ParseError("Unterminated string literal");
+                            char32_t c = decodeHex(iterator, end);
 
-                            if (*iterator == '"')
+                            // combine the surrogate pair
+                            if (c >= 0xD800 && c <= 0xDBFF &&
+                                end - iterator >= 6 && iterator[0] == '\\' && iterator[1] == 'u')
                             {
-                                ++iterator;
-                                break;
-                            }
-                            else if (*iterator == '\\')
-                            {
-                                if (++iterator == str.cend())
-                                    throw ParseError("Unterminated string literal");
-
-                                switch (*iterator)
+                                const char* next = iterator + 2;
+                                const char32_t low = decodeHex(next, end);
+                                if (low >= 0xDC00 && low <= 0xDFFF)
                                 {
-                                    case '"': token.value.push_back('"'); break;
-                                    case '\\': token.value.push_back('\\'); break;
-                                    case '/': token.value.push_back('/'); break;
-                                    case 'b': token.value.push_back('\b'); break;
-                                    case 'f': token.value.push_back('\f'); break;
-                                    case 'n': token.value.push_back('\n'); break;
-                                    case 'r': token.value.push_back('\r'); break;
-                                    case 't': token.value.push_back('\t'); break;
-                                    case 'u':
-                                    {
-                                        char32_t c = 0;
-
-                                        for (std::uint32_t i = 0; i < 4; ++i, ++iterator)
-                                        {
-                                            if (iterator == str.cend())
-                                                throw ParseError("Unexpected end of data");
-
-                                            std::uint8_t code = 0;
-
-                                            if (*iterator >= '0' && *iterator <= '9') code = static_cast<std::uint8_t>(*iterator) - '0';
-                                            else if (*iterator >= 'a' && *iterator <='f') code = static_cast<std::uint8_t>(*iterator) - 'a' + 10;
-                                            else if (*iterator >= 'A' && *iterator <='F') code = static_cast<std::uint8_t>(*iterator) - 'A' + 10;
-                                            else
-                                                throw ParseError("Invalid character code");
-
-                                            c = (c << 4) | code;
-                                        }
-
-                                        token.value.push_back(c);
-                                        break;
-                                    }
-                                    default:
-                                        throw ParseError("Unrecognized escape character");
+                                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                                    iterator = next;
                                 }
                             }
-                            else if (*iterator <= 0x1F) // control char
-                                throw ParseError("Unterminated string literal");
-                            else
-                                token.value.push_back(*iterator);
+
+                            const std::string encoded = utf8::fromUtf32(c);
+                            for (const char b : encoded) *result++ = b;
+                            break;
                         }
+                        default:
+                            throw ParseError("Unrecognized escape character");
                     }
-                    else if ((*iterator >= 'a' && *iterator <= 'z') ||
-                            (*iterator >= 'A' && *iterator <= 'Z') ||
-                            *iterator == '_')
+                }
+
+                return result;
+            }
+
+            constexpr double powersOfTen[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+        }
+
+        // Pull parser that reads the UTF-8 data in a single pass without building a tree,
+        // strings point into the source data unless they contain escape sequences
+        class Reader final
+        {
+        public:
+            enum class Event
+            {
+                StartObject,
+                EndObject,
+                StartArray,
+                EndArray,
+                Key,
+                String,
+                Integer,
+                Float,
+                Boolean,
+                Null,
+                End
+            };
+
+            Reader(const char* begin, const char* initEnd):
+                iterator(begin), end(initEnd)
+            {
+                if (end - iterator >= 3 &&
+                    std::equal(iterator, iterator + 3, std::begin(UTF8_BOM),
+                               [](const char a, const std::uint8_t b) noexcept {
+                                   return static_cast<std::uint8_t>(a) == b;
+                               }))
+                {
+                    bom = true;
+                    iterator += 3;
+                }
+            }
+
+            template <class T>
+            explicit Reader(const T& data):
+                Reader(reinterpret_cast<const char*>(data.data()),
+                       reinterpret_cast<const char*>(data.data() + data.size()))
+            {
+            }
+
+            Event next()
+            {
+                skipWhitespaces();
+
+                if (scopes.empty())
+                {
+                    if (started)
                     {
-                        while (iterator != str.cend() &&
-                            ((*iterator >= 'a' && *iterator <= 'z') ||
-                                (*iterator >= 'A' && *iterator <= 'Z') ||
-                                *iterator == '_' ||
-                                (*iterator >= '0' && *iterator <= '9')))
-                        {
-                            token.value.push_back(*iterator);
-                            ++iterator;
-                        }
+                        if (iterator != end && *iterator != '\0')
+                            throw ParseError("Unexpected data after the root value");
 
-                        auto keywordIterator = keywordMap.find(token.value);
+                        return event = Event::End;
+                    }
 
-                        if (keywordIterator != keywordMap.end())
-                            token.type = keywordIterator->second;
-                        else
-                            throw ParseError("Unknown keyword " + utf8::fromUtf32(token.value));
+                    started = true;
+                    return event = readValue();
+                }
+
+                Scope& scope = scopes.back();
+
+                if (scope.expectValue)
+                {
+                    scope.expectValue = false;
+                    return event = readValue();
+                }
+
+                if (iterator == end)
+                    throw ParseError("Unexpected end of data");
+
+                if (*iterator == (scope.object ? '}' : ']'))
+                {
+                    ++iterator;
+                    const bool object = scope.object;
+                    scopes.pop_back();
+                    return event = object ? Event::EndObject : Event::EndArray;
+                }
+
+                if (scope.first)
+                    scope.first = false;
+                else
+                {
+                    if (*iterator != ',')
+                        throw ParseError("Expected a comma");
+
+                    ++iterator;
+                    skipWhitespaces();
+                }
+
+                if (!scope.object)
+                    return event = readValue();
+
+                if (iterator == end)
+                    throw ParseError("Unexpected end of data");
+
+                if (*iterator != '"')
+                    throw ParseError("Expected a string literal");
+
+                readString();
+                skipWhitespaces();
+
+                if (iterator == end)
+                    throw ParseError("Unexpected end of data");
+
+                if (*iterator != ':')
+                    throw ParseError("Expected a colon");
+
+                ++iterator;
+                scope.expectValue = true;
+                return event = Event::Key;
+            }
+
+            // skips the rest of the object or array that was just started
+            void skip()
+            {
+                if (event != Event::StartObject && event != Event::StartArray) return;
+
+                const std::size_t depth = scopes.size();
+                while (scopes.size() >= depth) next();
+            }
+
+            inline auto getEvent() const noexcept { return event; }
+            inline auto getDepth() const noexcept { return scopes.size(); }
+            inline bool hasBOM() const noexcept { return bom; }
+
+            // valid until the next call to next()
+            inline auto getStringData() const noexcept { return stringData; }
+            inline auto getStringLength() const noexcept { return stringLength; }
+            inline std::string getString() const { return std::string(stringData, stringLength); }
+
+            // the string contained escape sequences, so it was decoded into a buffer of the reader
+            inline auto isStringDecoded() const noexcept { return stringDecoded; }
+
+            inline auto getInteger() const noexcept { return intValue; }
+            inline auto getFloat() const noexcept { return doubleValue; }
+            inline auto getBoolean() const noexcept { return boolValue; }
+
+        private:
+            void skipWhitespaces() noexcept
+            {
+                while (iterator != end && isWhitespace(*iterator)) ++iterator;
+            }
+
+            Event readValue()
+            {
+                if (iterator == end)
+                    throw ParseError("Unexpected end of data");
+
+                switch (*iterator)
+                {
+                    case '{':
+                        ++iterator;
+                        scopes.push_back(Scope{true});
+                        return Event::StartObject;
+                    case '[':
+                        ++iterator;
+                        scopes.push_back(Scope{false});
+                        return Event::StartArray;
+                    case '"':
+                        readString();
+                        return Event::String;
+                    case 't':
+                        readKeyword("true", 4);
+                        boolValue = true;
+                        return Event::Boolean;
+                    case 'f':
+                        readKeyword("false", 5);
+                        boolValue = false;
+                        return Event::Boolean;
+                    case 'n':
+                        readKeyword("null", 4);
+                        return Event::Null;
+                    default:
+                        if (*iterator == '-' || isDigit(*iterator))
+                            return readNumber();
+
+                        throw ParseError("Expected a value");
+                }
+            }
+
+            void readKeyword(const char* keyword, std::size_t length)
+            {
+                const char* begin = iterator;
+                while (iterator != end &&
+                       ((*iterator >= 'a' && *iterator <= 'z') ||
+                        (*iterator >= 'A' && *iterator <= 'Z') ||
+                        *iterator == '_' || isDigit(*iterator)))
+                    ++iterator;
+
+                if (static_cast<std::size_t>(iterator - begin) != length ||
+                    !std::equal(begin, iterator, keyword))
+                    throw ParseError("Unknown keyword " + std::string(begin, iterator));
+            }
+
+            void readString()
+            {
+                const char* begin = ++iterator; // skip the quote
+                bool escaped = false;
+
+                for (;;)
+                {
+                    iterator = skipPlainCharacters(iterator, end);
+
+                    if (iterator == end)
+                        throw ParseError("Unterminated string literal");
+
+                    const auto c = static_cast<std::uint8_t>(*iterator);
+
+                    if (c == '"')
+                        break;
+                    else if (c == '\\')
+                    {
+                        escaped = true;
+                        if (++iterator == end)
+                            throw ParseError("Unterminated string literal");
                     }
-                    else if (*iterator == ' ' ||
-                            *iterator == '\t' ||
-                            *iterator == '\r' ||
-                            *iterator == '\n') // whitespace or newline
+                    else if (c <= 0x1F) // control char
+                        throw ParseError("Unterminated string literal");
+
+                    ++iterator;
+                }
+
+                if (escaped)
+                {
+                    buffer.resize(static_cast<std::size_t>(iterator - begin));
+                    char* bufferEnd = decodeString(begin, iterator, &buffer[0]);
+                    stringData = buffer.data();
+                    stringLength = static_cast<std::size_t>(bufferEnd - buffer.data());
+                }
+                else
+                {
+                    stringData = begin;
+                    stringLength = static_cast<std::size_t>(iterator - begin);
+                }
+
+                stringDecoded = escaped;
+                ++iterator; // skip the quote
+            }
+
+            Event readNumber()
+            {
+                const char* begin = iterator;
+                const bool negative = (*iterator == '-');
+
+                if (negative && (++iterator == end || !isDigit(*iterator)))
+                    throw ParseError("Invalid number");
+
+                // up to 19 significant digits fit in the mantissa
+                std::uint64_t mantissa = 0;
+                std::uint32_t digits = 0;
+                std::int32_t exponent = 0;
+                bool truncated = false;
+                bool isFloat = false;
+
+                for (; iterator != end && isDigit(*iterator); ++iterator)
+                {
+                    if (digits < 19)
                     {
-                        ++iterator;
-                        continue;
+                        mantissa = mantissa * 10 + static_cast<std::uint64_t>(*iterator - '0');
+                        if (mantissa) ++digits;
                     }
-                    else if (*iterator == '\0')
-                        break;
                     else
                     {
-                        switch (*iterator)
+                        truncated = true;
+                        ++exponent;
+                    }
+                }
+
+                if (iterator != end && *iterator == '.')
+                {
+                    isFloat = true;
+
+                    for (++iterator; iterator != end && isDigit(*iterator); ++iterator)
+                    {
+                        if (digits < 19)
                         {
-                            case '{': token.type = Token::Type::LeftBrace; break;
-                            case '}': token.type = Token::Type::RightBrace; break;
-                            case '[': token.type = Token::Type::LeftBracket; break;
-                            case ']': token.type = Token::Type::RightBracket; break;
-                            case ',': token.type = Token::Type::Comma; break;
-                            case ':': token.type = Token::Type::Colon; break;
-                            default: throw ParseError("Unknown character");
+                            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*iterator - '0');
+                            if (mantissa) ++digits;
+                            --exponent;
                         }
-
-                        ++iterator;
+                        else
+                            truncated = true;
                     }
+                }
+
+                if (iterator != end && (*iterator == 'e' || *iterator == 'E'))
+                {
+                    isFloat = true;
+
+                    if (++iterator == end)
+                        throw ParseError("Invalid exponent");
+
+                    const bool negativeExponent = (*iterator == '-');
+                    if (*iterator == '+' || *iterator == '-') ++iterator;
+
+                    if (iterator == end || !isDigit(*iterator))
+                        throw ParseError("Invalid exponent");
+
+                    std::int32_t value = 0;
+                    for (; iterator != end && isDigit(*iterator); ++iterator)
+                        if (value < 100000) value = value * 10 + (*iterator - '0');
+
+                    exponent += negativeExponent ? -value : value;
+                }
 
-                    tokens.push_back(token);
+                if (!isFloat && !truncated &&
+                    mantissa <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + (negative ? 1 : 0))
+                {
+                    intValue = negative ? static_cast<std::int64_t>(0 - mantissa) : static_cast<std::int64_t>(mantissa);
+                    return Event::Integer;
+                }
+
+                // exact when both the mantissa and the power of ten are representable
+                if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+                {
+                    const double value = static_cast<double>(mantissa);
+                    doubleValue = (exponent < 0) ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+                    if (negative) doubleValue = -doubleValue;
+                }
+                else
+                {
+                    const std::string value(begin, iterator);
+                    doubleValue = std::strtod(value.c_str(), nullptr);
                 }
 
-                return tokens;
+                return Event::Float;
             }
-        }
+
+            struct Scope final
+            {
+                bool object = false;
+                bool first = true;
+                bool expectValue = false;
+            };
+
+            const char* iterator = nullptr;
+            const char* end = nullptr;
+            bool bom = false;
+            bool started = false;
+            std::vector<Scope> scopes;
+            Event event = Event::End;
+
+            const char* stringData = nullptr;
+            std::size_t stringLength = 0;
+            bool stringDecoded = false;
+            std::string buffer;
+
+            bool boolValue = false;
+            std::int64_t intValue = 0;
+            double doubleValue = 0.0;
+        };
 
         class Value
         {
@@ -303,7 +568,7 @@ namespace ouzel
             Value(const T initType): type(initType) {}
 
             template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
-            Value(const T value): type(Type::Float), doubleValue(isfinite(value) ? static_cast<double>(value) : 0.0) {}
+            Value(const T value): type(Type::Float), doubleValue(std::isfinite(value) ? static_cast<double>(value) : 0.0) {}
 
             template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type* = nullptr>
             Value(const T value): type(Type::Integer), intValue(static_cast<std::int64_t>(value)) {}
@@ -337,7 +602,7 @@ namespace ouzel
             inline Value& operator=(const T value) noexcept
             {
                 type = Type::Float;
-                doubleValue = isfinite(value) ? static_cast<double>(value) : 0.0;
+                doubleValue = std::isfinite(value) ? static_cast<double>(value) : 0.0;
                 return *this;
             }
 
@@ -556,156 +821,67 @@ namespace ouzel
             }
 
         protected:
-            template <class TokenIterator>
-            void parseValue(TokenIterator& iterator,
-                            TokenIterator end)
+            // expects the reader to be at the first event of the value
+            void parseValue(Reader& reader)
             {
-                if (iterator == end)
-                    throw ParseError("Unexpected end of data");
-
-                if (iterator->type == Token::Type::LeftBrace)
-                    return parseObject(iterator, end);
-                else if (iterator->type == Token::Type::LeftBracket)
-                    return parseArray(iterator, end);
-                else if (iterator->type == Token::Type::LiteralInteger)
+                switch (reader.getEvent())
                 {
-                    type = Type::Integer;
-                    intValue = std::stoll(utf8::fromUtf32(iterator->value));
-                    ++iterator;
-                }
-                else if (iterator->type == Token::Type::LiteralFloat)
-                {
-                    type = Type::Float;
-                    doubleValue = std::stod(utf8::fromUtf32(iterator->value));
-                    ++iterator;
-                }
-                else if (iterator->type == Token::Type::LiteralString)
-                {
-                    type = Type::String;
-                    stringValue = utf8::fromUtf32(iterator->value);
-                    ++iterator;
-                }
-                else if (iterator->type == Token::Type::KeywordTrue ||
-                         iterator->type == Token::Type::KeywordFalse)
-                {
-                    type = Type::Boolean;
-                    boolValue = (iterator->type == Token::Type::KeywordTrue);
-                    ++iterator;
-                }
-                else if (iterator->type == Token::Type::KeywordNull)
-                {
-                    type = Type::Null;
-                    ++iterator;
+                    case Reader::Event::StartObject:
+                        return parseObject(reader);
+                    case Reader::Event::StartArray:
+                        return parseArray(reader);
+                    case Reader::Event::Integer:
+                        type = Type::Integer;
+                        intValue = reader.getInteger();
+                        break;
+                    case Reader::Event::Float:
+                        type = Type::Float;
+                        doubleValue = reader.getFloat();
+                        break;
+                    case Reader::Event::String:
+                        type = Type::String;
+                        stringValue.assign(reader.getStringData(), reader.getStringLength());
+                        break;
+                    case Reader::Event::Boolean:
+                        type = Type::Boolean;
+                        boolValue = reader.getBoolean();
+                        break;
+                    case Reader::Event::Null:
+                        type = Type::Null;
+                        break;
+                    default:
+                        throw ParseError("Expected a value");
                 }
-                else
-                    throw ParseError("Expected a value");
             }
 
-            template <class TokenIterator>
-            void parseObject(TokenIterator& iterator,
-                             TokenIterator end)
+            void parseObject(Reader& reader)
             {
-                if (iterator == end)
-                    throw ParseError("Unexpected end of data");
-
-                if (iterator->type != Token::Type::LeftBrace)
-                    throw ParseError("Expected a left brace");
-
-                ++iterator; // skip the left brace
-
-                bool first = true;
+                type = Type::Object;
 
-                for (;;)
+                while (reader.next() != Reader::Event::EndObject)
                 {
-                    if (iterator == end)
-                        throw ParseError("Unexpected end of data");
-
-                    if (iterator->type == Token::Type::RightBrace)
-                    {
-                        ++iterator;// skip the right brace
-                        break;
-                    }
+                    std::string key = reader.getString();
 
-                    if (first)
-                        first = false;
-                    else
-                    {
-                        if (iterator->type != Token::Type::Comma)
-                            throw ParseError("Expected a comma");
-
-                        if (++iterator == end)
-                            throw ParseError("Unexpected end of data");
-                    }
-
-                    if (iterator->type != Token::Type::LiteralString)
-                        throw ParseError("Expected a string literal");
-
-                    std::string key = utf8::fromUtf32(iterator->value);
-
-                    if (objectValue.find(key) != objectValue.end())
+                    auto i = objectValue.lower_bound(key);
+                    if (i != objectValue.end() && i->first == key)
                         throw ParseError("Duplicate key value " + key);
 
-                    if (++iterator == end)
-                        throw ParseError("Unexpected end of data");
-
-                    if (iterator->type != Token::Type::Colon)
-                        throw ParseError("Expected a colon");
+                    i = objectValue.emplace_hint(i, std::move(key), Value());
 
-                    if (++iterator == end)
-                        throw ParseError("Unexpected end of data");
-
-                    Value value;
-                    value.parseValue(iterator, end);
-
-                    objectValue[key] = value;
+                    reader.next();
+                    i->second.parseValue(reader);
                 }
-
-                type = Type::Object;
             }
 
-            template <class TokenIterator>
-            void parseArray(TokenIterator& iterator,
-                            TokenIterator end)
+            void parseArray(Reader& reader)
             {
-                if (iterator == end)
-                    throw ParseError("Unexpected end of data");
-
-                if (iterator->type != Token::Type::LeftBracket)
-                    throw ParseError("Expected a left bracket");
-
-                ++iterator; // skip the left bracket
-
-                bool first = true;
+                type = Type::Array;
 
-                for (;;)
+                while (reader.next() != Reader::Event::EndArray)
                 {
-                    if (iterator == end)
-                        throw ParseError("Unexpected end of data");
-
-                    if (iterator->type == Token::Type::RightBracket)
-                    {
-                        ++iterator;// skip the right bracket
-                        break;
-                    }
-
-                    if (first)
-                        first = false;
-                    else
-                    {
-                        if (iterator->type != Token::Type::Comma)
-                            throw ParseError("Expected a comma");
-
-                        if (++iterator == end)
-                            throw ParseError("Unexpected end of data");
-                    }
-
-                    Value value;
-                    value.parseValue(iterator, end);
-
-                    arrayValue.push_back(value);
+                    arrayValue.emplace_back();
+                    arrayValue.back().parseValue(reader);
                 }
-
-                type = Type::Array;
             }
 
             void encodeValue(std::vector<std::uint8_t>& data) const
@@ -801,27 +977,12 @@ namespace ouzel
             template <class T>
             explicit Data(const T& data)
             {
-                std::u32string str;
-
-                // BOM
-                if (std::distance(std::begin(data), std::end(data)) >= 3 &&
-                    std::equal(std::begin(data), std::begin(data) + 3,
-                               std::begin(UTF8_BOM)))
-                {
-                    bom = true;
-                    str = utf8::toUtf32(std::begin(data) + 3, std::end(data));
-                }
-                else
-                {
-                    bom = false;
-                    str = utf8::toUtf32(data);
-                }
-
-                std::vector<Token> tokens = tokenize(str);
-
-                auto iterator = tokens.cbegin();
+                Reader reader(data);
+                bom = reader.hasBOM();
 
-                parseValue(iterator, tokens.cend());
+                reader.next();
+                parseValue(reader);
+                reader.next(); // check that nothing follows the root value
             }
 
             std::vector<std::uint8_t> encode() const
@@ -841,6 +1002,528 @@ namespace ouzel
         private:
             bool bom = false;
         };
+
+        // Read-only tree that keeps all of the values in one array, with the children of each
+        // object and array stored next to each other, strings point into the source data
+        class Document final
+        {
+            struct Node final
+            {
+                Value::Type type = Value::Type::Null;
+                std::uint32_t size = 0; // string length or number of children
+                const char* key = nullptr;
+                std::size_t keyLength = 0;
+                union
+                {
+                    bool boolValue = false;
+                    std::int64_t intValue;
+                    double doubleValue;
+                    const char* stringValue;
+                    std::size_t firstChild;
+                };
+            };
+
+        public:
+            class Element;
+
+            class Iterator final
+            {
+            public:
+                Iterator(const Node* initNodes, std::size_t initIndex) noexcept:
+                    nodes(initNodes), index(initIndex)
+                {
+                }
+
+                inline Element operator*() const noexcept { return Element(nodes, index); }
+                inline Iterator& operator++() noexcept { ++index; return *this; }
+                inline bool operator==(const Iterator& other) const noexcept { return index == other.index; }
+                inline bool operator!=(const Iterator& other) const noexcept { return index != other.index; }
+
+            private:
+                const Node* nodes = nullptr;
+                std::size_t index = 0;
+            };
+
+            class Element final
+            {
+            public:
+                Element(const Node* initNodes, std::size_t initIndex) noexcept:
+                    nodes(initNodes), node(initNodes + initIndex)
+                {
+                }
+
+                inline auto getType() const noexcept { return node->type; }
+                inline auto isNull() const noexcept { return node->type == Value::Type::Null; }
+
+                inline std::string getKey() const { return std::string(node->key, node->keyLength); }
+
+                template <typename T, typename std::enable_if<std::is_same<T, std::string>::value>::type* = nullptr>
+                inline T as() const
+                {
+                    if (node->type != Value::Type::String) throw TypeError("Wrong type");
+                    return std::string(node->stringValue, node->size);
+                }
+
+                template <typename T, typename std::enable_if<std::is_same<T, bool>::value>::type* = nullptr>
+                inline T as() const
+                {
+                    if (node->type == Value::Type::Boolean) return node->boolValue;
+                    else if (node->type == Value::Type::Integer) return node->intValue != 0;
+                    else if (node->type == Value::Type::Float) return node->doubleValue != 0.0;
+                    else throw TypeError("Wrong type");
+                }
+
+                template <typename T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type* = nullptr>
+                inline T as() const
+                {
+                    if (node->type == Value::Type::Boolean) return node->boolValue;
+                    else if (node->type == Value::Type::Integer) return static_cast<T>(node->intValue);
+                    else if (node->type == Value::Type::Float) return static_cast<T>(node->doubleValue);
+                    else throw TypeError("Wrong type");
+                }
+
+                // the string is not null-terminated
+                inline const char* getStringData() const
+                {
+                    if (node->type != Value::Type::String) throw TypeError("Wrong type");
+                    return node->stringValue;
+                }
+
+                inline std::size_t getStringLength() const
+                {
+                    if (node->type != Value::Type::String) throw TypeError("Wrong type");
+                    return node->size;
+                }
+
+                // iterates over the elements of an array or the members of an object
+                Iterator begin() const
+                {
+                    if (node->type != Value::Type::Array && node->type != Value::Type::Object)
+                        throw TypeError("Wrong type");
+                    return Iterator(nodes, node->firstChild);
+                }
+
+                Iterator end() const
+                {
+                    if (node->type != Value::Type::Array && node->type != Value::Type::Object)
+                        throw TypeError("Wrong type");
+                    return Iterator(nodes, node->firstChild + node->size);
+                }
+
+                inline auto getSize() const
+                {
+                    if (node->type != Value::Type::Array && node->type != Value::Type::Object)
+                        throw TypeError("Wrong type");
+                    return static_cast<std::size_t>(node->size);
+                }
+
+                inline bool hasMember(const std::string& member) const
+                {
+                    return findMember(member) != nullptr;
+                }
+
+                Element operator[](const std::string& member) const
+                {
+                    if (const Node* result = findMember(member))
+                        return Element(nodes, static_cast<std::size_t>(result - nodes));
+                    else
+                        throw RangeError("Member does not exist");
+                }
+
+                Element operator[](std::size_t index) const
+                {
+                    if (node->type != Value::Type::Array) throw TypeError("Wrong type");
+
+                    if (index < node->size)
+                        return Element(nodes, node->firstChild + index);
+                    else
+                        throw RangeError("Index out of range");
+                }
+
+            private:
+                const Node* findMember(const std::string& member) const
+                {
+                    if (node->type != Value::Type::Object) throw TypeError("Wrong type");
+
+                    // objects are usually small, so a linear search is faster than building an index
+                    const Node* children = nodes + node->firstChild;
+                    for (const Node* child = children; child != children + node->size; ++child)
+                        if (child->keyLength == member.length() &&
+                            std::equal(child->key, child->key + child->keyLength, member.begin()))
+                            return child;
+
+                    return nullptr;
+                }
+
+                const Node* nodes = nullptr;
+                const Node* node = nullptr;
+            };
+
+            explicit Document(std::vector<std::uint8_t> initData):
+                data(std::move(initData))
+            {
+                Reader reader(data);
+                bom = reader.hasBOM();
+
+                std::vector<Node> pending; // values whose containers are not finished yet
+                std::vector<std::size_t> scopes; // positions of the unfinished containers in pending
+                const char* key = nullptr;
+                std::size_t keyLength = 0;
+
+                for (;;)
+                {
+                    Node node;
+                    node.key = key;
+                    node.keyLength = keyLength;
+
+                    switch (reader.next())
+                    {
+                        case Reader::Event::End:
+                            nodes.push_back(pending.front());
+                            return;
+                        case Reader::Event::Key:
+                            key = storeString(reader);
+                            keyLength = reader.getStringLength();
+                            continue;
+                        case Reader::Event::StartObject:
+                        case Reader::Event::StartArray:
+                            node.type = (reader.getEvent() == Reader::Event::StartObject) ?
+                                Value::Type::Object : Value::Type::Array;
+                            scopes.push_back(pending.size());
+                            break;
+                        case Reader::Event::EndObject:
+                        case Reader::Event::EndArray:
+                        {
+                            // move the children to the final array, the container itself stays pending
+                            const std::size_t scope = scopes.back();
+                            scopes.pop_back();
+
+                            pending[scope].firstChild = nodes.size();
+                            pending[scope].size = static_cast<std::uint32_t>(pending.size() - scope - 1);
+                            nodes.insert(nodes.end(), pending.begin() + static_cast<std::ptrdiff_t>(scope) + 1, pending.end());
+                            pending.resize(scope + 1);
+                            continue;
+                        }
+                        case Reader::Event::String:
+                            node.type = Value::Type::String;
+                            node.stringValue = storeString(reader);
+                            node.size = static_cast<std::uint32_t>(reader.getStringLength());
+                            break;
+                        case Reader::Event::Integer:
+                            node.type = Value::Type::Integer;
+                            node.intValue = reader.getInteger();
+                            break;
+                        case Reader::Event::Float:
+                            node.type = Value::Type::Float;
+                            node.doubleValue = reader.getFloat();
+                            break;
+                        case Reader::Event::Boolean:
+                            node.type = Value::Type::Boolean;
+                            node.boolValue = reader.getBoolean();
+                            break;
+                        case Reader::Event::Null:
+                            node.type = Value::Type::Null;
+                            break;
+                    }
+
+                    pending.push_back(node);
+                    key = nullptr;
+                    keyLength = 0;
+                }
+            }
+
+            // strings point into the owned buffers, which stay in place when moved
+            Document(const Document&) = delete;
+            Document& operator=(const Document&) = delete;
+            Document(Document&&) = default;
+            Document& operator=(Document&&) = default;
+
+            inline Element getRoot() const noexcept { return Element(nodes.data(), nodes.size() - 1); }
+            inline bool hasBOM() const noexcept { return bom; }
+
+        private:
+            const char* storeString(const Reader& reader)
+            {
+                if (!reader.isStringDecoded()) return reader.getStringData();
+
+                // only the strings with escape sequences are copied out of the reader
+                decodedStrings.emplace_back(reader.getStringData(), reader.getStringLength());
+                return decodedStrings.back().data();
+            }
+
+            std::vector<std::uint8_t> data;
+            std::vector<Node> nodes;
+            std::deque<std::string> decodedStrings;
+            bool bom = false;
+        };
+
+        inline namespace detail
+        {
+            inline void encodeCborHeader(std::vector<std::uint8_t>& data,
+                                         std::uint8_t majorType, std::uint64_t value)
+            {
+                const auto type = static_cast<std::uint8_t>(majorType << 5);
+
+                if (value < 24)
+                    data.push_back(static_cast<std::uint8_t>(type | value));
+                else if (value <= 0xFF)
+                    data.insert(data.end(), {static_cast<std::uint8_t>(type | 24),
+                                             static_cast<std::uint8_t>(value)});
+                else if (value <= 0xFFFF)
+                    data.insert(data.end(), {static_cast<std::uint8_t>(type | 25),
+                                             static_cast<std::uint8_t>(value >> 8),
+                                             static_cast<std::uint8_t>(value)});
+                else if (value <= 0xFFFFFFFF)
+                    data.insert(data.end(), {static_cast<std::uint8_t>(type | 26),
+                                             static_cast<std::uint8_t>(value >> 24),
+                                             static_cast<std::uint8_t>(value >> 16),
+                                             static_cast<std::uint8_t>(value >> 8),
+                                             static_cast<std::uint8_t>(value)});
+                else
+                {
+                    data.push_back(static_cast<std::uint8_t>(type | 27));
+                    for (std::uint32_t i = 0; i < 8; ++i)
+                        data.push_back(static_cast<std::uint8_t>(value >> (56 - i * 8)));
+                }
+            }
+
+            inline void encodeCborString(std::vector<std::uint8_t>& data, const std::string& str)
+            {
+                encodeCborHeader(data, 3, str.length());
+                data.insert(data.end(), str.begin(), str.end());
+            }
+
+            inline void encodeCbor(std::vector<std::uint8_t>& data, const Value& value)
+            {
+                switch (value.getType())
+                {
+                    case Value::Type::Null:
+                        data.push_back(0xF6);
+                        break;
+                    case Value::Type::Integer:
+                    {
+                        const auto intValue = value.as<std::int64_t>();
+                        if (intValue >= 0)
+                            encodeCborHeader(data, 0, static_cast<std::uint64_t>(intValue));
+                        else
+                            encodeCborHeader(data, 1, static_cast<std::uint64_t>(-(intValue + 1)));
+                        break;
+                    }
+                    case Value::Type::Float:
+                    {
+                        const auto doubleValue = value.as<double>();
+                        const auto floatValue = static_cast<float>(doubleValue);
+
+                        // single precision is used when it does not lose any precision
+                        if (static_cast<double>(floatValue) == doubleValue)
+                        {
+                            std::uint32_t bits;
+                            std::memcpy(&bits, &floatValue, sizeof(bits));
+                            data.push_back(0xFA);
+                            for (std::uint32_t i = 0; i < 4; ++i)
+                                data.push_back(static_cast<std::uint8_t>(bits >> (24 - i * 8)));
+                        }
+                        else
+                        {
+                            std::uint64_t bits;
+                            std::memcpy(&bits, &doubleValue, sizeof(bits));
+                            data.push_back(0xFB);
+                            for (std::uint32_t i = 0; i < 8; ++i)
+                                data.push_back(static_cast<std::uint8_t>(bits >> (56 - i * 8)));
+                        }
+                        break;
+                    }
+                    case Value::Type::String:
+                        encodeCborString(data, value.as<std::string>());
+                        break;
+                    case Value::Type::Object:
+                    {
+                        const auto& objectValue = value.as<Value::Object>();
+                        encodeCborHeader(data, 5, objectValue.size());
+                        for (const auto& member : objectValue)
+                        {
+                            encodeCborString(data, member.first);
+                            encodeCbor(data, member.second);
+                        }
+                        break;
+                    }
+                    case Value::Type::Array:
+                    {
+                        const auto& arrayValue = value.as<Value::Array>();
+                        encodeCborHeader(data, 4, arrayValue.size());
+                        for (const auto& element : arrayValue)
+                            encodeCbor(data, element);
+                        break;
+                    }
+                    case Value::Type::Boolean:
+                        data.push_back(value.as<bool>() ? 0xF5 : 0xF4);
+                        break;
+                    default:
+                        throw ParseError("Unknown value type");
+                }
+            }
+
+            inline std::uint64_t decodeCborArgument(const std::uint8_t*& iterator,
+                                                    const std::uint8_t* end,
+                                                    std::uint8_t additional)
+            {
+                if (additional < 24) return additional;
+                if (additional > 27)
+                    throw ParseError("Indefinite length items are not supported");
+
+                const std::size_t size = std::size_t(1) << (additional - 24);
+                if (static_cast<std::size_t>(end - iterator) < size)
+                    throw ParseError("Unexpected end of data");
+
+                std::uint64_t result = 0;
+                for (std::size_t i = 0; i < size; ++i)
+                    result = (result << 8) | *iterator++;
+
+                return result;
+            }
+
+            inline std::string decodeCborString(const std::uint8_t*& iterator,
+                                                const std::uint8_t* end,
+                                                std::uint64_t length)
+            {
+                if (static_cast<std::uint64_t>(end - iterator) < length)
+                    throw ParseError("Unexpected end of data");
+
+                const std::string result(reinterpret_cast<const char*>(iterator),
+                                         static_cast<std::size_t>(length));
+                iterator += length;
+                return result;
+            }
+
+            inline Value decodeCbor(const std::uint8_t*& iterator,
+                                    const std::uint8_t* end,
+                                    std::uint32_t depth = 0)
+            {
+                if (iterator == end)
+                    throw ParseError("Unexpected end of data");
+
+                if (depth > 1024)
+                    throw ParseError("Too deep nesting");
+
+                const std::uint8_t initialByte = *iterator++;
+                const auto majorType = static_cast<std::uint8_t>(initialByte >> 5);
+                const auto additional = static_cast<std::uint8_t>(initialByte & 0x1F);
+
+                switch (majorType)
+                {
+                    case 0: // unsigned integer
+                    case 1: // negative integer
+                    {
+                        const std::uint64_t argument = decodeCborArgument(iterator, end, additional);
+                        if (argument > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+                            throw ParseError("Integer out of range");
+
+                        return Value(majorType == 0 ? static_cast<std::int64_t>(argument) :
+                                     -1 - static_cast<std::int64_t>(argument));
+                    }
+                    case 2: // byte string
+                    case 3: // text string
+                        return Value(decodeCborString(iterator, end, decodeCborArgument(iterator, end, additional)));
+                    case 4: // array
+                    {
+                        const std::uint64_t size = decodeCborArgument(iterator, end, additional);
+                        if (size > static_cast<std::uint64_t>(end - iterator))
+                            throw ParseError("Unexpected end of data");
+
+                        Value result = Value::Type::Array;
+                        auto& arrayValue = result.as<Value::Array>();
+                        arrayValue.reserve(static_cast<std::size_t>(size));
+                        for (std::uint64_t i = 0; i < size; ++i)
+                            arrayValue.push_back(decodeCbor(iterator, end, depth + 1));
+                        return result;
+                    }
+                    case 5: // map
+                    {
+                        const std::uint64_t size = decodeCborArgument(iterator, end, additional);
+
+                        Value result = Value::Type::Object;
+                        auto& objectValue = result.as<Value::Object>();
+                        for (std::uint64_t i = 0; i < size; ++i)
+                        {
+                            if (iterator == end)
+                                throw ParseError("Unexpected end of data");
+
+                            const std::uint8_t keyByte = *iterator++;
+                            if ((keyByte >> 5) != 3)
+                                throw ParseError("Expected a string key");
+
+                            const auto keyLength = decodeCborArgument(iterator, end, keyByte & 0x1F);
+                            std::string key = decodeCborString(iterator, end, keyLength);
+
+                            auto member = objectValue.lower_bound(key);
+                            if (member != objectValue.end() && member->first == key)
+                                throw ParseError("Duplicate key value " + key);
+
+                            objectValue.emplace_hint(member, std::move(key), decodeCbor(iterator, end, depth + 1));
+                        }
+                        return result;
+                    }
+                    case 6: // tag, the tagged item is decoded without it
+                        decodeCborArgument(iterator, end, additional);
+                        return decodeCbor(iterator, end, depth + 1);
+                    default: // simple values and floats
+                        switch (additional)
+                        {
+                            case 20: return Value(false);
+                            case 21: return Value(true);
+                            case 22: // null
+                            case 23: // undefined
+                                return Value(nullptr);
+                            case 25: // half precision
+                            {
+                                const auto bits = static_cast<std::uint32_t>(decodeCborArgument(iterator, end, additional));
+                                const std::uint32_t exponent = (bits >> 10) & 0x1F;
+                                const std::uint32_t mantissa = bits & 0x3FF;
+                                double result = (exponent == 0) ? std::ldexp(mantissa, -24) :
+                                    (exponent != 31) ? std::ldexp(mantissa + 1024, static_cast<int>(exponent) - 25) :
+                                    (mantissa == 0) ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+                                return Value((bits & 0x8000) ? -result : result);
+                            }
+                            case 26: // single precision
+                            {
+                                const auto bits = static_cast<std::uint32_t>(decodeCborArgument(iterator, end, additional));
+                                float result;
+                                std::memcpy(&result, &bits, sizeof(result));
+                                return Value(result);
+                            }
+                            case 27: // double precision
+                            {
+                                const std::uint64_t bits = decodeCborArgument(iterator, end, additional);
+                                double result;
+                                std::memcpy(&result, &bits, sizeof(result));
+                                return Value(result);
+                            }
+                            default:
+                                throw ParseError("Unsupported simple value");
+                        }
+                }
+            }
+        }
+
+        // Encodes the value in CBOR (RFC 7049), which is smaller than the text format
+        // and is read without parsing numbers or unescaping strings
+        inline std::vector<std::uint8_t> encodeCbor(const Value& value)
+        {
+            std::vector<std::uint8_t> result;
+            encodeCbor(result, value);
+            return result;
+        }
+
+        inline Value decodeCbor(const std::vector<std::uint8_t>& data)
+        {
+            const std::uint8_t* iterator = data.data();
+            Value result = decodeCbor(iterator, data.data() + data.size());
+
+            if (iterator != data.data() + data.size())
+                throw ParseError("Unexpected data after the root value");
+
+            return result;
+        }
     } // namespace json
 } // namespace ouzel
 
@@ -27,16 +27,338 @@
 #  include <emscripten.h>
 #endif
 
+#include <cinttypes>
+#include <cstdio>
 #include "Log.hpp"
 
 namespace ouzel
 {
+    namespace
+    {
+#if !defined(__ANDROID__) && !TARGET_OS_IOS && !TARGET_OS_TV && (TARGET_OS_MAC || defined(__linux__))
+        void writeAll(int fd, const char* data, std::size_t size)
+        {
+            std::size_t offset = 0;
+            while (offset < size)
+            {
+                const ssize_t written = write(fd, data + offset, size - offset);
+                if (written == -1)
+                    return;
+
+                offset += static_cast<std::size_t>(written);
+            }
+        }
+#endif
+
+        template <class T>
+        void appendHex(T value, std::size_t digitCount, std::string& result)
+        {
+            constexpr char digits[] = "0123456789abcdef";
+
+            for (std::size_t i = 0; i < digitCount; ++i)
+                result.push_back(digits[(value >> (digitCount - i - 1) * 4) & 0x0F]);
+        }
+    }
+
+    void Log::Record::format(const char* recordData, std::size_t recordSize, std::string& result)
+    {
+        std::size_t offset = 0;
+        while (offset + 3 <= recordSize)
+        {
+            const auto type = static_cast<Argument>(recordData[offset]);
+            const std::size_t valueSize = static_cast<std::uint8_t>(recordData[offset + 1]) |
+                (static_cast<std::size_t>(static_cast<std::uint8_t>(recordData[offset + 2])) << 8);
+
+            formatArgument(type, recordData + offset + 3, valueSize, result);
+            offset += 3 + valueSize;
+        }
+    }
+
+    void Log::Record::formatArgument(Argument type, const char* value, std::size_t valueSize, std::string& result)
+    {
+        char buffer[512]; // enough for any double in the %f format
+
+        switch (type)
+        {
+            case Argument::Text:
+                result.append(value, valueSize);
+                break;
+            case Argument::Boolean:
+            {
+                bool b;
+                std::memcpy(&b, value, sizeof(b));
+                result += b ? "true" : "false";
+                break;
+            }
+            case Argument::Integer:
+            {
+                std::int64_t i;
+                std::memcpy(&i, value, sizeof(i));
+                result.append(buffer, static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%" PRId64, i)));
+                break;
+            }
+            case Argument::UnsignedInteger:
+            {
+                std::uint64_t i;
+                std::memcpy(&i, value, sizeof(i));
+                result.append(buffer, static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%" PRIu64, i)));
+                break;
+            }
+            case Argument::Float:
+            {
+                // same format as std::to_string
+                double d;
+                std::memcpy(&d, value, sizeof(d));
+                result.append(buffer, static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%f", d)));
+                break;
+            }
+            case Argument::Hex:
+            {
+                std::uint8_t h;
+                std::memcpy(&h, value, sizeof(h));
+                appendHex(h, 2, result);
+                break;
+            }
+            case Argument::Pointer:
+            {
+                std::uintptr_t p;
+                std::memcpy(&p, value, sizeof(p));
+                appendHex(p, sizeof(p) * 2, result);
+                break;
+            }
+        }
+    }
+
     Log::~Log()
     {
-        if (!s.empty())
-            logger.log(s, level);
+        if (level > logger.threshold) return;
+
+        if (overflow)
+        {
+            if (!s.empty())
+                logger.submit(level, Logger::Kind::Text, s.data(), s.size());
+        }
+        else if (!record.isEmpty())
+            logger.submit(level, Logger::Kind::Record, record.getData(), record.getSize());
+    }
+
+    void Logger::startTrace(const storage::Path& path)
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        tracing = false;
+        traceFile.reset();
+        traceFile.reset(new trace::File(path));
+        tracing = true;
     }
 
+    void Logger::stopTrace()
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        tracing = false;
+        traceFile.reset();
+    }
+
+#if defined(__EMSCRIPTEN__)
+    void Logger::submit(const Log::Level level, const Kind kind, const char* data, std::size_t size) const
+    {
+        if (kind == Kind::Trace)
+        {
+            std::lock_guard<std::mutex> lock(traceMutex);
+            if (traceFile) traceFile->writeRecord(data, size);
+        }
+        else if (kind == Kind::Text)
+            logString(std::string(data, size), level);
+        else
+        {
+            std::string str;
+            Log::Record::format(data, size, str);
+            logString(str, level);
+        }
+    }
+#else
+    std::atomic<std::uint64_t> Logger::nextId{0};
+
+    void Logger::submit(const Log::Level level, const Kind kind, const char* data, std::size_t size) const
+    {
+        Ring& ring = getRing();
+
+        if (!ring.push(level, kind, data, size))
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            wake();
+        }
+        else if (level == Log::Level::Error || ring.getUsed() > Ring::capacity / 2)
+            wake();
+    }
+
+    Logger::Ring& Logger::getRing() const
+    {
+        // rings of the current thread for each logger, usually only one
+        thread_local std::vector<std::pair<std::uint64_t, std::shared_ptr<Ring>>> threadRings;
+
+        for (const auto& threadRing : threadRings)
+            if (threadRing.first == id)
+                return *threadRing.second;
+
+        auto ring = std::make_shared<Ring>();
+
+        std::unique_lock<std::mutex> lock(ringsMutex);
+        rings.push_back(ring);
+        lock.unlock();
+
+        threadRings.emplace_back(id, ring);
+        return *ring;
+    }
+
+    void Logger::wake() const
+    {
+        if (!wakeRequested.exchange(true, std::memory_order_acq_rel))
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            lock.unlock();
+            wakeCondition.notify_all();
+        }
+    }
+
+    void Logger::logLoop()
+    {
+        for (;;)
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(20), [this]() {
+                return !running || wakeRequested.load(std::memory_order_acquire);
+            });
+            wakeRequested.store(false, std::memory_order_release);
+            const bool quit = !running;
+            lock.unlock();
+
+            drain();
+
+            if (quit) break;
+        }
+    }
+
+    void Logger::drain()
+    {
+        std::unique_lock<std::mutex> lock(ringsMutex);
+        drainRings = rings;
+        lock.unlock();
+
+        std::size_t messageCount = 0;
+        bool prune = false;
+        std::string traceError;
+        std::unique_lock<std::mutex> traceLock(traceMutex);
+
+        for (const auto& ring : drainRings)
+        {
+            // a ring that is not referenced by its thread anymore will not receive new messages
+            const bool orphaned = ring.use_count() == 2;
+            prune |= orphaned;
+
+            ring->consume([this, &messageCount, &traceError](const Slot& slot) {
+                if (slot.kind == Kind::Trace)
+                {
+                    if (traceFile)
+                    {
+                        try
+                        {
+                            traceFile->writeRecord(slot.data, slot.size);
+                        }
+                        catch (const std::exception& e)
+                        {
+                            tracing = false;
+                            traceFile.reset();
+                            traceError = e.what();
+                        }
+                    }
+                    return;
+                }
+
+                if (slot.kind == Kind::Text)
+                    message.append(slot.data, slot.size);
+                else
+                    Log::Record::format(slot.data, slot.size, message);
+
+                if (slot.last && !message.empty())
+                {
+                    if (messageCount == messages.size()) messages.emplace_back();
+                    messages[messageCount].first = slot.level;
+                    std::swap(messages[messageCount].second, message);
+                    ++messageCount;
+                    message.clear();
+                }
+            });
+        }
+
+        traceLock.unlock();
+
+        if (!traceError.empty())
+        {
+            if (messageCount == messages.size()) messages.emplace_back();
+            messages[messageCount].first = Log::Level::Error;
+            messages[messageCount].second = "Failed to write trace, " + traceError;
+            ++messageCount;
+        }
+
+        if (prune)
+        {
+            lock.lock();
+            rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Ring>& ring) {
+                return ring.use_count() == 2 && ring->getUsed() == 0;
+            }), rings.end());
+            lock.unlock();
+        }
+
+        drainRings.clear();
+
+        const std::size_t droppedCount = dropped.load(std::memory_order_relaxed);
+        if (droppedCount != reportedDropped && Log::Level::Warning <= threshold)
+        {
+            if (messageCount == messages.size()) messages.emplace_back();
+            messages[messageCount].first = Log::Level::Warning;
+            messages[messageCount].second = std::to_string(droppedCount - reportedDropped) + " log messages dropped";
+            ++messageCount;
+            reportedDropped = droppedCount;
+        }
+
+        if (messageCount) logBatch(messages, messageCount);
+    }
+
+    void Logger::logBatch(const std::vector<std::pair<Log::Level, std::string>>& messages,
+                          std::size_t count)
+    {
+#if !defined(__ANDROID__) && !TARGET_OS_IOS && !TARGET_OS_TV && (TARGET_OS_MAC || defined(__linux__))
+        // one write per output instead of one per message
+        std::string output;
+        std::string errorOutput;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            switch (messages[i].first)
+            {
+                case Log::Level::Error:
+                case Log::Level::Warning:
+                    errorOutput += messages[i].second;
+                    errorOutput.push_back('\n');
+                    break;
+                case Log::Level::Info:
+                case Log::Level::All:
+                    output += messages[i].second;
+                    output.push_back('\n');
+                    break;
+                default: break;
+            }
+        }
+
+        if (!errorOutput.empty()) writeAll(STDERR_FILENO, errorOutput.data(), errorOutput.size());
+        if (!output.empty()) writeAll(STDOUT_FILENO, output.data(), output.size());
+#else
+        for (std::size_t i = 0; i < count; ++i)
+            logString(messages[i].second, messages[i].first);
+#endif
+    }
+#endif
+
     void Logger::logString(const std::string& str, Log::Level level)
     {
 #if defined(__ANDROID__)
@@ -79,15 +401,7 @@ namespace ouzel
         std::vector<char> output(str.begin(), str.end());
         output.push_back('\n');
 
-        std::size_t offset = 0;
-        while (offset < output.size())
-        {
-            const ssize_t written = write(fd, output.data() + offset, output.size() - offset);
-            if (written == -1)
-                return;
-
-            offset += static_cast<std::size_t>(written);
-        }
+        writeAll(fd, output.data(), output.size());
 #elif defined(_WIN32)
         const int bufferSize = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
         if (bufferSize == 0)
@@ -3,23 +3,29 @@
 #ifndef OUZEL_UTILS_LOG_HPP
 #define OUZEL_UTILS_LOG_HPP
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <initializer_list>
 #include <list>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <set>
 #include <string>
 #include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 #include "../math/Matrix.hpp"
 #include "../math/Quaternion.hpp"
 #include "../math/Size.hpp"
 #include "../math/Vector.hpp"
 #include "Thread.hpp"
+#include "Trace.hpp"
 
 namespace ouzel
 {
@@ -37,6 +43,48 @@ namespace ouzel
             All
         };
 
+        // Fixed-size list of arguments that are stored in binary and converted to text on the logger thread
+        class Record final
+        {
+        public:
+            static constexpr std::size_t capacity = 248;
+
+            enum class Argument: std::uint8_t
+            {
+                Text,
+                Boolean,
+                Integer,
+                UnsignedInteger,
+                Float,
+                Hex,
+                Pointer
+            };
+
+            // returns false if the argument does not fit
+            bool add(Argument type, const void* value, std::size_t valueSize) noexcept
+            {
+                if (size + 3 > capacity || valueSize > capacity - size - 3) return false;
+
+                data[size] = static_cast<char>(type);
+                data[size + 1] = static_cast<char>(valueSize & 0xFF);
+                data[size + 2] = static_cast<char>(valueSize >> 8);
+                std::memcpy(data + size + 3, value, valueSize);
+                size += 3 + valueSize;
+                return true;
+            }
+
+            inline auto isEmpty() const noexcept { return size == 0; }
+            inline auto getSize() const noexcept { return size; }
+            inline auto getData() const noexcept { return data; }
+
+            static void format(const char* recordData, std::size_t recordSize, std::string& result);
+            static void formatArgument(Argument type, const char* value, std::size_t valueSize, std::string& result);
+
+        private:
+            std::size_t size = 0;
+            char data[capacity];
+        };
+
         explicit Log(const Logger& initLogger, Level initLevel = Level::Info):
             logger(initLogger), level(initLevel)
         {
@@ -45,6 +93,8 @@ namespace ouzel
         Log(const Log& other):
             logger(other.logger),
             level(other.level),
+            record(other.record),
+            overflow(other.overflow),
             s(other.s)
         {
         }
@@ -52,9 +102,13 @@ namespace ouzel
         Log(Log&& other) noexcept:
             logger(other.logger),
             level(other.level),
+            record(other.record),
+            overflow(other.overflow),
             s(std::move(other.s))
         {
             other.level = Level::Info;
+            other.record = Record();
+            other.overflow = false;
         }
 
         Log& operator=(const Log& other)
@@ -62,6 +116,8 @@ namespace ouzel
             if (&other == this) return *this;
 
             level = other.level;
+            record = other.record;
+            overflow = other.overflow;
             s = other.s;
 
             return *this;
@@ -73,6 +129,10 @@ namespace ouzel
 
             level = other.level;
             other.level = Level::Info;
+            record = other.record;
+            other.record = Record();
+            overflow = other.overflow;
+            other.overflow = false;
             s = std::move(other.s);
 
             return *this;
@@ -83,55 +143,63 @@ namespace ouzel
         template <typename T, typename std::enable_if<std::is_same<T, bool>::value>::type* = nullptr>
         Log& operator<<(const T val)
         {
-            s += val ? "true" : "false";
+            addValue(Record::Argument::Boolean, val);
             return *this;
         }
 
         template <typename T, typename std::enable_if<std::is_same<T, std::uint8_t>::value>::type* = nullptr>
         Log& operator<<(const T val)
         {
-            constexpr char digits[] = "0123456789abcdef";
-
-            for (std::uint32_t p = 0; p < 2; ++p)
-                s.push_back(digits[(val >> (4 - p * 4)) & 0x0F]);
+            addValue(Record::Argument::Hex, val);
+            return *this;
+        }
 
+        template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+            std::is_signed<T>::value>::type* = nullptr>
+        Log& operator<<(const T val)
+        {
+            addValue(Record::Argument::Integer, static_cast<std::int64_t>(val));
             return *this;
         }
 
-        template <typename T, typename std::enable_if<std::is_arithmetic<T>::value &&
+        template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+            std::is_unsigned<T>::value &&
             !std::is_same<T, bool>::value &&
             !std::is_same<T, std::uint8_t>::value>::type* = nullptr>
         Log& operator<<(const T val)
         {
-            s += std::to_string(val);
+            addValue(Record::Argument::UnsignedInteger, static_cast<std::uint64_t>(val));
+            return *this;
+        }
+
+        template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+        Log& operator<<(const T val)
+        {
+            addValue(Record::Argument::Float, static_cast<double>(val));
             return *this;
         }
 
         template <typename T, typename std::enable_if<std::is_same<T, std::string>::value>::type* = nullptr>
         Log& operator<<(const T& val)
         {
-            s += val;
+            addText(val.data(), val.length());
             return *this;
         }
 
         template <typename T, typename std::enable_if<std::is_same<T, char>::value>::type* = nullptr>
         Log& operator<<(const T* val)
         {
-            s += val;
+            addText(val, std::strlen(val));
             return *this;
         }
 
         template <typename T, typename std::enable_if<!std::is_same<T, char>::value>::type* = nullptr>
         Log& operator<<(const T* val)
         {
-            constexpr char digits[] = "0123456789abcdef";
-
             std::uintptr_t ptrValue;
             memcpy(&ptrValue, &val, sizeof(ptrValue));
 
-            for (std::size_t i = 0; i < sizeof(val) * 2; ++i)
-                s.push_back(digits[(ptrValue >> (sizeof(ptrValue) * 2 - i - 1) * 4) & 0x0F]);
-
+            addValue(Record::Argument::Pointer, ptrValue);
             return *this;
         }
 
@@ -149,7 +217,7 @@ namespace ouzel
 
             for (const auto& i : val)
             {
-                if (!first) s += ", ";
+                if (!first) addText(", ", 2);
                 first = false;
 
                 operator<<(i);
@@ -165,9 +233,9 @@ namespace ouzel
 
             for (const T c : val.m)
             {
-                if (!first) s += ",";
+                if (!first) addText(",", 1);
                 first = false;
-                s += std::to_string(c);
+                addValue(Record::Argument::Float, static_cast<double>(c));
             }
 
             return *this;
@@ -176,8 +244,12 @@ namespace ouzel
         template <typename T>
         Log& operator<<(const Quaternion<T>& val)
         {
-            s += std::to_string(val.v[0]) + "," + std::to_string(val.v[1]) + "," +
-                std::to_string(val.v[2]) + "," + std::to_string(val.v[3]);
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                if (i) addText(",", 1);
+                addValue(Record::Argument::Float, static_cast<double>(val.v[i]));
+            }
+
             return *this;
         }
 
@@ -188,9 +260,9 @@ namespace ouzel
 
             for (const T c : val.v)
             {
-                if (!first) s += ",";
+                if (!first) addText(",", 1);
                 first = false;
-                s += std::to_string(c);
+                addValue(Record::Argument::Float, static_cast<double>(c));
             }
             return *this;
         }
@@ -202,21 +274,51 @@ namespace ouzel
 
             for (const T c : val.v)
             {
-                if (!first) s += ",";
+                if (!first) addText(",", 1);
                 first = false;
-                s += std::to_string(c);
+                addValue(Record::Argument::Float, static_cast<double>(c));
             }
             return *this;
         }
 
     private:
+        template <class T>
+        void addValue(Record::Argument type, const T value)
+        {
+            if (!overflow && record.add(type, &value, sizeof(value))) return;
+
+            if (!overflow) formatRecord();
+            Record::formatArgument(type, reinterpret_cast<const char*>(&value), sizeof(value), s);
+        }
+
+        void addText(const char* text, std::size_t length)
+        {
+            if (!overflow && record.add(Record::Argument::Text, text, length)) return;
+
+            if (!overflow) formatRecord();
+            s.append(text, length);
+        }
+
+        // messages that do not fit in a record are formatted on the calling thread
+        void formatRecord()
+        {
+            Record::format(record.getData(), record.getSize(), s);
+            record = Record();
+            overflow = true;
+        }
+
         const Logger& logger;
         Level level = Level::Info;
+        Record record;
+        bool overflow = false;
         std::string s;
     };
 
+    // Each logging thread writes to its own lock-free ring of fixed-size slots, which a
+    // background thread drains periodically and writes to the output in batches
     class Logger final
     {
+        friend Log;
     public:
         explicit Logger(Log::Level initThreshold = Log::Level::All):
             threshold(initThreshold)
@@ -234,10 +336,11 @@ namespace ouzel
         ~Logger()
         {
 #if !defined(__EMSCRIPTEN__)
-            std::unique_lock<std::mutex> lock(queueMutex);
-            commandQueue.push(Command(Command::Type::Quit));
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            running = false;
             lock.unlock();
-            queueCondition.notify_all();
+            wakeCondition.notify_all();
+            // the logger thread drains the remaining messages before it is joined
 #endif
         }
 
@@ -248,76 +351,147 @@ namespace ouzel
 
         void log(const std::string& str, const Log::Level level = Log::Level::Info) const
         {
-            if (level <= threshold)
-            {
-#if defined(__EMSCRIPTEN__)
-                logString(str, level);
-#else
-                std::unique_lock<std::mutex> lock(queueMutex);
-                commandQueue.push(Command(Command::Type::LogString, level, str));
-                lock.unlock();
-                queueCondition.notify_all();
-#endif
-            }
+            if (level <= threshold && !str.empty())
+                submit(level, Kind::Text, str.data(), str.size());
         }
 
+        // writes the events to a binary trace file on the logger thread
+        void startTrace(const storage::Path& path);
+        // events that have not been written yet are discarded
+        void stopTrace();
+
+        template <class... Args, class... Values>
+        void trace(const trace::Event<Args...>& event, const Values... values) const
+        {
+            static_assert(sizeof...(Args) == sizeof...(Values), "Invalid number of trace fields");
+            static_assert(trace::recordHeaderSize + trace::Event<Args...>::size <= Log::Record::capacity,
+                          "Trace event is too big");
+
+            if (!tracing.load(std::memory_order_relaxed)) return;
+
+            char data[trace::recordHeaderSize + trace::Event<Args...>::size];
+            const std::uint16_t eventId = event.getId();
+            const auto timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+            std::memcpy(data, &eventId, sizeof(eventId));
+            std::memcpy(data + sizeof(eventId), &timestamp, sizeof(timestamp));
+            event.encode(data + trace::recordHeaderSize, static_cast<Args>(values)...);
+
+            submit(Log::Level::Info, Kind::Trace, data, sizeof(data));
+        }
+
+        // the number of messages that were dropped because the ring of their thread was full
+        inline auto getDroppedCount() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
     private:
         static void logString(const std::string& str, const Log::Level level = Log::Level::Info);
 
+        enum class Kind: std::uint8_t
+        {
+            Record,
+            Text, // formatted text that can span multiple slots
+            Trace
+        };
+
+        void submit(const Log::Level level, const Kind kind, const char* data, std::size_t size) const;
+
 #ifdef DEBUG
         std::atomic<Log::Level> threshold{Log::Level::All};
 #else
         std::atomic<Log::Level> threshold{Log::Level::Info};
 #endif
 
+        std::atomic<bool> tracing{false};
+        mutable std::mutex traceMutex;
+        std::unique_ptr<trace::File> traceFile;
+
 #if !defined(__EMSCRIPTEN__)
-        class Command
+        struct Slot final
+        {
+            Log::Level level;
+            Kind kind;
+            bool last; // last slot of the message
+            std::uint16_t size;
+            char data[Log::Record::capacity];
+        };
+
+        // single producer and single consumer queue
+        class Ring final
         {
         public:
-            enum class Type
+            static constexpr std::size_t capacity = 512;
+
+            // returns false if there is not enough space for the whole message
+            bool push(const Log::Level level, const Kind kind, const char* data, std::size_t size) noexcept
             {
-                LogString,
-                Quit
-            };
+                const std::size_t count = (kind == Kind::Text) ? (size + Log::Record::capacity - 1) / Log::Record::capacity : 1;
+                const std::size_t currentTail = tail.load(std::memory_order_relaxed);
+                const std::size_t used = currentTail - head.load(std::memory_order_acquire);
+
+                if (count > capacity - used) return false;
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    Slot& slot = slots[(currentTail + i) % capacity];
+                    const std::size_t chunkSize = std::min(size - i * Log::Record::capacity, Log::Record::capacity);
+
+                    slot.level = level;
+                    slot.kind = kind;
+                    slot.last = (i == count - 1);
+                    slot.size = static_cast<std::uint16_t>(chunkSize);
+                    std::memcpy(slot.data, data + i * Log::Record::capacity, chunkSize);
+                }
+
+                tail.store(currentTail + count, std::memory_order_release);
+                return true;
+            }
 
-            explicit Command(const Type initType):
-                type(initType)
+            inline auto getUsed() const noexcept
             {
+                return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed);
             }
 
-            Command(const Type initType, const Log::Level initLevel,
-                    const std::string& initString):
-                type(initType),
-                level(initLevel),
-                str(initString)
+            template <class F>
+            void consume(F f)
             {
+                const std::size_t currentHead = head.load(std::memory_order_relaxed);
+                const std::size_t currentTail = tail.load(std::memory_order_acquire);
+
+                for (std::size_t i = currentHead; i != currentTail; ++i)
+                    f(slots[i % capacity]);
+
+                head.store(currentTail, std::memory_order_release);
             }
 
-            Type type;
-            Log::Level level;
-            std::string str;
+        private:
+            alignas(64) std::atomic<std::size_t> head{0};
+            alignas(64) std::atomic<std::size_t> tail{0};
+            Slot slots[capacity];
         };
 
-        void logLoop()
-        {
-            for (;;)
-            {
-                std::unique_lock<std::mutex> lock(queueMutex);
-                while (commandQueue.empty()) queueCondition.wait(lock);
-                auto command = std::move(commandQueue.front());
-                commandQueue.pop();
-                lock.unlock();
-
-                if (command.type == Command::Type::LogString)
-                    logString(command.str, command.level);
-                else if (command.type == Command::Type::Quit)
-                    break;
-            }
-        }
+        Ring& getRing() const;
+        void wake() const;
+        void logLoop();
+        void drain();
+        static void logBatch(const std::vector<std::pair<Log::Level, std::string>>& messages,
+                             std::size_t count);
+
+        const std::uint64_t id = nextId++;
+        static std::atomic<std::uint64_t> nextId;
+
+        mutable std::mutex ringsMutex;
+        mutable std::vector<std::shared_ptr<Ring>> rings;
+        mutable std::atomic<std::size_t> dropped{0};
+        std::size_t reportedDropped = 0;
+
+        mutable std::condition_variable wakeCondition;
+        mutable std::mutex wakeMutex;
+        mutable std::atomic<bool> wakeRequested{false};
+        bool running = true;
+
+        std::vector<std::shared_ptr<Ring>> drainRings;
+        std::vector<std::pair<Log::Level, std::string>> messages;
+        std::string message;
 
-        mutable std::condition_variable queueCondition;
-        mutable std::mutex queueMutex;
-        mutable std::queue<Command> commandQueue;
         Thread logThread;
 #endif
     };
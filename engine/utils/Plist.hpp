@@ -3,14 +3,28 @@
 #ifndef OUZEL_UTILS_PLIST_HPP
 #define OUZEL_UTILS_PLIST_HPP
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <map>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
+#include "Utf8.hpp"
 
 namespace ouzel
 {
     namespace plist
     {
+        class ParseError final: public std::logic_error
+        {
+        public:
+            explicit ParseError(const std::string& str): std::logic_error(str) {}
+            explicit ParseError(const char* str): std::logic_error(str) {}
+        };
+
         class TypeError final: public std::runtime_error
         {
         public:
@@ -288,7 +302,8 @@ namespace ouzel
         enum class Format
         {
             Ascii,
-            Xml
+            Xml,
+            Binary // bplist00
         };
 
         inline std::string encode(const Value& value, Format format)
@@ -525,14 +540,465 @@ namespace ouzel
                 }
             };
 
+
+            class BinaryEncoder final
+            {
+            public:
+                static std::string encode(const Value& value)
+                {
+                    BinaryEncoder encoder;
+                    encoder.addObject(value);
+                    return encoder.write();
+                }
+
+            private:
+                struct Object final
+                {
+                    const Value* value = nullptr;
+                    const std::string* string = nullptr;
+                    std::vector<std::size_t> references;
+                };
+
+                static std::uint8_t getByteCount(std::uint64_t value) noexcept
+                {
+                    return (value <= 0xFF) ? 1 : (value <= 0xFFFF) ? 2 : (value <= 0xFFFFFFFF) ? 4 : 8;
+                }
+
+                static void writeInteger(std::uint64_t value, std::uint8_t size, std::string& result)
+                {
+                    for (std::uint8_t i = size; i-- > 0;)
+                        result.push_back(static_cast<char>(value >> (i * 8)));
+                }
+
+                static void writeMarker(std::uint8_t type, std::size_t count, std::string& result)
+                {
+                    if (count < 15)
+                        result.push_back(static_cast<char>(type | count));
+                    else
+                    {
+                        // longer counts follow the marker as an integer object
+                        const std::uint8_t size = getByteCount(count);
+                        result.push_back(static_cast<char>(type | 0x0F));
+                        result.push_back(static_cast<char>(0x10 | (size == 1 ? 0 : size == 2 ? 1 : size == 4 ? 2 : 3)));
+                        writeInteger(count, size, result);
+                    }
+                }
+
+                // objects are collected first, because the size of the references depends on their count
+                std::size_t addObject(const Value& value)
+                {
+                    if (value.getType() == Value::Type::String)
+                        return addString(value.as<std::string>());
+
+                    const std::size_t index = objects.size();
+                    objects.emplace_back();
+                    objects[index].value = &value;
+
+                    if (value.getType() == Value::Type::Dictionary)
+                    {
+                        const auto& dictionary = value.as<Value::Dictionary>();
+                        std::vector<std::size_t> references;
+                        references.reserve(dictionary.size() * 2);
+
+                        for (const auto& entry : dictionary)
+                            references.push_back(addString(entry.first));
+                        for (const auto& entry : dictionary)
+                            references.push_back(addObject(entry.second));
+
+                        objects[index].references = std::move(references);
+                    }
+                    else if (value.getType() == Value::Type::Array)
+                    {
+                        const auto& array = value.as<Value::Array>();
+                        std::vector<std::size_t> references;
+                        references.reserve(array.size());
+
+                        for (const auto& child : array)
+                            references.push_back(addObject(child));
+
+                        objects[index].references = std::move(references);
+                    }
+
+                    return index;
+                }
+
+                // equal strings and keys are stored once
+                std::size_t addString(const std::string& string)
+                {
+                    auto i = strings.find(&string);
+                    if (i != strings.end()) return i->second;
+
+                    objects.emplace_back();
+                    objects.back().string = &string;
+                    strings[&string] = objects.size() - 1;
+
+                    return objects.size() - 1;
+                }
+
+                std::string write() const
+                {
+                    std::string result = "bplist00";
+
+                    const std::uint8_t referenceSize = getByteCount(objects.size());
+                    std::vector<std::uint64_t> offsets;
+                    offsets.reserve(objects.size());
+
+                    for (const Object& object : objects)
+                    {
+                        offsets.push_back(result.size());
+
+                        if (object.string)
+                        {
+                            writeString(*object.string, result);
+                            continue;
+                        }
+
+                        const Value& value = *object.value;
+
+                        switch (value.getType())
+                        {
+                            case Value::Type::Dictionary:
+                                writeMarker(0xD0, object.references.size() / 2, result);
+                                for (const std::size_t reference : object.references)
+                                    writeInteger(reference, referenceSize, result);
+                                break;
+                            case Value::Type::Array:
+                                writeMarker(0xA0, object.references.size(), result);
+                                for (const std::size_t reference : object.references)
+                                    writeInteger(reference, referenceSize, result);
+                                break;
+                            case Value::Type::Real:
+                            {
+                                const double realValue = value.as<double>();
+                                std::uint64_t bits;
+                                std::memcpy(&bits, &realValue, sizeof(bits));
+                                result.push_back(static_cast<char>(0x23));
+                                writeInteger(bits, 8, result);
+                                break;
+                            }
+                            case Value::Type::Integer:
+                            {
+                                // negative integers are always stored in eight bytes
+                                const auto integerValue = value.as<std::int64_t>();
+                                const std::uint8_t size = (integerValue < 0) ? 8 :
+                                    getByteCount(static_cast<std::uint64_t>(integerValue));
+                                result.push_back(static_cast<char>(0x10 | (size == 1 ? 0 : size == 2 ? 1 : size == 4 ? 2 : 3)));
+                                writeInteger(static_cast<std::uint64_t>(integerValue), size, result);
+                                break;
+                            }
+                            case Value::Type::Boolean:
+                                result.push_back(static_cast<char>(value.as<bool>() ? 0x09 : 0x08));
+                                break;
+                            case Value::Type::Data:
+                            {
+                                const auto& data = value.as<Value::Data>();
+                                writeMarker(0x40, data.size(), result);
+                                result.insert(result.end(), data.begin(), data.end());
+                                break;
+                            }
+                            case Value::Type::Date:
+                                throw std::runtime_error("Date fields are not supported");
+                            default:
+                                throw std::runtime_error("Unsupported value type");
+                        }
+                    }
+
+                    const std::uint64_t offsetTableOffset = result.size();
+                    const std::uint8_t offsetSize = getByteCount(offsets.empty() ? 0 : offsets.back());
+                    for (const std::uint64_t offset : offsets)
+                        writeInteger(offset, offsetSize, result);
+
+                    // trailer
+                    result.append(6, '\0');
+                    result.push_back(static_cast<char>(offsetSize));
+                    result.push_back(static_cast<char>(referenceSize));
+                    writeInteger(objects.size(), 8, result);
+                    writeInteger(0, 8, result); // top object
+                    writeInteger(offsetTableOffset, 8, result);
+
+                    return result;
+                }
+
+                static void writeString(const std::string& string, std::string& result)
+                {
+                    bool ascii = true;
+                    for (const char c : string)
+                        if (static_cast<std::uint8_t>(c) >= 0x80)
+                        {
+                            ascii = false;
+                            break;
+                        }
+
+                    if (ascii)
+                    {
+                        writeMarker(0x50, string.length(), result);
+                        result += string;
+                        return;
+                    }
+
+                    // other strings are stored in big-endian UTF-16
+                    std::vector<char16_t> units;
+                    for (const char32_t c : utf8::toUtf32(string))
+                        if (c >= 0x10000)
+                        {
+                            units.push_back(static_cast<char16_t>(0xD800 + ((c - 0x10000) >> 10)));
+                            units.push_back(static_cast<char16_t>(0xDC00 + ((c - 0x10000) & 0x3FF)));
+                        }
+                        else
+                            units.push_back(static_cast<char16_t>(c));
+
+                    writeMarker(0x60, units.size(), result);
+                    for (const char16_t unit : units)
+                        writeInteger(unit, 2, result);
+                }
+
+                // the strings are owned by the encoded value, so they are hashed by their contents
+                struct StringHash final
+                {
+                    std::size_t operator()(const std::string* string) const noexcept
+                    {
+                        return std::hash<std::string>()(*string);
+                    }
+                };
+
+                struct StringEqual final
+                {
+                    bool operator()(const std::string* a, const std::string* b) const noexcept
+                    {
+                        return *a == *b;
+                    }
+                };
+
+                std::vector<Object> objects;
+                std::unordered_map<const std::string*, std::size_t, StringHash, StringEqual> strings;
+            };
+
             switch (format)
             {
                 case Format::Ascii: return AsciiEncoder::encode(value);
                 case Format::Xml: return XmlEncoder::encode(value);
+                case Format::Binary: return BinaryEncoder::encode(value);
             }
 
             throw std::runtime_error("Unsupported format");
         }
+
+        // Decodes a binary property list
+        inline Value decode(const std::vector<std::uint8_t>& data)
+        {
+            class BinaryDecoder final
+            {
+            public:
+                explicit BinaryDecoder(const std::vector<std::uint8_t>& initData):
+                    data(initData)
+                {
+                    constexpr std::size_t headerSize = 8;
+                    constexpr std::size_t trailerSize = 32;
+
+                    if (data.size() < headerSize + trailerSize ||
+                        std::memcmp(data.data(), "bplist00", headerSize) != 0)
+                        throw ParseError("Not a binary property list");
+
+                    const std::size_t trailer = data.size() - trailerSize;
+                    offsetSize = data[trailer + 6];
+                    referenceSize = data[trailer + 7];
+                    objectCount = readInteger(trailer + 8, 8);
+                    topObject = readInteger(trailer + 16, 8);
+                    offsetTableOffset = readInteger(trailer + 24, 8);
+
+                    if (offsetSize < 1 || offsetSize > 8 ||
+                        referenceSize < 1 || referenceSize > 8 ||
+                        topObject >= objectCount ||
+                        offsetTableOffset < headerSize || offsetTableOffset > trailer ||
+                        objectCount > (trailer - offsetTableOffset) / offsetSize)
+                        throw ParseError("Invalid trailer");
+
+                    // shared objects are decoded once per reference, so references that fan out
+                    // on every level would take exponential time without a limit
+                    maxObjectVisits = std::max(objectCount * 16, std::uint64_t(1) << 20);
+                }
+
+                Value readObject(std::uint64_t index, std::uint32_t depth = 0)
+                {
+                    // references can form cycles in invalid files
+                    if (depth > 512)
+                        throw ParseError("Too deep nesting");
+
+                    if (index >= objectCount)
+                        throw ParseError("Invalid object reference");
+
+                    if (++objectVisits > maxObjectVisits)
+                        throw ParseError("Too many object references");
+
+                    std::uint64_t offset = readInteger(static_cast<std::size_t>(offsetTableOffset + index * offsetSize), offsetSize);
+                    if (offset >= offsetTableOffset)
+                        throw ParseError("Invalid object offset");
+
+                    const std::uint8_t marker = data[static_cast<std::size_t>(offset++)];
+                    const auto type = static_cast<std::uint8_t>(marker >> 4);
+                    const auto info = static_cast<std::uint8_t>(marker & 0x0F);
+
+                    switch (type)
+                    {
+                        case 0x0:
+                            if (marker == 0x08) return Value(false);
+                            else if (marker == 0x09) return Value(true);
+                            else throw ParseError("Unsupported object type");
+                        case 0x1: // integer
+                        case 0x8: // UID
+                        {
+                            if (info > 4) throw ParseError("Invalid integer size");
+
+                            // only the lower half of 16-byte integers is used
+                            const std::size_t size = std::size_t(1) << info;
+                            return Value(static_cast<std::int64_t>(readInteger(static_cast<std::size_t>(offset + size - std::min(size, std::size_t(8))),
+                                                                               std::min(size, std::size_t(8)))));
+                        }
+                        case 0x2: // real
+                        {
+                            if (info == 2)
+                            {
+                                const auto bits = static_cast<std::uint32_t>(readInteger(static_cast<std::size_t>(offset), 4));
+                                float result;
+                                std::memcpy(&result, &bits, sizeof(result));
+                                return Value(result);
+                            }
+                            else if (info == 3)
+                            {
+                                const std::uint64_t bits = readInteger(static_cast<std::size_t>(offset), 8);
+                                double result;
+                                std::memcpy(&result, &bits, sizeof(result));
+                                return Value(result);
+                            }
+                            else
+                                throw ParseError("Invalid real size");
+                        }
+                        case 0x3:
+                            throw ParseError("Date fields are not supported");
+                        case 0x4: // data
+                        {
+                            const std::uint64_t count = readCount(info, offset);
+                            check(offset, count);
+                            return Value(Value::Data(data.begin() + static_cast<std::ptrdiff_t>(offset),
+                                                     data.begin() + static_cast<std::ptrdiff_t>(offset + count)));
+                        }
+                        case 0x5: // ASCII string
+                        {
+                            const std::uint64_t count = readCount(info, offset);
+                            check(offset, count);
+                            return Value(std::string(reinterpret_cast<const char*>(data.data() + offset),
+                                                     static_cast<std::size_t>(count)));
+                        }
+                        case 0x6: // big-endian UTF-16 string
+                        {
+                            const std::uint64_t count = readCount(info, offset);
+                            check(offset, count, 2);
+
+                            std::string result;
+                            result.reserve(static_cast<std::size_t>(count));
+                            for (std::uint64_t i = 0; i < count; ++i)
+                            {
+                                auto c = static_cast<char32_t>(readInteger(static_cast<std::size_t>(offset + i * 2), 2));
+
+                                if (c >= 0xD800 && c <= 0xDBFF && i + 1 < count)
+                                {
+                                    const auto low = static_cast<char32_t>(readInteger(static_cast<std::size_t>(offset + (i + 1) * 2), 2));
+                                    if (low >= 0xDC00 && low <= 0xDFFF)
+                                    {
+                                        c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                                        ++i;
+                                    }
+                                }
+
+                                result += utf8::fromUtf32(c);
+                            }
+                            return Value(result);
+                        }
+                        case 0xA: // array
+                        {
+                            const std::uint64_t count = readCount(info, offset);
+                            check(offset, count, referenceSize);
+
+                            Value result = Value::Array();
+                            auto& array = result.as<Value::Array>();
+                            array.reserve(static_cast<std::size_t>(count));
+                            for (std::uint64_t i = 0; i < count; ++i)
+                                array.push_back(readObject(readInteger(static_cast<std::size_t>(offset + i * referenceSize), referenceSize), depth + 1));
+                            return result;
+                        }
+                        case 0xD: // dictionary
+                        {
+                            const std::uint64_t count = readCount(info, offset);
+                            check(offset, count, 2 * referenceSize);
+
+                            Value result = Value::Dictionary();
+                            auto& dictionary = result.as<Value::Dictionary>();
+                            for (std::uint64_t i = 0; i < count; ++i)
+                            {
+                                const Value key = readObject(readInteger(static_cast<std::size_t>(offset + i * referenceSize), referenceSize), depth + 1);
+                                if (key.getType() != Value::Type::String)
+                                    throw ParseError("Dictionary keys must be strings");
+
+                                dictionary[key.as<std::string>()] = readObject(readInteger(static_cast<std::size_t>(offset + (count + i) * referenceSize), referenceSize), depth + 1);
+                            }
+                            return result;
+                        }
+                        default:
+                            throw ParseError("Unsupported object type");
+                    }
+                }
+
+                inline auto getTopObject() const noexcept { return topObject; }
+
+            private:
+                std::uint64_t readInteger(std::size_t offset, std::size_t size) const
+                {
+                    if (offset > data.size() || size > data.size() - offset)
+                        throw ParseError("Unexpected end of data");
+
+                    std::uint64_t result = 0;
+                    for (std::size_t i = 0; i < size; ++i)
+                        result = (result << 8) | data[offset + i];
+                    return result;
+                }
+
+                // reads the count of the object and moves the offset to its contents
+                std::uint64_t readCount(std::uint8_t info, std::uint64_t& offset) const
+                {
+                    if (info != 0x0F) return info;
+
+                    if (offset >= offsetTableOffset)
+                        throw ParseError("Unexpected end of data");
+
+                    const std::uint8_t marker = data[static_cast<std::size_t>(offset++)];
+                    if ((marker >> 4) != 0x1 || (marker & 0x0F) > 3)
+                        throw ParseError("Invalid count");
+
+                    const std::size_t size = std::size_t(1) << (marker & 0x0F);
+                    const std::uint64_t result = readInteger(static_cast<std::size_t>(offset), size);
+                    offset += size;
+                    return result;
+                }
+
+                void check(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize = 1) const
+                {
+                    if (offset > offsetTableOffset || count > (offsetTableOffset - offset) / elementSize)
+                        throw ParseError("Unexpected end of data");
+                }
+
+                const std::vector<std::uint8_t>& data;
+                std::uint8_t offsetSize = 0;
+                std::uint8_t referenceSize = 0;
+                std::uint64_t objectCount = 0;
+                std::uint64_t topObject = 0;
+                std::uint64_t offsetTableOffset = 0;
+                std::uint64_t maxObjectVisits = 0;
+                std::uint64_t objectVisits = 0;
+            };
+
+            BinaryDecoder decoder(data);
+            return decoder.readObject(decoder.getTopObject());
+        }
     }
 }
 
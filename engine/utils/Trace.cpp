@@ -0,0 +1,194 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#if defined(_WIN32)
+#  pragma push_macro("WIN32_LEAN_AND_MEAN")
+#  pragma push_macro("NOMINMAX")
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <Windows.h>
+#  pragma pop_macro("WIN32_LEAN_AND_MEAN")
+#  pragma pop_macro("NOMINMAX")
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <system_error>
+#include "Trace.hpp"
+
+namespace ouzel
+{
+    namespace trace
+    {
+        File::File(const storage::Path& path)
+        {
+#if defined(_WIN32)
+            file = CreateFileW(path.getNative().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                               nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                throw std::system_error(GetLastError(), std::system_category(), "Failed to open trace file");
+#else
+            fd = open(path.getNative().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd == -1)
+                throw std::system_error(errno, std::system_category(), "Failed to open trace file");
+#endif
+
+            try
+            {
+                map();
+
+                const auto startTime = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+                write(&magic, sizeof(magic));
+                write(&version, sizeof(version));
+                write(&startTime, sizeof(startTime));
+            }
+            catch (...)
+            {
+#if defined(_WIN32)
+                CloseHandle(file);
+#else
+                close(fd);
+#endif
+                throw;
+            }
+        }
+
+        File::~File()
+        {
+            // cut the unused part of the last window
+            const std::uint64_t size = windowOffset + position;
+            unmap();
+
+#if defined(_WIN32)
+            LARGE_INTEGER distance;
+            distance.QuadPart = static_cast<LONGLONG>(size);
+            if (SetFilePointerEx(file, distance, nullptr, FILE_BEGIN))
+                SetEndOfFile(file);
+            CloseHandle(file);
+#else
+            static_cast<void>(ftruncate(fd, static_cast<off_t>(size)));
+            close(fd);
+#endif
+        }
+
+        void File::writeRecord(const char* data, std::size_t size)
+        {
+            std::uint16_t id;
+            std::memcpy(&id, data, sizeof(id));
+
+            if (id >= writtenSchemas.size()) writtenSchemas.resize(id + 1U);
+
+            if (!writtenSchemas[id])
+            {
+                const Schema schema = Registry::get(id);
+                const auto timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+
+                std::vector<char> definition(recordHeaderSize);
+                std::memcpy(definition.data(), &schemaId, sizeof(schemaId));
+                std::memcpy(definition.data() + 2, &timestamp, sizeof(timestamp));
+
+                const auto appendName = [&definition](const std::string& name) {
+                    const std::size_t length = std::min(name.length(), std::size_t{255});
+                    definition.push_back(static_cast<char>(length));
+                    definition.insert(definition.end(), name.begin(), name.begin() + static_cast<std::ptrdiff_t>(length));
+                };
+
+                definition.push_back(static_cast<char>(id & 0xFF));
+                definition.push_back(static_cast<char>(id >> 8));
+                appendName(schema.name);
+                definition.push_back(static_cast<char>(schema.fields.size()));
+                for (const Field& field : schema.fields)
+                {
+                    definition.push_back(static_cast<char>(field.type));
+                    appendName(field.name);
+                }
+
+                write(definition.data(), definition.size());
+                writtenSchemas[id] = true;
+            }
+
+            write(data, size);
+        }
+
+        // records can span windows, the next window is mapped when the current one is full
+        void File::write(const void* data, std::size_t size)
+        {
+            auto bytes = static_cast<const char*>(data);
+
+            while (size)
+            {
+                if (position == windowSize)
+                {
+                    unmap();
+                    windowOffset += windowSize;
+                    position = 0;
+                    map();
+                }
+
+                const std::size_t chunkSize = std::min(size, windowSize - position);
+                std::memcpy(window + position, bytes, chunkSize);
+                position += chunkSize;
+                bytes += chunkSize;
+                size -= chunkSize;
+            }
+        }
+
+        void File::map()
+        {
+            const std::uint64_t fileSize = windowOffset + windowSize;
+
+#if defined(_WIN32)
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+                                         static_cast<DWORD>(fileSize >> 32),
+                                         static_cast<DWORD>(fileSize & 0xFFFFFFFF),
+                                         nullptr);
+            if (!mapping)
+                throw std::system_error(GetLastError(), std::system_category(), "Failed to map trace file");
+
+            window = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE,
+                                                      static_cast<DWORD>(windowOffset >> 32),
+                                                      static_cast<DWORD>(windowOffset & 0xFFFFFFFF),
+                                                      windowSize));
+            if (!window)
+            {
+                const auto error = GetLastError();
+                CloseHandle(mapping);
+                mapping = nullptr;
+                throw std::system_error(error, std::system_category(), "Failed to map trace file");
+            }
+#else
+            if (ftruncate(fd, static_cast<off_t>(fileSize)) == -1)
+                throw std::system_error(errno, std::system_category(), "Failed to resize trace file");
+
+            void* address = mmap(nullptr, windowSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                 fd, static_cast<off_t>(windowOffset));
+            if (address == MAP_FAILED)
+                throw std::system_error(errno, std::system_category(), "Failed to map trace file");
+
+            window = static_cast<char*>(address);
+#endif
+        }
+
+        void File::unmap()
+        {
+            if (!window) return;
+
+#if defined(_WIN32)
+            UnmapViewOfFile(window);
+            CloseHandle(mapping);
+            mapping = nullptr;
+#else
+            munmap(window, windowSize);
+#endif
+            window = nullptr;
+        }
+    } // namespace trace
+} // namespace ouzel
@@ -0,0 +1,211 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_UTILS_TRACE_HPP
+#define OUZEL_UTILS_TRACE_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "../storage/Path.hpp"
+
+namespace ouzel
+{
+    namespace trace
+    {
+        // A trace file starts with the header (magic, version and the start time in nanoseconds)
+        // and is followed by records of [event id:2][timestamp:8][fields]. Each event is preceded by
+        // its definition, a record with the schema id: [event id:2][name][field count:1]{[type:1][name]},
+        // where names are stored as [length:1][characters]. An event id of 0 marks the end of the data.
+        constexpr std::uint32_t magic = 0x4352544F; // "OTRC"
+        constexpr std::uint16_t version = 1;
+        constexpr std::size_t headerSize = 4 + 2 + 8;
+        constexpr std::uint16_t schemaId = 0xFFFF;
+        constexpr std::size_t recordHeaderSize = 2 + 8;
+
+        enum class FieldType: std::uint8_t
+        {
+            Int8 = 1,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Int64,
+            UInt64,
+            Float,
+            Double
+        };
+
+        inline std::size_t getFieldSize(FieldType type)
+        {
+            switch (type)
+            {
+                case FieldType::Int8: case FieldType::UInt8: return 1;
+                case FieldType::Int16: case FieldType::UInt16: return 2;
+                case FieldType::Int32: case FieldType::UInt32: case FieldType::Float: return 4;
+                case FieldType::Int64: case FieldType::UInt64: case FieldType::Double: return 8;
+                default: throw std::runtime_error("Invalid field type");
+            }
+        }
+
+        inline namespace detail
+        {
+            template <class T> struct FieldTypeOf;
+            template <> struct FieldTypeOf<std::int8_t>: std::integral_constant<FieldType, FieldType::Int8> {};
+            template <> struct FieldTypeOf<std::uint8_t>: std::integral_constant<FieldType, FieldType::UInt8> {};
+            template <> struct FieldTypeOf<std::int16_t>: std::integral_constant<FieldType, FieldType::Int16> {};
+            template <> struct FieldTypeOf<std::uint16_t>: std::integral_constant<FieldType, FieldType::UInt16> {};
+            template <> struct FieldTypeOf<std::int32_t>: std::integral_constant<FieldType, FieldType::Int32> {};
+            template <> struct FieldTypeOf<std::uint32_t>: std::integral_constant<FieldType, FieldType::UInt32> {};
+            template <> struct FieldTypeOf<std::int64_t>: std::integral_constant<FieldType, FieldType::Int64> {};
+            template <> struct FieldTypeOf<std::uint64_t>: std::integral_constant<FieldType, FieldType::UInt64> {};
+            template <> struct FieldTypeOf<float>: std::integral_constant<FieldType, FieldType::Float> {};
+            template <> struct FieldTypeOf<double>: std::integral_constant<FieldType, FieldType::Double> {};
+
+            template <class... Args> struct FieldsSize: std::integral_constant<std::size_t, 0> {};
+            template <class T, class... Args> struct FieldsSize<T, Args...>:
+                std::integral_constant<std::size_t, sizeof(T) + FieldsSize<Args...>::value> {};
+        }
+
+        struct Field final
+        {
+            std::string name;
+            FieldType type;
+        };
+
+        struct Schema final
+        {
+            std::string name;
+            std::vector<Field> fields;
+        };
+
+        // all the events of the process, indexed by the event id - 1
+        class Registry final
+        {
+        public:
+            static std::uint16_t add(Schema schema)
+            {
+                std::lock_guard<std::mutex> lock(getMutex());
+                auto& schemas = getSchemas();
+
+                if (schemas.size() >= schemaId - 1)
+                    throw std::runtime_error("Too many trace events");
+
+                schemas.push_back(std::move(schema));
+                return static_cast<std::uint16_t>(schemas.size());
+            }
+
+            static Schema get(std::uint16_t id)
+            {
+                std::lock_guard<std::mutex> lock(getMutex());
+                const auto& schemas = getSchemas();
+
+                if (id == 0 || id > schemas.size())
+                    throw std::runtime_error("Invalid trace event");
+
+                return schemas[id - 1];
+            }
+
+        private:
+            static std::mutex& getMutex()
+            {
+                static std::mutex mutex;
+                return mutex;
+            }
+
+            static std::vector<Schema>& getSchemas()
+            {
+                static std::vector<Schema> schemas;
+                return schemas;
+            }
+        };
+
+        // Event with a fixed list of fields whose types and record size are known at compile time,
+        // e.g. static const trace::Event<std::uint32_t, float> frameEvent{"frame", {"index", "time"}};
+        template <class... Args>
+        class Event final
+        {
+        public:
+            static constexpr std::size_t size = FieldsSize<Args...>::value;
+
+            Event(const std::string& name, const std::array<std::string, sizeof...(Args)>& fieldNames):
+                id(Registry::add(createSchema(name, fieldNames)))
+            {
+            }
+
+            inline auto getId() const noexcept { return id; }
+
+            // writes the fields without the record header
+            void encode(char* data, const Args... args) const noexcept
+            {
+                const int unused[] = {0, (data = write(data, args), 0)...};
+                static_cast<void>(unused);
+                static_cast<void>(data);
+            }
+
+        private:
+            static Schema createSchema(const std::string& name,
+                                       const std::array<std::string, sizeof...(Args)>& fieldNames)
+            {
+                const std::array<FieldType, sizeof...(Args)> fieldTypes{{FieldTypeOf<Args>::value...}};
+
+                Schema schema;
+                schema.name = name;
+                for (std::size_t i = 0; i < sizeof...(Args); ++i)
+                    schema.fields.push_back(Field{fieldNames[i], fieldTypes[i]});
+
+                return schema;
+            }
+
+            template <class T>
+            static char* write(char* data, const T value) noexcept
+            {
+                std::memcpy(data, &value, sizeof(value));
+                return data + sizeof(value);
+            }
+
+            std::uint16_t id;
+        };
+
+        // Memory-mapped output file that grows in fixed-size windows
+        class File final
+        {
+        public:
+            explicit File(const storage::Path& path);
+            ~File();
+
+            File(const File&) = delete;
+            File& operator=(const File&) = delete;
+            File(File&&) = delete;
+            File& operator=(File&&) = delete;
+
+            // writes a complete record and the definition of its event if it was not written yet
+            void writeRecord(const char* data, std::size_t size);
+
+        private:
+            void write(const void* data, std::size_t size);
+            void map();
+            void unmap();
+
+            static constexpr std::size_t windowSize = 1024 * 1024;
+
+#if defined(_WIN32)
+            void* file = nullptr;
+            void* mapping = nullptr;
+#else
+            int fd = -1;
+#endif
+            char* window = nullptr;
+            std::uint64_t windowOffset = 0;
+            std::size_t position = 0;
+            std::vector<bool> writtenSchemas;
+        };
+    } // namespace trace
+} // namespace ouzel
+
+#endif // OUZEL_UTILS_TRACE_HPP
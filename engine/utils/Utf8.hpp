@@ -4,7 +4,18 @@
 #define OUZEL_UTILS_UTF8_HPP
 
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && (defined(__arm64__) || defined(__aarch64__))
+#  include <arm_neon.h>
+#  define OUZEL_UTF8_NEON64
+#endif
 
 namespace ouzel
 {
@@ -17,7 +28,193 @@ namespace ouzel
             explicit ParseError(const char* str): std::logic_error(str) {}
         };
 
-        template <class Iterator>
+        inline namespace detail
+        {
+            // returns the number of leading bytes that are below 0x80
+            inline std::size_t getAsciiLength(const unsigned char* data, std::size_t length) noexcept
+            {
+                std::size_t i = 0;
+
+#if defined(__SSE2__)
+                for (; i + 16 <= length; i += 16)
+                    if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))))
+                        break;
+#elif defined(OUZEL_UTF8_NEON64)
+                for (; i + 16 <= length; i += 16)
+                    if (vmaxvq_u8(vld1q_u8(data + i)) & 0x80)
+                        break;
+#endif
+
+                for (; i + 8 <= length; i += 8)
+                {
+                    std::uint64_t word;
+                    std::memcpy(&word, data + i, sizeof(word));
+                    if (word & 0x8080808080808080ULL) break;
+                }
+
+                while (i < length && data[i] < 0x80) ++i;
+
+                return i;
+            }
+
+            // zero-extends ASCII bytes to code points
+            inline void widenAscii(const unsigned char* data, std::size_t length, char32_t* result) noexcept
+            {
+                std::size_t i = 0;
+
+#if defined(__SSE2__)
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 16 <= length; i += 16)
+                {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                    const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+                    const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_unpacklo_epi16(low, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i + 4), _mm_unpackhi_epi16(low, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i + 8), _mm_unpacklo_epi16(high, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i + 12), _mm_unpackhi_epi16(high, zero));
+                }
+#elif defined(OUZEL_UTF8_NEON64)
+                for (; i + 16 <= length; i += 16)
+                {
+                    const uint8x16_t bytes = vld1q_u8(data + i);
+                    const uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+                    const uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+                    auto output = reinterpret_cast<std::uint32_t*>(result + i);
+                    vst1q_u32(output, vmovl_u16(vget_low_u16(low)));
+                    vst1q_u32(output + 4, vmovl_u16(vget_high_u16(low)));
+                    vst1q_u32(output + 8, vmovl_u16(vget_low_u16(high)));
+                    vst1q_u32(output + 12, vmovl_u16(vget_high_u16(high)));
+                }
+#endif
+
+                for (; i < length; ++i)
+                    result[i] = data[i];
+            }
+
+            // narrows code points to bytes while they are below 0x80, returns the number of converted code points
+            inline std::size_t narrowAscii(const char32_t* data, std::size_t length, char* result) noexcept
+            {
+                std::size_t i = 0;
+
+#if defined(__SSE2__)
+                const __m128i nonAscii = _mm_set1_epi32(~0x7F);
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 16 <= length; i += 16)
+                {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 4));
+                    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 8));
+                    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12));
+                    const __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(all, nonAscii), zero)) != 0xFFFF)
+                        break;
+
+                    const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), bytes);
+                }
+#elif defined(OUZEL_UTF8_NEON64)
+                for (; i + 8 <= length; i += 8)
+                {
+                    const auto input = reinterpret_cast<const std::uint32_t*>(data + i);
+                    const uint32x4_t a = vld1q_u32(input);
+                    const uint32x4_t b = vld1q_u32(input + 4);
+                    if (vmaxvq_u32(vorrq_u32(a, b)) > 0x7F)
+                        break;
+
+                    const uint16x8_t words = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+                    vst1_u8(reinterpret_cast<std::uint8_t*>(result + i), vmovn_u16(words));
+                }
+#endif
+
+                for (; i < length && data[i] <= 0x7F; ++i)
+                    result[i] = static_cast<char>(data[i]);
+
+                return i;
+            }
+
+            template <class Iterator, class T = typename std::iterator_traits<Iterator>::value_type>
+            struct IsContiguous: std::integral_constant<bool,
+                std::is_pointer<Iterator>::value ||
+                std::is_same<Iterator, typename std::vector<T>::iterator>::value ||
+                std::is_same<Iterator, typename std::vector<T>::const_iterator>::value> {};
+            template <class T> struct IsContiguous<std::string::iterator, T>: std::true_type {};
+            template <class T> struct IsContiguous<std::string::const_iterator, T>: std::true_type {};
+            template <class T> struct IsContiguous<std::u32string::iterator, T>: std::true_type {};
+            template <class T> struct IsContiguous<std::u32string::const_iterator, T>: std::true_type {};
+
+            template <class Iterator, class T = typename std::remove_cv<typename std::iterator_traits<Iterator>::value_type>::type>
+            struct IsContiguousBytes: std::integral_constant<bool,
+                IsContiguous<Iterator>::value && std::is_integral<T>::value && sizeof(T) == 1> {};
+
+            // signed values would be read as different code points through the char32_t fast path
+            template <class Iterator, class T = typename std::remove_cv<typename std::iterator_traits<Iterator>::value_type>::type>
+            struct IsContiguousCodePoints: std::integral_constant<bool,
+                IsContiguous<Iterator>::value && std::is_integral<T>::value && std::is_unsigned<T>::value && sizeof(T) == 4> {};
+        }
+
+        // Converts the UTF-8 bytes to code points, output must have space for (end - begin) code points
+        // returns the end of the output
+        inline char32_t* toUtf32(const char* begin, const char* end, char32_t* output)
+        {
+            auto i = reinterpret_cast<const unsigned char*>(begin);
+            const auto last = reinterpret_cast<const unsigned char*>(end);
+
+            while (i != last)
+            {
+                const std::size_t asciiLength = getAsciiLength(i, static_cast<std::size_t>(last - i));
+                widenAscii(i, asciiLength, output);
+                i += asciiLength;
+                output += asciiLength;
+
+                while (i != last && *i > 0x7F)
+                {
+                    char32_t cp = *i;
+
+                    if ((cp >> 5) == 0x6) // length = 2
+                    {
+                        if (last - i < 2)
+                            throw ParseError("Invalid UTF-8 string");
+                        cp = ((cp << 6) & 0x7FF) + (i[1] & 0x3F);
+                        i += 2;
+                    }
+                    else if ((cp >> 4) == 0xE) // length = 3
+                    {
+                        if (last - i < 3)
+                            throw ParseError("Invalid UTF-8 string");
+                        cp = ((cp << 12) & 0xFFFF) + ((i[1] & 0x3FU) << 6) + (i[2] & 0x3F);
+                        i += 3;
+                    }
+                    else if ((cp >> 3) == 0x1E) // length = 4
+                    {
+                        if (last - i < 4)
+                            throw ParseError("Invalid UTF-8 string");
+                        cp = ((cp << 18) & 0x1FFFFF) + ((i[1] & 0x3FU) << 12) + ((i[2] & 0x3FU) << 6) + (i[3] & 0x3F);
+                        i += 4;
+                    }
+                    else // invalid lead bytes are passed through
+                        ++i;
+
+                    *output++ = cp;
+                }
+            }
+
+            return output;
+        }
+
+        template <class Iterator, typename std::enable_if<IsContiguousBytes<Iterator>::value>::type* = nullptr>
+        inline std::u32string toUtf32(Iterator begin, Iterator end)
+        {
+            std::u32string result(static_cast<std::size_t>(std::distance(begin, end)), U'\0');
+            if (begin == end) return result;
+
+            const auto data = reinterpret_cast<const char*>(&*begin);
+            const char32_t* resultEnd = toUtf32(data, data + result.size(), &result[0]);
+            result.resize(static_cast<std::size_t>(resultEnd - result.data()));
+            return result;
+        }
+
+        template <class Iterator, typename std::enable_if<!IsContiguousBytes<Iterator>::value>::type* = nullptr>
         inline std::u32string toUtf32(Iterator begin, Iterator end)
         {
             std::u32string result;
@@ -98,7 +295,116 @@ namespace ouzel
             return result;
         }
 
-        template <class Iterator>
+        // returns the number of bytes needed to encode the code points
+        inline std::size_t getUtf8Length(const char32_t* begin, const char32_t* end) noexcept
+        {
+            auto i = begin;
+            std::size_t result = static_cast<std::size_t>(end - begin);
+
+#if defined(__SSE2__)
+            // SSE2 has only signed comparison, so the values are biased by 0x80000000
+            const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000U));
+            const __m128i limit1 = _mm_set1_epi32(static_cast<int>(0x8000007FU));
+            const __m128i limit2 = _mm_set1_epi32(static_cast<int>(0x800007FFU));
+            const __m128i limit3 = _mm_set1_epi32(static_cast<int>(0x8000FFFFU));
+
+            while (end - i >= 4)
+            {
+                // each lane counts at most 3 bytes per code point, so 32 bits do not overflow before a flush
+                __m128i sum = _mm_setzero_si128();
+                for (std::size_t block = 0; block < 65536 && end - i >= 4; ++block, i += 4)
+                {
+                    const __m128i value = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(i)), bias);
+                    sum = _mm_sub_epi32(sum, _mm_cmpgt_epi32(value, limit1));
+                    sum = _mm_sub_epi32(sum, _mm_cmpgt_epi32(value, limit2));
+                    sum = _mm_sub_epi32(sum, _mm_cmpgt_epi32(value, limit3));
+                }
+
+                std::uint32_t lanes[4];
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum);
+                result += static_cast<std::size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+            }
+#elif defined(OUZEL_UTF8_NEON64)
+            while (end - i >= 4)
+            {
+                uint32x4_t sum = vdupq_n_u32(0);
+                for (std::size_t block = 0; block < 65536 && end - i >= 4; ++block, i += 4)
+                {
+                    const uint32x4_t value = vld1q_u32(reinterpret_cast<const std::uint32_t*>(i));
+                    sum = vsubq_u32(sum, vcgtq_u32(value, vdupq_n_u32(0x7F)));
+                    sum = vsubq_u32(sum, vcgtq_u32(value, vdupq_n_u32(0x7FF)));
+                    sum = vsubq_u32(sum, vcgtq_u32(value, vdupq_n_u32(0xFFFF)));
+                }
+
+                result += vaddvq_u32(sum);
+            }
+#endif
+
+            for (; i != end; ++i)
+                result += static_cast<std::size_t>(*i > 0x7F) + (*i > 0x7FF) + (*i > 0xFFFF);
+
+            return result;
+        }
+
+        // Converts the code points to UTF-8, output must have space for getUtf8Length(begin, end) bytes
+        // returns the end of the output
+        inline char* fromUtf32(const char32_t* begin, const char32_t* end, char* output) noexcept
+        {
+            auto i = begin;
+
+            while (i != end)
+            {
+                const std::size_t asciiLength = narrowAscii(i, static_cast<std::size_t>(end - i), output);
+                i += asciiLength;
+                output += asciiLength;
+
+                for (; i != end && *i > 0x7F; ++i)
+                {
+                    const char32_t c = *i;
+
+                    if (c <= 0x7FF)
+                    {
+                        *output++ = static_cast<char>(0xC0 | ((c >> 6) & 0x1F));
+                        *output++ = static_cast<char>(0x80 | (c & 0x3F));
+                    }
+                    else if (c <= 0xFFFF)
+                    {
+                        *output++ = static_cast<char>(0xE0 | ((c >> 12) & 0x0F));
+                        *output++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                        *output++ = static_cast<char>(0x80 | (c & 0x3F));
+                    }
+                    else
+                    {
+                        *output++ = static_cast<char>(0xF0 | ((c >> 18) & 0x07));
+                        *output++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+                        *output++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                        *output++ = static_cast<char>(0x80 | (c & 0x3F));
+                    }
+                }
+            }
+
+            return output;
+        }
+
+        template <class Iterator, typename std::enable_if<IsContiguousCodePoints<Iterator>::value>::type* = nullptr>
+        inline std::string fromUtf32(Iterator begin, Iterator end)
+        {
+            if (begin == end) return std::string();
+
+            const auto data = reinterpret_cast<const char32_t*>(&*begin);
+            const auto dataEnd = data + std::distance(begin, end);
+
+            // every code point takes at least one byte, so ASCII text is converted in one pass
+            std::string result(static_cast<std::size_t>(dataEnd - data), '\0');
+            const std::size_t asciiLength = narrowAscii(data, result.size(), &result[0]);
+            if (asciiLength == result.size()) return result;
+
+            result.resize(asciiLength + getUtf8Length(data + asciiLength, dataEnd));
+            fromUtf32(data + asciiLength, dataEnd, &result[asciiLength]);
+            return result;
+        }
+
+        template <class Iterator, typename std::enable_if<!IsContiguousCodePoints<Iterator>::value>::type* = nullptr>
         inline std::string fromUtf32(Iterator begin, Iterator end)
         {
             std::string result;
@@ -135,7 +441,60 @@ namespace ouzel
         {
             return fromUtf32(std::begin(text), std::end(text));
         }
+
+        // Checks that the bytes are well-formed UTF-8 (no overlong encodings, surrogates or code points above 0x10FFFF)
+        inline bool validate(const char* begin, const char* end) noexcept
+        {
+            auto i = reinterpret_cast<const unsigned char*>(begin);
+            const auto last = reinterpret_cast<const unsigned char*>(end);
+
+            while (i != last)
+            {
+                i += getAsciiLength(i, static_cast<std::size_t>(last - i));
+
+                while (i != last && *i > 0x7F)
+                {
+                    const unsigned char lead = *i;
+                    std::size_t length;
+                    unsigned char minimum = 0x80; // range of the second byte
+                    unsigned char maximum = 0xBF;
+
+                    if (lead >= 0xC2 && lead <= 0xDF) length = 2;
+                    else if (lead >= 0xE0 && lead <= 0xEF)
+                    {
+                        length = 3;
+                        if (lead == 0xE0) minimum = 0xA0;
+                        else if (lead == 0xED) maximum = 0x9F;
+                    }
+                    else if (lead >= 0xF0 && lead <= 0xF4)
+                    {
+                        length = 4;
+                        if (lead == 0xF0) minimum = 0x90;
+                        else if (lead == 0xF4) maximum = 0x8F;
+                    }
+                    else return false;
+
+                    if (static_cast<std::size_t>(last - i) < length) return false;
+                    if (i[1] < minimum || i[1] > maximum) return false;
+                    for (std::size_t b = 2; b < length; ++b)
+                        if ((i[b] & 0xC0) != 0x80) return false;
+
+                    i += length;
+                }
+            }
+
+            return true;
+        }
+
+        template <class T>
+        inline bool validate(const T& text) noexcept
+        {
+            const auto data = reinterpret_cast<const char*>(text.data());
+            return validate(data, data + text.size());
+        }
     } // namespace utf8
 } // namespace ouzel
 
+#undef OUZEL_UTF8_NEON64
+
 #endif // OUZEL_UTILS_UTF8_HPP
@@ -3,6 +3,10 @@
 #ifndef OUZEL_UTILS_XML_HPP
 #define OUZEL_UTILS_XML_HPP
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <map>
 #include <stdexcept>
 #include <string>
@@ -24,202 +28,90 @@ namespace ouzel
         {
             constexpr std::uint8_t UTF8_BOM[] = {0xEF, 0xBB, 0xBF};
 
-            constexpr auto isWhitespace(const char32_t c) noexcept
+            constexpr auto isWhitespace(const char c) noexcept
             {
                 return c == ' ' || c == '\t' || c == '\r' || c == '\n';
             }
 
-            constexpr auto isNameStartChar(const char32_t c) noexcept
+            // bytes of multi-byte UTF-8 sequences are accepted in names without decoding them
+            constexpr auto isNameStartChar(const char c) noexcept
             {
                 return (c >= 'a' && c <= 'z') ||
                     (c >= 'A' && c <= 'Z') ||
                     c == ':' || c == '_' ||
-                    (c >= 0xC0 && c <= 0xD6) ||
-                    (c >= 0xD8 && c <= 0xF6) ||
-                    (c >= 0xF8 && c <= 0x2FF) ||
-                    (c >= 0x370 && c <= 0x37D) ||
-                    (c >= 0x37F && c <= 0x1FFF) ||
-                    (c >= 0x200C && c <= 0x200D) ||
-                    (c >= 0x2070 && c <= 0x218F);
+                    static_cast<std::uint8_t>(c) >= 0x80;
             }
 
-            constexpr auto isNameChar(const char32_t c) noexcept
+            constexpr auto isNameChar(const char c) noexcept
             {
                 return isNameStartChar(c) ||
                     c == '-' || c == '.' ||
-                    (c >= '0' && c <= '9') ||
-                    c == 0xB7 ||
-                    (c >= 0x0300 && c <= 0x036F) ||
-                    (c >= 0x203F && c <= 0x2040);
+                    (c >= '0' && c <= '9');
             }
 
-            inline void skipWhitespaces(std::u32string::const_iterator& iterator,
-                                        std::u32string::const_iterator end)
+            // decodes the entities of a text or an attribute value, the result is never longer than the source
+            inline char* decodeEntities(const char* iterator, const char* end, char* result)
             {
                 while (iterator != end)
-                    if (isWhitespace(*iterator))
-                        ++iterator;
-                    else
-                        break;
-            }
-
-            inline std::string parseName(std::u32string::const_iterator& iterator,
-                                         std::u32string::const_iterator end)
-            {
-                std::string result;
-
-                if (iterator == end)
-                    throw ParseError("Unexpected end of data");
-
-                if (!isNameStartChar(*iterator))
-                    throw ParseError("Invalid name start");
-
-                for (;;)
                 {
-                    if (iterator == end)
-                        throw ParseError("Unexpected end of data");
-
-                    if (!isNameChar(*iterator))
-                        break;
-                    else
+                    if (*iterator != '&')
                     {
-                        result += utf8::fromUtf32(*iterator);
-                        ++iterator;
+                        *result++ = *iterator++;
+                        continue;
                     }
-                }
-
-                return result;
-            }
-
-            inline std::string parseEntity(std::u32string::const_iterator& iterator,
-                                           std::u32string::const_iterator end)
-            {
-                std::string result;
-
-                if (iterator == end)
-                    throw ParseError("Unexpected end of data");
 
-                if (*iterator != '&')
-                    throw ParseError("Expected an ampersand");
+                    const char* begin = ++iterator;
+                    while (iterator != end && *iterator != ';') ++iterator;
 
-                std::string value;
-
-                for (;;)
-                {
-                    if (++iterator == end)
+                    if (iterator == end)
                         throw ParseError("Unexpected end of data");
 
-                    if (*iterator == ';')
-                    {
-                        ++iterator;
-                        break;
-                    }
-                    else
-                        value.push_back(static_cast<char>(*iterator));
-                }
+                    const std::string value(begin, iterator++);
 
-                if (value.empty())
-                    throw ParseError("Invalid entity");
-
-                if (value == "quot")
-                    result = "\"";
-                else if (value == "amp")
-                    result = "&";
-                else if (value == "apos")
-                    result = "'";
-                else if (value == "lt")
-                    result = "<";
-                else if (value == "gt")
-                    result = ">";
-                else if (value[0] == '#')
-                {
-                    if (value.length() < 2)
+                    if (value.empty())
                         throw ParseError("Invalid entity");
 
-                    char32_t c = 0;
-
-                    if (value[1] == 'x') // hex value
+                    if (value == "quot")
+                        *result++ = '"';
+                    else if (value == "amp")
+                        *result++ = '&';
+                    else if (value == "apos")
+                        *result++ = '\'';
+                    else if (value == "lt")
+                        *result++ = '<';
+                    else if (value == "gt")
+                        *result++ = '>';
+                    else if (value[0] == '#')
                     {
-                        if (value.length() != 2 + 4)
-                            throw ParseError("Invalid entity");
-
-                        for (std::size_t i = 0; i < 4; ++i)
-                        {
-                            std::uint8_t code = 0;
-
-                            if (value[i + 2] >= '0' && value[i + 2] <= '9')
-                                code = static_cast<std::uint8_t>(value[i + 2]) - '0';
-                            else if (value[i + 2] >= 'a' && value[i + 2] <='f')
-                                code = static_cast<std::uint8_t>(value[i + 2]) - 'a' + 10;
-                            else if (value[i + 2] >= 'A' && value[i + 2] <='F')
-                                code = static_cast<std::uint8_t>(value[i + 2]) - 'A' + 10;
-                            else
-                                throw ParseError("Invalid character code");
+                        const bool hex = (value.length() > 1 && value[1] == 'x');
+                        const std::size_t first = hex ? 2 : 1;
 
-                            c = (c << 4) | code;
-                        }
-                    }
-                    else
-                    {
-                        if (value.length() != 1 + 4)
+                        if (value.length() <= first || value.length() > first + 8)
                             throw ParseError("Invalid entity");
 
-                        for (std::size_t i = 0; i < 4; ++i)
+                        char32_t c = 0;
+
+                        for (std::size_t i = first; i < value.length(); ++i)
                         {
                             std::uint8_t code = 0;
 
-                            if (value[i + 1] >= '0' && value[i + 1] <= '9')
-                                code = static_cast<std::uint8_t>(value[i + 1]) - '0';
+                            if (value[i] >= '0' && value[i] <= '9')
+                                code = static_cast<std::uint8_t>(value[i]) - '0';
+                            else if (hex && value[i] >= 'a' && value[i] <='f')
+                                code = static_cast<std::uint8_t>(value[i]) - 'a' + 10;
+                            else if (hex && value[i] >= 'A' && value[i] <='F')
+                                code = static_cast<std::uint8_t>(value[i]) - 'A' + 10;
                             else
                                 throw ParseError("Invalid character code");
 
-                            c = c * 10 + code;
+                            c = hex ? ((c << 4) | code) : (c * 10 + code);
                         }
-                    }
 
-                    result = utf8::fromUtf32(c);
-                }
-                else
-                    throw ParseError("Invalid entity");
-
-                return result;
-            }
-
-            inline std::string parseString(std::u32string::const_iterator& iterator,
-                                           std::u32string::const_iterator end)
-            {
-                std::string result;
-
-                if (iterator == end)
-                    throw ParseError("Unexpected end of data");
-
-                if (*iterator != '"' && *iterator != '\'')
-                    throw ParseError("Expected quotes");
-
-                auto quotes = *iterator;
-
-                ++iterator;
-
-                for (;;)
-                {
-                    if (iterator == end)
-                        throw ParseError("Unexpected end of data");
-
-                    if (*iterator == quotes)
-                    {
-                        ++iterator;
-                        break;
-                    }
-                    else if (*iterator == '&')
-                    {
-                        std::string entity = parseEntity(iterator, end);
-                        result += entity;
+                        const std::string encoded = utf8::fromUtf32(c);
+                        for (const char b : encoded) *result++ = b;
                     }
                     else
-                    {
-                        result += utf8::fromUtf32(*iterator);
-                        ++iterator;
-                    }
+                        throw ParseError("Invalid entity");
                 }
 
                 return result;
@@ -256,299 +148,522 @@ namespace ouzel
             }
         }
 
-        class Data;
+        // Points into the source data or into a buffer that owns the decoded string
+        struct StringView final
+        {
+            const char* data = nullptr;
+            std::size_t length = 0;
 
-        class Node final
+            inline std::string toString() const { return std::string(data, length); }
+
+            inline bool operator==(const StringView& other) const noexcept
+            {
+                return length == other.length && std::equal(data, data + length, other.data);
+            }
+
+            inline bool operator==(const std::string& other) const noexcept
+            {
+                return length == other.length() && std::equal(data, data + length, other.begin());
+            }
+
+            template <class T>
+            inline bool operator!=(const T& other) const noexcept
+            {
+                return !(*this == other);
+            }
+        };
+
+        // Pull parser that reads the UTF-8 data in a single pass without building a tree,
+        // names and values point into the source data unless they contain entities
+        class Reader final
         {
-            friend Data;
         public:
-            enum class Type
+            enum class Event
             {
-                Comment,
+                StartElement,
+                EndElement,
+                Text,
                 CData,
+                Comment,
                 TypeDeclaration,
                 ProcessingInstruction,
-                Tag,
-                Text
+                End
             };
 
-            Node() = default;
-            Node(Type initType): type(initType) {}
-            Node(const std::string& val): type(Type::Text), value(val) {}
+            struct Attribute final
+            {
+                StringView name;
+                StringView value;
+            };
 
-            inline Node& operator=(Type newType) noexcept
+            Reader(const char* begin, const char* initEnd,
+                   bool initPreserveWhitespaces = false):
+                iterator(begin), end(initEnd),
+                preserveWhitespaces(initPreserveWhitespaces)
             {
-                type = newType;
-                return *this;
+                if (end - iterator >= 3 &&
+                    std::equal(iterator, iterator + 3, std::begin(UTF8_BOM),
+                               [](const char a, const std::uint8_t b) noexcept {
+                                   return static_cast<std::uint8_t>(a) == b;
+                               }))
+                {
+                    bom = true;
+                    iterator += 3;
+                }
             }
 
-            inline Node& operator=(const std::string& val)
+            template <class T>
+            explicit Reader(const T& data, bool initPreserveWhitespaces = false):
+                Reader(reinterpret_cast<const char*>(data.data()),
+                       reinterpret_cast<const char*>(data.data() + data.size()),
+                       initPreserveWhitespaces)
             {
-                type = Type::Text;
-                value = val;
-                return *this;
             }
 
-            inline auto getType() const noexcept { return type; }
+            Event next()
+            {
+                attributes.clear();
+
+                if (selfClosing)
+                {
+                    selfClosing = false;
+                    names.pop_back();
+                    return event = Event::EndElement;
+                }
+
+                if (!preserveWhitespaces) skipWhitespaces();
+
+                if (iterator == end)
+                {
+                    if (!names.empty())
+                        throw ParseError("Unexpected end of data");
+
+                    return event = Event::End;
+                }
+
+                if (*iterator != '<')
+                {
+                    readText();
+                    return event = Event::Text;
+                }
 
+                if (++iterator == end)
+                    throw ParseError("Unexpected end of data");
+
+                switch (*iterator)
+                {
+                    case '/': return event = readEndTag();
+                    case '!': return event = readDeclaration();
+                    case '?': return event = readProcessingInstruction();
+                    default: return event = readStartTag();
+                }
+            }
+
+            // skips the rest of the element that was just started
+            void skip()
+            {
+                if (event != Event::StartElement) return;
+
+                const std::size_t depth = names.size();
+                while (names.size() >= depth) next();
+            }
+
+            inline auto getEvent() const noexcept { return event; }
+            inline auto getDepth() const noexcept { return names.size(); }
+            inline bool hasBOM() const noexcept { return bom; }
+
+            // element or processing instruction name
+            inline auto& getName() const noexcept { return name; }
+
+            // contents of a text, CDATA, comment or type declaration, valid until the next call to next()
             inline auto& getValue() const noexcept { return value; }
-            inline void setValue(const std::string& newValue) { value = newValue; }
 
-            inline auto& getChildren() const noexcept { return children; }
+            // valid until the next call to next()
+            inline auto& getAttributes() const noexcept { return attributes; }
 
-            std::vector<Node>::iterator begin() { return children.begin(); }
-            std::vector<Node>::iterator end() { return children.end(); }
+            // the value contained entities, so it was decoded into a buffer of the reader
+            inline bool isDecoded(const StringView& view) const noexcept
+            {
+                return view.data >= buffer.data() && view.data < buffer.data() + buffer.size();
+            }
 
-            std::vector<Node>::const_iterator begin() const { return children.begin(); }
-            std::vector<Node>::const_iterator end() const { return children.end(); }
+        private:
+            void skipWhitespaces() noexcept
+            {
+                while (iterator != end && isWhitespace(*iterator)) ++iterator;
+            }
 
-        protected:
-            void parse(std::u32string::const_iterator& iterator,
-                       std::u32string::const_iterator end,
-                       bool preserveWhitespaces = false,
-                       bool preserveComments = false,
-                       bool preserveProcessingInstructions = false)
+            void expect(const char c, const char* error)
             {
                 if (iterator == end)
                     throw ParseError("Unexpected end of data");
 
-                if (*iterator == '<')
+                if (*iterator != c)
+                    throw ParseError(error);
+
+                ++iterator;
+            }
+
+            StringView readName()
+            {
+                if (iterator == end)
+                    throw ParseError("Unexpected end of data");
+
+                if (!isNameStartChar(*iterator))
+                    throw ParseError("Invalid name start");
+
+                const char* begin = iterator;
+                while (iterator != end && isNameChar(*iterator)) ++iterator;
+
+                return StringView{begin, static_cast<std::size_t>(iterator - begin)};
+            }
+
+            // finds the sequence and moves the iterator past it
+            const char* find(const char* sequence, std::size_t length)
+            {
+                for (;;)
                 {
-                    if (++iterator == end)
+                    if (static_cast<std::size_t>(end - iterator) < length)
+                        throw ParseError("Unexpected end of data");
+
+                    const auto next = static_cast<const char*>(std::memchr(iterator, sequence[0],
+                                                                           static_cast<std::size_t>(end - iterator) - length + 1));
+                    if (!next)
                         throw ParseError("Unexpected end of data");
 
-                    if (*iterator == '!') // <!
+                    iterator = next + 1;
+
+                    if (std::equal(sequence + 1, sequence + length, iterator))
                     {
-                        if (++iterator == end)
-                            throw ParseError("Unexpected end of data");
+                        iterator += length - 1;
+                        return next;
+                    }
+                }
+            }
 
-                        if (*iterator == '-') // <!-
-                        {
-                            if (++iterator == end)
-                                throw ParseError("Unexpected end of data");
+            void readText()
+            {
+                const char* begin = iterator;
+                const auto next = static_cast<const char*>(std::memchr(iterator, '<',
+                                                                       static_cast<std::size_t>(end - iterator)));
+                iterator = next ? next : end;
 
-                            if (*iterator != '-') // <!--
-                                throw ParseError("Expected a comment");
+                buffer.clear();
+                value = decode(begin, iterator, 0);
+            }
 
-                            for (;;)
-                            {
-                                if (std::distance(++iterator, end) < 3)
-                                    throw ParseError("Unexpected end of data");
+            Event readEndTag()
+            {
+                ++iterator; // skip the slash
 
-                                if (*iterator == '-')
-                                {
-                                    if (*(iterator + 1) == '-') // --
-                                    {
-                                        iterator += 2;
-
-                                        if (*iterator == '>') // -->
-                                        {
-                                            ++iterator;
-                                            break;
-                                        }
-                                        else
-                                            throw ParseError("Unexpected double-hyphen inside comment");
-                                    }
-                                }
+                name = readName();
 
-                                value += utf8::fromUtf32(*iterator);
-                            }
+                if (names.empty() || name != names.back())
+                    throw ParseError("Tag not closed properly");
 
-                            type = Type::Comment;
-                        }
-                        else if (*iterator == '[') // <![
-                        {
-                            ++iterator;
-                            std::string name;
-                            name = parseName(iterator, end);
+                skipWhitespaces();
+                expect('>', "Expected a right angle bracket");
 
-                            if (name != "CDATA")
-                                throw ParseError("Expected CDATA");
+                names.pop_back();
+                return Event::EndElement;
+            }
 
-                            if (iterator == end)
-                                throw ParseError("Unexpected end of data");
+            Event readDeclaration()
+            {
+                if (++iterator == end)
+                    throw ParseError("Unexpected end of data");
 
-                            if (*iterator != '[')
-                                throw ParseError("Expected a left bracket");
+                if (*iterator == '-') // <!-
+                {
+                    ++iterator;
+                    expect('-', "Expected a comment");
 
-                            for (;;)
-                            {
-                                if (std::distance(++iterator, end) < 3)
-                                    throw ParseError("Unexpected end of data");
+                    const char* begin = iterator;
+                    const char* commentEnd = find("--", 2);
 
-                                if (*iterator == ']' &&
-                                    *(iterator + 1) == ']' &&
-                                    *(iterator + 2) == '>')
-                                {
-                                    iterator += 3;
-                                    break;
-                                }
+                    expect('>', "Unexpected double-hyphen inside comment");
 
-                                value += utf8::fromUtf32(*iterator);
-                            }
+                    value = StringView{begin, static_cast<std::size_t>(commentEnd - begin)};
+                    return Event::Comment;
+                }
+                else if (*iterator == '[') // <![
+                {
+                    ++iterator;
 
-                            type = Type::CData;
-                        }
-                        else
-                            throw ParseError("Type declarations are not supported");
-                    }
-                    else if (*iterator == '?') // <?
+                    if (readName() != "CDATA")
+                        throw ParseError("Expected CDATA");
+
+                    expect('[', "Expected a left bracket");
+
+                    const char* begin = iterator;
+                    const char* dataEnd = find("]]>", 3);
+
+                    value = StringView{begin, static_cast<std::size_t>(dataEnd - begin)};
+                    return Event::CData;
+                }
+                else
+                {
+                    name = readName();
+
+                    if (name != "DOCTYPE")
+                        throw ParseError("Invalid declaration");
+
+                    // skip the declaration with its internal subset
+                    const char* begin = iterator;
+                    std::size_t brackets = 0;
+                    char quotes = '\0';
+
+                    for (;; ++iterator)
                     {
-                        ++iterator;
-                        value = parseName(iterator, end);
+                        if (iterator == end)
+                            throw ParseError("Unexpected end of data");
 
-                        for (;;)
+                        if (quotes)
                         {
-                            skipWhitespaces(iterator, end);
+                            if (*iterator == quotes) quotes = '\0';
+                        }
+                        else if (*iterator == '"' || *iterator == '\'') quotes = *iterator;
+                        else if (*iterator == '[') ++brackets;
+                        else if (*iterator == ']' && brackets) --brackets;
+                        else if (*iterator == '>' && !brackets) break;
+                    }
 
-                            if (iterator == end)
-                                throw ParseError("Unexpected end of data");
+                    value = StringView{begin, static_cast<std::size_t>(iterator - begin)};
+                    ++iterator;
+                    return Event::TypeDeclaration;
+                }
+            }
 
-                            if (*iterator == '?')
-                            {
-                                if (++iterator == end)
-                                    throw ParseError("Unexpected end of data");
+            Event readProcessingInstruction()
+            {
+                ++iterator; // skip the question mark
+                name = readName();
 
-                                if (*iterator != '>') // ?>
-                                    throw ParseError("Expected a right angle bracket");
+                for (;;)
+                {
+                    skipWhitespaces();
 
-                                ++iterator;
-                                break;
-                            }
+                    if (iterator == end)
+                        throw ParseError("Unexpected end of data");
 
-                            std::string attribute = parseName(iterator, end);
+                    if (*iterator == '?')
+                    {
+                        ++iterator;
+                        expect('>', "Expected a right angle bracket");
+                        break;
+                    }
 
-                            skipWhitespaces(iterator, end);
+                    readAttribute();
+                }
 
-                            if (iterator == end)
-                                throw ParseError("Unexpected end of data");
+                decodeAttributes();
+                return Event::ProcessingInstruction;
+            }
 
-                            if (*iterator != '=')
-                                throw ParseError("Expected an equal sign");
+            Event readStartTag()
+            {
+                name = readName();
 
-                            ++iterator;
+                for (;;)
+                {
+                    skipWhitespaces();
 
-                            skipWhitespaces(iterator, end);
-                            attributes[attribute] = parseString(iterator, end);
-                        }
+                    if (iterator == end)
+                        throw ParseError("Unexpected end of data");
 
-                        type = Type::ProcessingInstruction;
+                    if (*iterator == '>')
+                    {
+                        ++iterator;
+                        break;
                     }
-                    else // <
+                    else if (*iterator == '/')
                     {
-                        value = parseName(iterator, end);
+                        ++iterator;
+                        expect('>', "Expected a right angle bracket");
+                        selfClosing = true;
+                        break;
+                    }
 
-                        bool tagClosed = false;
+                    readAttribute();
+                }
 
-                        for (;;)
-                        {
-                            skipWhitespaces(iterator, end);
+                decodeAttributes();
+                names.push_back(name);
+                return Event::StartElement;
+            }
 
-                            if (iterator == end)
-                                throw ParseError("Unexpected end of data");
+            void readAttribute()
+            {
+                Attribute attribute;
+                attribute.name = readName();
 
-                            if (*iterator == '>')
-                            {
-                                ++iterator;
-                                break;
-                            }
-                            else if (*iterator == '/')
-                            {
-                                if (++iterator == end)
-                                    throw ParseError("Unexpected end of data");
+                skipWhitespaces();
+                expect('=', "Expected an equal sign");
+                skipWhitespaces();
 
-                                if (*iterator != '>') // />
-                                    throw ParseError("Expected a right angle bracket");
+                if (iterator == end)
+                    throw ParseError("Unexpected end of data");
 
-                                tagClosed = true;
-                                ++iterator;
-                                break;
-                            }
+                const char quotes = *iterator;
+                if (quotes != '"' && quotes != '\'')
+                    throw ParseError("Expected quotes");
 
-                            std::string attribute;
-                            attribute = parseName(iterator, end);
+                const char* begin = ++iterator;
+                const auto valueEnd = static_cast<const char*>(std::memchr(iterator, quotes,
+                                                                           static_cast<std::size_t>(end - iterator)));
+                if (!valueEnd)
+                    throw ParseError("Unexpected end of data");
 
-                            skipWhitespaces(iterator, end);
+                iterator = valueEnd + 1;
+                attribute.value = StringView{begin, static_cast<std::size_t>(valueEnd - begin)};
+                attributes.push_back(attribute);
+            }
 
-                            if (iterator == end)
-                                throw ParseError("Unexpected end of data");
+            // decodes the values with entities once the whole tag is read, so that the buffer does not move
+            void decodeAttributes()
+            {
+                std::size_t size = 0;
+                for (const Attribute& attribute : attributes)
+                    if (std::memchr(attribute.value.data, '&', attribute.value.length))
+                        size += attribute.value.length;
+
+                buffer.clear();
+                if (size == 0) return;
+
+                buffer.reserve(size);
+                for (Attribute& attribute : attributes)
+                    attribute.value = decode(attribute.value.data,
+                                             attribute.value.data + attribute.value.length,
+                                             buffer.size());
+            }
 
-                            if (*iterator != '=')
-                                throw ParseError("Expected an equal sign");
+            StringView decode(const char* begin, const char* valueEnd, std::size_t offset)
+            {
+                if (!std::memchr(begin, '&', static_cast<std::size_t>(valueEnd - begin)))
+                    return StringView{begin, static_cast<std::size_t>(valueEnd - begin)};
 
-                            ++iterator;
+                buffer.resize(offset + static_cast<std::size_t>(valueEnd - begin));
+                char* result = &buffer[offset];
+                char* resultEnd = decodeEntities(begin, valueEnd, result);
+                buffer.resize(offset + static_cast<std::size_t>(resultEnd - result));
 
-                            skipWhitespaces(iterator, end);
+                return StringView{buffer.data() + offset, static_cast<std::size_t>(resultEnd - result)};
+            }
 
-                            attributes[attribute] = parseString(iterator, end);
-                        }
+            const char* iterator = nullptr;
+            const char* end = nullptr;
+            bool preserveWhitespaces = false;
+            bool bom = false;
+            bool selfClosing = false;
+            std::vector<StringView> names;
+            Event event = Event::End;
+
+            StringView name;
+            StringView value;
+            std::vector<Attribute> attributes;
+            std::string buffer;
+        };
 
-                        if (!tagClosed)
-                        {
-                            for (;;)
-                            {
-                                if (!preserveWhitespaces) skipWhitespaces(iterator, end);
+        class Data;
 
-                                if (iterator == end)
-                                    throw ParseError("Unexpected end of data");
+        class Node final
+        {
+            friend Data;
+        public:
+            enum class Type
+            {
+                Comment,
+                CData,
+                TypeDeclaration,
+                ProcessingInstruction,
+                Tag,
+                Text
+            };
 
-                                if (*iterator == '<' &&
-                                    iterator + 1 != end &&
-                                    *(iterator + 1) == '/')
-                                {
-                                    ++iterator; // skip the left angle bracket
-                                    ++iterator; // skip the slash
+            Node() = default;
+            Node(Type initType): type(initType) {}
+            Node(const std::string& val): type(Type::Text), value(val) {}
 
-                                    std::string tag = parseName(iterator, end);
+            inline Node& operator=(Type newType) noexcept
+            {
+                type = newType;
+                return *this;
+            }
 
-                                    if (tag != value)
-                                        throw ParseError("Tag not closed properly");
+            inline Node& operator=(const std::string& val)
+            {
+                type = Type::Text;
+                value = val;
+                return *this;
+            }
 
-                                    if (iterator == end)
-                                        throw ParseError("Unexpected end of data");
+            inline auto getType() const noexcept { return type; }
 
-                                    if (*iterator != '>')
-                                        throw ParseError("Expected a right angle bracket");
+            inline auto& getValue() const noexcept { return value; }
+            inline void setValue(const std::string& newValue) { value = newValue; }
 
-                                    ++iterator;
+            inline auto& getAttributes() const noexcept { return attributes; }
+            inline auto& getChildren() const noexcept { return children; }
 
-                                    break;
-                                }
-                                else
-                                {
-                                    Node node;
-                                    node.parse(iterator, end, preserveWhitespaces, preserveComments, preserveProcessingInstructions);
+            std::vector<Node>::iterator begin() { return children.begin(); }
+            std::vector<Node>::iterator end() { return children.end(); }
 
-                                    if ((preserveComments || node.getType() != Type::Comment) &&
-                                        (preserveProcessingInstructions || node.getType() != Type::ProcessingInstruction))
-                                        children.push_back(node);
-                                }
-                            }
-                        }
+            std::vector<Node>::const_iterator begin() const { return children.begin(); }
+            std::vector<Node>::const_iterator end() const { return children.end(); }
 
-                        type = Type::Tag;
-                    }
-                }
-                else
+        protected:
+            // expects the reader to be at the first event of the node
+            void parse(Reader& reader,
+                       bool preserveComments = false,
+                       bool preserveProcessingInstructions = false)
+            {
+                switch (reader.getEvent())
                 {
-                    for (;;)
+                    case Reader::Event::StartElement:
                     {
-                        if (iterator == end || // end of a file
-                            *iterator == '<') // start of a tag
-                            break;
-                        else if (*iterator == '&')
-                        {
-                            std::string entity = parseEntity(iterator, end);
-                            value += entity;
-                        }
-                        else
+                        type = Type::Tag;
+                        value = reader.getName().toString();
+
+                        for (const Reader::Attribute& attribute : reader.getAttributes())
+                            attributes[attribute.name.toString()] = attribute.value.toString();
+
+                        while (reader.next() != Reader::Event::EndElement)
                         {
-                            value += utf8::fromUtf32(*iterator);
-                            ++iterator;
+                            Node node;
+                            node.parse(reader, preserveComments, preserveProcessingInstructions);
+
+                            if ((preserveComments || node.getType() != Type::Comment) &&
+                                (preserveProcessingInstructions || node.getType() != Type::ProcessingInstruction) &&
+                                node.getType() != Type::TypeDeclaration)
+                                children.push_back(std::move(node));
                         }
+                        break;
                     }
+                    case Reader::Event::ProcessingInstruction:
+                        type = Type::ProcessingInstruction;
+                        value = reader.getName().toString();
 
-                    type = Type::Text;
+                        for (const Reader::Attribute& attribute : reader.getAttributes())
+                            attributes[attribute.name.toString()] = attribute.value.toString();
+                        break;
+                    case Reader::Event::Text:
+                        type = Type::Text;
+                        value = reader.getValue().toString();
+                        break;
+                    case Reader::Event::CData:
+                        type = Type::CData;
+                        value = reader.getValue().toString();
+                        break;
+                    case Reader::Event::Comment:
+                        type = Type::Comment;
+                        value = reader.getValue().toString();
+                        break;
+                    case Reader::Event::TypeDeclaration:
+                        type = Type::TypeDeclaration;
+                        value = reader.getValue().toString();
+                        break;
+                    default:
+                        throw ParseError("Unexpected end of data");
                 }
             }
 
@@ -647,43 +762,21 @@ namespace ouzel
                  bool preserveComments = false,
                  bool preserveProcessingInstructions = false)
             {
-                std::u32string str;
-
-                // BOM
-                if (data.size() >= 3 &&
-                    std::equal(data.begin(), data.begin() + 3,
-                               std::begin(UTF8_BOM), std::end(UTF8_BOM)))
-                {
-                    bom = true;
-                    str = utf8::toUtf32(data.begin() + 3, data.end());
-                }
-                else
-                {
-                    bom = false;
-                    str = utf8::toUtf32(data);
-                }
+                Reader reader(data, preserveWhitespaces);
+                bom = reader.hasBOM();
 
                 bool rootTagFound = false;
 
-                auto iterator = str.cbegin();
-
-                for (;;)
+                while (reader.next() != Reader::Event::End)
                 {
-                    if (!preserveWhitespaces) skipWhitespaces(iterator, str.end());
-
-                    if (iterator == str.end()) break;
-
                     Node node;
-                    node.parse(iterator, str.end(),
-                               preserveWhitespaces,
-                               preserveComments,
-                               preserveProcessingInstructions);
+                    node.parse(reader, preserveComments, preserveProcessingInstructions);
 
+                    // type declarations are skipped, because they can not be encoded
                     if ((preserveComments || node.getType() != Node::Type::Comment) &&
-                        (preserveProcessingInstructions || node.getType() != Node::Type::ProcessingInstruction))
+                        (preserveProcessingInstructions || node.getType() != Node::Type::ProcessingInstruction) &&
+                        node.getType() != Node::Type::TypeDeclaration)
                     {
-                        children.push_back(node);
-
                         if (node.getType() == Node::Type::Tag)
                         {
                             if (rootTagFound)
@@ -691,6 +784,8 @@ namespace ouzel
                             else
                                 rootTagFound = true;
                         }
+
+                        children.push_back(std::move(node));
                     }
                 }
 
@@ -719,6 +814,209 @@ namespace ouzel
             bool bom = false;
             std::vector<Node> children;
         };
+
+        // Read-only tree that keeps all of the nodes in one array, with the children of each
+        // element stored next to each other, names and values point into the source data
+        class Document final
+        {
+            struct Entry final
+            {
+                Node::Type type = Node::Type::Text;
+                StringView value; // tag name or contents
+                std::size_t firstChild = 0;
+                std::size_t childCount = 0;
+                std::size_t firstAttribute = 0;
+                std::size_t attributeCount = 0;
+            };
+
+        public:
+            class Element;
+
+            class Iterator final
+            {
+            public:
+                Iterator(const Document* initDocument, std::size_t initIndex) noexcept:
+                    document(initDocument), index(initIndex)
+                {
+                }
+
+                inline Element operator*() const noexcept { return Element(document, index); }
+                inline Iterator& operator++() noexcept { ++index; return *this; }
+                inline bool operator==(const Iterator& other) const noexcept { return index == other.index; }
+                inline bool operator!=(const Iterator& other) const noexcept { return index != other.index; }
+
+            private:
+                const Document* document = nullptr;
+                std::size_t index = 0;
+            };
+
+            class Element final
+            {
+            public:
+                Element(const Document* initDocument, std::size_t initIndex) noexcept:
+                    document(initDocument), entry(&initDocument->entries[initIndex])
+                {
+                }
+
+                inline auto getType() const noexcept { return entry->type; }
+
+                // tag name for elements and contents for the other nodes
+                inline auto& getValue() const noexcept { return entry->value; }
+
+                inline auto getAttributeCount() const noexcept { return entry->attributeCount; }
+
+                inline auto& getAttribute(std::size_t index) const noexcept
+                {
+                    return document->attributes[entry->firstAttribute + index];
+                }
+
+                inline bool hasAttribute(const std::string& name) const noexcept
+                {
+                    return findAttribute(name) != nullptr;
+                }
+
+                // returns an empty string if the attribute does not exist
+                inline StringView getAttribute(const std::string& name) const noexcept
+                {
+                    const Reader::Attribute* attribute = findAttribute(name);
+                    return attribute ? attribute->value : StringView();
+                }
+
+                inline auto getChildCount() const noexcept { return entry->childCount; }
+
+                Iterator begin() const noexcept { return Iterator(document, entry->firstChild); }
+                Iterator end() const noexcept { return Iterator(document, entry->firstChild + entry->childCount); }
+
+            private:
+                const Reader::Attribute* findAttribute(const std::string& name) const noexcept
+                {
+                    for (std::size_t i = 0; i < entry->attributeCount; ++i)
+                        if (document->attributes[entry->firstAttribute + i].name == name)
+                            return &document->attributes[entry->firstAttribute + i];
+
+                    return nullptr;
+                }
+
+                const Document* document = nullptr;
+                const Entry* entry = nullptr;
+            };
+
+            explicit Document(std::vector<std::uint8_t> initData,
+                              bool preserveWhitespaces = false,
+                              bool preserveComments = false,
+                              bool preserveProcessingInstructions = false):
+                data(std::move(initData))
+            {
+                Reader reader(data, preserveWhitespaces);
+                bom = reader.hasBOM();
+
+                std::vector<Entry> pending; // nodes whose parents are not finished yet
+                std::vector<std::size_t> scopes; // positions of the unfinished elements in pending
+
+                for (;;)
+                {
+                    Entry entry;
+
+                    switch (reader.next())
+                    {
+                        case Reader::Event::End:
+                        {
+                            std::size_t rootIndex = pending.size();
+                            for (std::size_t i = 0; i < pending.size(); ++i)
+                                if (pending[i].type == Node::Type::Tag)
+                                {
+                                    if (rootIndex != pending.size())
+                                        throw ParseError("Multiple root tags found");
+                                    rootIndex = i;
+                                }
+
+                            if (rootIndex == pending.size())
+                                throw ParseError("No root tag found");
+
+                            root = entries.size() + rootIndex;
+                            entries.insert(entries.end(), pending.begin(), pending.end());
+                            return;
+                        }
+                        case Reader::Event::StartElement:
+                            entry.type = Node::Type::Tag;
+                            entry.value = reader.getName();
+                            storeAttributes(reader, entry);
+                            scopes.push_back(pending.size());
+                            break;
+                        case Reader::Event::EndElement:
+                        {
+                            // move the children to the final array, the element itself stays pending
+                            const std::size_t scope = scopes.back();
+                            scopes.pop_back();
+
+                            pending[scope].firstChild = entries.size();
+                            pending[scope].childCount = pending.size() - scope - 1;
+                            entries.insert(entries.end(), pending.begin() + static_cast<std::ptrdiff_t>(scope) + 1, pending.end());
+                            pending.resize(scope + 1);
+                            continue;
+                        }
+                        case Reader::Event::ProcessingInstruction:
+                            if (!preserveProcessingInstructions) continue;
+                            entry.type = Node::Type::ProcessingInstruction;
+                            entry.value = reader.getName();
+                            storeAttributes(reader, entry);
+                            break;
+                        case Reader::Event::Comment:
+                            if (!preserveComments) continue;
+                            entry.type = Node::Type::Comment;
+                            entry.value = reader.getValue();
+                            break;
+                        case Reader::Event::TypeDeclaration:
+                            continue;
+                        case Reader::Event::Text:
+                            entry.type = Node::Type::Text;
+                            entry.value = storeString(reader, reader.getValue());
+                            break;
+                        case Reader::Event::CData:
+                            entry.type = Node::Type::CData;
+                            entry.value = reader.getValue();
+                            break;
+                    }
+
+                    pending.push_back(entry);
+                }
+            }
+
+            // names and values point into the owned buffers, which stay in place when moved
+            Document(const Document&) = delete;
+            Document& operator=(const Document&) = delete;
+            Document(Document&&) = default;
+            Document& operator=(Document&&) = default;
+
+            inline Element getRoot() const noexcept { return Element(this, root); }
+            inline bool hasBOM() const noexcept { return bom; }
+
+        private:
+            StringView storeString(const Reader& reader, const StringView& view)
+            {
+                if (!reader.isDecoded(view)) return view;
+
+                // only the values with entities are copied out of the reader
+                decodedStrings.emplace_back(view.data, view.length);
+                return StringView{decodedStrings.back().data(), view.length};
+            }
+
+            void storeAttributes(const Reader& reader, Entry& entry)
+            {
+                entry.firstAttribute = attributes.size();
+                entry.attributeCount = reader.getAttributes().size();
+
+                for (const Reader::Attribute& attribute : reader.getAttributes())
+                    attributes.push_back(Reader::Attribute{attribute.name, storeString(reader, attribute.value)});
+            }
+
+            std::vector<std::uint8_t> data;
+            std::vector<Entry> entries;
+            std::vector<Reader::Attribute> attributes;
+            std::deque<std::string> decodedStrings;
+            std::size_t root = 0;
+            bool bom = false;
+        };
     } // namespace xml
 } // namespace ouzel
 
@@ -0,0 +1,29 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+cbuffer Constants: register(b0)
+{
+    float4x4 viewProjection;
+};
+
+struct VSInput
+{
+    float3 position: POSITION;
+    float4 color: COLOR;
+    float2 texCoord0: TEXCOORD0;
+    float4x4 instanceTransform: INSTANCETRANSFORM;
+    float4 instanceColor: INSTANCECOLOR;
+};
+
+struct VS2PS
+{
+    float4 position: SV_POSITION;
+    float4 color: COLOR;
+    float2 texCoord: TEXCOORD;
+};
+
+void main(in VSInput input, out VS2PS output)
+{
+    output.position = mul(viewProjection, mul(input.instanceTransform, float4(input.position, 1)));
+    output.color = input.color * input.instanceColor;
+    output.texCoord = input.texCoord0;
+}
@@ -1,5 +1,6 @@
 fxc /Zi /E"main" /Od /Fh"TexturePSD3D11.h" /Vn"TEXTURE_PIXEL_SHADER_D3D11" /T ps_4_0_level_9_1 /nologo TexturePS.hlsl
 fxc /Zi /E"main" /Od /Fh"TextureVSD3D11.h" /Vn"TEXTURE_VERTEX_SHADER_D3D11" /T vs_4_0_level_9_1 /nologo TextureVS.hlsl
+fxc /Zi /E"main" /Od /Fh"TextureInstancedVSD3D11.h" /Vn"TEXTURE_INSTANCED_VERTEX_SHADER_D3D11" /T vs_4_0_level_9_3 /nologo TextureInstancedVS.hlsl
 
 fxc /Zi /E"main" /Od /Fh"ColorPSD3D11.h" /Vn"COLOR_PIXEL_SHADER_D3D11" /T ps_4_0_level_9_1 /nologo ColorPS.hlsl
 fxc /Zi /E"main" /Od /Fh"ColorVSD3D11.h" /Vn"COLOR_VERTEX_SHADER_D3D11" /T vs_4_0_level_9_1 /nologo ColorVS.hlsl
\ No newline at end of file
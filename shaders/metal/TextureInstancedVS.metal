@@ -0,0 +1,45 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#include <simd/simd.h>
+
+using namespace metal;
+
+typedef struct
+{
+    float4x4 viewProjection;
+} uniforms_t;
+
+typedef struct
+{
+    float3 position [[attribute(0)]];
+    half4 color [[attribute(1)]];
+    float2 texCoord [[attribute(2)]];
+    float4 instanceTransform0 [[attribute(3)]];
+    float4 instanceTransform1 [[attribute(4)]];
+    float4 instanceTransform2 [[attribute(5)]];
+    float4 instanceTransform3 [[attribute(6)]];
+    half4 instanceColor [[attribute(7)]];
+} VSInput;
+
+typedef struct
+{
+    float4 position [[position]];
+    half4 color;
+    float2 texCoord;
+} VS2PS;
+
+// Vertex shader function
+vertex VS2PS mainVS(VSInput input [[stage_in]],
+                    constant uniforms_t& uniforms [[buffer(1)]])
+{
+    const float4x4 instanceTransform(input.instanceTransform0,
+                                     input.instanceTransform1,
+                                     input.instanceTransform2,
+                                     input.instanceTransform3);
+
+    VS2PS output;
+    output.position = uniforms.viewProjection * instanceTransform * float4(input.position, 1.0);
+    output.color = input.color * input.instanceColor;
+    output.texCoord = input.texCoord;
+    return output;
+}
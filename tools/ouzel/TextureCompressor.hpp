@@ -0,0 +1,396 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_TEXTURECOMPRESSOR_HPP
+#define OUZEL_TEXTURECOMPRESSOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "storage/Path.hpp"
+#include "stb_image.h"
+
+namespace ouzel
+{
+    enum class TextureCompression
+    {
+        BC1,
+        BC3
+    };
+
+    class TextureCompressor final
+    {
+    public:
+        explicit TextureCompressor(TextureCompression initCompression):
+            compression{initCompression}
+        {
+        }
+
+        void compress(const storage::Path& inputPath,
+                      const storage::Path& outputPath,
+                      bool mipmaps = true) const
+        {
+            int width;
+            int height;
+            int comp;
+
+            const std::string input = inputPath;
+            stbi_uc* data = stbi_load(input.c_str(), &width, &height, &comp, STBI_rgb_alpha);
+
+            if (!data)
+                throw std::runtime_error("Failed to load " + input + ", reason: " + stbi_failure_reason());
+
+            Image image{static_cast<std::uint32_t>(width),
+                static_cast<std::uint32_t>(height),
+                std::vector<std::uint8_t>(data, data + static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4)};
+            stbi_image_free(data);
+
+            std::vector<std::vector<std::uint8_t>> levels;
+            levels.push_back(encode(image));
+
+            while (mipmaps && (image.width > 1 || image.height > 1))
+            {
+                image = downsample(image);
+                levels.push_back(encode(image));
+            }
+
+            writeDds(outputPath, static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), levels);
+        }
+
+    private:
+        struct Image final
+        {
+            std::uint32_t width;
+            std::uint32_t height;
+            std::vector<std::uint8_t> pixels; // RGBA8
+        };
+
+        using Block = std::array<std::array<std::uint8_t, 4>, 16>;
+
+        static Image downsample(const Image& image)
+        {
+            Image result{std::max(image.width / 2, 1U), std::max(image.height / 2, 1U), {}};
+            result.pixels.resize(result.width * result.height * 4);
+
+            for (std::uint32_t y = 0; y < result.height; ++y)
+                for (std::uint32_t x = 0; x < result.width; ++x)
+                {
+                    const std::uint32_t x0 = std::min(x * 2, image.width - 1);
+                    const std::uint32_t x1 = std::min(x * 2 + 1, image.width - 1);
+                    const std::uint32_t y0 = std::min(y * 2, image.height - 1);
+                    const std::uint32_t y1 = std::min(y * 2 + 1, image.height - 1);
+
+                    for (std::uint32_t c = 0; c < 4; ++c)
+                    {
+                        const std::uint32_t sum = image.pixels[(y0 * image.width + x0) * 4 + c] +
+                            image.pixels[(y0 * image.width + x1) * 4 + c] +
+                            image.pixels[(y1 * image.width + x0) * 4 + c] +
+                            image.pixels[(y1 * image.width + x1) * 4 + c];
+                        result.pixels[(y * result.width + x) * 4 + c] = static_cast<std::uint8_t>((sum + 2) / 4);
+                    }
+                }
+
+            return result;
+        }
+
+        std::vector<std::uint8_t> encode(const Image& image) const
+        {
+            const std::uint32_t blocksX = (image.width + 3) / 4;
+            const std::uint32_t blocksY = (image.height + 3) / 4;
+            const std::size_t blockSize = (compression == TextureCompression::BC1) ? 8 : 16;
+
+            std::vector<std::uint8_t> result(blocksX * blocksY * blockSize);
+            std::uint8_t* output = result.data();
+
+            for (std::uint32_t blockY = 0; blockY < blocksY; ++blockY)
+                for (std::uint32_t blockX = 0; blockX < blocksX; ++blockX)
+                {
+                    // edge blocks of non-multiple-of-four levels repeat the last row and column
+                    Block block;
+                    for (std::uint32_t y = 0; y < 4; ++y)
+                        for (std::uint32_t x = 0; x < 4; ++x)
+                        {
+                            const std::uint32_t pixelX = std::min(blockX * 4 + x, image.width - 1);
+                            const std::uint32_t pixelY = std::min(blockY * 4 + y, image.height - 1);
+                            const std::uint8_t* pixel = &image.pixels[(pixelY * image.width + pixelX) * 4];
+                            block[y * 4 + x] = {pixel[0], pixel[1], pixel[2], pixel[3]};
+                        }
+
+                    if (compression == TextureCompression::BC1)
+                        encodeColorBlock(block, true, output);
+                    else
+                    {
+                        encodeAlphaBlock(block, output);
+                        encodeColorBlock(block, false, output + 8);
+                    }
+
+                    output += blockSize;
+                }
+
+            return result;
+        }
+
+        static std::uint16_t packColor(const float color[3]) noexcept
+        {
+            const auto r = static_cast<std::uint16_t>(std::min(std::max(color[0], 0.0F), 255.0F) * 31.0F / 255.0F + 0.5F);
+            const auto g = static_cast<std::uint16_t>(std::min(std::max(color[1], 0.0F), 255.0F) * 63.0F / 255.0F + 0.5F);
+            const auto b = static_cast<std::uint16_t>(std::min(std::max(color[2], 0.0F), 255.0F) * 31.0F / 255.0F + 0.5F);
+            return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        static void unpackColor(std::uint16_t color, std::int32_t result[3]) noexcept
+        {
+            const std::int32_t r = (color >> 11) & 0x1F;
+            const std::int32_t g = (color >> 5) & 0x3F;
+            const std::int32_t b = color & 0x1F;
+            result[0] = (r << 3) | (r >> 2);
+            result[1] = (g << 2) | (g >> 4);
+            result[2] = (b << 3) | (b >> 2);
+        }
+
+        // fits the endpoints to the extent of the block's colors along their principal axis
+        static void encodeColorBlock(const Block& block, bool punchThroughAlpha, std::uint8_t* output) noexcept
+        {
+            bool transparent[16];
+            bool hasTransparent = false;
+            float mean[3] = {0.0F, 0.0F, 0.0F};
+            std::uint32_t count = 0;
+
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                transparent[i] = punchThroughAlpha && block[i][3] < 128;
+                hasTransparent |= transparent[i];
+                if (transparent[i]) continue;
+
+                for (std::size_t c = 0; c < 3; ++c) mean[c] += block[i][c];
+                ++count;
+            }
+
+            if (count == 0)
+            {
+                // fully transparent block, both endpoints black and all indices 3
+                std::fill(output, output + 4, 0);
+                std::fill(output + 4, output + 8, 0xFF);
+                return;
+            }
+
+            for (float& m : mean) m /= static_cast<float>(count);
+
+            float covariance[6] = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                if (transparent[i]) continue;
+
+                const float r = block[i][0] - mean[0];
+                const float g = block[i][1] - mean[1];
+                const float b = block[i][2] - mean[2];
+                covariance[0] += r * r;
+                covariance[1] += r * g;
+                covariance[2] += r * b;
+                covariance[3] += g * g;
+                covariance[4] += g * b;
+                covariance[5] += b * b;
+            }
+
+            float axis[3] = {1.0F, 1.0F, 1.0F};
+            for (std::uint32_t iteration = 0; iteration < 8; ++iteration)
+            {
+                const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+                const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+                const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+                const float length = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+                if (length <= 0.0F) break;
+                axis[0] = x / length;
+                axis[1] = y / length;
+                axis[2] = z / length;
+            }
+
+            float minProjection = std::numeric_limits<float>::max();
+            float maxProjection = std::numeric_limits<float>::lowest();
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                if (transparent[i]) continue;
+
+                const float projection = (block[i][0] - mean[0]) * axis[0] +
+                    (block[i][1] - mean[1]) * axis[1] +
+                    (block[i][2] - mean[2]) * axis[2];
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+
+            const float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            float minColor[3];
+            float maxColor[3];
+            for (std::size_t c = 0; c < 3; ++c)
+            {
+                const float scale = (axisLengthSquared > 0.0F) ? axis[c] / axisLengthSquared : 0.0F;
+                minColor[c] = mean[c] + minProjection * scale;
+                maxColor[c] = mean[c] + maxProjection * scale;
+            }
+
+            std::uint16_t color0 = packColor(maxColor);
+            std::uint16_t color1 = packColor(minColor);
+
+            // four color mode requires color0 > color1, three color mode with transparency requires color0 <= color1
+            if (hasTransparent ? color0 > color1 : color0 < color1)
+                std::swap(color0, color1);
+
+            std::int32_t palette[4][3];
+            unpackColor(color0, palette[0]);
+            unpackColor(color1, palette[1]);
+
+            const bool fourColors = color0 > color1;
+            for (std::size_t c = 0; c < 3; ++c)
+                if (fourColors)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                else
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+
+            const std::uint32_t paletteSize = fourColors ? 4 : 3;
+            std::uint32_t indices = 0;
+
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                std::uint32_t bestIndex = 3;
+
+                if (!transparent[i])
+                {
+                    std::int32_t bestDistance = std::numeric_limits<std::int32_t>::max();
+                    for (std::uint32_t p = 0; p < paletteSize; ++p)
+                    {
+                        const std::int32_t r = block[i][0] - palette[p][0];
+                        const std::int32_t g = block[i][1] - palette[p][1];
+                        const std::int32_t b = block[i][2] - palette[p][2];
+                        const std::int32_t distance = r * r + g * g + b * b;
+                        if (distance < bestDistance)
+                        {
+                            bestDistance = distance;
+                            bestIndex = p;
+                        }
+                    }
+                }
+
+                indices |= bestIndex << (i * 2);
+            }
+
+            output[0] = static_cast<std::uint8_t>(color0);
+            output[1] = static_cast<std::uint8_t>(color0 >> 8);
+            output[2] = static_cast<std::uint8_t>(color1);
+            output[3] = static_cast<std::uint8_t>(color1 >> 8);
+            output[4] = static_cast<std::uint8_t>(indices);
+            output[5] = static_cast<std::uint8_t>(indices >> 8);
+            output[6] = static_cast<std::uint8_t>(indices >> 16);
+            output[7] = static_cast<std::uint8_t>(indices >> 24);
+        }
+
+        static void encodeAlphaBlock(const Block& block, std::uint8_t* output) noexcept
+        {
+            std::uint8_t alpha0 = 0;
+            std::uint8_t alpha1 = 255;
+
+            for (const auto& pixel : block)
+            {
+                alpha0 = std::max(alpha0, pixel[3]);
+                alpha1 = std::min(alpha1, pixel[3]);
+            }
+
+            // eight value mode (alpha0 > alpha1) interpolates six values between the extremes
+            std::int32_t palette[8];
+            palette[0] = alpha0;
+            palette[1] = alpha1;
+            for (std::int32_t i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+
+            std::uint64_t indices = 0;
+
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                std::uint64_t bestIndex = 0;
+                std::int32_t bestDistance = std::numeric_limits<std::int32_t>::max();
+
+                for (std::uint32_t p = 0; p < 8; ++p)
+                {
+                    const std::int32_t distance = std::abs(block[i][3] - palette[p]);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        bestIndex = p;
+                    }
+                }
+
+                indices |= bestIndex << (i * 3);
+            }
+
+            output[0] = alpha0;
+            output[1] = alpha1;
+            for (std::size_t i = 0; i < 6; ++i)
+                output[2 + i] = static_cast<std::uint8_t>(indices >> (i * 8));
+        }
+
+        void writeDds(const storage::Path& outputPath,
+                      std::uint32_t width, std::uint32_t height,
+                      const std::vector<std::vector<std::uint8_t>>& levels) const
+        {
+            constexpr std::uint32_t DDSD_CAPS = 0x1;
+            constexpr std::uint32_t DDSD_HEIGHT = 0x2;
+            constexpr std::uint32_t DDSD_WIDTH = 0x4;
+            constexpr std::uint32_t DDSD_PIXELFORMAT = 0x1000;
+            constexpr std::uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+            constexpr std::uint32_t DDSD_LINEARSIZE = 0x80000;
+            constexpr std::uint32_t DDPF_FOURCC = 0x4;
+            constexpr std::uint32_t DDSCAPS_COMPLEX = 0x8;
+            constexpr std::uint32_t DDSCAPS_TEXTURE = 0x1000;
+            constexpr std::uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+            std::vector<std::uint8_t> header(128, 0);
+            auto put = [&header](std::size_t offset, std::uint32_t value) noexcept {
+                for (std::size_t i = 0; i < 4; ++i)
+                    header[offset + i] = static_cast<std::uint8_t>(value >> (i * 8));
+            };
+
+            const auto mipMapCount = static_cast<std::uint32_t>(levels.size());
+
+            header[0] = 'D'; header[1] = 'D'; header[2] = 'S'; header[3] = ' ';
+            put(4, 124);
+            put(8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE |
+                (mipMapCount > 1 ? DDSD_MIPMAPCOUNT : 0));
+            put(12, height);
+            put(16, width);
+            put(20, static_cast<std::uint32_t>(levels.front().size()));
+            put(28, mipMapCount);
+            put(76, 32);
+            put(80, DDPF_FOURCC);
+            header[84] = 'D'; header[85] = 'X'; header[86] = 'T';
+            header[87] = (compression == TextureCompression::BC1) ? '1' : '5';
+            put(108, DDSCAPS_TEXTURE | (mipMapCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+
+            const std::string output = outputPath;
+            std::ofstream file(output, std::ios::binary | std::ios::trunc);
+
+            if (!file)
+                throw std::runtime_error("Failed to open " + output);
+
+            file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+            for (const auto& level : levels)
+                file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+
+            if (!file)
+                throw std::runtime_error("Failed to write " + output);
+        }
+
+        TextureCompression compression;
+    };
+}
+
+#endif // OUZEL_TEXTURECOMPRESSOR_HPP
@@ -0,0 +1,307 @@
+// Copyright 2015-2020 Elviss Strazdins. All rights reserved.
+
+#ifndef OUZEL_TRACEDECODER_HPP
+#define OUZEL_TRACEDECODER_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "storage/Path.hpp"
+#include "utils/Trace.hpp"
+
+namespace ouzel
+{
+    enum class TraceFormat
+    {
+        Csv,
+        Json
+    };
+
+    // Converts binary trace files written by Logger::startTrace to text
+    class TraceDecoder final
+    {
+    public:
+        explicit TraceDecoder(const storage::Path& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+                throw std::runtime_error("Failed to open " + std::string(path));
+
+            const std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+            if (data.size() < trace::headerSize ||
+                read<std::uint32_t>(data, 0) != trace::magic)
+                throw std::runtime_error("Not a trace file");
+
+            if (read<std::uint16_t>(data, 4) != trace::version)
+                throw std::runtime_error("Unsupported trace file version");
+
+            const auto startTime = read<std::uint64_t>(data, 6);
+
+            // a file that was not closed properly ends with zeros or a partial record
+            std::size_t offset = trace::headerSize;
+            while (offset + trace::recordHeaderSize <= data.size())
+            {
+                const auto id = read<std::uint16_t>(data, offset);
+                if (id == 0) break;
+
+                const auto timestamp = read<std::uint64_t>(data, offset + 2);
+                offset += trace::recordHeaderSize;
+
+                if (id == trace::schemaId)
+                {
+                    std::uint16_t eventId;
+                    Event event;
+                    if (!readSchema(data, offset, eventId, event)) break;
+                    events[eventId] = std::move(event);
+                }
+                else
+                {
+                    const auto i = events.find(id);
+                    if (i == events.end())
+                        throw std::runtime_error("Undefined trace event " + std::to_string(id));
+
+                    if (offset + i->second.size > data.size()) break;
+
+                    Record record;
+                    record.event = id;
+                    record.time = static_cast<std::int64_t>(timestamp - startTime);
+                    record.fields.assign(data.begin() + static_cast<std::ptrdiff_t>(offset),
+                                         data.begin() + static_cast<std::ptrdiff_t>(offset + i->second.size));
+                    records.push_back(std::move(record));
+
+                    offset += i->second.size;
+                }
+            }
+        }
+
+        inline auto getRecordCount() const noexcept { return records.size(); }
+
+        void decode(const storage::Path& outputPath, TraceFormat format) const
+        {
+            std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+                throw std::runtime_error("Failed to open " + std::string(outputPath));
+
+            if (format == TraceFormat::Csv)
+                writeCsv(file);
+            else
+                writeJson(file);
+
+            if (!file)
+                throw std::runtime_error("Failed to write " + std::string(outputPath));
+        }
+
+    private:
+        struct Event final
+        {
+            trace::Schema schema;
+            std::size_t size = 0;
+        };
+
+        struct Record final
+        {
+            std::uint16_t event;
+            std::int64_t time; // nanoseconds since the start of the trace
+            std::vector<char> fields;
+        };
+
+        template <class T>
+        static T read(const std::vector<char>& data, std::size_t offset)
+        {
+            T result;
+            std::memcpy(&result, data.data() + offset, sizeof(result));
+            return result;
+        }
+
+        static bool readName(const std::vector<char>& data, std::size_t& offset, std::string& name)
+        {
+            if (offset + 1 > data.size()) return false;
+            const std::size_t length = static_cast<std::uint8_t>(data[offset++]);
+            if (offset + length > data.size()) return false;
+
+            name.assign(data.data() + offset, length);
+            offset += length;
+            return true;
+        }
+
+        static bool readSchema(const std::vector<char>& data, std::size_t& offset,
+                               std::uint16_t& eventId, Event& event)
+        {
+            if (offset + 2 > data.size()) return false;
+            eventId = read<std::uint16_t>(data, offset);
+            offset += 2;
+
+            if (!readName(data, offset, event.schema.name)) return false;
+            if (offset + 1 > data.size()) return false;
+            const std::size_t fieldCount = static_cast<std::uint8_t>(data[offset++]);
+
+            for (std::size_t i = 0; i < fieldCount; ++i)
+            {
+                if (offset + 1 > data.size()) return false;
+
+                trace::Field field;
+                field.type = static_cast<trace::FieldType>(data[offset++]);
+                if (!readName(data, offset, field.name)) return false;
+
+                event.size += trace::getFieldSize(field.type);
+                event.schema.fields.push_back(std::move(field));
+            }
+
+            return true;
+        }
+
+        // non-finite numbers are written as null in JSON
+        static std::string formatField(trace::FieldType type, const char* data, bool json = false)
+        {
+            char buffer[32];
+            std::int64_t i = 0;
+            std::uint64_t u = 0;
+
+            switch (type)
+            {
+                case trace::FieldType::Int8: { std::int8_t v; std::memcpy(&v, data, sizeof(v)); i = v; break; }
+                case trace::FieldType::Int16: { std::int16_t v; std::memcpy(&v, data, sizeof(v)); i = v; break; }
+                case trace::FieldType::Int32: { std::int32_t v; std::memcpy(&v, data, sizeof(v)); i = v; break; }
+                case trace::FieldType::Int64: { std::memcpy(&i, data, sizeof(i)); break; }
+                case trace::FieldType::UInt8: { std::uint8_t v; std::memcpy(&v, data, sizeof(v)); return std::to_string(v); }
+                case trace::FieldType::UInt16: { std::uint16_t v; std::memcpy(&v, data, sizeof(v)); return std::to_string(v); }
+                case trace::FieldType::UInt32: { std::uint32_t v; std::memcpy(&v, data, sizeof(v)); return std::to_string(v); }
+                case trace::FieldType::UInt64: { std::memcpy(&u, data, sizeof(u)); return std::to_string(u); }
+                case trace::FieldType::Float:
+                {
+                    float v;
+                    std::memcpy(&v, data, sizeof(v));
+                    if (json && !std::isfinite(v)) return "null";
+                    std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(v));
+                    return buffer;
+                }
+                case trace::FieldType::Double:
+                {
+                    double v;
+                    std::memcpy(&v, data, sizeof(v));
+                    if (json && !std::isfinite(v)) return "null";
+                    std::snprintf(buffer, sizeof(buffer), "%.17g", v);
+                    return buffer;
+                }
+                default: throw std::runtime_error("Invalid field type");
+            }
+
+            return std::to_string(i);
+        }
+
+        static std::string escapeCsv(const std::string& str)
+        {
+            if (str.find_first_of(",\"\n") == std::string::npos) return str;
+
+            std::string result = "\"";
+            for (const char c : str)
+            {
+                if (c == '"') result += '"';
+                result += c;
+            }
+            return result + "\"";
+        }
+
+        static std::string escapeJson(const std::string& str)
+        {
+            std::string result = "\"";
+            for (const char c : str)
+            {
+                if (c == '"' || c == '\\') result += '\\';
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    result += buffer;
+                }
+                else
+                    result += c;
+            }
+            return result + "\"";
+        }
+
+        // one column per distinct field name, fields that an event does not have are left empty
+        void writeCsv(std::ostream& output) const
+        {
+            std::vector<std::string> columns;
+            std::map<std::string, std::size_t> columnIndices;
+            std::map<std::uint16_t, std::vector<std::size_t>> eventColumns;
+
+            for (const auto& event : events)
+                for (const trace::Field& field : event.second.schema.fields)
+                {
+                    auto result = columnIndices.insert(std::make_pair(field.name, columns.size()));
+                    if (result.second) columns.push_back(field.name);
+                    eventColumns[event.first].push_back(result.first->second);
+                }
+
+            output << "timestamp,event";
+            for (const std::string& column : columns)
+                output << ',' << escapeCsv(column);
+            output << '\n';
+
+            std::vector<std::string> values(columns.size());
+
+            for (const Record& record : records)
+            {
+                const Event& event = events.at(record.event);
+                const auto& indices = eventColumns[record.event];
+
+                for (std::string& value : values) value.clear();
+
+                std::size_t offset = 0;
+                for (std::size_t i = 0; i < event.schema.fields.size(); ++i)
+                {
+                    const trace::FieldType type = event.schema.fields[i].type;
+                    values[indices[i]] = formatField(type, record.fields.data() + offset);
+                    offset += trace::getFieldSize(type);
+                }
+
+                output << record.time << ',' << escapeCsv(event.schema.name);
+                for (const std::string& value : values)
+                    output << ',' << value;
+                output << '\n';
+            }
+        }
+
+        void writeJson(std::ostream& output) const
+        {
+            output << '[';
+
+            bool first = true;
+            for (const Record& record : records)
+            {
+                const Event& event = events.at(record.event);
+
+                output << (first ? "\n" : ",\n") << "{\"timestamp\":" << record.time <<
+                    ",\"event\":" << escapeJson(event.schema.name) << ",\"fields\":{";
+                first = false;
+
+                std::size_t offset = 0;
+                for (const trace::Field& field : event.schema.fields)
+                {
+                    output << (offset ? "," : "") << escapeJson(field.name) << ':' <<
+                        formatField(field.type, record.fields.data() + offset, true);
+                    offset += trace::getFieldSize(field.type);
+                }
+
+                output << "}}";
+            }
+
+            output << "\n]\n";
+        }
+
+        std::map<std::uint16_t, Event> events;
+        std::vector<Record> records;
+    };
+}
+
+#endif // OUZEL_TRACEDECODER_HPP
@@ -6,10 +6,40 @@
 #include <stdexcept>
 #include "storage/Path.hpp"
 #include "Project.hpp"
+#include "TextureCompressor.hpp"
+#include "TraceDecoder.hpp"
 #include "makefile/BuildSystem.hpp"
 #include "visualstudio/BuildSystem.hpp"
 #include "xcode/BuildSystem.hpp"
 
+#if defined(_MSC_VER)
+#  pragma warning( push )
+#  pragma warning( disable : 4100 )
+#  pragma warning( disable : 4505 )
+#elif defined(__GNUC__)
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wconversion"
+#  pragma GCC diagnostic ignored "-Wdouble-promotion"
+#  pragma GCC diagnostic ignored "-Wold-style-cast"
+#  pragma GCC diagnostic ignored "-Wsign-conversion"
+#  pragma GCC diagnostic ignored "-Wunused-function"
+#  pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#define STBI_NO_PSD
+#define STBI_NO_HDR
+#define STBI_NO_PIC
+#define STBI_NO_GIF
+#define STBI_NO_PNM
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#if defined(_MSC_VER)
+#  pragma warning( pop )
+#elif defined(__GNUC__)
+#  pragma GCC diagnostic pop
+#endif
+
 enum class ProjectType
 {
     Makefile,
@@ -25,13 +55,20 @@ int main(int argc, const char* argv[])
         {
             None,
             GenerateProject,
-            ExportAssets
+            ExportAssets,
+            CompressTexture,
+            DecodeTrace
         };
 
         Action action = Action::None;
         ouzel::storage::Path projectPath;
         std::set<ProjectType> projectTypes;
         std::string targetName;
+        ouzel::storage::Path texturePath;
+        ouzel::storage::Path outputPath;
+        ouzel::TextureCompression textureCompression = ouzel::TextureCompression::BC3;
+        ouzel::storage::Path tracePath;
+        ouzel::TraceFormat traceFormat = ouzel::TraceFormat::Csv;
 
         for (int i = 1; i < argc; ++i)
         {
@@ -41,7 +78,11 @@ int main(int argc, const char* argv[])
                 std::cout << argv[0] << " [--help] [--generate-project <project-file>]"
                     " [--project <all|makefile|visualstudio|xcode>]"
                     " [--export-assets <project-file>]\n"
-                    " [--target <target-name>]\n";
+                    " [--target <target-name>]\n"
+                    " [--compress-texture <image-file> <dds-file>]"
+                    " [--compression <bc1|bc3>]\n"
+                    " [--decode-trace <trace-file> <output-file>]"
+                    " [--trace-format <csv|json>]\n";
                 return EXIT_SUCCESS;
             }
             else if (std::string(argv[i]) == "--generate-project")
@@ -82,6 +123,50 @@ int main(int argc, const char* argv[])
 
                 projectPath = ouzel::storage::Path{argv[i], ouzel::storage::Path::Format::Native};
             }
+            else if (std::string(argv[i]) == "--compress-texture")
+            {
+                action = Action::CompressTexture;
+
+                if (i + 2 >= argc)
+                    throw std::runtime_error("Invalid command");
+
+                texturePath = ouzel::storage::Path{argv[++i], ouzel::storage::Path::Format::Native};
+                outputPath = ouzel::storage::Path{argv[++i], ouzel::storage::Path::Format::Native};
+            }
+            else if (std::string(argv[i]) == "--compression")
+            {
+                if (++i >= argc)
+                    throw std::runtime_error("Invalid command");
+
+                if (std::string(argv[i]) == "bc1")
+                    textureCompression = ouzel::TextureCompression::BC1;
+                else if (std::string(argv[i]) == "bc3")
+                    textureCompression = ouzel::TextureCompression::BC3;
+                else
+                    throw std::runtime_error("Invalid compression");
+            }
+            else if (std::string(argv[i]) == "--decode-trace")
+            {
+                action = Action::DecodeTrace;
+
+                if (i + 2 >= argc)
+                    throw std::runtime_error("Invalid command");
+
+                tracePath = ouzel::storage::Path{argv[++i], ouzel::storage::Path::Format::Native};
+                outputPath = ouzel::storage::Path{argv[++i], ouzel::storage::Path::Format::Native};
+            }
+            else if (std::string(argv[i]) == "--trace-format")
+            {
+                if (++i >= argc)
+                    throw std::runtime_error("Invalid command");
+
+                if (std::string(argv[i]) == "csv")
+                    traceFormat = ouzel::TraceFormat::Csv;
+                else if (std::string(argv[i]) == "json")
+                    traceFormat = ouzel::TraceFormat::Json;
+                else
+                    throw std::runtime_error("Invalid trace format");
+            }
             else if (std::string(argv[i]) == "--target")
             {
                 if (++i >= argc)
@@ -120,6 +205,18 @@ int main(int argc, const char* argv[])
                 project.exportAssets(targetName);
                 break;
             }
+            case Action::CompressTexture:
+            {
+                ouzel::TextureCompressor compressor(textureCompression);
+                compressor.compress(texturePath, outputPath);
+                break;
+            }
+            case Action::DecodeTrace:
+            {
+                const ouzel::TraceDecoder decoder(tracePath);
+                decoder.decode(outputPath, traceFormat);
+                break;
+            }
         }
     }
     catch (const std::exception& e)